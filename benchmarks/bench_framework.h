@@ -0,0 +1,168 @@
+#ifndef BENCH_FRAMEWORK_H
+#define BENCH_FRAMEWORK_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+template <typename T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+class Benchmark {
+  public:
+    struct Stats {
+        double meanNs = 0.0;
+        double stddevNs = 0.0;
+        double minNs = 0.0;
+        size_t iterations = 0;
+        size_t samples = 0;
+    };
+
+    explicit Benchmark(size_t samples, double minSampleMs)
+        : sampleCount(samples), minSampleNs(minSampleMs * 1e6) {}
+
+    // Times fn() in isolation. Iterations per sample are calibrated so that one
+    // sample lasts at least minSampleMs; each sample yields one ns/op figure.
+    template <typename Fn>
+    void measure(Fn&& fn) {
+        using Clock = std::chrono::steady_clock;
+
+        size_t iterations = 16;
+        for (;;) {
+            auto start = Clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+                fn();
+            double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            if (elapsed >= minSampleNs || iterations >= (size_t(1) << 30))
+                break;
+            iterations *= 2;
+        }
+
+        std::vector<double> perOp;
+        perOp.reserve(sampleCount);
+        for (size_t s = 0; s < sampleCount; ++s) {
+            auto start = Clock::now();
+            for (size_t i = 0; i < iterations; ++i)
+                fn();
+            double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            perOp.push_back(elapsed / static_cast<double>(iterations));
+        }
+
+        double sum = 0.0;
+        for (double v : perOp)
+            sum += v;
+        double mean = sum / perOp.size();
+        double var = 0.0;
+        for (double v : perOp)
+            var += (v - mean) * (v - mean);
+        var = perOp.size() > 1 ? var / (perOp.size() - 1) : 0.0;
+
+        result.meanNs = mean;
+        result.stddevNs = std::sqrt(var);
+        result.minNs = *std::min_element(perOp.begin(), perOp.end());
+        result.iterations = iterations;
+        result.samples = perOp.size();
+        measured = true;
+    }
+
+    bool hasResult() const {
+        return measured;
+    }
+    const Stats& stats() const {
+        return result;
+    }
+
+  private:
+    size_t sampleCount;
+    double minSampleNs;
+    bool measured = false;
+    Stats result;
+};
+
+class BenchmarkFramework {
+  public:
+    struct BenchmarkCase {
+        std::string name;
+        std::function<void(Benchmark&)> body;
+    };
+
+    static BenchmarkFramework& instance() {
+        static BenchmarkFramework instance;
+        return instance;
+    }
+
+    void addBenchmark(const std::string& name, std::function<void(Benchmark&)> body) {
+        benchmarks.push_back({name, body});
+    }
+
+    int runAll(int argc, char** argv) {
+        std::string filter;
+        size_t samples = 15;
+        double minSampleMs = 2.0;
+        for (int i = 1; i < argc; ++i) {
+            if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+                filter = argv[++i];
+            else if (std::strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+                samples = std::max(2, std::atoi(argv[++i]));
+            else if (std::strcmp(argv[i], "--sample-ms") == 0 && i + 1 < argc)
+                minSampleMs = std::max(0.1, std::atof(argv[++i]));
+        }
+
+        int failed = 0;
+        std::printf("%-28s %12s %12s %12s %8s\n", "Benchmark", "ns/op", "stddev", "min", "cv%");
+        std::printf("%s\n", std::string(76, '-').c_str());
+
+        for (const auto& bench : benchmarks) {
+            if (!filter.empty() && bench.name.find(filter) == std::string::npos)
+                continue;
+            Benchmark b(samples, minSampleMs);
+            try {
+                bench.body(b);
+            } catch (const std::exception& e) {
+                std::printf("%-28s FAILED: %s\n", bench.name.c_str(), e.what());
+                failed++;
+                continue;
+            }
+            if (!b.hasResult()) {
+                std::printf("%-28s FAILED: no measurement\n", bench.name.c_str());
+                failed++;
+                continue;
+            }
+            const auto& s = b.stats();
+            double cv = s.meanNs > 0.0 ? 100.0 * s.stddevNs / s.meanNs : 0.0;
+            std::printf("%-28s %12.2f %12.2f %12.2f %7.1f%%\n",
+                        bench.name.c_str(),
+                        s.meanNs,
+                        s.stddevNs,
+                        s.minNs,
+                        cv);
+        }
+        return failed;
+    }
+
+  private:
+    std::vector<BenchmarkCase> benchmarks;
+};
+
+#define BENCH_CASE(name)                                                                    \
+    static void bench_##name(Benchmark& bench);                                             \
+    static int dummy_##name = (BenchmarkFramework::instance().addBenchmark(#name, bench_##name), \
+                               0);                                                          \
+    static void bench_##name(Benchmark& bench)
+
+#endif
@@ -0,0 +1,439 @@
+#include <string>
+#include <vector>
+
+#include "bench_framework.h"
+#include "emulator8086.h"
+#include "instructions/arithmetic.h"
+#include "instructions/bit_manipulation.h"
+#include "instructions/data_transfer.h"
+#include "instructions/logical.h"
+#include "instructions/processor_control.h"
+#include "instructions/program_transfer.h"
+#include "instructions/string.h"
+
+// Each benchmark calls a single handler of the *Instructions classes directly with
+// pre-built operands, so tokenizing and dispatch are excluded from the numbers.
+namespace {
+
+struct HandlerFixture {
+    Emulator8086 emu;
+    DataTransferInstructions dataTransfer{&emu};
+    ArithmeticInstructions arithmetic{&emu};
+    LogicalInstructions logical{&emu};
+    StringInstructions string{&emu};
+    ProgramTransferInstructions programTransfer{&emu};
+    ProcessorControlInstructions processorControl{&emu};
+    BitManipulationInstructions bitManipulation{&emu};
+    Registers& regs = emu.getRegisters();
+
+    HandlerFixture() {
+        emu.loadProgram({"TARGET:", "NOP", "NOP", "NOP"});
+        regs.AX.x = 0x1234;
+        regs.BX.x = 0x0100;
+        regs.CX.x = 0x0002;
+        regs.DX.x = 0x0000;
+        regs.SI = 0x2000;
+        regs.DI = 0x4000;
+    }
+};
+
+constexpr uint16_t kRepCount = 256;
+
+}  // namespace
+
+BENCH_CASE(MovRegReg8) {
+    HandlerFixture f;
+    Operands ops{"AL", "BL"};
+    bench.measure([&] { f.dataTransfer.mov(ops); });
+}
+
+BENCH_CASE(MovRegReg16) {
+    HandlerFixture f;
+    Operands ops{"AX", "BX"};
+    bench.measure([&] { f.dataTransfer.mov(ops); });
+}
+
+BENCH_CASE(MovRegImm16) {
+    HandlerFixture f;
+    Operands ops{"AX", "1234h"};
+    bench.measure([&] { f.dataTransfer.mov(ops); });
+}
+
+BENCH_CASE(MovMemLoad8) {
+    HandlerFixture f;
+    Operands ops{"AL", "[BX+SI+10h]"};
+    bench.measure([&] { f.dataTransfer.mov(ops); });
+}
+
+BENCH_CASE(MovMemLoad16) {
+    HandlerFixture f;
+    Operands ops{"AX", "[BX+SI+10h]"};
+    bench.measure([&] { f.dataTransfer.mov(ops); });
+}
+
+BENCH_CASE(MovMemStore8) {
+    HandlerFixture f;
+    Operands ops{"[BX+DI]", "AL"};
+    bench.measure([&] { f.dataTransfer.mov(ops); });
+}
+
+BENCH_CASE(MovMemStore16) {
+    HandlerFixture f;
+    Operands ops{"[BX+DI]", "AX"};
+    bench.measure([&] { f.dataTransfer.mov(ops); });
+}
+
+BENCH_CASE(AddRegReg8) {
+    HandlerFixture f;
+    Operands ops{"AL", "BL"};
+    bench.measure([&] { f.arithmetic.add(ops); });
+    doNotOptimize(f.regs.FLAGS);
+}
+
+BENCH_CASE(AddRegReg16) {
+    HandlerFixture f;
+    Operands ops{"AX", "BX"};
+    bench.measure([&] { f.arithmetic.add(ops); });
+    doNotOptimize(f.regs.FLAGS);
+}
+
+BENCH_CASE(AddRegImm16) {
+    HandlerFixture f;
+    Operands ops{"AX", "7FFFh"};
+    bench.measure([&] { f.arithmetic.add(ops); });
+}
+
+BENCH_CASE(AddMemReg16) {
+    HandlerFixture f;
+    Operands ops{"[BX]", "AX"};
+    bench.measure([&] { f.arithmetic.add(ops); });
+}
+
+BENCH_CASE(IncReg8) {
+    HandlerFixture f;
+    Operands ops{"AL"};
+    bench.measure([&] { f.arithmetic.inc(ops); });
+}
+
+BENCH_CASE(IncReg16) {
+    HandlerFixture f;
+    Operands ops{"AX"};
+    bench.measure([&] { f.arithmetic.inc(ops); });
+}
+
+BENCH_CASE(CmpRegReg8) {
+    HandlerFixture f;
+    Operands ops{"AL", "BL"};
+    bench.measure([&] { f.logical.cmp(ops); });
+}
+
+BENCH_CASE(CmpRegReg16) {
+    HandlerFixture f;
+    Operands ops{"AX", "BX"};
+    bench.measure([&] { f.logical.cmp(ops); });
+}
+
+BENCH_CASE(XorRegReg16) {
+    HandlerFixture f;
+    Operands ops{"AX", "BX"};
+    bench.measure([&] { f.logical.xor_op(ops); });
+}
+
+BENCH_CASE(JccTaken) {
+    HandlerFixture f;
+    Operands ops{"TARGET"};
+    f.regs.FLAGS |= Registers::ZF;
+    bench.measure([&] { f.programTransfer.je(ops); });
+}
+
+BENCH_CASE(JccNotTaken) {
+    HandlerFixture f;
+    Operands ops{"TARGET"};
+    f.regs.FLAGS &= ~Registers::ZF;
+    bench.measure([&] { f.programTransfer.je(ops); });
+}
+
+BENCH_CASE(JmpLabel) {
+    HandlerFixture f;
+    Operands ops{"TARGET"};
+    bench.measure([&] { f.programTransfer.jmp(ops); });
+}
+
+BENCH_CASE(LoopTaken) {
+    HandlerFixture f;
+    Operands ops{"TARGET"};
+    bench.measure([&] {
+        f.regs.CX.x = 2;
+        f.programTransfer.loop(ops);
+    });
+}
+
+BENCH_CASE(PushPopReg16) {
+    HandlerFixture f;
+    Operands ops{"AX"};
+    bench.measure([&] {
+        f.dataTransfer.push(ops);
+        f.dataTransfer.pop(ops);
+    });
+}
+
+BENCH_CASE(PushfPopf) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] {
+        f.dataTransfer.pushf(none);
+        f.dataTransfer.popf(none);
+    });
+}
+
+BENCH_CASE(CallRet) {
+    HandlerFixture f;
+    Operands target{"TARGET"};
+    Operands none;
+    bench.measure([&] {
+        f.programTransfer.call(target);
+        f.programTransfer.ret(none);
+    });
+}
+
+BENCH_CASE(Movsb) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.movsb(none); });
+}
+
+BENCH_CASE(Movsw) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.movsw(none); });
+}
+
+BENCH_CASE(Cmpsb) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.cmpsb(none); });
+}
+
+BENCH_CASE(Cmpsw) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.cmpsw(none); });
+}
+
+BENCH_CASE(Scasb) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.scasb(none); });
+}
+
+BENCH_CASE(Scasw) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.scasw(none); });
+}
+
+BENCH_CASE(Lodsb) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.lodsb(none); });
+}
+
+BENCH_CASE(Lodsw) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.lodsw(none); });
+}
+
+BENCH_CASE(Stosb) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.stosb(none); });
+}
+
+BENCH_CASE(Stosw) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.stosw(none); });
+}
+
+BENCH_CASE(RepMovsb256) {
+    HandlerFixture f;
+    Operands ops{"MOVSB"};
+    bench.measure([&] {
+        f.regs.CX.x = kRepCount;
+        f.string.rep(ops);
+    });
+}
+
+BENCH_CASE(RepStosw256) {
+    HandlerFixture f;
+    Operands ops{"STOSW"};
+    bench.measure([&] {
+        f.regs.CX.x = kRepCount;
+        f.string.rep(ops);
+    });
+}
+
+BENCH_CASE(RepeCmpsb256) {
+    HandlerFixture f;
+    Operands ops{"CMPSB"};
+    bench.measure([&] {
+        f.regs.SI = 0x2000;
+        f.regs.DI = 0x4000;
+        f.regs.CX.x = kRepCount;
+        f.string.repe(ops);
+    });
+}
+
+BENCH_CASE(RepneScasb256) {
+    HandlerFixture f;
+    Operands ops{"SCASB"};
+    f.regs.AX.bytes.l = 0xFF;
+    bench.measure([&] {
+        f.regs.DI = 0x4000;
+        f.regs.CX.x = kRepCount;
+        f.string.repne(ops);
+    });
+}
+
+BENCH_CASE(ShlReg8Count1) {
+    HandlerFixture f;
+    Operands ops{"AL", "1"};
+    bench.measure([&] { f.bitManipulation.shl(ops); });
+}
+
+BENCH_CASE(ShlReg16Count1) {
+    HandlerFixture f;
+    Operands ops{"AX", "1"};
+    bench.measure([&] { f.bitManipulation.shl(ops); });
+}
+
+BENCH_CASE(ShrReg16CountCL31) {
+    HandlerFixture f;
+    Operands ops{"AX", "CL"};
+    f.regs.CX.bytes.l = 31;
+    bench.measure([&] { f.bitManipulation.shr(ops); });
+}
+
+BENCH_CASE(SarReg8CountCL31) {
+    HandlerFixture f;
+    Operands ops{"AL", "CL"};
+    f.regs.CX.bytes.l = 31;
+    bench.measure([&] { f.bitManipulation.sar(ops); });
+}
+
+BENCH_CASE(RolReg16CountCL31) {
+    HandlerFixture f;
+    Operands ops{"AX", "CL"};
+    f.regs.CX.bytes.l = 31;
+    bench.measure([&] { f.bitManipulation.rol(ops); });
+}
+
+BENCH_CASE(RcrReg8CountCL31) {
+    HandlerFixture f;
+    Operands ops{"AL", "CL"};
+    f.regs.CX.bytes.l = 31;
+    bench.measure([&] { f.bitManipulation.rcr(ops); });
+}
+
+BENCH_CASE(RclMem16CountCL31) {
+    HandlerFixture f;
+    Operands ops{"[BX]", "CL"};
+    f.regs.CX.bytes.l = 31;
+    bench.measure([&] { f.bitManipulation.rcl(ops); });
+}
+
+BENCH_CASE(MulReg8) {
+    HandlerFixture f;
+    Operands ops{"BL"};
+    bench.measure([&] {
+        f.regs.AX.x = 0x00FE;
+        f.arithmetic.mul(ops);
+    });
+}
+
+BENCH_CASE(MulReg16) {
+    HandlerFixture f;
+    Operands ops{"BX"};
+    bench.measure([&] {
+        f.regs.AX.x = 0xFEDC;
+        f.arithmetic.mul(ops);
+    });
+}
+
+BENCH_CASE(ImulReg16) {
+    HandlerFixture f;
+    Operands ops{"BX"};
+    bench.measure([&] {
+        f.regs.AX.x = 0xFEDC;
+        f.arithmetic.imul(ops);
+    });
+}
+
+BENCH_CASE(DivReg8) {
+    HandlerFixture f;
+    Operands ops{"BL"};
+    f.regs.BX.bytes.l = 7;
+    bench.measure([&] {
+        f.regs.AX.x = 0x03E8;
+        f.arithmetic.div(ops);
+    });
+}
+
+BENCH_CASE(DivReg16) {
+    HandlerFixture f;
+    Operands ops{"BX"};
+    f.regs.BX.x = 0x0107;
+    bench.measure([&] {
+        f.regs.DX.x = 0x0001;
+        f.regs.AX.x = 0x2345;
+        f.arithmetic.div(ops);
+    });
+}
+
+BENCH_CASE(IdivReg16) {
+    HandlerFixture f;
+    Operands ops{"BX"};
+    f.regs.BX.x = 0xFF07;
+    bench.measure([&] {
+        f.regs.DX.x = 0x0000;
+        f.regs.AX.x = 0x2345;
+        f.arithmetic.idiv(ops);
+    });
+}
+
+BENCH_CASE(ClcStc) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] {
+        f.processorControl.clc(none);
+        f.processorControl.stc(none);
+    });
+}
+
+BENCH_CASE(Xlat) {
+    HandlerFixture f;
+    Operands none;
+    bench.measure([&] { f.string.xlat(none); });
+}
+
+// Whole-loop cases: executeInstruction dispatch plus the run() loop, with and without an
+// instrumentation policy, to keep the null policy honest.
+BENCH_CASE(RunLoopNullPolicy) {
+    Emulator8086 emu;
+    emu.loadProgram({"top:", "INC AX", "JMP top"});
+    bench.measure([&] { emu.run(1); });
+}
+
+BENCH_CASE(RunLoopProfilerPolicy) {
+    Emulator8086 emu;
+    emu.loadProgram({"top:", "INC AX", "JMP top"});
+    Profiler profiler;
+    profiler.attach(emu.getProgram(), emu.getLabels(), emu.getSourceLines());
+    ProfilerInstrumentation policy(profiler);
+    bench.measure([&] { emu.run(policy, 1); });
+}
+
+int main(int argc, char** argv) {
+    return BenchmarkFramework::instance().runAll(argc, argv);
+}
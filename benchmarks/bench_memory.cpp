@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "emulator8086.h"
+
+// Memory per emulator instance. Runs many instances of each program side by side, all
+// sharing one Program, and reports the guest memory each keeps resident next to the growth
+// of the whole process, per instance.
+namespace {
+
+// Resident set of this process in KB, or 0 where /proc is not available.
+size_t processResidentKb() {
+    std::ifstream status("/proc/self/status");
+    std::string field;
+    while (status >> field) {
+        size_t kb = 0;
+        if (field == "VmRSS:" && status >> kb)
+            return kb;
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    size_t instances = 100;
+    size_t maxSteps = 100000;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+            instances = std::max<size_t>(1, std::strtoull(argv[++i], nullptr, 0));
+        else if (std::strcmp(argv[i], "--max") == 0 && i + 1 < argc)
+            maxSteps = std::strtoull(argv[++i], nullptr, 0);
+        else
+            files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [--instances N] [--max N] <program>...\n";
+        return 2;
+    }
+
+    // What the programs print (interrupt notes, execution errors) would drown the table.
+    std::streambuf* output = std::cout.rdbuf(nullptr);
+    std::streambuf* errors = std::cerr.rdbuf(nullptr);
+    std::printf("%-28s %10s %12s %14s %12s\n",
+                "Program",
+                "instances",
+                "guest KB",
+                "resident KB",
+                "process KB");
+    std::printf("%s\n", std::string(80, '-').c_str());
+    size_t guestTotal = 0;
+    size_t residentTotal = 0;
+    size_t processTotal = 0;
+    size_t runs = 0;
+    for (const auto& file : files) {
+        std::shared_ptr<const Program> program;
+        try {
+            program = Program::create(loadSourceFile(file));
+        } catch (const std::exception& e) {
+            std::printf("%-28s FAILED: %s\n", file.c_str(), e.what());
+            continue;
+        }
+        size_t before = processResidentKb();
+        std::vector<std::unique_ptr<Emulator8086>> emulators;
+        size_t guest = 0;
+        size_t resident = 0;
+        for (size_t i = 0; i < instances; ++i) {
+            emulators.push_back(std::make_unique<Emulator8086>());
+            Emulator8086& emu = *emulators.back();
+            emu.loadProgram(program);
+            emu.run(maxSteps);
+            guest += emu.getMemory().size();
+            resident += emu.getMemory().residentBytes();
+        }
+        size_t after = processResidentKb();
+        size_t grown = after > before ? after - before : 0;
+
+        std::string name = file.substr(file.find_last_of("/\\") + 1);
+        std::printf("%-28s %10zu %12.1f %14.1f %12.1f\n",
+                    name.c_str(),
+                    instances,
+                    guest / 1024.0 / instances,
+                    resident / 1024.0 / instances,
+                    static_cast<double>(grown) / instances);
+        guestTotal += guest;
+        residentTotal += resident;
+        processTotal += grown;
+        runs += instances;
+    }
+    std::cout.rdbuf(output);
+    std::cerr.rdbuf(errors);
+    if (runs == 0)
+        return 1;
+    std::printf("%s\n", std::string(80, '-').c_str());
+    std::printf("%-28s %10zu %12.1f %14.1f %12.1f\n",
+                "per instance",
+                runs,
+                guestTotal / 1024.0 / runs,
+                residentTotal / 1024.0 / runs,
+                static_cast<double>(processTotal) / runs);
+    return 0;
+}
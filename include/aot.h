@@ -0,0 +1,74 @@
+#ifndef AOT_H
+#define AOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "emulator8086.h"
+#include "instrumentation.h"
+#include "registers.h"
+#include "source_loader.h"
+
+// Ahead-of-time translation of a whole program to C++. Every line becomes a goto label in one
+// function that works on the emulator's own Registers; register and immediate MOV, ALU,
+// INC/DEC and NOT/NEG lines and jumps or loops to a label are written out as C++, and every
+// other line - memory operands, stack, I/O, string instructions - runs through
+// Emulator8086::run() one instruction at a time. The emulator has to hold the same program,
+// which the generated code embeds. Breakpoints and watchpoints are not honoured.
+//
+// The generated file defines `extern const AotProgram <name>` and, when asked for, a main()
+// that calls aotMain().
+
+struct AotProgram {
+    const char* name;
+    DecodedProgram (*source)();
+    // Run like Emulator8086::run() from the current IP; return the instructions retired.
+    size_t (*run)(Emulator8086& emu, size_t maxSteps);
+    size_t (*runTracked)(Emulator8086& emu, DirtyPageTracker& tracker, size_t maxSteps);
+};
+
+struct AotStats {
+    size_t lines = 0;
+    size_t translated = 0;  // Lines written out as C++; the rest call the interpreter.
+};
+
+// `name` must be a C++ identifier. Throws std::runtime_error when it is not.
+AotStats writeAotProgram(std::ostream& out,
+                         const DecodedProgram& program,
+                         const std::string& name,
+                         bool withMain);
+
+// Turns a file name into an identifier for writeAotProgram(): "samples/loop-2.asm" gives
+// "aot_loop_2".
+std::string aotProgramName(const std::string& path);
+
+// Driver behind a generated main(): runs the program and prints the registers, times
+// repeated runs, or with --lockstep checks it against the interpreter.
+int aotMain(const AotProgram& program, int argc, char** argv);
+
+// Emulator8086::updateFlags() for generated code.
+inline void aotUpdateFlags(uint16_t& flags, uint32_t result, bool isByte, bool checkCarry) {
+    uint16_t res = result & (isByte ? 0xFF : 0xFFFF);
+    uint16_t mask = Registers::ZF | Registers::SF | Registers::PF;
+    uint16_t set = 0;
+    if (res == 0)
+        set |= Registers::ZF;
+    if (res & (isByte ? 0x80 : 0x8000))
+        set |= Registers::SF;
+    uint8_t parity = res & 0xFF;
+    parity ^= parity >> 4;
+    parity ^= parity >> 2;
+    parity ^= parity >> 1;
+    if (!(parity & 1))
+        set |= Registers::PF;
+    if (checkCarry) {
+        mask |= Registers::CF;
+        if (result > (isByte ? 0xFFu : 0xFFFFu))
+            set |= Registers::CF;
+    }
+    flags = static_cast<uint16_t>((flags & ~mask) | set);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef DOS_LOADER_H
+#define DOS_LOADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class Emulator8086;
+
+// Loaders for DOS executables. Both build a program segment prefix, copy the image into the
+// emulator's 1 MB address space and set the segment registers, IP and SP the way DOS hands
+// control to a program. A file starting with "MZ" (or "ZM") is an .EXE; anything else is
+// treated as a flat .COM image, as DOS itself does.
+enum class ExecutableFormat { Com, Mz };
+
+struct ExecutableInfo {
+    ExecutableFormat format = ExecutableFormat::Com;
+    uint16_t pspSegment = 0;
+    uint16_t loadSegment = 0;  // Segment of the first image byte.
+    size_t imageSize = 0;
+    size_t relocations = 0;
+};
+
+constexpr uint16_t kDefaultPspSegment = 0x0100;
+
+// True if the path has a .com or .exe extension, in any case.
+bool isExecutablePath(const std::string& path);
+
+// Resets the emulator and loads `image`. `commandTail` becomes the PSP command line at 80h.
+// Throws std::runtime_error for truncated headers or images that do not fit in memory.
+ExecutableInfo loadExecutable(Emulator8086& emulator,
+                              std::string_view image,
+                              const std::string& commandTail = "",
+                              uint16_t pspSegment = kDefaultPspSegment);
+ExecutableInfo loadExecutableFile(Emulator8086& emulator,
+                                  const std::string& path,
+                                  const std::string& commandTail = "",
+                                  uint16_t pspSegment = kDefaultPspSegment);
+
+#endif
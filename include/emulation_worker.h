@@ -0,0 +1,147 @@
+#ifndef EMULATION_WORKER_H
+#define EMULATION_WORKER_H
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "emulator8086.h"
+#include "instrumentation.h"
+#include "spsc_queue.h"
+
+// Machine state as last published by the worker thread. Everything a front end draws comes
+// from here, so rendering never touches the Emulator8086 the worker is running.
+struct EmulatorSnapshot {
+    uint64_t sequence = 0;
+    uint64_t retired = 0;
+    bool running = false;
+    Registers regs;
+    Emulator8086::StopReason stopReason = Emulator8086::StopReason::EndOfProgram;
+    Emulator8086::WatchHit watchHit;
+    size_t memorySize = 0;
+
+    // Rebuilt only when they change; publishing shares them between snapshots.
+    std::shared_ptr<const std::vector<std::string>> program;
+    std::shared_ptr<const std::vector<size_t>> breakpoints;  // Sorted program indices.
+    std::shared_ptr<const std::vector<Emulator8086::Watchpoint>> watchpoints;
+
+    // Copy of the 64K address space the instructions can reach.
+    std::vector<uint8_t> memory;
+
+    bool hasBreakpoint(size_t line) const;
+    uint8_t readByte(uint16_t address) const {
+        return memory[address];
+    }
+    uint16_t readWord(uint16_t address) const {
+        return memory[address] | (memory[static_cast<uint16_t>(address + 1)] << 8);
+    }
+
+  private:
+    friend class EmulationWorker;
+    std::array<uint32_t, DirtyPageTracker::kPageCount> pageVersions{};
+};
+
+// Runs an Emulator8086 on its own thread in batches of run() so long loops never stall the
+// caller. Commands travel over a lock-free SPSC queue; state comes back through a triple
+// buffer of snapshots, of which only pages written since a slot was last filled are copied.
+// Exactly one thread may send commands and read snapshots.
+class EmulationWorker {
+  public:
+    static constexpr size_t kDefaultBatch = 20000;
+
+    // onPublish runs on the worker thread after every snapshot it publishes, e.g. to wake an
+    // event loop that sleeps while nothing changes.
+    explicit EmulationWorker(size_t batchSize = kDefaultBatch,
+                             std::function<void()> onPublish = nullptr);
+    ~EmulationWorker();
+    EmulationWorker(const EmulationWorker&) = delete;
+    EmulationWorker& operator=(const EmulationWorker&) = delete;
+
+    // Each returns false if the command queue is full.
+    bool run();
+    bool pause();
+    bool step();
+    bool reset();
+    bool load(const std::vector<std::string>& lines);
+    bool load(DecodedProgram program);
+    bool toggleBreakpoint(size_t line);
+    bool addWatchpoint(uint16_t address, uint16_t length, bool onRead, bool onWrite);
+    bool removeWatchpoint(uint16_t address);
+
+    // Returns the newest published snapshot. The reference stays valid and unchanged until the
+    // next call, and the call never blocks on the worker.
+    const EmulatorSnapshot& acquireSnapshot();
+    bool hasNewSnapshot() const {
+        return (middle.load(std::memory_order_acquire) & kFresh) != 0;
+    }
+
+  private:
+    enum class CommandType {
+        Run,
+        Pause,
+        Step,
+        Reset,
+        Load,
+        ToggleBreakpoint,
+        AddWatchpoint,
+        RemoveWatchpoint
+    };
+
+    struct Command {
+        explicit Command(CommandType type = CommandType::Pause) : type(type) {}
+
+        CommandType type;
+        size_t line = 0;
+        uint16_t address = 0;
+        uint16_t length = 0;
+        bool onRead = false;
+        bool onWrite = false;
+        std::shared_ptr<const std::vector<std::string>> lines;
+        std::shared_ptr<DecodedProgram> decoded;
+    };
+
+    static constexpr int kFresh = 4;
+
+    const size_t batchSize;
+    const std::function<void()> onPublish;
+    Emulator8086 emulator;
+    DirtyPageTracker tracker;
+
+    // Worker-thread state.
+    bool running = false;
+    bool changed = true;
+    uint64_t retired = 0;
+    uint64_t sequence = 0;
+    std::array<uint32_t, DirtyPageTracker::kPageCount> pageVersions{};
+    std::shared_ptr<const std::vector<std::string>> program;
+    std::shared_ptr<const std::vector<size_t>> breakpoints;
+    std::shared_ptr<const std::vector<Emulator8086::Watchpoint>> watchpoints;
+
+    // Triple buffer: the worker fills slots[back], the reader holds slots[front], and `middle`
+    // carries the third index plus kFresh when it holds a snapshot the reader has not taken.
+    std::array<EmulatorSnapshot, 3> slots;
+    int back = 0;
+    int front = 1;
+    std::atomic<int> middle{2};
+
+    SpscQueue<Command, 64> commands;
+    std::atomic<bool> stopping{false};
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::thread thread;
+
+    bool send(Command command);
+    void threadMain();
+    void execute(Command& command);
+    void markAllPagesDirty();
+    void publish();
+};
+
+#endif
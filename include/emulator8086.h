@@ -1,91 +1,343 @@
 #ifndef EMULATOR8086_H
 #define EMULATOR8086_H
 
-#include <functional>
-#include <map>
+#include <array>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "flag_liveness.h"
+#include "fusion.h"
+#include "guest_memory.h"
+#include "instruction_table.h"
+#include "instructions/arithmetic.h"
+#include "instructions/bit_manipulation.h"
+#include "instructions/data_transfer.h"
+#include "instructions/logical.h"
+#include "instructions/processor_control.h"
+#include "instructions/program_transfer.h"
+#include "instructions/string.h"
+#include "instrumentation.h"
+#include "jit.h"
 #include "memory_components.h"
+#include "operands.h"
+#include "profiler.h"
+#include "program.h"
 #include "registers.h"
-
-class DataTransferInstructions;
-class ArithmeticInstructions;
-class LogicalInstructions;
-class StringInstructions;
-class ProgramTransferInstructions;
-class ProcessorControlInstructions;
-class BitManipulationInstructions;
+#include "source_loader.h"
 
 class Emulator8086 {
+  public:
+    enum class StopReason { StepLimit, EndOfProgram, Breakpoint, Watchpoint };
+
+    struct Watchpoint {
+        uint16_t address;
+        uint16_t length;
+        bool onRead;
+        bool onWrite;
+    };
+
+    struct WatchHit {
+        uint16_t address = 0;
+        bool isWrite = false;
+        size_t line = 0;
+    };
+
   private:
     Registers regs;
-    std::vector<uint8_t> memory;
+    GuestMemory memory;
+
+    // Shared with every other emulator running it. Fused pairs and dead flags point into it
+    // with default settings, and at the own* copies otherwise; empty when off.
+    std::shared_ptr<const Program> program = Program::empty();
+    const std::vector<FusedPair>* fusedLines = &program->getFusedPairs();
+    const std::vector<uint16_t>* deadFlags = &program->getDeadFlags();
+    std::vector<FusedPair> ownFusedLines;
+    std::vector<uint16_t> ownDeadFlags;
+    FusionCandidates fusionCandidates = FusionCandidates::all();
+    bool flagLiveness = true;
+    uint16_t skipFlags = 0;  // Flags updateFlags() leaves alone for the current line.
+    std::unique_ptr<Profiler> profiler;
+    std::unique_ptr<Jit> jit;  // Null when disabled or unsupported.
+    InstrumentationThunks hooks;
 
-    std::map<std::string, std::function<void(std::vector<std::string>&)>> instructions;
-    std::map<std::string, size_t> labels;
-    std::vector<std::string> program;
+    // Breakpoints are a bitmap over program indices. Watchpoints mark the 256-byte pages they
+    // touch so the memory accessors only search the watch list on a watched page.
+    static constexpr uint8_t kPageWatchRead = 1;
+    static constexpr uint8_t kPageWatchWrite = 2;
+    std::vector<uint64_t> breakpointBits;
+    std::vector<Watchpoint> watchpoints;
+    std::array<uint8_t, 256> watchedPages{};
+    bool watchTriggered = false;
+    WatchHit watchHit;
+    StopReason stopReason = StopReason::EndOfProgram;
 
-    std::unique_ptr<DataTransferInstructions> dataTransfer;
-    std::unique_ptr<ArithmeticInstructions> arithmetic;
-    std::unique_ptr<LogicalInstructions> logical;
-    std::unique_ptr<StringInstructions> string;
-    std::unique_ptr<ProgramTransferInstructions> programTransfer;
-    std::unique_ptr<ProcessorControlInstructions> processorControl;
-    std::unique_ptr<BitManipulationInstructions> bitManipulation;
+    // A REP string instruction runs in chunks. One that stops with iterations left keeps IP on
+    // its line, the way the CPU leaves IP on an interrupted string instruction, and carries on
+    // from SI, DI and CX when the line runs again. repeatEntry holds the registers from before
+    // its first chunk so the instruction retires once, with its whole effect.
+    bool repeatSuspended = false;
+    size_t repeatLine = 0;
+    Registers repeatEntry;
 
-    void initializeInstructions();
+    // The handler units hold nothing but this pointer, so they live inline rather than on the
+    // heap.
+    DataTransferInstructions dataTransfer{this};
+    ArithmeticInstructions arithmetic{this};
+    LogicalInstructions logical{this};
+    StringInstructions string{this};
+    ProgramTransferInstructions programTransfer{this};
+    ProcessorControlInstructions processorControl{this};
+    BitManipulationInstructions bitManipulation{this};
+
+    void execute(Opcode opcode, const Operands& operands);
+    void executeLine(size_t line);
+    void executeFused(const FusedPair& pair, size_t line);
+    void rebuildFusion();
+    void rebuildFlagLiveness();
+    void updateBreakpointLiveness(const std::vector<size_t>& changed);
+    bool resumingRepeat(size_t line) const {
+        return repeatSuspended && repeatLine == line;
+    }
+    void rebuildWatchedPages();
+    void checkWatchpoints(uint16_t address, uint16_t size, bool isWrite);
+    uint8_t pageWatchBits(uint16_t address, uint16_t size) const {
+        return watchedPages[address >> 8] |
+               watchedPages[static_cast<uint16_t>(address + size - 1) >> 8];
+    }
 
   public:
     explicit Emulator8086(size_t memSize = 1024 * 1024);
     ~Emulator8086();
 
-    void executeInstruction(const std::string& instruction);
+    void executeInstruction(std::string_view instruction);
 
     void loadProgram(const std::vector<std::string>& lines);
+    // Takes a program already decoded by decodeSource()/loadSourceFile().
+    void loadProgram(DecodedProgram decoded);
+    // Runs a program other emulators may be running too; nothing about it is copied.
+    void loadProgram(std::shared_ptr<const Program> shared);
+    const std::shared_ptr<const Program>& getSharedProgram() const {
+        return program;
+    }
     bool step();
+    // run(maxSteps) with the profiler attached when it is enabled; what step() and the front
+    // ends' run modes execute through.
+    size_t advance(size_t maxSteps);
+
+    // Chooses which instruction pairs run fused (see fusion.h) and fuses the loaded program
+    // again. FusionCandidates::none() turns fusion off.
+    void setFusionCandidates(const FusionCandidates& candidates);
+    const std::vector<FusedPair>& getFusedPairs() const {
+        return *fusedLines;
+    }
+
+    // Translation of hot blocks to host code (see jit.h), on by default where supported.
+    // Turning it off runs everything through the interpreter, e.g. for debugging.
+    void setJitEnabled(bool enable);
+    bool isJitEnabled() const {
+        return jit != nullptr;
+    }
+    const Jit* getJit() const {
+        return jit.get();
+    }
+
+    // Skipping flag updates that nothing reads (see flag_liveness.h), on by default. Off while
+    // any watchpoint is set, since a watchpoint can stop a run after any memory access.
+    void setFlagLivenessEnabled(bool enable);
+    bool isFlagLivenessEnabled() const {
+        return flagLiveness;
+    }
+    // One entry per line, or empty when the analysis is off.
+    const std::vector<uint16_t>& getDeadFlags() const {
+        return *deadFlags;
+    }
+
+    // Executes up to maxSteps steps and returns how many instructions retired. A step is one
+    // instruction, or one chunk of a REP instruction that suspends with iterations left, so a
+    // long REP uses several steps of the budget but retires once, with its last chunk. The
+    // policy is fixed for the whole call; see instrumentation.h. Stops early before a line with
+    // a breakpoint (other than the first one executed) or after an instruction that hit a
+    // watchpoint; getStopReason() tells which.
+    template <typename Policy>
+    size_t run(Policy& policy, size_t maxSteps);
+    size_t run(size_t maxSteps) {
+        NullInstrumentation none;
+        return run(none, maxSteps);
+    }
+
     void reset();
     const std::vector<std::string>& getProgram() const {
-        return program;
+        return program->getLines();
+    }
+    const std::vector<DecodedInstruction>& getDecodedLines() const {
+        return program->getDecodedLines();
+    }
+    const std::vector<size_t>& getSourceLines() const {
+        return program->getSourceLines();
     }
     size_t getIP() const {
         return regs.IP;
     }
     void setIP(size_t ip) {
         regs.IP = static_cast<uint16_t>(ip);
+        repeatSuspended = false;
     }
     void displayRegisters();
     void displayStack();
     void displayMemory(uint16_t address, uint16_t count);
     void displayHelp();
 
-    uint16_t& getRegister(const std::string& reg);
-    uint8_t& getRegister8(const std::string& reg);
-    bool is8BitRegister(const std::string& reg);
-    bool isMemoryOperand(const std::string& operand);
-    uint16_t getValue(const std::string& operand);
-    uint8_t getValue8(const std::string& operand);
+    uint16_t& getRegister(std::string_view reg);
+    uint8_t& getRegister8(std::string_view reg);
+    bool is8BitRegister(std::string_view reg);
+    bool isMemoryOperand(std::string_view operand);
+    uint16_t getValue(std::string_view operand);
+    uint8_t getValue8(std::string_view operand);
     void updateFlags(uint32_t result, bool isByte, bool checkCarry);
-    MemoryOperand parseMemoryOperand(const std::string& operand);
+    MemoryOperand parseMemoryOperand(std::string_view operand);
     uint16_t calculateEffectiveAddress(const MemoryOperand& memOp);
     uint16_t readMemoryWord(uint16_t address);
     void writeMemoryWord(uint16_t address, uint16_t value);
     uint8_t readMemoryByte(uint16_t address);
     void writeMemoryByte(uint16_t address, uint8_t value);
+    // Host pointer to [address, address + length) for bulk string operations, or nullptr if
+    // the range leaves memory or the 64K space, or if an access there has to be seen by a
+    // watchpoint or an instrumentation hook.
+    uint8_t* directMemory(uint16_t address, size_t length, bool isWrite);
+
+    // Called by a REP handler that stops with iterations left; see repeatSuspended.
+    void suspendRepeat() {
+        repeatSuspended = true;
+        repeatLine = regs.IP;
+    }
+    bool isWatchTriggered() const {
+        return watchTriggered;
+    }
 
     Registers& getRegisters() {
         return regs;
     }
-    std::vector<uint8_t>& getMemory() {
+    GuestMemory& getMemory() {
         return memory;
     }
-    std::map<std::string, size_t>& getLabels() {
-        return labels;
+    const LabelMap& getLabels() const {
+        return program->getLabels();
+    }
+
+    StopReason getStopReason() const {
+        return stopReason;
+    }
+    const WatchHit& getWatchHit() const {
+        return watchHit;
+    }
+
+    void setBreakpoint(size_t line, bool enabled);
+    bool toggleBreakpoint(size_t line);
+    void clearBreakpoints();
+    std::vector<size_t> getBreakpoints() const;
+    bool hasBreakpoint(size_t line) const {
+        size_t word = line >> 6;
+        return word < breakpointBits.size() && ((breakpointBits[word] >> (line & 63)) & 1);
+    }
+
+    void addWatchpoint(uint16_t address, uint16_t length, bool onRead, bool onWrite);
+    bool removeWatchpoint(uint16_t address);
+    void clearWatchpoints();
+    const std::vector<Watchpoint>& getWatchpoints() const {
+        return watchpoints;
+    }
+
+    void notifyPortIn(uint16_t port, uint16_t value) {
+        if (hooks.portIn)
+            hooks.portIn(hooks.context, port, value);
     }
+    void notifyPortOut(uint16_t port, uint16_t value) {
+        if (hooks.portOut)
+            hooks.portOut(hooks.context, port, value);
+    }
+    void notifyInterrupt(uint8_t vector, size_t returnLine) {
+        if (hooks.interrupt)
+            hooks.interrupt(hooks.context, vector, returnLine);
+    }
+
+    size_t getLabelAddress(std::string_view label);
+    bool hasLabel(std::string_view label);
 
-    size_t getLabelAddress(const std::string& label);
-    bool hasLabel(const std::string& label);
+    void enableProfiler(bool enable);
+    bool isProfilerEnabled() const {
+        return profiler != nullptr;
+    }
+    Profiler* getProfiler() {
+        return profiler.get();
+    }
 };
 
+template <typename Policy>
+size_t Emulator8086::run(Policy& policy, size_t maxSteps) {
+    constexpr bool kNeedsThunks = Policy::kMemory || Policy::kPorts || Policy::kInterrupts;
+    InstrumentationThunks thunks;
+    if constexpr (kNeedsThunks)
+        thunks = InstrumentationThunks::bind(policy);
+    ScopedInstrumentationThunks scope(hooks, thunks);
+
+    const std::vector<FusedPair>& fused = *fusedLines;
+    const std::vector<uint16_t>& dead = *deadFlags;
+    size_t size = program->size();
+    watchTriggered = false;
+    size_t steps = 0;
+    size_t retired = 0;
+    while (steps < maxSteps && regs.IP < size) {
+        size_t line = regs.IP;
+        if (steps > 0 && hasBreakpoint(line) && !resumingRepeat(line)) {
+            stopReason = StopReason::Breakpoint;
+            return retired;
+        }
+        // Translated blocks and fused pairs retire several instructions at once, so they only
+        // run when nothing observes each retirement. Both stay within the step budget and
+        // never run past a breakpoint.
+        if constexpr (!Policy::kRetire) {
+            if (jit) {
+                if (size_t ran = jit->execute(line, regs, maxSteps - steps)) {
+                    steps += ran;
+                    retired += ran;
+                    continue;
+                }
+            }
+            // Dead flag writes only hold while the run cannot stop within the horizon.
+            if (!dead.empty() && maxSteps - steps > kFlagLivenessHorizon)
+                skipFlags = dead[line];
+            if (!fused.empty() && fused[line].first != Opcode::Invalid &&
+                maxSteps - steps >= 2 && !hasBreakpoint(line + 1)) {
+                executeFused(fused[line], line);
+                skipFlags = 0;
+                steps += 2;
+                retired += 2;
+                continue;
+            }
+        }
+        if constexpr (Policy::kRetire) {
+            Registers before = regs;
+            executeLine(line);
+            if (!repeatSuspended) {
+                bool repeat = isRepeatPrefix(program->getDecodedLines()[line].opcode);
+                policy.onRetire(line, repeat ? repeatEntry : before, regs);
+            }
+        } else {
+            executeLine(line);
+            skipFlags = 0;
+        }
+        ++steps;
+        if (!repeatSuspended)
+            ++retired;
+        if (watchTriggered) {
+            stopReason = StopReason::Watchpoint;
+            return retired;
+        }
+    }
+    stopReason = regs.IP < size ? StopReason::StepLimit : StopReason::EndOfProgram;
+    return retired;
+}
+
 #endif
@@ -0,0 +1,74 @@
+#ifndef EXECUTION_PACER_H
+#define EXECUTION_PACER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Emulator8086;
+
+// Decides how much a front end's run mode executes per redraw. Full speed fills the frame
+// budget with run() slices whose size adapts to about a millisecond each; throttled mode hands
+// out a fixed instruction rate; animate mode retires one instruction per tick so execution can
+// be followed on screen. Breakpoints and watchpoints are handled inside run().
+class ExecutionPacer {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Mode { Full, Throttled, Animate };
+
+    struct FrameResult {
+        size_t retired = 0;
+        bool stopped = false;  // run() stopped for a reason other than its step limit.
+    };
+
+    static constexpr uint32_t kDefaultThrottleRate = 1000;
+    static constexpr uint32_t kDefaultAnimateRate = 4;
+
+    explicit ExecutionPacer(Clock::duration frameBudget = std::chrono::milliseconds(16));
+
+    Mode getMode() const {
+        return mode;
+    }
+    void setMode(Mode newMode);
+    void cycleMode();
+
+    // Instructions per second in throttled mode, steps per second in animate mode.
+    uint32_t getRate() const;
+    void setRate(uint32_t rate);
+    void faster();
+    void slower();
+
+    // Call when run mode starts so time spent paused does not turn into a burst.
+    void resume(Clock::time_point now = Clock::now());
+    FrameResult runFrame(Emulator8086& emulator, Clock::time_point now = Clock::now());
+
+    // Retired instructions per second, measured over roughly the last second of running.
+    double getMeasuredRate() const {
+        return measuredRate;
+    }
+    std::string describe() const;
+
+  private:
+    static constexpr size_t kMinSlice = 64;
+    static constexpr size_t kMaxSlice = 1 << 20;
+
+    Clock::duration frameBudget;
+    Mode mode = Mode::Full;
+    uint32_t throttleRate = kDefaultThrottleRate;
+    uint32_t animateRate = kDefaultAnimateRate;
+    size_t slice = 1024;
+
+    Clock::time_point lastFrame;
+    double credit = 0.0;
+
+    Clock::time_point windowStart;
+    uint64_t windowRetired = 0;
+    double measuredRate = 0.0;
+
+    size_t runBudgeted(Emulator8086& emulator, size_t limit, FrameResult& result);
+    void measure(size_t retired, Clock::time_point now);
+};
+
+#endif
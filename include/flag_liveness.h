@@ -0,0 +1,85 @@
+#ifndef FLAG_LIVENESS_H
+#define FLAG_LIVENESS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "instruction_table.h"
+#include "operands.h"
+
+// Static flag liveness. A backward dataflow pass over the program's control-flow graph,
+// built from the resolved label targets, finds the flags each instruction writes that
+// nothing reads before they are written again. Those writes can be skipped.
+//
+// FLAGS must still be exact wherever a run stops, and a run can stop after any instruction
+// when its step budget runs out. The pass therefore only calls a write dead when every path
+// overwrites the flag within kFlagLivenessHorizon instructions. Callers use the result only
+// while at least that many steps of the budget remain. The end of the program, breakpoint
+// lines, returns, interrupts, PUSHF and any branch without a label target count as reading
+// every flag. A line only counts as overwriting flags when its handler cannot fail before
+// writing them.
+
+constexpr size_t kFlagLivenessHorizon = 16;
+
+// Flags the handler of a MOV, ALU, INC/DEC or NOT/NEG instruction sets. These are SF, ZF and
+// PF, plus CF for ADD, SUB, CMP and NEG. Unlike the instruction table, this leaves out the
+// OF and AF the 8086 defines, because the handlers never write them.
+uint16_t handlerFlagsWritten(Opcode opcode);
+
+// The flag effects and control flow of every line, built once per program. Dead writes for
+// any set of stop lines come from it without decoding operands again, and when a stop line is
+// added or removed only the lines that can reach it within the horizon are recomputed.
+class FlagFlowGraph {
+  public:
+    FlagFlowGraph() = default;
+    FlagFlowGraph(const std::vector<std::string>& program,
+                  const std::vector<DecodedInstruction>& decoded,
+                  const LabelMap& labels);
+
+    size_t size() const {
+        return nodes.size();
+    }
+
+    // One entry per line: the flags in handlerFlagsWritten() that the line's instruction may
+    // leave as they are. `stopLines` are lines where a run may stop before executing them.
+    std::vector<uint16_t> findDeadFlagWrites(const std::vector<size_t>& stopLines) const;
+
+    // The lines whose dead writes depend on whether a run may stop before `line`: those with
+    // a path of at most kFlagLivenessHorizon instructions to it, `line` itself included.
+    std::vector<size_t> linesReaching(size_t line) const;
+
+    // Recomputes `dead`, a findDeadFlagWrites() result, for just `lines` under a new set of
+    // stop lines. `lines` has to cover every line whose result can change: linesReaching() of
+    // each stop line added or removed.
+    void updateDeadFlagWrites(std::vector<uint16_t>& dead,
+                              const std::vector<size_t>& lines,
+                              const std::vector<size_t>& stopLines) const;
+
+  private:
+    static constexpr uint32_t kUnknown = UINT32_MAX;
+
+    struct Node {
+        uint16_t reads = 0;
+        uint16_t kills = 0;   // Flags it is sure to overwrite.
+        uint16_t writes = 0;  // handlerFlagsWritten() of its opcode.
+        bool opaque = false;  // Successors unknown: everything is live after it.
+        uint32_t next[2] = {kUnknown, kUnknown};  // Successors; kUnknown where unused.
+    };
+
+    std::vector<Node> nodes;
+    // Lines each line is a successor of, for the lines whose live flags follow from their
+    // successors': predecessors[predecessorStart[i] .. predecessorStart[i + 1]).
+    std::vector<uint32_t> predecessorStart;
+    std::vector<uint32_t> predecessors;
+
+    static Node analyse(const std::string& text,
+                        const DecodedInstruction& instruction,
+                        const LabelMap& labels,
+                        size_t line);
+    template <typename LiveIn>
+    uint16_t liveOut(const Node& node, LiveIn liveIn) const;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "instruction_table.h"
+#include "operands.h"
+#include "registers.h"
+
+// Superinstructions. The fusion pass looks at each pair of adjacent lines and, when both are
+// simple enough, decodes them once into a FusedPair that run() executes in a single dispatch:
+// operands are resolved to register indices and immediates up front and a branch's label to
+// its line. Only register and immediate operands qualify, so a fused pair touches no memory
+// and cannot throw; anything else stays on the ordinary path, which reports the error.
+//
+// First halves: MOV, CMP, TEST, ADD, SUB, INC, DEC. Second halves: MOV, JMP, the conditional
+// jumps, JCXZ and the LOOPs. Entering at the second line (a jump target) runs it alone.
+
+// Which (first, second) opcode pairs the pass may fuse. Defaults to every supported pair; a
+// profile narrows it to the pairs that matter for a workload.
+class FusionCandidates {
+  public:
+    static FusionCandidates all();
+    static FusionCandidates none() {
+        return FusionCandidates();
+    }
+
+    // Reads "FIRST SECOND [count]" lines, e.g. "CMP JNE 120000", or the "pair" records of
+    // an OpcodeProfile data file; its other records, blank lines and lines starting with '#'
+    // are skipped. Keeps the `limit` pairs with the highest counts (all of
+    // them when limit is 0). Throws std::runtime_error on an unknown mnemonic.
+    static FusionCandidates parse(std::istream& in, size_t limit = 0);
+    static FusionCandidates load(const std::string& path, size_t limit = 0);
+
+    static bool supports(Opcode first, Opcode second);
+    bool allows(Opcode first, Opcode second) const {
+        return pairs[index(first, second)];
+    }
+    void allow(Opcode first, Opcode second);
+    size_t count() const {
+        return pairs.count();
+    }
+    bool operator==(const FusionCandidates& other) const {
+        return pairs == other.pairs;
+    }
+
+  private:
+    static size_t index(Opcode first, Opcode second) {
+        return static_cast<size_t>(first) * kOpcodeCount + static_cast<size_t>(second);
+    }
+    std::bitset<kOpcodeCount * kOpcodeCount> pairs;
+};
+
+struct FusedOperand {
+    enum Kind : uint8_t { Reg16, Reg8, Immediate };
+
+    Kind kind = Immediate;
+    uint8_t reg = 0;  // AX CX DX BX SP BP SI DI, or AL CL DL BL AH CH DH BH.
+    uint16_t value = 0;
+};
+
+struct FusedPair {
+    Opcode first = Opcode::Invalid;  // Invalid: the line does not start a pair.
+    Opcode second = Opcode::Invalid;
+    bool byte = false;  // Width of the first instruction.
+    bool secondByte = false;
+    FusedOperand dest;
+    FusedOperand src;
+    FusedOperand secondDest;  // Second half is a MOV.
+    FusedOperand secondSrc;
+    uint16_t target = 0;  // Second half is a jump or loop.
+};
+
+inline uint16_t& fusedRegister16(Registers& regs, uint8_t reg) {
+    switch (reg) {
+        case 0:
+            return regs.AX.x;
+        case 1:
+            return regs.CX.x;
+        case 2:
+            return regs.DX.x;
+        case 3:
+            return regs.BX.x;
+        case 4:
+            return regs.SP;
+        case 5:
+            return regs.BP;
+        case 6:
+            return regs.SI;
+        default:
+            return regs.DI;
+    }
+}
+
+inline uint8_t& fusedRegister8(Registers& regs, uint8_t reg) {
+    Register16* rows[] = {&regs.AX, &regs.CX, &regs.DX, &regs.BX};
+    return reg & 4 ? rows[reg & 3]->bytes.h : rows[reg & 3]->bytes.l;
+}
+
+// Resolves a MOV, ALU, INC/DEC or NOT/NEG line whose operands are all registers or
+// immediates, classifying them the way its handler would. False for any other operand or a
+// wrong operand count. `byte` is the width of the destination register.
+bool resolveRegisterOperands(Opcode opcode,
+                             const Operands& operands,
+                             bool& byte,
+                             FusedOperand& dest,
+                             FusedOperand& src);
+
+// Whether the jump or loop in a pair's second half goes to its target. LOOPs decrement CX.
+bool fusedBranchTaken(Opcode opcode, Registers& regs);
+
+// One entry per line; entry i, when valid, covers lines i and i + 1.
+std::vector<FusedPair> fuseProgram(const std::vector<std::string>& program,
+                                   const std::vector<DecodedInstruction>& decoded,
+                                   const LabelMap& labels,
+                                   const FusionCandidates& candidates);
+
+#endif
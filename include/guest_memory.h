@@ -0,0 +1,66 @@
+#ifndef GUEST_MEMORY_H
+#define GUEST_MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The emulator's physical memory. Where the platform allows it, this is an anonymous private
+// mapping that reads as zeros and takes no RAM until a page is first written, so an instance
+// that touches a few KB of its megabyte keeps only those pages resident. Elsewhere it is a
+// zero-filled heap block.
+class GuestMemory {
+  public:
+    explicit GuestMemory(size_t size);
+    ~GuestMemory();
+    GuestMemory(const GuestMemory&) = delete;
+    GuestMemory& operator=(const GuestMemory&) = delete;
+
+    size_t size() const {
+        return length;
+    }
+    uint8_t* data() {
+        return bytes;
+    }
+    const uint8_t* data() const {
+        return bytes;
+    }
+    uint8_t& operator[](size_t address) {
+        return bytes[address];
+    }
+    uint8_t operator[](size_t address) const {
+        return bytes[address];
+    }
+    uint8_t* begin() {
+        return bytes;
+    }
+    uint8_t* end() {
+        return bytes + length;
+    }
+    const uint8_t* begin() const {
+        return bytes;
+    }
+    const uint8_t* end() const {
+        return bytes + length;
+    }
+
+    bool operator==(const GuestMemory& other) const;
+    bool operator!=(const GuestMemory& other) const {
+        return !(*this == other);
+    }
+
+    // Sets every byte to zero. A mapping gives its written pages back instead of clearing them.
+    void zero();
+
+    // Bytes held in RAM right now: the pages written since construction or the last zero().
+    // size() where the platform cannot tell.
+    size_t residentBytes() const;
+
+  private:
+    uint8_t* bytes = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::vector<uint8_t> fallback;
+};
+
+#endif
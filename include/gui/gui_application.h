@@ -1,6 +1,8 @@
 #ifndef GUI_APPLICATION_H
 #define GUI_APPLICATION_H
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -11,13 +13,15 @@
     #include <SDL2/SDL.h>
 #endif
 #include "image_loader.h"
+#include "text_buffer.h"
 
 class ImGuiFileDialog;
 struct ImGuiContext;
 struct ImGuiInputTextCallbackData;
 typedef union SDL_Event SDL_Event;
 
-class Emulator8086;
+class EmulationWorker;
+struct EmulatorSnapshot;
 
 class GUIApplication {
   public:
@@ -40,10 +44,14 @@ class GUIApplication {
     SDL_GLContext glContext = nullptr;
     ImGuiContext* imguiContext = nullptr;
 
-    std::unique_ptr<Emulator8086> emulator;
+    // The emulator lives on the worker's thread; rendering only reads the snapshot acquired
+    // once per frame in update().
+    std::unique_ptr<EmulationWorker> worker;
+    const EmulatorSnapshot* snapshot = nullptr;
     std::unique_ptr<ImGuiFileDialog> fileDialog;
     std::string loadedFilePath;
-    std::vector<std::string> assemblyLines;
+    TextBuffer editorText;
+    std::vector<std::string> assemblyLines;  // Line view of editorText, kept in step by syncLines.
 
     bool running = false;
     bool initialized = false;
@@ -57,14 +65,38 @@ class GUIApplication {
     bool splashScreenInitialized = false;
     Image logoImage;
 
+    std::string executionStatus;
+    char watchAddressBuffer[8] = "0000";
+
+    // The main loop sleeps in SDL_WaitEventTimeout until input arrives or the worker publishes
+    // (signalled with a user event), and renders at most kRunningFrameRate while running.
+    static constexpr int kIdleWaitMs = 1000;
+    static constexpr int kRunningFrameRate = 60;
+    static constexpr int kFramesAfterInput = 2;
+    Uint32 wakeEventType = static_cast<Uint32>(-1);
+    std::atomic<bool> wakePending{false};
+    int pendingFrames = kFramesAfterInput;
+    uint64_t lastSequence = 0;
+    Uint64 nextFrameCounter = 0;
+
+    struct FrameStats {
+        double frameMs = 0.0;
+        double framesPerSecond = 0.0;
+        double idlePercent = 0.0;
+        uint64_t framesRendered = 0;
+    };
+    FrameStats frameStats;
+    Uint64 statsWindowStart = 0;
+    Uint64 statsIdleCounter = 0;
+    Uint64 statsRenderCounter = 0;
+    uint64_t statsFrames = 0;
+
     int memoryViewStart = 0;
     int memoryViewSize = 256;
     int stackViewSize = 16;
 
     bool assemblyEditorModified = false;
-    std::string assemblyEditorBuffer;
-    static constexpr size_t EDITOR_BUFFER_SIZE = 65536;
-    char assemblyEditorCharBuffer[EDITOR_BUFFER_SIZE];
+    std::string assemblyEditorBuffer;  // Contiguous copy the ImGui widget edits; grows on demand.
     int currentLine = 0;
 
     bool initSDL(int width, int height, const std::string& title);
@@ -72,11 +104,16 @@ class GUIApplication {
     bool initImGui();
 
     void handleEvents();
+    void processEvent(const SDL_Event& event);
+    int eventWaitTimeout() const;
     void update();
     void render();
+    void updateFrameStats();
 
     void handleKeyDown(const SDL_Event& event);
     void handleWindowEvent(const SDL_Event& event);
+    void toggleExecution();
+    void resetEmulator();
 
     void renderImGui();
     void renderMainMenuBar();
@@ -84,6 +121,7 @@ class GUIApplication {
     void renderSplashScreen();
     void renderAssemblyEditor();
     void renderEmulatorStatus();
+    void renderBreakpoints();
     void renderRegistersWindow();
     void renderMemoryWindow();
     void renderStackWindow();
@@ -2,10 +2,12 @@
 #define IM8086_IDE_TUI_H
 
 #include <cstdint>
-#include <set>
 #include <string>
 #include <vector>
 
+#include "execution_pacer.h"
+#include "text_buffer.h"
+
 class Emulator8086;
 
 class EmulatorIDETUI {
@@ -20,19 +22,22 @@ class EmulatorIDETUI {
     bool quit = false;
     int memWindowStart = 0;
     int memWindowSize = 128;
-    std::set<size_t> breakpoints;
     int selectedPane = 0;
     bool showLabels = false;
     bool inEditMode = true;
     int currentMode = 0;
 
-    std::vector<std::string> editorLines;
+    TextBuffer editor;
+    std::vector<std::string> editorLines;  // Line view of `editor` handed to the loader.
     int cursorRow = 0;
     int cursorCol = 0;
     int editorScrollY = 0;
     int editorScrollX = 0;
 
     std::string statusMessage = "IDE Mode - Press F1 for help";
+    ExecutionPacer pacer;
+
+    static constexpr size_t kHotLineCount = 5;
 
     void draw();
     void drawEditor(int h, int w);
@@ -47,6 +52,11 @@ class EmulatorIDETUI {
     void drawHelp(int h, int w);
 
     void toggleBreakpoint();
+    void toggleWatchpoint();
+    void startRunning();
+    void runFrame();
+    void changeSpeed(int ch);
+    void exportProfile();
     void step();
     void compileAndLoad();
     void newProgram();
@@ -63,7 +73,7 @@ class EmulatorIDETUI {
 
     void setStatus(const std::string& msg);
     std::string getCurrentLine();
-    void setCurrentLine(const std::string& line);
+    size_t cursorOffset() const;
 };
 
 #endif
@@ -0,0 +1,356 @@
+#ifndef INSTRUCTION_TABLE_H
+#define INSTRUCTION_TABLE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#include "operands.h"
+#include "registers.h"
+
+constexpr uint16_t kFlagsNone = 0;
+constexpr uint16_t kFlagsArith = Registers::OF | Registers::SF | Registers::ZF | Registers::AF |
+                                 Registers::PF | Registers::CF;
+constexpr uint16_t kFlagsIncDec = kFlagsArith & ~Registers::CF;
+constexpr uint16_t kFlagsLogic = kFlagsArith & ~Registers::AF;
+constexpr uint16_t kFlagsSZAPC = kFlagsArith & ~Registers::OF;
+constexpr uint16_t kFlagsSZP = Registers::SF | Registers::ZF | Registers::PF;
+constexpr uint16_t kFlagsAC = Registers::AF | Registers::CF;
+constexpr uint16_t kFlagsOC = Registers::OF | Registers::CF;
+constexpr uint16_t kFlagsSO = Registers::SF | Registers::OF;
+constexpr uint16_t kFlagsSZO = Registers::SF | Registers::ZF | Registers::OF;
+constexpr uint16_t kFlagsZC = Registers::ZF | Registers::CF;
+constexpr uint16_t kFlagsIT = Registers::IF | Registers::TF;
+constexpr uint16_t kFlagsAll = kFlagsArith | Registers::TF | Registers::IF | Registers::DF;
+
+// Every instruction the emulator executes, in the order the help lists them:
+//
+//   X(id, mnemonic, unit, handler, minOperands, maxOperands, flagsRead, flagsWritten,
+//     baseCycles, extraCycles, group, kind, syntax, help)
+//
+// `unit.handler` is the Emulator8086 member function that executes it. Flags are the ones the
+// 8086 defines; flags it leaves undefined are not listed as written. Cycles are approximate
+// clocks with register operands, extraCycles being added when a branch is taken.
+#define IM8086_INSTRUCTIONS(X)                                                                 \
+    X(Mov, "MOV", dataTransfer, mov, 2, 2, kFlagsNone, kFlagsNone, 2, 0,                       \
+      DataTransfer, Plain, "dest,src", "Move data from src to dest (reg/mem/imm)")             \
+    X(Push, "PUSH", dataTransfer, push, 1, 1, kFlagsNone, kFlagsNone, 11, 0,                   \
+      DataTransfer, Plain, "src", "Push 16-bit value onto stack")                              \
+    X(Pop, "POP", dataTransfer, pop, 1, 1, kFlagsNone, kFlagsNone, 8, 0,                       \
+      DataTransfer, Plain, "dest", "Pop 16-bit value from stack to dest")                      \
+    X(Xchg, "XCHG", dataTransfer, xchg, 2, 2, kFlagsNone, kFlagsNone, 4, 0,                    \
+      DataTransfer, Plain, "op1,op2", "Exchange contents of two operands")                     \
+    X(Lea, "LEA", dataTransfer, lea, 2, 2, kFlagsNone, kFlagsNone, 2, 0,                       \
+      DataTransfer, Plain, "reg,[mem]", "Load effective address into register")                \
+    X(Lds, "LDS", dataTransfer, lds, 2, 2, kFlagsNone, kFlagsNone, 16, 0,                      \
+      DataTransfer, Plain, "reg,[mem]", "Load DS and register from memory")                    \
+    X(Les, "LES", dataTransfer, les, 2, 2, kFlagsNone, kFlagsNone, 16, 0,                      \
+      DataTransfer, Plain, "reg,[mem]", "Load ES and register from memory")                    \
+    X(Lahf, "LAHF", dataTransfer, lahf, 0, 0, kFlagsSZAPC, kFlagsNone, 4, 0,                   \
+      DataTransfer, Plain, "", "Load AH from flags")                                           \
+    X(Sahf, "SAHF", dataTransfer, sahf, 0, 0, kFlagsNone, kFlagsSZAPC, 4, 0,                   \
+      DataTransfer, Plain, "", "Store AH into flags")                                          \
+    X(Pushf, "PUSHF", dataTransfer, pushf, 0, 0, kFlagsAll, kFlagsNone, 10, 0,                 \
+      DataTransfer, Plain, "", "Push flags onto stack")                                        \
+    X(Popf, "POPF", dataTransfer, popf, 0, 0, kFlagsNone, kFlagsAll, 8, 0,                     \
+      DataTransfer, Plain, "", "Pop flags from stack")                                         \
+    X(Pusha, "PUSHA", dataTransfer, pusha, 0, 0, kFlagsNone, kFlagsNone, 36, 0,                \
+      DataTransfer, Plain, "", "Push all general-purpose registers")                           \
+    X(Popa, "POPA", dataTransfer, popa, 0, 0, kFlagsNone, kFlagsNone, 51, 0,                   \
+      DataTransfer, Plain, "", "Pop all general-purpose registers")                            \
+    X(In, "IN", processorControl, in_op, 2, 2, kFlagsNone, kFlagsNone, 10, 0,                  \
+      DataTransfer, Plain, "dest,port", "Input from port (enhanced simulation)")               \
+    X(Out, "OUT", processorControl, out, 2, 2, kFlagsNone, kFlagsNone, 10, 0,                  \
+      DataTransfer, Plain, "port,src", "Output to port (enhanced simulation)")                 \
+    X(Xlat, "XLAT", string, xlat, 0, 0, kFlagsNone, kFlagsNone, 11, 0,                         \
+      DataTransfer, Plain, "", "Translate byte using table (BX+AL)")                           \
+    X(Add, "ADD", arithmetic, add, 2, 2, kFlagsNone, kFlagsArith, 3, 0,                        \
+      Arithmetic, Plain, "dest,src", "Add src to dest")                                        \
+    X(Adc, "ADC", arithmetic, adc, 2, 2, Registers::CF, kFlagsArith, 3, 0,                     \
+      Arithmetic, Plain, "dest,src", "Add with carry")                                         \
+    X(Inc, "INC", arithmetic, inc, 1, 1, kFlagsNone, kFlagsIncDec, 2, 0,                       \
+      Arithmetic, Plain, "op", "Increment operand by 1")                                       \
+    X(Aaa, "AAA", arithmetic, aaa, 0, 0, Registers::AF, kFlagsAC, 4, 0,                        \
+      Arithmetic, Plain, "", "ASCII adjust after addition")                                    \
+    X(Daa, "DAA", arithmetic, daa, 0, 0, kFlagsAC, kFlagsSZAPC, 4, 0,                          \
+      Arithmetic, Plain, "", "Decimal adjust after addition")                                  \
+    X(Sub, "SUB", arithmetic, sub, 2, 2, kFlagsNone, kFlagsArith, 3, 0,                        \
+      Arithmetic, Plain, "dest,src", "Subtract src from dest")                                 \
+    X(Sbb, "SBB", arithmetic, sbb, 2, 2, Registers::CF, kFlagsArith, 3, 0,                     \
+      Arithmetic, Plain, "dest,src", "Subtract with borrow")                                   \
+    X(Dec, "DEC", arithmetic, dec, 1, 1, kFlagsNone, kFlagsIncDec, 2, 0,                       \
+      Arithmetic, Plain, "op", "Decrement operand by 1")                                       \
+    X(Neg, "NEG", arithmetic, neg, 1, 1, kFlagsNone, kFlagsArith, 3, 0,                        \
+      Arithmetic, Plain, "op", "Negate operand (two's complement)")                            \
+    X(Aas, "AAS", arithmetic, aas, 0, 0, Registers::AF, kFlagsAC, 4, 0,                        \
+      Arithmetic, Plain, "", "ASCII adjust after subtraction")                                 \
+    X(Das, "DAS", arithmetic, das, 0, 0, kFlagsAC, kFlagsSZAPC, 4, 0,                          \
+      Arithmetic, Plain, "", "Decimal adjust after subtraction")                               \
+    X(Mul, "MUL", arithmetic, mul, 1, 1, kFlagsNone, kFlagsOC, 118, 0,                         \
+      Arithmetic, Plain, "op", "Unsigned multiply (AX or DX:AX)")                              \
+    X(Imul, "IMUL", arithmetic, imul, 1, 1, kFlagsNone, kFlagsOC, 128, 0,                      \
+      Arithmetic, Plain, "op", "Signed multiply (AX or DX:AX)")                                \
+    X(Aam, "AAM", arithmetic, aam, 0, 0, kFlagsNone, kFlagsSZP, 83, 0,                         \
+      Arithmetic, Plain, "", "ASCII adjust after multiplication")                              \
+    X(Div, "DIV", arithmetic, div, 1, 1, kFlagsNone, kFlagsNone, 144, 0,                       \
+      Arithmetic, Plain, "op", "Unsigned divide (AX or DX:AX)")                                \
+    X(Idiv, "IDIV", arithmetic, idiv, 1, 1, kFlagsNone, kFlagsNone, 165, 0,                    \
+      Arithmetic, Plain, "op", "Signed divide (AX or DX:AX)")                                  \
+    X(Aad, "AAD", arithmetic, aad, 0, 0, kFlagsNone, kFlagsSZP, 60, 0,                         \
+      Arithmetic, Plain, "", "ASCII adjust before division")                                   \
+    X(Cbw, "CBW", arithmetic, cbw, 0, 0, kFlagsNone, kFlagsNone, 2, 0,                         \
+      Arithmetic, Plain, "", "Convert byte to word (sign-extend AL to AX)")                    \
+    X(Cwd, "CWD", arithmetic, cwd, 0, 0, kFlagsNone, kFlagsNone, 5, 0,                         \
+      Arithmetic, Plain, "", "Convert word to doubleword (sign-extend AX to DX:AX)")           \
+    X(And, "AND", logical, and_op, 2, 2, kFlagsNone, kFlagsLogic, 3, 0,                        \
+      Logical, Plain, "dest,src", "Bitwise AND")                                               \
+    X(Or, "OR", logical, or_op, 2, 2, kFlagsNone, kFlagsLogic, 3, 0,                           \
+      Logical, Plain, "dest,src", "Bitwise OR")                                                \
+    X(Xor, "XOR", logical, xor_op, 2, 2, kFlagsNone, kFlagsLogic, 3, 0,                        \
+      Logical, Plain, "dest,src", "Bitwise XOR")                                               \
+    X(Not, "NOT", logical, not_op, 1, 1, kFlagsNone, kFlagsNone, 3, 0,                         \
+      Logical, Plain, "op", "Bitwise NOT")                                                     \
+    X(Test, "TEST", logical, test, 2, 2, kFlagsNone, kFlagsLogic, 3, 0,                        \
+      Logical, Plain, "dest,src", "Test bits (AND without storing result)")                    \
+    X(Cmp, "CMP", logical, cmp, 2, 2, kFlagsNone, kFlagsArith, 3, 0,                           \
+      Logical, Plain, "dest,src", "Compare (subtract without storing result)")                 \
+    X(Rcl, "RCL", bitManipulation, rcl, 2, 2, Registers::CF, kFlagsOC, 2, 0,                   \
+      ShiftRotate, Shift, "op,count", "Rotate left through carry")                             \
+    X(Rcr, "RCR", bitManipulation, rcr, 2, 2, Registers::CF, kFlagsOC, 2, 0,                   \
+      ShiftRotate, Shift, "op,count", "Rotate right through carry")                            \
+    X(Rol, "ROL", bitManipulation, rol, 2, 2, kFlagsNone, kFlagsOC, 2, 0,                      \
+      ShiftRotate, Shift, "op,count", "Rotate left")                                           \
+    X(Ror, "ROR", bitManipulation, ror, 2, 2, kFlagsNone, kFlagsOC, 2, 0,                      \
+      ShiftRotate, Shift, "op,count", "Rotate right")                                          \
+    X(Sal, "SAL", bitManipulation, sal, 2, 2, kFlagsNone, kFlagsLogic, 2, 0,                   \
+      ShiftRotate, Shift, "op,count", "Shift arithmetic left (same as SHL)")                   \
+    X(Sar, "SAR", bitManipulation, sar, 2, 2, kFlagsNone, kFlagsLogic, 2, 0,                   \
+      ShiftRotate, Shift, "op,count", "Shift arithmetic right")                                \
+    X(Shl, "SHL", bitManipulation, shl, 2, 2, kFlagsNone, kFlagsLogic, 2, 0,                   \
+      ShiftRotate, Shift, "op,count", "Shift logical left")                                    \
+    X(Shr, "SHR", bitManipulation, shr, 2, 2, kFlagsNone, kFlagsLogic, 2, 0,                   \
+      ShiftRotate, Shift, "op,count", "Shift logical right")                                   \
+    X(Movsb, "MOVSB", string, movsb, 0, 0, Registers::DF, kFlagsNone, 18, 0,                   \
+      String, Plain, "", "Move byte from SI to DI")                                            \
+    X(Movsw, "MOVSW", string, movsw, 0, 0, Registers::DF, kFlagsNone, 18, 0,                   \
+      String, Plain, "", "Move word from SI to DI")                                            \
+    X(Cmpsb, "CMPSB", string, cmpsb, 0, 0, Registers::DF, kFlagsArith, 22, 0,                  \
+      String, Plain, "", "Compare byte at SI and DI")                                          \
+    X(Cmpsw, "CMPSW", string, cmpsw, 0, 0, Registers::DF, kFlagsArith, 22, 0,                  \
+      String, Plain, "", "Compare word at SI and DI")                                          \
+    X(Scasb, "SCASB", string, scasb, 0, 0, Registers::DF, kFlagsArith, 15, 0,                  \
+      String, Plain, "", "Scan byte (compare AL with DI)")                                     \
+    X(Scasw, "SCASW", string, scasw, 0, 0, Registers::DF, kFlagsArith, 15, 0,                  \
+      String, Plain, "", "Scan word (compare AX with DI)")                                     \
+    X(Lodsb, "LODSB", string, lodsb, 0, 0, Registers::DF, kFlagsNone, 12, 0,                   \
+      String, Plain, "", "Load byte from SI to AL")                                            \
+    X(Lodsw, "LODSW", string, lodsw, 0, 0, Registers::DF, kFlagsNone, 12, 0,                   \
+      String, Plain, "", "Load word from SI to AX")                                            \
+    X(Stosb, "STOSB", string, stosb, 0, 0, Registers::DF, kFlagsNone, 11, 0,                   \
+      String, Plain, "", "Store AL to DI")                                                     \
+    X(Stosw, "STOSW", string, stosw, 0, 0, Registers::DF, kFlagsNone, 11, 0,                   \
+      String, Plain, "", "Store AX to DI")                                                     \
+    X(Rep, "REP", string, rep, 1, 1, Registers::DF, kFlagsNone, 9, 0,                          \
+      String, Repeat, "inst", "Repeat string instruction (enhanced)")                          \
+    X(Repe, "REPE", string, repe, 1, 1, Registers::DF, kFlagsArith, 9, 0,                      \
+      String, Repeat, "inst", "Repeat while equal (enhanced)")                                 \
+    X(Repne, "REPNE", string, repne, 1, 1, Registers::DF, kFlagsArith, 9, 0,                   \
+      String, Repeat, "inst", "Repeat while not equal (enhanced)")                             \
+    X(Call, "CALL", programTransfer, call, 1, 1, kFlagsNone, kFlagsNone, 19, 0,                \
+      ControlTransfer, Call, "addr", "Call subroutine")                                        \
+    X(Jmp, "JMP", programTransfer, jmp, 1, 1, kFlagsNone, kFlagsNone, 15, 0,                   \
+      ControlTransfer, Jump, "addr", "Unconditional jump")                                     \
+    X(Ret, "RET", programTransfer, ret, 0, 0, kFlagsNone, kFlagsNone, 8, 0,                    \
+      ControlTransfer, Ret, "", "Return from subroutine")                                      \
+    X(Retf, "RETF", programTransfer, retf, 0, 0, kFlagsNone, kFlagsNone, 18, 0,                \
+      ControlTransfer, Ret, "", "Return far (pops CS and IP)")                                 \
+    X(Je, "JE", programTransfer, je, 1, 1, Registers::ZF, kFlagsNone, 4, 12,                   \
+      ControlTransfer, CondJump, "addr", "Jump if equal/zero (ZF=1)")                          \
+    X(Jl, "JL", programTransfer, jl, 1, 1, kFlagsSO, kFlagsNone, 4, 12,                        \
+      ControlTransfer, CondJump, "addr", "Jump if less/not greater or equal (SF!=OF)")         \
+    X(Jle, "JLE", programTransfer, jle, 1, 1, kFlagsSZO, kFlagsNone, 4, 12,                    \
+      ControlTransfer, CondJump, "addr", "Jump if less or equal/not greater (ZF=1 or SF!=OF)") \
+    X(Jb, "JB", programTransfer, jb, 1, 1, Registers::CF, kFlagsNone, 4, 12,                   \
+      ControlTransfer, CondJump, "addr", "Jump if below/not above or equal/carry (CF=1)")      \
+    X(Jbe, "JBE", programTransfer, jbe, 1, 1, kFlagsZC, kFlagsNone, 4, 12,                     \
+      ControlTransfer, CondJump, "addr", "Jump if below or equal/not above (CF=1 or ZF=1)")    \
+    X(Jp, "JP", programTransfer, jp, 1, 1, Registers::PF, kFlagsNone, 4, 12,                   \
+      ControlTransfer, CondJump, "addr", "Jump if parity/parity even (PF=1)")                  \
+    X(Jo, "JO", programTransfer, jo, 1, 1, Registers::OF, kFlagsNone, 4, 12,                   \
+      ControlTransfer, CondJump, "addr", "Jump if overflow (OF=1)")                            \
+    X(Js, "JS", programTransfer, js, 1, 1, Registers::SF, kFlagsNone, 4, 12,                   \
+      ControlTransfer, CondJump, "addr", "Jump if sign (SF=1)")                                \
+    X(Jne, "JNE", programTransfer, jne, 1, 1, Registers::ZF, kFlagsNone, 4, 12,                \
+      ControlTransfer, CondJump, "addr", "Jump if not equal/not zero (ZF=0)")                  \
+    X(Jnl, "JNL", programTransfer, jnl, 1, 1, kFlagsSO, kFlagsNone, 4, 12,                     \
+      ControlTransfer, CondJump, "addr", "Jump if not less/greater or equal (SF=OF)")          \
+    X(Jg, "JG", programTransfer, jg, 1, 1, kFlagsSZO, kFlagsNone, 4, 12,                       \
+      ControlTransfer, CondJump, "addr", "Jump if greater/not less or equal (ZF=0 and SF=OF)") \
+    X(Jnb, "JNB", programTransfer, jnb, 1, 1, Registers::CF, kFlagsNone, 4, 12,                \
+      ControlTransfer, CondJump, "addr", "Jump if not below/above or equal/not carry (CF=0)")  \
+    X(Ja, "JA", programTransfer, ja, 1, 1, kFlagsZC, kFlagsNone, 4, 12,                        \
+      ControlTransfer, CondJump, "addr", "Jump if above/not below or equal (CF=0 and ZF=0)")   \
+    X(Jnp, "JNP", programTransfer, jnp, 1, 1, Registers::PF, kFlagsNone, 4, 12,                \
+      ControlTransfer, CondJump, "addr", "Jump if not parity/parity odd (PF=0)")               \
+    X(Jno, "JNO", programTransfer, jno, 1, 1, Registers::OF, kFlagsNone, 4, 12,                \
+      ControlTransfer, CondJump, "addr", "Jump if no overflow (OF=0)")                         \
+    X(Jns, "JNS", programTransfer, jns, 1, 1, Registers::SF, kFlagsNone, 4, 12,                \
+      ControlTransfer, CondJump, "addr", "Jump if not sign (SF=0)")                            \
+    X(Loop, "LOOP", programTransfer, loop, 1, 1, kFlagsNone, kFlagsNone, 5, 12,                \
+      ControlTransfer, Loop, "addr", "Loop while CX != 0")                                     \
+    X(Loopz, "LOOPZ", programTransfer, loopz, 1, 1, Registers::ZF, kFlagsNone, 6, 12,          \
+      ControlTransfer, Loop, "addr", "Loop while CX != 0 and ZF=1")                            \
+    X(Loopnz, "LOOPNZ", programTransfer, loopnz, 1, 1, Registers::ZF, kFlagsNone, 5, 14,       \
+      ControlTransfer, Loop, "addr", "Loop while CX != 0 and ZF=0")                            \
+    X(Jcxz, "JCXZ", programTransfer, jcxz, 1, 1, kFlagsNone, kFlagsNone, 6, 12,                \
+      ControlTransfer, CondJump, "addr", "Jump if CX = 0")                                     \
+    X(Int, "INT", processorControl, int_op, 1, 1, kFlagsAll, kFlagsIT, 51, 0,                  \
+      Interrupt, Int, "num", "Software interrupt (enhanced simulation)")                       \
+    X(Into, "INTO", processorControl, into, 0, 0, kFlagsAll, kFlagsIT, 4, 49,                  \
+      Interrupt, Int, "", "Interrupt on overflow (enhanced)")                                  \
+    X(Iret, "IRET", processorControl, iret, 0, 0, kFlagsNone, kFlagsAll, 24, 0,                \
+      Interrupt, Iret, "", "Return from interrupt (enhanced)")                                 \
+    X(Clc, "CLC", processorControl, clc, 0, 0, kFlagsNone, Registers::CF, 2, 0,                \
+      FlagControl, Plain, "", "Clear carry flag")                                              \
+    X(Cmc, "CMC", processorControl, cmc, 0, 0, Registers::CF, Registers::CF, 2, 0,             \
+      FlagControl, Plain, "", "Complement carry flag")                                         \
+    X(Stc, "STC", processorControl, stc, 0, 0, kFlagsNone, Registers::CF, 2, 0,                \
+      FlagControl, Plain, "", "Set carry flag")                                                \
+    X(Cld, "CLD", processorControl, cld, 0, 0, kFlagsNone, Registers::DF, 2, 0,                \
+      FlagControl, Plain, "", "Clear direction flag")                                          \
+    X(Std, "STD", processorControl, std, 0, 0, kFlagsNone, Registers::DF, 2, 0,                \
+      FlagControl, Plain, "", "Set direction flag")                                            \
+    X(Cli, "CLI", processorControl, cli, 0, 0, kFlagsNone, Registers::IF, 2, 0,                \
+      FlagControl, Plain, "", "Clear interrupt flag")                                          \
+    X(Sti, "STI", processorControl, sti, 0, 0, kFlagsNone, Registers::IF, 2, 0,                \
+      FlagControl, Plain, "", "Set interrupt flag")                                            \
+    X(Hlt, "HLT", processorControl, hlt, 0, 0, kFlagsNone, kFlagsNone, 2, 0,                   \
+      Miscellaneous, Plain, "", "Halt execution")                                              \
+    X(Wait, "WAIT", processorControl, wait, 0, 0, kFlagsNone, kFlagsNone, 3, 0,                \
+      Miscellaneous, Plain, "", "Wait for external signal")                                    \
+    X(Esc, "ESC", processorControl, esc, 1, 4, kFlagsNone, kFlagsNone, 2, 0,                   \
+      Miscellaneous, Plain, "op", "Escape to coprocessor (enhanced simulation)")               \
+    X(Lock, "LOCK", processorControl, lock, 1, 4, kFlagsNone, kFlagsNone, 2, 0,                \
+      Miscellaneous, Plain, "inst", "Lock bus (simulation)")                                   \
+    X(Nop, "NOP", processorControl, nop, 0, 0, kFlagsNone, kFlagsNone, 3, 0,                   \
+      Miscellaneous, Plain, "", "No operation")
+
+// Other spellings of the mnemonics above: X(mnemonic, id).
+#define IM8086_ALIASES(X) \
+    X("XLATB", Xlat)      \
+    X("REPZ", Repe)       \
+    X("REPNZ", Repne)     \
+    X("JZ", Je)           \
+    X("JNGE", Jl)         \
+    X("JNG", Jle)         \
+    X("JNAE", Jb)         \
+    X("JC", Jb)           \
+    X("JNA", Jbe)         \
+    X("JPE", Jp)          \
+    X("JNZ", Jne)         \
+    X("JGE", Jnl)         \
+    X("JNLE", Jg)         \
+    X("JAE", Jnb)         \
+    X("JNC", Jnb)         \
+    X("JNBE", Ja)         \
+    X("JPO", Jnp)         \
+    X("LOOPE", Loopz)     \
+    X("LOOPNE", Loopnz)
+
+enum class Opcode : uint8_t {
+#define IM8086_OPCODE(id, ...) id,
+    IM8086_INSTRUCTIONS(IM8086_OPCODE)
+#undef IM8086_OPCODE
+    Invalid
+};
+
+constexpr size_t kOpcodeCount = static_cast<size_t>(Opcode::Invalid);
+
+enum class InstructionGroup : uint8_t {
+    DataTransfer,
+    Arithmetic,
+    Logical,
+    ShiftRotate,
+    String,
+    ControlTransfer,
+    Interrupt,
+    FlagControl,
+    Miscellaneous,
+};
+
+enum class InstructionKind : uint8_t {
+    Plain,
+    Jump,
+    CondJump,
+    Loop,
+    Call,
+    Ret,
+    Int,
+    Iret,
+    Shift,
+    Repeat,
+};
+
+struct InstructionInfo {
+    std::string_view mnemonic;
+    uint8_t minOperands;
+    uint8_t maxOperands;
+    uint16_t flagsRead;
+    uint16_t flagsWritten;
+    uint16_t baseCycles;
+    uint16_t extraCycles;
+    InstructionGroup group;
+    InstructionKind kind;
+    const char* syntax;
+    const char* help;
+};
+
+inline constexpr std::array<InstructionInfo, kOpcodeCount> kInstructionTable = {{
+#define IM8086_INFO(id, name, unit, handler, minOps, maxOps, read, written, base, extra, group, \
+                    kind, syntax, help)                                                         \
+    {name, minOps, maxOps, read, written, base, extra, InstructionGroup::group,                 \
+     InstructionKind::kind, syntax, help},
+    IM8086_INSTRUCTIONS(IM8086_INFO)
+#undef IM8086_INFO
+}};
+
+constexpr const InstructionInfo& instructionInfo(Opcode opcode) {
+    return kInstructionTable[static_cast<size_t>(opcode)];
+}
+
+constexpr bool isRepeatPrefix(Opcode opcode) {
+    return opcode != Opcode::Invalid && instructionInfo(opcode).kind == InstructionKind::Repeat;
+}
+
+// Case-insensitive mnemonic lookup through a perfect hash built at compile time. Returns
+// Opcode::Invalid for anything that is not a mnemonic or alias.
+Opcode lookupMnemonic(std::string_view text);
+
+// Throws std::runtime_error when `count` is outside the instruction's operand range.
+void checkOperandCount(Opcode opcode, size_t count);
+
+// Splits "MNEMONIC op1, op2" into views of `text`. Returns false if there are more operands
+// than Operands can hold.
+bool splitInstruction(std::string_view text, std::string_view& mnemonic, Operands& operands);
+
+// An instruction line resolved once when the program is loaded: the opcode plus where each
+// operand sits in the line, so executing it needs neither a lookup nor a tokenizer pass.
+struct DecodedInstruction {
+    Opcode opcode = Opcode::Invalid;
+    uint8_t operandCount = 0;
+    std::array<uint32_t, Operands::kCapacity> operandStart{};
+    std::array<uint32_t, Operands::kCapacity> operandLength{};
+
+    // `text` must be the line this was decoded from.
+    Operands operands(std::string_view text) const;
+};
+
+// Opcode::Invalid when the mnemonic is unknown or there are too many operands.
+DecodedInstruction decodeInstruction(std::string_view text);
+
+// The instruction reference shown by the REPL's `?` command, one section per group.
+void writeInstructionHelp(std::ostream& out);
+
+#endif
@@ -1,10 +1,8 @@
 #ifndef ARITHMETIC_H
 #define ARITHMETIC_H
 
-#include <string>
-#include <vector>
-
 #include "../memory_components.h"
+#include "../operands.h"
 #include "../registers.h"
 
 class Emulator8086;
@@ -16,25 +14,25 @@ class ArithmeticInstructions {
   public:
     ArithmeticInstructions(Emulator8086* emu);
 
-    void add(const std::vector<std::string>& operands);
-    void adc(const std::vector<std::string>& operands);
-    void inc(const std::vector<std::string>& operands);
-    void aaa(const std::vector<std::string>& operands);
-    void daa(const std::vector<std::string>& operands);
-    void sub(const std::vector<std::string>& operands);
-    void sbb(const std::vector<std::string>& operands);
-    void dec(const std::vector<std::string>& operands);
-    void neg(const std::vector<std::string>& operands);
-    void aas(const std::vector<std::string>& operands);
-    void das(const std::vector<std::string>& operands);
-    void mul(const std::vector<std::string>& operands);
-    void imul(const std::vector<std::string>& operands);
-    void aam(const std::vector<std::string>& operands);
-    void div(const std::vector<std::string>& operands);
-    void idiv(const std::vector<std::string>& operands);
-    void aad(const std::vector<std::string>& operands);
-    void cbw(const std::vector<std::string>& operands);
-    void cwd(const std::vector<std::string>& operands);
+    void add(const Operands& operands);
+    void adc(const Operands& operands);
+    void inc(const Operands& operands);
+    void aaa(const Operands& operands);
+    void daa(const Operands& operands);
+    void sub(const Operands& operands);
+    void sbb(const Operands& operands);
+    void dec(const Operands& operands);
+    void neg(const Operands& operands);
+    void aas(const Operands& operands);
+    void das(const Operands& operands);
+    void mul(const Operands& operands);
+    void imul(const Operands& operands);
+    void aam(const Operands& operands);
+    void div(const Operands& operands);
+    void idiv(const Operands& operands);
+    void aad(const Operands& operands);
+    void cbw(const Operands& operands);
+    void cwd(const Operands& operands);
 };
 
 #endif
@@ -1,10 +1,8 @@
 #ifndef BIT_MANIPULATION_H
 #define BIT_MANIPULATION_H
 
-#include <string>
-#include <vector>
-
 #include "../memory_components.h"
+#include "../operands.h"
 #include "../registers.h"
 
 class Emulator8086;
@@ -16,14 +14,14 @@ class BitManipulationInstructions {
   public:
     BitManipulationInstructions(Emulator8086* emu);
 
-    void rcl(const std::vector<std::string>& operands);
-    void rcr(const std::vector<std::string>& operands);
-    void rol(const std::vector<std::string>& operands);
-    void ror(const std::vector<std::string>& operands);
-    void sal(const std::vector<std::string>& operands);
-    void sar(const std::vector<std::string>& operands);
-    void shl(const std::vector<std::string>& operands);
-    void shr(const std::vector<std::string>& operands);
+    void rcl(const Operands& operands);
+    void rcr(const Operands& operands);
+    void rol(const Operands& operands);
+    void ror(const Operands& operands);
+    void sal(const Operands& operands);
+    void sar(const Operands& operands);
+    void shl(const Operands& operands);
+    void shr(const Operands& operands);
 };
 
 #endif
@@ -1,10 +1,8 @@
 #ifndef DATA_TRANSFER_H
 #define DATA_TRANSFER_H
 
-#include <string>
-#include <vector>
-
 #include "../memory_components.h"
+#include "../operands.h"
 #include "../registers.h"
 
 class Emulator8086;
@@ -16,19 +14,19 @@ class DataTransferInstructions {
   public:
     DataTransferInstructions(Emulator8086* emu);
 
-    void mov(const std::vector<std::string>& operands);
-    void push(const std::vector<std::string>& operands);
-    void pop(const std::vector<std::string>& operands);
-    void xchg(const std::vector<std::string>& operands);
-    void lea(const std::vector<std::string>& operands);
-    void lds(const std::vector<std::string>& operands);
-    void les(const std::vector<std::string>& operands);
-    void lahf(const std::vector<std::string>& operands);
-    void sahf(const std::vector<std::string>& operands);
-    void pushf(const std::vector<std::string>& operands);
-    void popf(const std::vector<std::string>& operands);
-    void pusha(const std::vector<std::string>& operands);
-    void popa(const std::vector<std::string>& operands);
+    void mov(const Operands& operands);
+    void push(const Operands& operands);
+    void pop(const Operands& operands);
+    void xchg(const Operands& operands);
+    void lea(const Operands& operands);
+    void lds(const Operands& operands);
+    void les(const Operands& operands);
+    void lahf(const Operands& operands);
+    void sahf(const Operands& operands);
+    void pushf(const Operands& operands);
+    void popf(const Operands& operands);
+    void pusha(const Operands& operands);
+    void popa(const Operands& operands);
 };
 
 #endif
@@ -1,10 +1,8 @@
 #ifndef LOGICAL_H
 #define LOGICAL_H
 
-#include <string>
-#include <vector>
-
 #include "../memory_components.h"
+#include "../operands.h"
 #include "../registers.h"
 
 class Emulator8086;
@@ -16,12 +14,12 @@ class LogicalInstructions {
   public:
     LogicalInstructions(Emulator8086* emu);
 
-    void and_op(const std::vector<std::string>& operands);
-    void or_op(const std::vector<std::string>& operands);
-    void xor_op(const std::vector<std::string>& operands);
-    void not_op(const std::vector<std::string>& operands);
-    void test(const std::vector<std::string>& operands);
-    void cmp(const std::vector<std::string>& operands);
+    void and_op(const Operands& operands);
+    void or_op(const Operands& operands);
+    void xor_op(const Operands& operands);
+    void not_op(const Operands& operands);
+    void test(const Operands& operands);
+    void cmp(const Operands& operands);
 };
 
 #endif
@@ -1,10 +1,8 @@
 #ifndef PROCESSOR_CONTROL_H
 #define PROCESSOR_CONTROL_H
 
-#include <string>
-#include <vector>
-
 #include "../memory_components.h"
+#include "../operands.h"
 #include "../registers.h"
 
 class Emulator8086;
@@ -16,26 +14,26 @@ class ProcessorControlInstructions {
   public:
     ProcessorControlInstructions(Emulator8086* emu);
 
-    void clc(const std::vector<std::string>& operands);
-    void cmc(const std::vector<std::string>& operands);
-    void stc(const std::vector<std::string>& operands);
-    void cld(const std::vector<std::string>& operands);
-    void std(const std::vector<std::string>& operands);
-    void cli(const std::vector<std::string>& operands);
-    void sti(const std::vector<std::string>& operands);
-
-    void hlt(const std::vector<std::string>& operands);
-    void wait(const std::vector<std::string>& operands);
-    void esc(const std::vector<std::string>& operands);
-    void lock(const std::vector<std::string>& operands);
-    void nop(const std::vector<std::string>& operands);
-
-    void int_op(const std::vector<std::string>& operands);
-    void into(const std::vector<std::string>& operands);
-    void iret(const std::vector<std::string>& operands);
-
-    void in_op(const std::vector<std::string>& operands);
-    void out(const std::vector<std::string>& operands);
+    void clc(const Operands& operands);
+    void cmc(const Operands& operands);
+    void stc(const Operands& operands);
+    void cld(const Operands& operands);
+    void std(const Operands& operands);
+    void cli(const Operands& operands);
+    void sti(const Operands& operands);
+
+    void hlt(const Operands& operands);
+    void wait(const Operands& operands);
+    void esc(const Operands& operands);
+    void lock(const Operands& operands);
+    void nop(const Operands& operands);
+
+    void int_op(const Operands& operands);
+    void into(const Operands& operands);
+    void iret(const Operands& operands);
+
+    void in_op(const Operands& operands);
+    void out(const Operands& operands);
 };
 
 #endif
@@ -1,10 +1,8 @@
 #ifndef PROGRAM_TRANSFER_H
 #define PROGRAM_TRANSFER_H
 
-#include <string>
-#include <vector>
-
 #include "../memory_components.h"
+#include "../operands.h"
 #include "../registers.h"
 
 class Emulator8086;
@@ -16,32 +14,32 @@ class ProgramTransferInstructions {
   public:
     ProgramTransferInstructions(Emulator8086* emu);
 
-    void call(const std::vector<std::string>& operands);
-    void jmp(const std::vector<std::string>& operands);
-    void ret(const std::vector<std::string>& operands);
-    void retf(const std::vector<std::string>& operands);
-
-    void je(const std::vector<std::string>& operands);
-    void jl(const std::vector<std::string>& operands);
-    void jle(const std::vector<std::string>& operands);
-    void jb(const std::vector<std::string>& operands);
-    void jbe(const std::vector<std::string>& operands);
-    void jp(const std::vector<std::string>& operands);
-    void jo(const std::vector<std::string>& operands);
-    void js(const std::vector<std::string>& operands);
-    void jne(const std::vector<std::string>& operands);
-    void jnl(const std::vector<std::string>& operands);
-    void jg(const std::vector<std::string>& operands);
-    void jnb(const std::vector<std::string>& operands);
-    void ja(const std::vector<std::string>& operands);
-    void jnp(const std::vector<std::string>& operands);
-    void jno(const std::vector<std::string>& operands);
-    void jns(const std::vector<std::string>& operands);
-
-    void loop(const std::vector<std::string>& operands);
-    void loopz(const std::vector<std::string>& operands);
-    void loopnz(const std::vector<std::string>& operands);
-    void jcxz(const std::vector<std::string>& operands);
+    void call(const Operands& operands);
+    void jmp(const Operands& operands);
+    void ret(const Operands& operands);
+    void retf(const Operands& operands);
+
+    void je(const Operands& operands);
+    void jl(const Operands& operands);
+    void jle(const Operands& operands);
+    void jb(const Operands& operands);
+    void jbe(const Operands& operands);
+    void jp(const Operands& operands);
+    void jo(const Operands& operands);
+    void js(const Operands& operands);
+    void jne(const Operands& operands);
+    void jnl(const Operands& operands);
+    void jg(const Operands& operands);
+    void jnb(const Operands& operands);
+    void ja(const Operands& operands);
+    void jnp(const Operands& operands);
+    void jno(const Operands& operands);
+    void jns(const Operands& operands);
+
+    void loop(const Operands& operands);
+    void loopz(const Operands& operands);
+    void loopnz(const Operands& operands);
+    void jcxz(const Operands& operands);
 };
 
 #endif
@@ -1,10 +1,10 @@
 #ifndef STRING_H
 #define STRING_H
 
-#include <string>
-#include <vector>
+#include <cstddef>
 
 #include "../memory_components.h"
+#include "../operands.h"
 #include "../registers.h"
 
 class Emulator8086;
@@ -13,26 +13,36 @@ class StringInstructions {
   private:
     Emulator8086* emulator;
 
+    // Iterations a REP runs per call before it suspends and lets the run loop stop or go on.
+    static constexpr size_t kRepeatChunk = 4096;
+
+    // REP fast paths: do `count` iterations at once on host memory. Return false, changing
+    // nothing, when the elements must go one at a time (watched or hooked memory, a range
+    // that wraps or leaves memory, or an overlap closer than one element).
+    bool bulkMove(size_t size, size_t count);
+    bool bulkStore(size_t size, size_t count);
+    // REPE/REPNE CMPS and SCAS: finds the element among the next `count` that ends the
+    // repeat with a vector search and executes only that one, with the same fallbacks.
+    bool bulkCompare(bool scan, size_t size, bool whileEqual, size_t count);
+    void repeatCompare(std::string_view op, bool whileEqual);
+
   public:
     StringInstructions(Emulator8086* emu);
 
-    void movsb(const std::vector<std::string>& operands);
-    void movsw(const std::vector<std::string>& operands);
-    void cmpsb(const std::vector<std::string>& operands);
-    void cmpsw(const std::vector<std::string>& operands);
-    void scasb(const std::vector<std::string>& operands);
-    void scasw(const std::vector<std::string>& operands);
-    void lodsb(const std::vector<std::string>& operands);
-    void lodsw(const std::vector<std::string>& operands);
-    void stosb(const std::vector<std::string>& operands);
-    void stosw(const std::vector<std::string>& operands);
-    void rep(const std::vector<std::string>& operands);
-    void repe(const std::vector<std::string>& operands);
-    void repne(const std::vector<std::string>& operands);
-    void repnz(const std::vector<std::string>& operands);
-    void repz(const std::vector<std::string>& operands);
-    void xlat(const std::vector<std::string>& operands);
-    void xlatb(const std::vector<std::string>& operands);
+    void movsb(const Operands& operands);
+    void movsw(const Operands& operands);
+    void cmpsb(const Operands& operands);
+    void cmpsw(const Operands& operands);
+    void scasb(const Operands& operands);
+    void scasw(const Operands& operands);
+    void lodsb(const Operands& operands);
+    void lodsw(const Operands& operands);
+    void stosb(const Operands& operands);
+    void stosw(const Operands& operands);
+    void rep(const Operands& operands);
+    void repe(const Operands& operands);
+    void repne(const Operands& operands);
+    void xlat(const Operands& operands);
 };
 
 #endif
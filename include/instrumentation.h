@@ -0,0 +1,114 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "registers.h"
+
+// Base instrumentation policy for Emulator8086::run(). A policy derives from this, shadows the
+// callbacks it needs and flips the matching flag; everything left at false is compiled out of
+// the run loop. Retire is called directly from the templated loop and inlines.
+struct NullInstrumentation {
+    static constexpr bool kRetire = false;
+    static constexpr bool kMemory = false;
+    static constexpr bool kPorts = false;
+    static constexpr bool kInterrupts = false;
+
+    void onRetire(size_t /*line*/, const Registers& /*before*/, const Registers& /*after*/) {}
+    void onMemoryRead(uint16_t /*address*/, uint16_t /*value*/, bool /*isByte*/) {}
+    void onMemoryWrite(uint16_t /*address*/, uint16_t /*value*/, bool /*isByte*/) {}
+    void onPortIn(uint16_t /*port*/, uint16_t /*value*/) {}
+    void onPortOut(uint16_t /*port*/, uint16_t /*value*/) {}
+    void onInterrupt(uint8_t /*vector*/, size_t /*returnLine*/) {}
+};
+
+// Memory, port and interrupt events are raised from inside the out-of-line instruction
+// handlers, so they reach the policy through these pointers. run() only fills the ones the
+// policy asks for; with NullInstrumentation each access costs one predictable null test.
+struct InstrumentationThunks {
+    void* context = nullptr;
+    void (*memoryRead)(void*, uint16_t, uint16_t, bool) = nullptr;
+    void (*memoryWrite)(void*, uint16_t, uint16_t, bool) = nullptr;
+    void (*portIn)(void*, uint16_t, uint16_t) = nullptr;
+    void (*portOut)(void*, uint16_t, uint16_t) = nullptr;
+    void (*interrupt)(void*, uint8_t, size_t) = nullptr;
+
+    template <typename Policy>
+    static InstrumentationThunks bind(Policy& policy) {
+        InstrumentationThunks thunks;
+        thunks.context = &policy;
+        if constexpr (Policy::kMemory) {
+            thunks.memoryRead = [](void* ctx, uint16_t address, uint16_t value, bool isByte) {
+                static_cast<Policy*>(ctx)->onMemoryRead(address, value, isByte);
+            };
+            thunks.memoryWrite = [](void* ctx, uint16_t address, uint16_t value, bool isByte) {
+                static_cast<Policy*>(ctx)->onMemoryWrite(address, value, isByte);
+            };
+        }
+        if constexpr (Policy::kPorts) {
+            thunks.portIn = [](void* ctx, uint16_t port, uint16_t value) {
+                static_cast<Policy*>(ctx)->onPortIn(port, value);
+            };
+            thunks.portOut = [](void* ctx, uint16_t port, uint16_t value) {
+                static_cast<Policy*>(ctx)->onPortOut(port, value);
+            };
+        }
+        if constexpr (Policy::kInterrupts) {
+            thunks.interrupt = [](void* ctx, uint8_t vector, size_t returnLine) {
+                static_cast<Policy*>(ctx)->onInterrupt(vector, returnLine);
+            };
+        }
+        return thunks;
+    }
+};
+
+// Restores the previously installed thunks when run() returns or unwinds.
+class ScopedInstrumentationThunks {
+  public:
+    ScopedInstrumentationThunks(InstrumentationThunks& slot, const InstrumentationThunks& thunks)
+        : slot(slot), saved(slot) {
+        slot = thunks;
+    }
+    ~ScopedInstrumentationThunks() {
+        slot = saved;
+    }
+    ScopedInstrumentationThunks(const ScopedInstrumentationThunks&) = delete;
+    ScopedInstrumentationThunks& operator=(const ScopedInstrumentationThunks&) = delete;
+
+  private:
+    InstrumentationThunks& slot;
+    InstrumentationThunks saved;
+};
+
+// Records which 256-byte pages of the 64K address space were written, in first-write order,
+// so consumers only rehash or copy those.
+struct DirtyPageTracker : NullInstrumentation {
+    static constexpr bool kMemory = true;
+    static constexpr size_t kPageShift = 8;
+    static constexpr size_t kPageCount = 0x10000 >> kPageShift;
+
+    void onMemoryWrite(uint16_t address, uint16_t /*value*/, bool isByte) {
+        mark(address >> kPageShift);
+        if (!isByte)
+            mark(static_cast<uint16_t>(address + 1) >> kPageShift);
+    }
+    void mark(size_t page) {
+        if (!dirty[page]) {
+            dirty[page] = true;
+            dirtyPages.push_back(page);
+        }
+    }
+    void clear() {
+        for (size_t page : dirtyPages)
+            dirty[page] = false;
+        dirtyPages.clear();
+    }
+
+    std::array<bool, kPageCount> dirty{};
+    std::vector<size_t> dirtyPages;
+};
+
+#endif
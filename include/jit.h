@@ -0,0 +1,91 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "registers.h"
+
+class Emulator8086;
+
+// Translates hot basic blocks to x86-64 machine code (Linux only; elsewhere nothing is ever
+// translated). A block is a run of register/immediate MOV, ALU, INC/DEC and NOT/NEG lines,
+// optionally ended by a jump or loop; its operands are resolved like a fused pair's. While
+// translated code runs, AX..DI and FLAGS live in host registers, and a block's exits jump
+// straight into the block they lead to once that one is translated.
+//
+// Anything else - memory operands, I/O, interrupts, string instructions - ends the block and
+// goes back to the interpreter, as do lines with breakpoints, which are never translated.
+// Translations are dropped whenever the program or its breakpoints change.
+class Jit {
+  public:
+    // Entries to a block leader before it is translated. Leaders are the lines a block can
+    // start at: labels and the lines after a branch or an instruction that is not translated.
+    static constexpr uint16_t kHotThreshold = 16;
+    static constexpr size_t kMaxBlockLength = 64;
+
+    explicit Jit(Emulator8086* emulator);
+    ~Jit();
+    Jit(const Jit&) = delete;
+    Jit& operator=(const Jit&) = delete;
+
+    // Whether this host can run translated code at all.
+    static bool isSupported();
+
+    // Forgets every translation and the entry counts; call after the program changes.
+    void flush();
+
+    // Drops the blocks covering any of `lines`, e.g. after a breakpoint or the dead flags of
+    // those lines change. Exits into a dropped block go back to the interpreter until the
+    // line gets hot and is translated again.
+    void invalidate(const std::vector<size_t>& lines);
+
+    // Runs translated code from `line` for at most `budget` instructions and returns how many
+    // ran, leaving IP at the next line. 0 means the interpreter has to run the line: it has
+    // no translation yet, cannot be translated, or its block does not fit in the budget.
+    size_t execute(size_t line, Registers& regs, size_t budget) {
+        if (line >= entries.size())
+            return 0;
+        if (const uint8_t* code = entries[line])
+            return enter(code, regs, budget);
+        if (heat[line] >= kHotThreshold || ++heat[line] < kHotThreshold)
+            return 0;
+        return translate(line) ? enter(entries[line], regs, budget) : 0;
+    }
+
+    size_t blockCount() const {
+        return blocks;
+    }
+
+  private:
+    Emulator8086* emulator;
+    std::vector<const uint8_t*> entries;  // Per line: its block's code, or nullptr.
+    std::vector<uint16_t> heat;  // Per line: entries seen; kHotThreshold once tried or no leader.
+    // Exits that still leave to the interpreter, by the line they go to; linked to that line's
+    // block when it gets one.
+    std::unordered_map<size_t, std::vector<uint8_t*>> unlinkedExits;
+    // Exits that jump straight into the block at a line.
+    std::unordered_map<size_t, std::vector<uint8_t*>> linkedExits;
+    struct Block {
+        size_t length;
+        std::vector<std::pair<uint8_t*, size_t>> exits;  // (jmp field, line)
+    };
+    std::unordered_map<size_t, Block> translated;  // By first line.
+    size_t blocks = 0;
+
+    uint8_t* code = nullptr;  // Executable region; the trampoline sits at the start.
+    size_t codeSize = 0;
+    size_t codeUsed = 0;
+    size_t trampolineSize = 0;
+    const uint8_t* exitStub = nullptr;
+
+    size_t enter(const uint8_t* block, Registers& regs, size_t budget);
+    bool translate(size_t line);
+    void drop(size_t start);
+    bool allocate();
+    void emitTrampoline();
+};
+
+#endif
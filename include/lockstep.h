@@ -0,0 +1,71 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "emulator8086.h"
+#include "instrumentation.h"
+
+struct LockstepResult {
+    bool diverged = false;
+    uint64_t steps = 0;  // Instructions retired by both engines.
+    size_t line = 0;     // Program index of the divergent instruction.
+    std::string instruction;
+    std::vector<std::string> differences;
+};
+
+// Runs two engine instances over the same program one instruction at a time and compares the
+// full register file after every step. Memory is compared through per-page FNV-1a hashes that
+// are refreshed only for pages either engine wrote, folded into one running hash per engine.
+class LockstepChecker {
+  public:
+    // Advances the given engine by one step. The default is run(tracker, 1), one instruction,
+    // which never leaves the budget for a fused pair or a translated block; giving both sides
+    // run(tracker, N) checks those every N instructions. Other engines plug in here as long as
+    // they report writes to the tracker.
+    using Stepper = std::function<void(Emulator8086&, DirtyPageTracker&)>;
+
+    LockstepChecker(Emulator8086& reference, Emulator8086& candidate);
+
+    void setReferenceStepper(Stepper stepper) {
+        sides[0].stepper = std::move(stepper);
+    }
+    void setCandidateStepper(Stepper stepper) {
+        sides[1].stepper = std::move(stepper);
+    }
+
+    // Loads the program into both engines after resetting them.
+    void load(const std::vector<std::string>& program);
+    void load(const DecodedProgram& program);
+    void load(const std::shared_ptr<const Program>& program);
+    LockstepResult run(uint64_t maxSteps);
+
+    static std::string formatReport(const LockstepResult& result);
+
+  private:
+    struct Side {
+        Emulator8086* emu;
+        Stepper stepper;
+        DirtyPageTracker tracker;
+        std::array<uint64_t, DirtyPageTracker::kPageCount> pageHashes{};
+        uint64_t memoryHash = 0;
+    };
+
+    std::array<Side, 2> sides;
+
+    void rehashAll(Side& side);
+    void rehashPage(Side& side, size_t page);
+    void compareRegisters(std::vector<std::string>& differences) const;
+    void compareMemory(std::vector<std::string>& differences) const;
+};
+
+// Deterministic random straight-line-ish program for fuzzing engines against each other. Only
+// forward branches are generated so every program terminates.
+std::vector<std::string> generateRandomProgram(uint32_t seed, size_t length);
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef OPCODE_PROFILE_H
+#define OPCODE_PROFILE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "instruction_table.h"
+#include "instrumentation.h"
+#include "registers.h"
+
+// Instruction-mix statistics for choosing fusions and fast paths: opcode, bigram and trigram
+// frequencies, addressing modes per opcode and how many instructions work on bytes versus
+// words. Counters are flat arrays indexed by opcode, so counting a retirement is a few
+// increments. Counts accumulate over every program attached, so one profile can cover a
+// whole batch; n-grams never span two programs.
+class OpcodeProfile {
+  public:
+    enum class Mode : uint8_t {
+        Register8,
+        Register16,
+        Segment,
+        Immediate,
+        Direct,              // [disp]
+        RegisterIndirect,    // [BX]
+        Based,               // [BX + disp], [BP + disp]
+        Indexed,             // [SI + disp], [DI + disp]
+        BasedIndexed,        // [BX + SI]
+        BasedIndexedOffset,  // [BX + SI + disp]
+        Label,
+    };
+    static constexpr size_t kModeCount = static_cast<size_t>(Mode::Label) + 1;
+
+    enum class Width : uint8_t { Byte, Word, None };
+
+    struct Gram {
+        Opcode ops[3] = {Opcode::Invalid, Opcode::Invalid, Opcode::Invalid};
+        uint64_t count = 0;
+    };
+
+    OpcodeProfile();
+
+    // Starts counting a new program; call before running it.
+    void attach(const std::vector<std::string>& program);
+    void reset();
+
+    void onRetire(size_t line) {
+        if (line >= lines.size() || lines[line].opcode == Opcode::Invalid)
+            return;
+        const LineInfo& info = lines[line];
+        size_t op = static_cast<size_t>(info.opcode);
+        ++unigrams[op];
+        ++widths[static_cast<size_t>(info.width)];
+        for (size_t i = 0; i < info.modeCount; ++i)
+            ++modes[op * kModeCount + info.modes[i]];
+        if (previous != kNone) {
+            ++bigrams[previous * kOpcodeCount + op];
+            if (beforePrevious != kNone)
+                ++trigrams[(beforePrevious * kOpcodeCount + previous) * kOpcodeCount + op];
+        }
+        beforePrevious = previous;
+        previous = op;
+        ++total;
+    }
+
+    uint64_t getTotal() const {
+        return total;
+    }
+    uint64_t count(Opcode op) const {
+        return unigrams[static_cast<size_t>(op)];
+    }
+    uint64_t count(Opcode a, Opcode b) const;
+    uint64_t count(Opcode a, Opcode b, Opcode c) const;
+    uint64_t modeCount(Opcode op, Mode mode) const {
+        return modes[static_cast<size_t>(op) * kModeCount + static_cast<size_t>(mode)];
+    }
+    uint64_t widthCount(Width width) const {
+        return widths[static_cast<size_t>(width)];
+    }
+
+    // Non-zero n-grams of length 1 to 3, most frequent first.
+    std::vector<Gram> ranked(size_t length) const;
+
+    static Mode classifyOperand(std::string_view operand);
+    static const char* modeName(Mode mode);
+
+    // Human-readable tables, each cut to the `top` most frequent rows.
+    void writeReport(std::ostream& out, size_t top = 20) const;
+    // One record per line: "op MNEMONIC n", "pair A B n", "triple A B C n",
+    // "mode MNEMONIC MODE n" and "width byte|word|none n". FusionCandidates reads the pair
+    // records, so the file can be passed straight to --fusion.
+    void writeData(std::ostream& out) const;
+    bool exportData(const std::string& path) const;
+
+  private:
+    static constexpr size_t kNone = kOpcodeCount;
+
+    struct LineInfo {
+        Opcode opcode = Opcode::Invalid;
+        Width width = Width::None;
+        uint8_t modeCount = 0;
+        uint8_t modes[2] = {};
+    };
+
+    std::vector<LineInfo> lines;
+    std::vector<uint64_t> unigrams;
+    std::vector<uint64_t> bigrams;
+    std::vector<uint64_t> trigrams;
+    std::vector<uint64_t> modes;
+    uint64_t widths[3] = {};
+    uint64_t total = 0;
+    size_t previous = kNone;
+    size_t beforePrevious = kNone;
+};
+
+struct OpcodeProfileInstrumentation : NullInstrumentation {
+    static constexpr bool kRetire = true;
+
+    explicit OpcodeProfileInstrumentation(OpcodeProfile& profile) : profile(profile) {}
+    void onRetire(size_t line, const Registers&, const Registers&) {
+        profile.onRetire(line);
+    }
+
+    OpcodeProfile& profile;
+};
+
+#endif
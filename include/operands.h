@@ -0,0 +1,66 @@
+#ifndef OPERANDS_H
+#define OPERANDS_H
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <string_view>
+
+// Operands of one instruction as views into its text. The capacity is fixed so tokenizing an
+// instruction never touches the heap; the views are only valid while that text is.
+class Operands {
+  public:
+    static constexpr size_t kCapacity = 4;
+
+    Operands() = default;
+    Operands(std::initializer_list<std::string_view> list);
+
+    // Throws std::runtime_error past kCapacity.
+    void push_back(std::string_view operand);
+
+    size_t size() const {
+        return count;
+    }
+    bool empty() const {
+        return count == 0;
+    }
+    const std::string_view& operator[](size_t index) const {
+        return items[index];
+    }
+    const std::string_view* begin() const {
+        return items.data();
+    }
+    const std::string_view* end() const {
+        return items.data() + count;
+    }
+
+  private:
+    std::array<std::string_view, kCapacity> items{};
+    size_t count = 0;
+};
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+// ASCII case-insensitive ordering. Transparent, so maps keyed by std::string can be searched
+// with a std::string_view without building a key.
+struct CaseInsensitiveLess {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const;
+};
+
+using LabelMap = std::map<std::string, size_t, CaseInsensitiveLess>;
+
+enum class NumberParse { Ok, Invalid, OutOfRange };
+
+// Parses the longest numeric prefix of `text` the way std::stol does: leading whitespace, an
+// optional sign and, for base 16, an optional 0x. Stops at the first character that is not a
+// digit. OutOfRange if the value does not fit in a long.
+NumberParse parseIntegerPrefix(std::string_view text, int base, long& value);
+
+// Immediate operands: with `hex` the operand ends in 'h', which is dropped, otherwise the
+// value is decimal and must fit in an int. Throws std::runtime_error on a bad value.
+long parseImmediate(std::string_view operand, bool hex);
+
+#endif
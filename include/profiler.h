@@ -0,0 +1,134 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "instruction_table.h"
+#include "instrumentation.h"
+#include "operands.h"
+#include "registers.h"
+
+class Profiler {
+  public:
+    struct Cost {
+        uint64_t instructions = 0;
+        uint64_t cycles = 0;
+    };
+
+    struct BranchStats {
+        uint64_t taken = 0;
+        uint64_t notTaken = 0;
+    };
+
+    struct FunctionStats {
+        std::string name;
+        uint64_t calls = 0;
+        Cost inclusive;
+        Cost exclusive;
+    };
+
+    // Binds the profiler to a loaded program. sourceLines maps a program index to its
+    // 1-based line in the source file and is used for the callgrind export.
+    void attach(const std::vector<std::string>& program,
+                const LabelMap& labels,
+                const std::vector<size_t>& sourceLines);
+    void reset();
+
+    // Called once per retired instruction with the register file before and after it.
+    void onRetire(size_t line, const Registers& before, const Registers& after);
+
+    const std::vector<Cost>& getLineCosts() const {
+        return lineCosts;
+    }
+    const std::map<size_t, BranchStats>& getBranchStats() const {
+        return branches;
+    }
+    const Cost& getTotal() const {
+        return total;
+    }
+    size_t getCallDepth() const {
+        return stack.size();
+    }
+
+    std::vector<FunctionStats> getFunctionStats() const;
+    std::vector<size_t> hottestLines(size_t count) const;
+
+    void writeFolded(std::ostream& out) const;
+    void writeCallgrind(std::ostream& out, const std::string& sourceName) const;
+    bool exportFolded(const std::string& path) const;
+    bool exportCallgrind(const std::string& path, const std::string& sourceName) const;
+
+  private:
+    struct LineInfo {
+        InstructionKind kind = InstructionKind::Plain;
+        Opcode opcode = Opcode::Invalid;
+        uint32_t baseCycles = 0;
+        uint32_t extraCycles = 0;
+        uint8_t condition = 0;
+        bool countInCl = false;  // Shift or rotate by CL.
+    };
+
+    struct Frame {
+        size_t function;
+        size_t callLine;
+        Cost entry;
+        size_t foldedKey;
+    };
+
+    struct CallEdge {
+        uint64_t count = 0;
+        Cost inclusive;
+    };
+
+    std::vector<LineInfo> lines;
+    std::vector<size_t> sourceLineMap;
+    std::map<size_t, std::string> labelAt;
+
+    std::vector<Cost> lineCosts;
+    std::map<size_t, BranchStats> branches;
+    Cost total;
+
+    std::vector<FunctionStats> functions;
+    std::vector<size_t> functionEntry;
+    std::unordered_map<std::string, size_t> functionIds;
+    std::vector<uint32_t> activeFrames;
+    std::vector<Frame> stack;
+    size_t currentLine = 0;
+
+    std::unordered_map<uint64_t, Cost> selfCosts;
+    std::map<std::tuple<size_t, size_t, size_t>, CallEdge> callEdges;
+
+    std::vector<std::string> foldedPaths;
+    std::vector<uint64_t> foldedCycles;
+    std::unordered_map<std::string, size_t> foldedIds;
+
+    size_t functionId(const std::string& name);
+    size_t foldedId(const std::string& path);
+    void pushFrame(const std::string& name, size_t entryLine);
+    void popFrame();
+    uint32_t cyclesFor(const LineInfo& info,
+                       const Registers& before,
+                       const Registers& after,
+                       bool taken) const;
+    bool conditionTaken(const LineInfo& info, const Registers& before) const;
+    size_t sourceLine(size_t line) const;
+};
+
+struct ProfilerInstrumentation : NullInstrumentation {
+    static constexpr bool kRetire = true;
+
+    explicit ProfilerInstrumentation(Profiler& profiler) : profiler(profiler) {}
+    void onRetire(size_t line, const Registers& before, const Registers& after) {
+        profiler.onRetire(line, before, after);
+    }
+
+    Profiler& profiler;
+};
+
+#endif
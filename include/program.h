@@ -0,0 +1,81 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "flag_liveness.h"
+#include "fusion.h"
+#include "instruction_table.h"
+#include "operands.h"
+#include "source_loader.h"
+
+// Tables worked out ahead of time, e.g. read back from a program image. Each is used as given
+// when it has one entry per line and worked out from the text otherwise.
+struct ProgramTables {
+    std::vector<DecodedInstruction> decodedLines;
+    std::vector<FusedPair> fusedLines;  // With FusionCandidates::all().
+    std::vector<uint16_t> deadFlags;    // With no breakpoints.
+};
+
+// A loaded program: its instruction text, decoded instructions, labels and source lines,
+// plus the fused pairs and dead flag writes an emulator with default settings runs with.
+// It never changes once built, so any number of emulators, on any threads, can share one
+// through a shared_ptr. Everything per run - registers, memory, breakpoints - stays in the
+// emulator.
+class Program {
+  public:
+    explicit Program(DecodedProgram decoded, ProgramTables tables = {});
+    Program(const Program&) = delete;
+    Program& operator=(const Program&) = delete;
+
+    static std::shared_ptr<const Program> create(DecodedProgram decoded,
+                                                 ProgramTables tables = {}) {
+        return std::make_shared<const Program>(std::move(decoded), std::move(tables));
+    }
+    // The program of a freshly constructed emulator; one shared instance.
+    static const std::shared_ptr<const Program>& empty();
+
+    size_t size() const {
+        return lines.size();
+    }
+    const std::vector<std::string>& getLines() const {
+        return lines;
+    }
+    const std::vector<DecodedInstruction>& getDecodedLines() const {
+        return decodedLines;
+    }
+    const std::vector<size_t>& getSourceLines() const {
+        return sourceLines;
+    }
+    const LabelMap& getLabels() const {
+        return labels;
+    }
+    // With FusionCandidates::all().
+    const std::vector<FusedPair>& getFusedPairs() const {
+        return fusedLines;
+    }
+    // With no breakpoints.
+    const std::vector<uint16_t>& getDeadFlags() const {
+        return deadFlags;
+    }
+    // What dead flags with breakpoints are worked out from. Built on first use when the dead
+    // flags came with the program, as only breakpoints and watchpoints need it then.
+    const FlagFlowGraph& getFlagFlow() const;
+
+  private:
+    std::vector<std::string> lines;
+    std::vector<DecodedInstruction> decodedLines;  // Parallel to lines.
+    std::vector<size_t> sourceLines;
+    LabelMap labels;
+    std::vector<FusedPair> fusedLines;
+    std::vector<uint16_t> deadFlags;
+    mutable std::once_flag flagFlowBuilt;
+    mutable FlagFlowGraph flagFlow;
+};
+
+#endif
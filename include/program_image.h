@@ -0,0 +1,168 @@
+#ifndef PROGRAM_IMAGE_H
+#define PROGRAM_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "program.h"
+#include "source_loader.h"
+
+// .i86img: a decoded program laid out so it can be used straight from a read-only mapping.
+// Everything is addressed by byte offsets from the start of the file:
+//
+//   ImageHeader
+//   ImageInstruction[instructionCount]  text in the string pool, 1-based source line
+//   ImageDecoded[instructionCount]      opcode and operand offsets into the text
+//   ImageLabel[labelCount]              name in the string pool, program index
+//   ImageFused[fusedCount]              the lines that start a pair, with FusionCandidates::all()
+//   uint16_t[instructionCount]          dead flag writes with no breakpoints
+//   string pool
+//
+// Fields are little-endian; an image written on a host with the other byte order is rejected.
+// Opcodes are numbered as in the instruction table, so `tableHash` ties an image to the table
+// it was written with.
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t sourceHash;
+    uint64_t sourceSize;
+    uint64_t tableHash;
+    uint64_t sourceLineCount;
+    uint64_t instructionCount;
+    uint64_t labelCount;
+    uint64_t fusedCount;
+    uint64_t instructionsOffset;
+    uint64_t decodedOffset;
+    uint64_t labelsOffset;
+    uint64_t fusedOffset;
+    uint64_t deadFlagsOffset;
+    uint64_t stringsOffset;
+    uint64_t fileSize;
+};
+
+struct ImageInstruction {
+    uint64_t textOffset;  // Relative to the string pool.
+    uint32_t textLength;
+    uint32_t sourceLine;
+};
+
+struct ImageDecoded {
+    uint8_t opcode;
+    uint8_t operandCount;
+    uint16_t reserved;
+    uint32_t operandStart[Operands::kCapacity];  // Relative to the instruction's text.
+    uint32_t operandLength[Operands::kCapacity];
+};
+
+struct ImageFusedOperand {
+    uint8_t kind;
+    uint8_t reg;
+    uint16_t value;
+};
+
+struct ImageFused {
+    uint32_t line;
+    uint8_t first;
+    uint8_t second;
+    uint8_t byte;
+    uint8_t secondByte;
+    ImageFusedOperand dest;
+    ImageFusedOperand src;
+    ImageFusedOperand secondDest;
+    ImageFusedOperand secondSrc;
+    uint16_t target;
+    uint16_t reserved;
+};
+
+struct ImageLabel {
+    uint64_t nameOffset;
+    uint32_t nameLength;
+    uint32_t reserved;
+    uint64_t programIndex;
+};
+
+// 64-bit hash of the source bytes, eight at a time; images are keyed and checked by it.
+uint64_t hashSource(std::string_view text);
+
+// Hash of the instruction table's mnemonics, kinds and flags, the parts the stored tables
+// depend on.
+uint64_t hashInstructionTable();
+
+class ProgramImage {
+  public:
+    // Bump when decoding, fusion or the liveness pass change what they produce.
+    static constexpr uint32_t kVersion = 2;
+
+    // Maps an image and checks its header and table bounds. Throws std::runtime_error if the
+    // file is missing, truncated, from another format version or from another instruction
+    // table.
+    explicit ProgramImage(const std::string& path);
+
+    static void write(const std::string& path,
+                      const Program& program,
+                      std::string_view source,
+                      size_t sourceLineCount);
+
+    const ImageHeader& getHeader() const {
+        return *header;
+    }
+    size_t instructionCount() const {
+        return header->instructionCount;
+    }
+    std::string_view instruction(size_t index) const;
+    size_t sourceLine(size_t index) const {
+        return instructions[index].sourceLine;
+    }
+    size_t labelCount() const {
+        return header->labelCount;
+    }
+    std::string_view labelName(size_t index) const;
+    size_t labelIndex(size_t index) const {
+        return labels[index].programIndex;
+    }
+
+    // The engine still executes from owned strings, so this copies the text and tables out;
+    // nothing is re-parsed, re-fused or re-analysed. Throws std::runtime_error if a table
+    // entry is out of range.
+    std::shared_ptr<const Program> toProgram() const;
+
+  private:
+    MappedFile file;
+    const ImageHeader* header = nullptr;
+    const ImageInstruction* instructions = nullptr;
+    const ImageDecoded* decoded = nullptr;
+    const ImageLabel* labels = nullptr;
+    const ImageFused* fused = nullptr;
+    const uint16_t* deadFlags = nullptr;
+    std::string_view strings;
+
+    std::string_view poolString(uint64_t offset, uint32_t length) const;
+};
+
+// Decoded programs cached on disk as images named by the hash of their source, so repeated
+// runs of an unchanged file skip parsing and analysis.
+class ProgramCache {
+  public:
+    // $IM8086_CACHE_DIR, else $XDG_CACHE_HOME/im8086, else ~/.cache/im8086. Empty if none of
+    // them is set, which disables caching.
+    static std::string defaultDirectory();
+
+    explicit ProgramCache(std::string directory = defaultDirectory());
+
+    std::string imagePath(uint64_t sourceHash) const;
+
+    // Loads a source file through its cached image when one matches the file's contents, and
+    // decodes it and writes the image otherwise. `hit` reports which happened.
+    std::shared_ptr<const Program> load(const std::string& sourcePath,
+                                        bool* hit = nullptr,
+                                        SourceLoadStats* stats = nullptr);
+
+  private:
+    std::string directory;
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SOURCE_LOADER_H
+#define SOURCE_LOADER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "operands.h"
+
+// What loadProgram() keeps of a source: the instruction text per program index, the 1-based
+// source line each came from, and labels mapped to the program index that follows them.
+struct DecodedProgram {
+    std::vector<std::string> instructions;
+    std::vector<size_t> sourceLines;
+    LabelMap labels;
+};
+
+enum class SourceLineKind { Blank, Instruction, Label };
+
+// Trims a source line and drops its comment the way loadProgram() always has. `text` is set
+// to the instruction, or to the label name without its ':' (not yet upper-cased).
+SourceLineKind classifySourceLine(std::string_view line, std::string_view& text);
+
+struct SourceLoadOptions {
+    unsigned threads = 0;  // 0 = std::thread::hardware_concurrency().
+    size_t chunkSize = size_t(1) << 20;  // Bytes per parallel decode task.
+};
+
+struct SourceLoadStats {
+    size_t bytes = 0;
+    size_t lines = 0;
+    unsigned threads = 0;
+    double seconds = 0.0;
+
+    double megabytesPerSecond() const;
+    std::string summary() const;
+};
+
+// Read-only view of a whole file, memory-mapped where the platform allows it.
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const {
+        return std::string_view(data, length);
+    }
+
+  private:
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::string fallback;
+};
+
+// Splits `text` into chunks on line boundaries, decodes the chunks in parallel and merges
+// labels in one serial pass. The result matches loadProgram() on the same lines.
+DecodedProgram decodeSource(std::string_view text,
+                            const SourceLoadOptions& options = SourceLoadOptions(),
+                            SourceLoadStats* stats = nullptr);
+DecodedProgram loadSourceFile(const std::string& path,
+                              const SourceLoadOptions& options = SourceLoadOptions(),
+                              SourceLoadStats* stats = nullptr);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef STRING_SCAN_H
+#define STRING_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Vector search behind REPE/REPNE CMPS and SCAS. Compares data[i] with other[i], or with the
+// pattern when other is null (low byte at even offsets, high byte at odd ones), and returns
+// the offset of the first byte whose equality is `matchEqual`: the lowest such offset, or the
+// highest when `descending`. Returns `length` when there is none.
+//
+// Uses 32-byte AVX2 compares when the CPU has them, 16-byte SSE2 compares otherwise and plain
+// byte compares where neither is available.
+size_t scanBytes(const uint8_t* data,
+                 const uint8_t* other,
+                 uint16_t pattern,
+                 size_t length,
+                 bool matchEqual,
+                 bool descending);
+
+#endif
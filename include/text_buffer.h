@@ -0,0 +1,101 @@
+#ifndef TEXT_BUFFER_H
+#define TEXT_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Piece-table text buffer for the editors. The text is a sequence of pieces pointing into the
+// immutable original text or the append-only add buffer. Pieces live in a treap ordered by
+// position whose nodes also sum lengths and newline counts, so inserting, erasing and mapping
+// between offsets and line numbers are all O(log n) with no size limit.
+class TextBuffer {
+  public:
+    TextBuffer();
+    explicit TextBuffer(std::string text);
+
+    size_t size() const;
+    size_t lineCount() const;
+
+    void insert(size_t offset, std::string_view text);
+    void erase(size_t offset, size_t length);
+    void replace(size_t offset, size_t length, std::string_view text);
+    void assign(std::string text);
+
+    char at(size_t offset) const;
+    std::string text() const;
+    std::string substr(size_t offset, size_t length) const;
+
+    // Lines are separated by '\n', which is not part of the returned line. A trailing newline
+    // starts an empty last line.
+    size_t lineStart(size_t line) const;
+    size_t lineLength(size_t line) const;
+    size_t lineOfOffset(size_t offset) const;
+    std::string line(size_t line) const;
+    std::vector<std::string> lines() const;
+
+    // Brings `lines` up to date by replacing only the lines edited since the previous call.
+    // The vector must be one this buffer last synced, or empty before the first call.
+    void syncLines(std::vector<std::string>& lines);
+
+    uint64_t getVersion() const {
+        return version;
+    }
+
+  private:
+    static constexpr int kNull = -1;
+
+    struct Node {
+        uint8_t buffer;  // 0 = original, 1 = add.
+        size_t start;
+        size_t length;
+        size_t newlines;
+        uint32_t priority;
+        int left = kNull;
+        int right = kNull;
+        size_t totalLength = 0;
+        size_t totalNewlines = 0;
+    };
+
+    std::string original;
+    std::string added;
+    std::vector<size_t> newlinePositions[2];  // Sorted offsets of '\n' in each buffer.
+
+    std::vector<Node> nodes;
+    std::vector<int> freeNodes;
+    int root = kNull;
+    uint32_t rng = 0x9E3779B9u;
+    uint64_t version = 0;
+
+    // Lines edited since the last syncLines(): old lines [dirtyFirst, dirtyOldEnd) became the
+    // current lines [dirtyFirst, dirtyNewEnd).
+    bool dirty = true;
+    size_t dirtyFirst = 0;
+    size_t dirtyOldEnd = 0;
+    size_t dirtyNewEnd = 1;
+
+    const char* data(uint8_t buffer) const {
+        return buffer ? added.data() : original.data();
+    }
+    size_t totalLength(int node) const {
+        return node == kNull ? 0 : nodes[node].totalLength;
+    }
+    size_t totalNewlines(int node) const {
+        return node == kNull ? 0 : nodes[node].totalNewlines;
+    }
+
+    size_t countNewlines(uint8_t buffer, size_t start, size_t length) const;
+    int newNode(uint8_t buffer, size_t start, size_t length, uint32_t priority);
+    void update(int node);
+    int merge(int a, int b);
+    void split(int node, size_t offset, int& left, int& right);
+    void release(int node);
+    uint32_t nextPriority();
+    bool extendLastInsert(size_t offset, size_t appendedAt, size_t length, size_t newlines);
+    void collect(int node, size_t base, size_t from, size_t to, std::string& out) const;
+    void recordEdit(size_t firstLine, size_t removedLines, size_t insertedLines);
+};
+
+#endif
@@ -0,0 +1,169 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "instrumentation.h"
+#include "registers.h"
+
+// Binary execution trace.
+//
+// Header: "IM86TRC1", the mnemonic dictionary and program text (varint length + bytes each),
+// then the 13 traced registers of the initial state as varints.
+// Record per retired instruction, all varints:
+//   opcode (dictionary index), zigzag(line - (previousLine + 1)), changed-register mask,
+//   zigzag int16 delta for every register in the mask, write count,
+//   then per write: (address delta from the previous write, zigzagged) << 1 | isByte, value.
+// The file ends after the last record; there is no footer to rewrite, so a trace cut short by
+// a crash is still readable up to the last complete buffer.
+
+struct TraceMemoryWrite {
+    uint16_t address = 0;
+    uint16_t value = 0;
+    bool isByte = false;
+
+    bool operator==(const TraceMemoryWrite& other) const {
+        return address == other.address && value == other.value && isByte == other.isByte;
+    }
+};
+
+struct TraceRecord {
+    uint64_t index = 0;
+    size_t line = 0;
+    uint32_t opcode = 0;
+    uint16_t changedMask = 0;
+    Registers regs;  // State after the instruction retired.
+    std::vector<TraceMemoryWrite> writes;
+};
+
+// Registers stored in a trace, in mask-bit order. IP is implied by the record line.
+constexpr int kTraceRegisterCount = 13;
+const char* traceRegisterName(int index);
+uint16_t traceRegisterValue(const Registers& regs, int index);
+
+class TraceWriter {
+  public:
+    TraceWriter(const std::string& path,
+                const std::vector<std::string>& program,
+                const Registers& initial);
+    ~TraceWriter();
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    void memoryWrite(uint16_t address, uint16_t value, bool isByte);
+    void retire(size_t line, const Registers& before, const Registers& after);
+
+    // Flushes outstanding records and joins the writer thread. Called by the destructor.
+    void close();
+
+    uint64_t getRecordCount() const {
+        return recordCount;
+    }
+
+  private:
+    static constexpr size_t kBufferSize = 1 << 20;
+
+    std::ofstream out;
+    std::vector<uint32_t> lineOpcodes;
+    std::vector<TraceMemoryWrite> pendingWrites;
+    size_t previousLine = static_cast<size_t>(-1);
+    uint64_t recordCount = 0;
+
+    // The CPU thread fills `active`; the writer thread drains `pending`. They are swapped when
+    // `active` reaches kBufferSize, which only waits if the disk is a whole buffer behind.
+    std::vector<uint8_t> active;
+    std::vector<uint8_t> pending;
+    bool pendingFull = false;
+    bool stopping = false;
+    bool closed = false;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::thread worker;
+
+    void handOff();
+    void writerLoop();
+};
+
+struct TraceInstrumentation : NullInstrumentation {
+    static constexpr bool kRetire = true;
+    static constexpr bool kMemory = true;
+
+    explicit TraceInstrumentation(TraceWriter& writer) : writer(writer) {}
+    void onRetire(size_t line, const Registers& before, const Registers& after) {
+        writer.retire(line, before, after);
+    }
+    void onMemoryWrite(uint16_t address, uint16_t value, bool isByte) {
+        writer.memoryWrite(address, value, isByte);
+    }
+
+    TraceWriter& writer;
+};
+
+// Reads a trace through a read-only memory mapping so multi-gigabyte files are scanned without
+// copying; Windows builds read the whole file instead.
+class TraceReader {
+  public:
+    explicit TraceReader(const std::string& path);
+    ~TraceReader();
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    bool next(TraceRecord& record);
+    void rewind();
+
+    const std::vector<std::string>& getProgram() const {
+        return program;
+    }
+    const std::vector<std::string>& getMnemonics() const {
+        return mnemonics;
+    }
+    const Registers& getInitialRegisters() const {
+        return initial;
+    }
+    const std::string& mnemonic(const TraceRecord& record) const;
+
+  private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    size_t recordsStart = 0;
+#ifdef _WIN32
+    std::vector<uint8_t> contents;
+#endif
+
+    std::vector<std::string> mnemonics;
+    std::vector<std::string> program;
+    Registers initial;
+    Registers state;
+    size_t previousLine = static_cast<size_t>(-1);
+    uint64_t index = 0;
+
+    uint64_t readVarint();
+    size_t readCount();
+    std::string readString();
+};
+
+struct TraceDivergence {
+    bool diverged = false;
+    uint64_t index = 0;  // First divergent record, or the record count when the traces match.
+    bool leftEnded = false;
+    bool rightEnded = false;
+    TraceRecord left;
+    TraceRecord right;
+    std::vector<std::string> differences;
+};
+
+// Steps both traces together and stops at the first record that differs in line, mnemonic,
+// register state or memory writes.
+TraceDivergence findFirstDivergence(TraceReader& left, TraceReader& right);
+
+std::string formatTraceRecord(const TraceReader& reader, const TraceRecord& record);
+
+#endif
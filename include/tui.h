@@ -2,27 +2,32 @@
 #define IM8086_TUI_H
 
 #include <cstdint>
-#include <set>
 #include <string>
 #include <vector>
 
+#include "execution_pacer.h"
+
 class Emulator8086;
 
 class EmulatorTUI {
   public:
-    explicit EmulatorTUI(Emulator8086* emu);
+    explicit EmulatorTUI(Emulator8086* emu, const std::string& sourcePath = "program.asm");
     ~EmulatorTUI();
     void run();
 
   private:
     Emulator8086* emulator;
+    std::string sourcePath;
     bool running = false;
     bool quit = false;
     int memWindowStart = 0;
     int memWindowSize = 128;
-    std::set<size_t> breakpoints;
     int selectedPane = 0;
     bool showLabels = false;
+    std::string statusMessage;
+    ExecutionPacer pacer;
+
+    static constexpr size_t kHotLineCount = 5;
 
     void draw();
     void drawCode(int h, int w);
@@ -31,6 +36,12 @@ class EmulatorTUI {
     void drawMemory(int starty, int startx, int w, int h);
     void drawLabels(int h, int w);
     void toggleBreakpoint();
+    void toggleWatchpoint();
+    void startRunning();
+    void runFrame();
+    void changeSpeed(int ch);
+    void toggleProfiler();
+    void exportProfile();
     void step();
 };
 
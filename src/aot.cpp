@@ -0,0 +1,417 @@
+#include "aot.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+#include "fusion.h"
+#include "lockstep.h"
+
+namespace {
+
+const char* const kRegisters16[] = {"regs.AX.x", "regs.CX.x", "regs.DX.x", "regs.BX.x",
+                                    "regs.SP",   "regs.BP",   "regs.SI",   "regs.DI"};
+const char* const kRegisters8[] = {"regs.AX.bytes.l", "regs.CX.bytes.l", "regs.DX.bytes.l",
+                                   "regs.BX.bytes.l", "regs.AX.bytes.h", "regs.CX.bytes.h",
+                                   "regs.DX.bytes.h", "regs.BX.bytes.h"};
+
+std::string operandExpression(const FusedOperand& operand) {
+    switch (operand.kind) {
+        case FusedOperand::Reg16:
+            return kRegisters16[operand.reg];
+        case FusedOperand::Reg8:
+            return kRegisters8[operand.reg];
+        default: {
+            char buffer[16];
+            std::snprintf(buffer, sizeof(buffer), "0x%X", operand.value);
+            return buffer;
+        }
+    }
+}
+
+std::string quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += static_cast<char>(c);
+        } else if (c < 0x20 || c >= 0x7F) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\%03o", c);
+            quoted += buffer;
+        } else {
+            quoted += static_cast<char>(c);
+        }
+    }
+    return quoted + "\"";
+}
+
+bool isIdentifier(const std::string& name) {
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0])))
+        return false;
+    for (unsigned char c : name) {
+        if (!std::isalnum(c) && c != '_')
+            return false;
+    }
+    return true;
+}
+
+// When a jump or loop goes to its target, decided as fusedBranchTaken() does. Empty for JMP.
+std::string branchCondition(Opcode opcode) {
+    const std::string zf = "(regs.FLAGS & Registers::ZF)";
+    const std::string less = "!(regs.FLAGS & Registers::SF) != !(regs.FLAGS & Registers::OF)";
+    const std::string notLess = "!(regs.FLAGS & Registers::SF) == !(regs.FLAGS & Registers::OF)";
+    switch (opcode) {
+        case Opcode::Je:
+            return zf;
+        case Opcode::Jne:
+            return "!" + zf;
+        case Opcode::Jl:
+            return less;
+        case Opcode::Jnl:
+            return notLess;
+        case Opcode::Jle:
+            return less + " || " + zf;
+        case Opcode::Jg:
+            return notLess + " && !" + zf;
+        case Opcode::Jb:
+            return "(regs.FLAGS & Registers::CF)";
+        case Opcode::Jnb:
+            return "!(regs.FLAGS & Registers::CF)";
+        case Opcode::Jbe:
+            return "(regs.FLAGS & (Registers::CF | Registers::ZF))";
+        case Opcode::Ja:
+            return "!(regs.FLAGS & (Registers::CF | Registers::ZF))";
+        case Opcode::Jp:
+            return "(regs.FLAGS & Registers::PF)";
+        case Opcode::Jnp:
+            return "!(regs.FLAGS & Registers::PF)";
+        case Opcode::Jo:
+            return "(regs.FLAGS & Registers::OF)";
+        case Opcode::Jno:
+            return "!(regs.FLAGS & Registers::OF)";
+        case Opcode::Js:
+            return "(regs.FLAGS & Registers::SF)";
+        case Opcode::Jns:
+            return "!(regs.FLAGS & Registers::SF)";
+        case Opcode::Jcxz:
+            return "regs.CX.x == 0";
+        case Opcode::Loop:
+            return "--regs.CX.x != 0";
+        case Opcode::Loopz:
+            return "--regs.CX.x != 0 && " + zf;
+        case Opcode::Loopnz:
+            return "--regs.CX.x != 0 && !" + zf;
+        default:
+            return std::string();
+    }
+}
+
+// The statement for a jump or loop to a label, or "" when the interpreter has to run it. A
+// branch to its own line falls through in the interpreter, so that stays there too.
+std::string translateBranch(Opcode opcode,
+                            const Operands& operands,
+                            const LabelMap& labels,
+                            size_t line) {
+    auto label = operands.size() == 1 ? labels.find(operands[0]) : labels.end();
+    if (label == labels.end() || label->second == line)
+        return std::string();
+    std::string jump = "goto L" + std::to_string(label->second) + ";";
+    if (opcode == Opcode::Jmp)
+        return jump;
+    return "if (" + branchCondition(opcode) + ")\n        " + jump;
+}
+
+// The statement for a register/immediate instruction, written the way its handler computes
+// it, or "" when the interpreter has to run it.
+std::string translateOperation(Opcode opcode, const Operands& operands) {
+    bool byte = false;
+    FusedOperand destination;
+    FusedOperand source;
+    switch (opcode) {
+        case Opcode::Mov:
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Cmp:
+        case Opcode::And:
+        case Opcode::Or:
+        case Opcode::Xor:
+        case Opcode::Test:
+        case Opcode::Inc:
+        case Opcode::Dec:
+        case Opcode::Not:
+        case Opcode::Neg:
+            if (!resolveRegisterOperands(opcode, operands, byte, destination, source))
+                return std::string();
+            break;
+        default:
+            return std::string();
+    }
+
+    std::string d = operandExpression(destination);
+    std::string s = operandExpression(source);
+    std::string wide = byte ? "uint16_t" : "uint32_t";
+    std::string narrow = byte ? "uint8_t" : "uint16_t";
+    std::string width = byte ? "true" : "false";
+    auto withResult = [&](const std::string& expression, bool carry) {
+        return "{\n        " + wide + " r = " + expression + ";\n        " + d +
+               " = static_cast<" + narrow + ">(r);\n        aotUpdateFlags(regs.FLAGS, r, " +
+               width + (carry ? ", true);" : ", false);") + "\n    }";
+    };
+    auto flagsOnly = [&](const std::string& expression, bool carry) {
+        return "aotUpdateFlags(regs.FLAGS, " + expression + ", " + width +
+               (carry ? ", true);" : ", false);");
+    };
+    auto logical = [&](const char* op) {
+        return d + " " + op + "= " + s + ";\n    " + flagsOnly(d, false);
+    };
+
+    switch (opcode) {
+        case Opcode::Mov:
+            return d + " = " + s + ";";
+        case Opcode::Add:
+            return withResult(d + " + " + s, true);
+        case Opcode::Sub:
+            return withResult(d + " - " + s, true);
+        case Opcode::Cmp:
+            return flagsOnly("static_cast<" + wide + ">(" + d + " - " + s + ")", true);
+        case Opcode::Test:
+            return flagsOnly("static_cast<" + narrow + ">(" + d + " & " + s + ")", false);
+        case Opcode::And:
+            return logical("&");
+        case Opcode::Or:
+            return logical("|");
+        case Opcode::Xor:
+            return logical("^");
+        case Opcode::Inc:
+            return withResult(d + " + 1", false);
+        case Opcode::Dec:
+            return withResult(d + " - 1", false);
+        case Opcode::Not:
+            return d + " = static_cast<" + narrow + ">(~" + d + ");";
+        default:  // Neg
+            return withResult("0 - " + d, true);
+    }
+}
+
+std::string translateLine(const std::string& text, const LabelMap& labels, size_t line) {
+    DecodedInstruction decoded = decodeInstruction(text);
+    if (decoded.opcode == Opcode::Invalid)
+        return std::string();
+    Operands operands = decoded.operands(text);
+    switch (instructionInfo(decoded.opcode).kind) {
+        case InstructionKind::Jump:
+        case InstructionKind::CondJump:
+        case InstructionKind::Loop:
+            return translateBranch(decoded.opcode, operands, labels, line);
+        default:
+            return translateOperation(decoded.opcode, operands);
+    }
+}
+
+void writeSource(std::ostream& out, const DecodedProgram& program) {
+    out << "DecodedProgram source() {\n"
+        << "    DecodedProgram program;\n"
+        << "    program.instructions = {\n";
+    for (const auto& instruction : program.instructions)
+        out << "        " << quote(instruction) << ",\n";
+    out << "    };\n"
+        << "    program.sourceLines = {";
+    for (size_t i = 0; i < program.sourceLines.size(); ++i)
+        out << (i % 16 == 0 ? "\n        " : " ") << program.sourceLines[i] << ",";
+    out << "\n    };\n"
+        << "    program.labels = {\n";
+    for (const auto& label : program.labels)
+        out << "        {" << quote(label.first) << ", " << label.second << "},\n";
+    out << "    };\n"
+        << "    return program;\n"
+        << "}\n\n";
+}
+
+}  // namespace
+
+AotStats writeAotProgram(std::ostream& out,
+                         const DecodedProgram& program,
+                         const std::string& name,
+                         bool withMain) {
+    if (!isIdentifier(name))
+        throw std::runtime_error("Not a C++ identifier: " + name);
+
+    const std::vector<std::string>& lines = program.instructions;
+    AotStats stats;
+    stats.lines = lines.size();
+    std::vector<std::string> statements(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        statements[i] = translateLine(lines[i], program.labels, i);
+        if (!statements[i].empty())
+            ++stats.translated;
+    }
+    bool interprets = stats.translated < stats.lines;
+    std::string end = "L" + std::to_string(lines.size());
+    bool jumpsToEnd = false;
+    for (const auto& statement : statements)
+        jumpsToEnd |= statement.find("goto " + end + ";") != std::string::npos;
+
+    out << "// Generated by im8086-aot. Do not edit.\n"
+        << "#include \"aot.h\"\n\n"
+        << "extern const AotProgram " << name << ";\n\n"
+        << "namespace {\n\n";
+    writeSource(out, program);
+
+    out << "template <typename Policy>\n"
+        << "size_t run(Emulator8086& emu, Policy& policy, size_t maxSteps) {\n"
+        << "    Registers& regs = emu.getRegisters();\n"
+        << "    size_t steps = 0;\n";
+    if (interprets)
+        out << "dispatch:\n";
+    else
+        out << "    static_cast<void>(policy);\n";
+    out << "    switch (regs.IP) {\n";
+    for (size_t i = 0; i < lines.size(); ++i)
+        out << "        case " << i << ":\n            goto L" << i << ";\n";
+    out << "        default:\n"
+        << "            return steps;\n"
+        << "    }\n";
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        out << "L" << i << ":";
+        if (lines[i].find('\\') == std::string::npos)
+            out << "  // " << lines[i];
+        out << "\n    if (steps == maxSteps) {\n"
+            << "        regs.IP = " << i << ";\n"
+            << "        return steps;\n"
+            << "    }\n";
+        if (statements[i].empty()) {
+            out << "    regs.IP = " << i << ";\n"
+                << "    steps += emu.run(policy, 1);\n"
+                << "    goto dispatch;\n";
+        } else {
+            out << "    ++steps;\n"
+                << "    " << statements[i] << "\n";
+        }
+    }
+    if (jumpsToEnd)
+        out << end << ":\n";
+    out << "    regs.IP = " << lines.size() << ";\n"
+        << "    return steps;\n"
+        << "}\n\n";
+
+    out << "size_t runPlain(Emulator8086& emu, size_t maxSteps) {\n"
+        << "    NullInstrumentation none;\n"
+        << "    return run(emu, none, maxSteps);\n"
+        << "}\n\n"
+        << "size_t runTracked(Emulator8086& emu, DirtyPageTracker& tracker, size_t maxSteps) {\n"
+        << "    return run(emu, tracker, maxSteps);\n"
+        << "}\n\n"
+        << "}  // namespace\n\n"
+        << "const AotProgram " << name << " = {\"" << name
+        << "\", source, runPlain, runTracked};\n";
+    if (withMain) {
+        out << "\nint main(int argc, char** argv) {\n"
+            << "    return aotMain(" << name << ", argc, argv);\n"
+            << "}\n";
+    }
+    return stats;
+}
+
+std::string aotProgramName(const std::string& path) {
+    size_t start = path.find_last_of("/\\");
+    start = start == std::string::npos ? 0 : start + 1;
+    size_t end = path.find('.', start);
+    std::string name = "aot_";
+    for (size_t i = start; i < path.size() && i < end; ++i) {
+        unsigned char c = static_cast<unsigned char>(path[i]);
+        name += std::isalnum(c) ? static_cast<char>(c) : '_';
+    }
+    return name;
+}
+
+int aotMain(const AotProgram& program, int argc, char** argv) {
+    size_t maxSteps = 100000000;
+    size_t repeat = 1;
+    bool lockstep = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max" && i + 1 < argc) {
+            maxSteps = std::stoull(argv[++i], nullptr, 0);
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::stoull(argv[++i], nullptr, 0);
+        } else if (arg == "--lockstep") {
+            lockstep = true;
+        } else {
+            std::cout << "Usage: " << argv[0] << " [--max N] [--repeat N] [--lockstep]\n"
+                      << "\nRuns " << program.name << " and prints the registers. --repeat times\n"
+                      << "N runs from a fresh state; --lockstep checks the program against the\n"
+                      << "interpreter, one instruction at a time and then over a whole run.\n";
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+    std::shared_ptr<const Program> source = Program::create(program.source());
+
+    if (lockstep) {
+        Emulator8086 reference;
+        Emulator8086 candidate;
+        reference.setJitEnabled(false);
+        reference.setFusionCandidates(FusionCandidates::none());
+        LockstepChecker checker(reference, candidate);
+        checker.setCandidateStepper([&program](Emulator8086& emu, DirtyPageTracker& tracker) {
+            program.runTracked(emu, tracker, 1);
+        });
+        checker.load(source);
+        LockstepResult result = checker.run(maxSteps);
+        if (result.diverged) {
+            std::cerr << program.name << ": " << LockstepChecker::formatReport(result);
+            return 1;
+        }
+        uint64_t steps = result.steps;
+
+        // One step each for the whole program, so translated lines also run straight into
+        // each other the way they do outside the checker.
+        checker.setReferenceStepper([maxSteps](Emulator8086& emu, DirtyPageTracker& tracker) {
+            emu.run(tracker, maxSteps);
+        });
+        checker.setCandidateStepper(
+            [&program, maxSteps](Emulator8086& emu, DirtyPageTracker& tracker) {
+                program.runTracked(emu, tracker, maxSteps);
+            });
+        checker.load(source);
+        result = checker.run(1);
+        if (result.diverged) {
+            std::cerr << program.name << " (whole run): " << LockstepChecker::formatReport(result);
+            return 1;
+        }
+        std::cerr << program.name << " agrees with the interpreter over " << steps
+                  << " instructions\n";
+        return 0;
+    }
+
+    Emulator8086 emu;
+    emu.loadProgram(source);
+    size_t retired = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < repeat; ++i) {
+        emu.reset();
+        retired = program.run(emu, maxSteps);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                          start)
+                    .count();
+    const Registers& regs = emu.getRegisters();
+    char line[160];
+    std::snprintf(line,
+                  sizeof(line),
+                  "%s: %zu instructions, AX=%04X BX=%04X CX=%04X DX=%04X (%.3f ms per run)",
+                  program.name,
+                  retired,
+                  regs.AX.x,
+                  regs.BX.x,
+                  regs.CX.x,
+                  regs.DX.x,
+                  repeat ? ms / repeat : 0.0);
+    std::cout << line << "\n";
+    emu.displayRegisters();
+    return 0;
+}
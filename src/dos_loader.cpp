@@ -0,0 +1,169 @@
+#include "dos_loader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+#include "emulator8086.h"
+#include "source_loader.h"
+
+namespace {
+
+constexpr size_t kPspSize = 0x100;
+constexpr size_t kParagraph = 16;
+
+// Fields of the MZ header, all little-endian words.
+enum MzField : size_t {
+    kBytesInLastPage = 0x02,
+    kPageCount = 0x04,
+    kRelocationCount = 0x06,
+    kHeaderParagraphs = 0x08,
+    kMinExtraParagraphs = 0x0A,
+    kInitialSS = 0x0E,
+    kInitialSP = 0x10,
+    kInitialIP = 0x14,
+    kInitialCS = 0x16,
+    kRelocationTable = 0x18,
+};
+constexpr size_t kMzHeaderSize = 0x1C;
+
+uint16_t readWord(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+void writeWord(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+}
+
+size_t linear(uint16_t segment, uint16_t offset) {
+    return static_cast<size_t>(segment) * kParagraph + offset;
+}
+
+void requireFits(const GuestMemory& memory, size_t start, size_t length) {
+    if (start > memory.size() || length > memory.size() - start)
+        throw std::runtime_error("Executable does not fit in emulated memory");
+}
+
+void buildPsp(GuestMemory& memory, uint16_t pspSegment, const std::string& commandTail) {
+    size_t base = linear(pspSegment, 0);
+    requireFits(memory, base, kPspSize);
+    uint8_t* psp = memory.data() + base;
+    std::memset(psp, 0, kPspSize);
+    psp[0x00] = 0xCD;  // INT 20h, reached by a RET from a .COM program's stack.
+    psp[0x01] = 0x20;
+    writeWord(psp + 0x02, static_cast<uint16_t>(std::min<size_t>(memory.size() / kParagraph,
+                                                                 0xA000)));
+    psp[0x50] = 0xCD;  // INT 21h / RETF: the far-call DOS entry.
+    psp[0x51] = 0x21;
+    psp[0x52] = 0xCB;
+    std::memset(psp + 0x5D, ' ', 11);  // Two unopened FCBs with blank names.
+    std::memset(psp + 0x6D, ' ', 11);
+
+    size_t tailLength = std::min<size_t>(commandTail.size(), 126);
+    psp[0x80] = static_cast<uint8_t>(tailLength);
+    std::memcpy(psp + 0x81, commandTail.data(), tailLength);
+    psp[0x81 + tailLength] = 0x0D;
+}
+
+ExecutableInfo loadCom(Emulator8086& emulator, std::string_view image, uint16_t pspSegment) {
+    if (image.size() > 0x10000 - kPspSize - 2)
+        throw std::runtime_error(".COM image larger than a 64K segment");
+    GuestMemory& memory = emulator.getMemory();
+    size_t base = linear(pspSegment, kPspSize);
+    requireFits(memory, linear(pspSegment, 0), 0x10000);
+    std::memcpy(memory.data() + base, image.data(), image.size());
+
+    Registers& regs = emulator.getRegisters();
+    regs.CS = regs.DS = regs.ES = regs.SS = pspSegment;
+    regs.IP = kPspSize;
+    regs.SP = 0xFFFE;  // DOS leaves a zero word here so RET lands on the INT 20h at PSP:0.
+
+    ExecutableInfo info;
+    info.format = ExecutableFormat::Com;
+    info.pspSegment = pspSegment;
+    info.loadSegment = pspSegment;
+    info.imageSize = image.size();
+    return info;
+}
+
+ExecutableInfo loadMz(Emulator8086& emulator, std::string_view file, uint16_t pspSegment) {
+    if (file.size() < kMzHeaderSize)
+        throw std::runtime_error("Truncated MZ header");
+    const uint8_t* header = reinterpret_cast<const uint8_t*>(file.data());
+    size_t pages = readWord(header + kPageCount);
+    size_t lastPage = readWord(header + kBytesInLastPage);
+    size_t headerSize = readWord(header + kHeaderParagraphs) * kParagraph;
+    size_t fileSize = pages * 512 - (lastPage ? 512 - lastPage : 0);
+    if (pages == 0 || fileSize > file.size() || headerSize > fileSize)
+        throw std::runtime_error("MZ header describes more data than the file holds");
+
+    size_t relocationCount = readWord(header + kRelocationCount);
+    size_t relocationTable = readWord(header + kRelocationTable);
+    if (relocationTable + relocationCount * 4 > file.size())
+        throw std::runtime_error("MZ relocation table out of range");
+
+    size_t imageSize = fileSize - headerSize;
+    uint16_t loadSegment = static_cast<uint16_t>(pspSegment + kPspSize / kParagraph);
+    size_t base = linear(loadSegment, 0);
+    GuestMemory& memory = emulator.getMemory();
+    requireFits(memory, base, imageSize + readWord(header + kMinExtraParagraphs) * kParagraph);
+    std::memcpy(memory.data() + base, file.data() + headerSize, imageSize);
+
+    // Each entry names a word inside the image holding a segment; all of them are patched in
+    // one pass over the table, directly in memory.
+    const uint8_t* entry = header + relocationTable;
+    for (size_t i = 0; i < relocationCount; ++i, entry += 4) {
+        size_t target = base + linear(readWord(entry + 2), readWord(entry));
+        if (target + 2 > base + imageSize)
+            throw std::runtime_error("MZ relocation outside the load image");
+        uint8_t* word = memory.data() + target;
+        writeWord(word, static_cast<uint16_t>(readWord(word) + loadSegment));
+    }
+
+    Registers& regs = emulator.getRegisters();
+    regs.DS = regs.ES = pspSegment;
+    regs.CS = static_cast<uint16_t>(loadSegment + readWord(header + kInitialCS));
+    regs.IP = readWord(header + kInitialIP);
+    regs.SS = static_cast<uint16_t>(loadSegment + readWord(header + kInitialSS));
+    regs.SP = readWord(header + kInitialSP);
+
+    ExecutableInfo info;
+    info.format = ExecutableFormat::Mz;
+    info.pspSegment = pspSegment;
+    info.loadSegment = loadSegment;
+    info.imageSize = imageSize;
+    info.relocations = relocationCount;
+    return info;
+}
+
+}  // namespace
+
+bool isExecutablePath(const std::string& path) {
+    if (path.size() < 4 || path[path.size() - 4] != '.')
+        return false;
+    std::string extension = path.substr(path.size() - 3);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "com" || extension == "exe";
+}
+
+ExecutableInfo loadExecutable(Emulator8086& emulator,
+                              std::string_view image,
+                              const std::string& commandTail,
+                              uint16_t pspSegment) {
+    emulator.reset();
+    emulator.loadProgram(DecodedProgram());
+    buildPsp(emulator.getMemory(), pspSegment, commandTail);
+    bool mz = image.size() >= 2 && ((image[0] == 'M' && image[1] == 'Z') ||
+                                    (image[0] == 'Z' && image[1] == 'M'));
+    return mz ? loadMz(emulator, image, pspSegment) : loadCom(emulator, image, pspSegment);
+}
+
+ExecutableInfo loadExecutableFile(Emulator8086& emulator,
+                                  const std::string& path,
+                                  const std::string& commandTail,
+                                  uint16_t pspSegment) {
+    MappedFile file(path);
+    return loadExecutable(emulator, file.view(), commandTail, pspSegment);
+}
@@ -0,0 +1,213 @@
+#include "emulation_worker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+bool EmulatorSnapshot::hasBreakpoint(size_t line) const {
+    return breakpoints && std::binary_search(breakpoints->begin(), breakpoints->end(), line);
+}
+
+EmulationWorker::EmulationWorker(size_t batchSize, std::function<void()> onPublish)
+    : batchSize(batchSize), onPublish(std::move(onPublish)) {
+    for (auto& slot : slots)
+        slot.memory.resize(0x10000);
+    program = std::make_shared<const std::vector<std::string>>();
+    breakpoints = std::make_shared<const std::vector<size_t>>();
+    watchpoints = std::make_shared<const std::vector<Emulator8086::Watchpoint>>();
+    markAllPagesDirty();
+    publish();
+    thread = std::thread(&EmulationWorker::threadMain, this);
+}
+
+EmulationWorker::~EmulationWorker() {
+    stopping.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> guard(wakeMutex);
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+bool EmulationWorker::send(Command command) {
+    if (!commands.push(std::move(command)))
+        return false;
+    // Taking the mutex orders the push before the worker's predicate check, so a worker that
+    // is about to sleep cannot miss the notification.
+    {
+        std::lock_guard<std::mutex> guard(wakeMutex);
+    }
+    wake.notify_one();
+    return true;
+}
+
+bool EmulationWorker::run() {
+    return send(Command(CommandType::Run));
+}
+
+bool EmulationWorker::pause() {
+    return send(Command(CommandType::Pause));
+}
+
+bool EmulationWorker::step() {
+    return send(Command(CommandType::Step));
+}
+
+bool EmulationWorker::reset() {
+    return send(Command(CommandType::Reset));
+}
+
+bool EmulationWorker::load(const std::vector<std::string>& lines) {
+    Command command(CommandType::Load);
+    command.lines = std::make_shared<const std::vector<std::string>>(lines);
+    return send(std::move(command));
+}
+
+bool EmulationWorker::load(DecodedProgram program) {
+    Command command(CommandType::Load);
+    command.decoded = std::make_shared<DecodedProgram>(std::move(program));
+    return send(std::move(command));
+}
+
+bool EmulationWorker::toggleBreakpoint(size_t line) {
+    Command command(CommandType::ToggleBreakpoint);
+    command.line = line;
+    return send(std::move(command));
+}
+
+bool EmulationWorker::addWatchpoint(uint16_t address, uint16_t length, bool onRead, bool onWrite) {
+    if (length == 0)
+        throw std::runtime_error("Watchpoint length must be at least 1");
+    Command command(CommandType::AddWatchpoint);
+    command.address = address;
+    command.length = length;
+    command.onRead = onRead;
+    command.onWrite = onWrite;
+    return send(std::move(command));
+}
+
+bool EmulationWorker::removeWatchpoint(uint16_t address) {
+    Command command(CommandType::RemoveWatchpoint);
+    command.address = address;
+    return send(std::move(command));
+}
+
+const EmulatorSnapshot& EmulationWorker::acquireSnapshot() {
+    if (middle.load(std::memory_order_relaxed) & kFresh)
+        front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+    return slots[front];
+}
+
+void EmulationWorker::threadMain() {
+    while (true) {
+        Command command;
+        while (commands.pop(command))
+            execute(command);
+        if (stopping.load(std::memory_order_acquire))
+            break;
+
+        if (running) {
+            tracker.clear();
+            retired += emulator.run(tracker, batchSize);
+            for (size_t page : tracker.dirtyPages)
+                ++pageVersions[page];
+            if (emulator.getStopReason() != Emulator8086::StopReason::StepLimit)
+                running = false;
+            publish();
+            continue;
+        }
+        if (changed)
+            publish();
+
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wake.wait(lock, [this] {
+            return stopping.load(std::memory_order_acquire) || !commands.empty();
+        });
+    }
+}
+
+void EmulationWorker::execute(Command& command) {
+    changed = true;
+    switch (command.type) {
+        case CommandType::Run:
+            running = true;
+            break;
+        case CommandType::Pause:
+            running = false;
+            break;
+        case CommandType::Step:
+            running = false;
+            tracker.clear();
+            retired += emulator.run(tracker, 1);
+            for (size_t page : tracker.dirtyPages)
+                ++pageVersions[page];
+            break;
+        case CommandType::Reset:
+            running = false;
+            retired = 0;
+            emulator.reset();
+            markAllPagesDirty();
+            break;
+        case CommandType::Load:
+            running = false;
+            retired = 0;
+            emulator.reset();
+            if (command.decoded)
+                emulator.loadProgram(std::move(*command.decoded));
+            else
+                emulator.loadProgram(*command.lines);
+            // Snapshots share the program's lines instead of copying them.
+            program = std::shared_ptr<const std::vector<std::string>>(
+                emulator.getSharedProgram(), &emulator.getProgram());
+            markAllPagesDirty();
+            break;
+        case CommandType::ToggleBreakpoint:
+            emulator.toggleBreakpoint(command.line);
+            breakpoints = std::make_shared<const std::vector<size_t>>(emulator.getBreakpoints());
+            break;
+        case CommandType::AddWatchpoint:
+            emulator.addWatchpoint(command.address, command.length, command.onRead, command.onWrite);
+            watchpoints = std::make_shared<const std::vector<Emulator8086::Watchpoint>>(
+                emulator.getWatchpoints());
+            break;
+        case CommandType::RemoveWatchpoint:
+            emulator.removeWatchpoint(command.address);
+            watchpoints = std::make_shared<const std::vector<Emulator8086::Watchpoint>>(
+                emulator.getWatchpoints());
+            break;
+    }
+}
+
+void EmulationWorker::markAllPagesDirty() {
+    for (auto& version : pageVersions)
+        ++version;
+}
+
+void EmulationWorker::publish() {
+    EmulatorSnapshot& slot = slots[back];
+    slot.sequence = ++sequence;
+    slot.retired = retired;
+    slot.running = running;
+    slot.regs = emulator.getRegisters();
+    slot.stopReason = emulator.getStopReason();
+    slot.watchHit = emulator.getWatchHit();
+    slot.memorySize = emulator.getMemory().size();
+    slot.program = program;
+    slot.breakpoints = breakpoints;
+    slot.watchpoints = watchpoints;
+
+    const uint8_t* memory = emulator.getMemory().data();
+    constexpr size_t kPageSize = size_t(1) << DirtyPageTracker::kPageShift;
+    for (size_t page = 0; page < DirtyPageTracker::kPageCount; ++page) {
+        if (slot.pageVersions[page] == pageVersions[page])
+            continue;
+        std::memcpy(slot.memory.data() + page * kPageSize, memory + page * kPageSize, kPageSize);
+        slot.pageVersions[page] = pageVersions[page];
+    }
+
+    back = middle.exchange(back | kFresh, std::memory_order_acq_rel) & 3;
+    changed = false;
+    if (onPublish)
+        onPublish();
+}
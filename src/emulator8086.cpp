@@ -2,425 +2,128 @@
 
 #include <algorithm>
 #include <bitset>
+#include <cctype>
+#include <climits>
 #include <iomanip>
 #include <iostream>
-#include <sstream>
 #include <stdexcept>
 
-#include "instructions/arithmetic.h"
-#include "instructions/bit_manipulation.h"
-#include "instructions/data_transfer.h"
-#include "instructions/logical.h"
-#include "instructions/processor_control.h"
-#include "instructions/program_transfer.h"
-#include "instructions/string.h"
-
-Emulator8086::Emulator8086(size_t memSize) : memory(memSize, 0) {
-    dataTransfer = std::make_unique<DataTransferInstructions>(this);
-    arithmetic = std::make_unique<ArithmeticInstructions>(this);
-    logical = std::make_unique<LogicalInstructions>(this);
-    string = std::make_unique<StringInstructions>(this);
-    programTransfer = std::make_unique<ProgramTransferInstructions>(this);
-    processorControl = std::make_unique<ProcessorControlInstructions>(this);
-    bitManipulation = std::make_unique<BitManipulationInstructions>(this);
-
-    initializeInstructions();
+Emulator8086::Emulator8086(size_t memSize) : memory(memSize) {
+    setJitEnabled(true);
 }
 
 Emulator8086::~Emulator8086() = default;
 
-void Emulator8086::initializeInstructions() {
-    instructions["MOV"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->mov(operands);
-    };
-    instructions["PUSH"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->push(operands);
-    };
-    instructions["POP"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->pop(operands);
-    };
-    instructions["XCHG"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->xchg(operands);
-    };
-    instructions["LEA"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->lea(operands);
-    };
-    instructions["LDS"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->lds(operands);
-    };
-    instructions["LES"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->les(operands);
-    };
-    instructions["LAHF"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->lahf(operands);
-    };
-    instructions["SAHF"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->sahf(operands);
-    };
-    instructions["PUSHF"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->pushf(operands);
-    };
-    instructions["POPF"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->popf(operands);
-    };
-    instructions["PUSHA"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->pusha(operands);
-    };
-    instructions["POPA"] = [this](std::vector<std::string>& operands) {
-        dataTransfer->popa(operands);
-    };
-
-    instructions["ADD"] = [this](std::vector<std::string>& operands) { arithmetic->add(operands); };
-    instructions["ADC"] = [this](std::vector<std::string>& operands) { arithmetic->adc(operands); };
-    instructions["INC"] = [this](std::vector<std::string>& operands) { arithmetic->inc(operands); };
-    instructions["AAA"] = [this](std::vector<std::string>& operands) { arithmetic->aaa(operands); };
-    instructions["DAA"] = [this](std::vector<std::string>& operands) { arithmetic->daa(operands); };
-    instructions["SUB"] = [this](std::vector<std::string>& operands) { arithmetic->sub(operands); };
-    instructions["SBB"] = [this](std::vector<std::string>& operands) { arithmetic->sbb(operands); };
-    instructions["DEC"] = [this](std::vector<std::string>& operands) { arithmetic->dec(operands); };
-    instructions["NEG"] = [this](std::vector<std::string>& operands) { arithmetic->neg(operands); };
-    instructions["AAS"] = [this](std::vector<std::string>& operands) { arithmetic->aas(operands); };
-    instructions["DAS"] = [this](std::vector<std::string>& operands) { arithmetic->das(operands); };
-    instructions["MUL"] = [this](std::vector<std::string>& operands) { arithmetic->mul(operands); };
-    instructions["IMUL"] = [this](std::vector<std::string>& operands) {
-        arithmetic->imul(operands);
-    };
-    instructions["AAM"] = [this](std::vector<std::string>& operands) { arithmetic->aam(operands); };
-    instructions["DIV"] = [this](std::vector<std::string>& operands) { arithmetic->div(operands); };
-    instructions["IDIV"] = [this](std::vector<std::string>& operands) {
-        arithmetic->idiv(operands);
-    };
-    instructions["AAD"] = [this](std::vector<std::string>& operands) { arithmetic->aad(operands); };
-    instructions["CBW"] = [this](std::vector<std::string>& operands) { arithmetic->cbw(operands); };
-    instructions["CWD"] = [this](std::vector<std::string>& operands) { arithmetic->cwd(operands); };
-
-    instructions["AND"] = [this](std::vector<std::string>& operands) { logical->and_op(operands); };
-    instructions["OR"] = [this](std::vector<std::string>& operands) { logical->or_op(operands); };
-    instructions["XOR"] = [this](std::vector<std::string>& operands) { logical->xor_op(operands); };
-    instructions["NOT"] = [this](std::vector<std::string>& operands) { logical->not_op(operands); };
-    instructions["TEST"] = [this](std::vector<std::string>& operands) { logical->test(operands); };
-    instructions["CMP"] = [this](std::vector<std::string>& operands) { logical->cmp(operands); };
-
-    instructions["MOVSB"] = [this](std::vector<std::string>& operands) { string->movsb(operands); };
-    instructions["MOVSW"] = [this](std::vector<std::string>& operands) { string->movsw(operands); };
-    instructions["CMPSB"] = [this](std::vector<std::string>& operands) { string->cmpsb(operands); };
-    instructions["CMPSW"] = [this](std::vector<std::string>& operands) { string->cmpsw(operands); };
-    instructions["SCASB"] = [this](std::vector<std::string>& operands) { string->scasb(operands); };
-    instructions["SCASW"] = [this](std::vector<std::string>& operands) { string->scasw(operands); };
-    instructions["LODSB"] = [this](std::vector<std::string>& operands) { string->lodsb(operands); };
-    instructions["LODSW"] = [this](std::vector<std::string>& operands) { string->lodsw(operands); };
-    instructions["STOSB"] = [this](std::vector<std::string>& operands) { string->stosb(operands); };
-    instructions["STOSW"] = [this](std::vector<std::string>& operands) { string->stosw(operands); };
-    instructions["REP"] = [this](std::vector<std::string>& operands) { string->rep(operands); };
-    instructions["REPE"] = [this](std::vector<std::string>& operands) { string->repe(operands); };
-    instructions["REPNE"] = [this](std::vector<std::string>& operands) { string->repne(operands); };
-    instructions["REPNZ"] = [this](std::vector<std::string>& operands) { string->repnz(operands); };
-    instructions["REPZ"] = [this](std::vector<std::string>& operands) { string->repz(operands); };
-    instructions["XLAT"] = [this](std::vector<std::string>& operands) { string->xlat(operands); };
-    instructions["XLATB"] = [this](std::vector<std::string>& operands) { string->xlatb(operands); };
-
-    instructions["CALL"] = [this](std::vector<std::string>& operands) {
-        programTransfer->call(operands);
-    };
-    instructions["JMP"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jmp(operands);
-    };
-    instructions["RET"] = [this](std::vector<std::string>& operands) {
-        programTransfer->ret(operands);
-    };
-    instructions["RETF"] = [this](std::vector<std::string>& operands) {
-        programTransfer->retf(operands);
-    };
-    instructions["JE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->je(operands);
-    };
-    instructions["JZ"] = [this](std::vector<std::string>& operands) {
-        programTransfer->je(operands);
-    };
-    instructions["JL"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jl(operands);
-    };
-    instructions["JNGE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jl(operands);
-    };
-    instructions["JLE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jle(operands);
-    };
-    instructions["JNG"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jle(operands);
-    };
-    instructions["JB"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jb(operands);
-    };
-    instructions["JNAE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jb(operands);
-    };
-    instructions["JC"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jb(operands);
-    };
-    instructions["JBE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jbe(operands);
-    };
-    instructions["JNA"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jbe(operands);
-    };
-    instructions["JP"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jp(operands);
-    };
-    instructions["JPE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jp(operands);
-    };
-    instructions["JO"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jo(operands);
-    };
-    instructions["JS"] = [this](std::vector<std::string>& operands) {
-        programTransfer->js(operands);
-    };
-    instructions["JNE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jne(operands);
-    };
-    instructions["JNZ"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jne(operands);
-    };
-    instructions["JNL"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jnl(operands);
-    };
-    instructions["JGE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jnl(operands);
-    };
-    instructions["JG"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jg(operands);
-    };
-    instructions["JNLE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jg(operands);
-    };
-    instructions["JNB"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jnb(operands);
-    };
-    instructions["JAE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jnb(operands);
-    };
-    instructions["JNC"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jnb(operands);
-    };
-    instructions["JA"] = [this](std::vector<std::string>& operands) {
-        programTransfer->ja(operands);
-    };
-    instructions["JNBE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->ja(operands);
-    };
-    instructions["JNP"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jnp(operands);
-    };
-    instructions["JPO"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jnp(operands);
-    };
-    instructions["JNO"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jno(operands);
-    };
-    instructions["JNS"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jns(operands);
-    };
-    instructions["LOOP"] = [this](std::vector<std::string>& operands) {
-        programTransfer->loop(operands);
-    };
-    instructions["LOOPZ"] = [this](std::vector<std::string>& operands) {
-        programTransfer->loopz(operands);
-    };
-    instructions["LOOPE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->loopz(operands);
-    };
-    instructions["LOOPNZ"] = [this](std::vector<std::string>& operands) {
-        programTransfer->loopnz(operands);
-    };
-    instructions["LOOPNE"] = [this](std::vector<std::string>& operands) {
-        programTransfer->loopnz(operands);
-    };
-    instructions["JCXZ"] = [this](std::vector<std::string>& operands) {
-        programTransfer->jcxz(operands);
-    };
-
-    instructions["CLC"] = [this](std::vector<std::string>& operands) {
-        processorControl->clc(operands);
-    };
-    instructions["CMC"] = [this](std::vector<std::string>& operands) {
-        processorControl->cmc(operands);
-    };
-    instructions["STC"] = [this](std::vector<std::string>& operands) {
-        processorControl->stc(operands);
-    };
-    instructions["CLD"] = [this](std::vector<std::string>& operands) {
-        processorControl->cld(operands);
-    };
-    instructions["STD"] = [this](std::vector<std::string>& operands) {
-        processorControl->std(operands);
-    };
-    instructions["CLI"] = [this](std::vector<std::string>& operands) {
-        processorControl->cli(operands);
-    };
-    instructions["STI"] = [this](std::vector<std::string>& operands) {
-        processorControl->sti(operands);
-    };
-    instructions["HLT"] = [this](std::vector<std::string>& operands) {
-        processorControl->hlt(operands);
-    };
-    instructions["WAIT"] = [this](std::vector<std::string>& operands) {
-        processorControl->wait(operands);
-    };
-    instructions["ESC"] = [this](std::vector<std::string>& operands) {
-        processorControl->esc(operands);
-    };
-    instructions["LOCK"] = [this](std::vector<std::string>& operands) {
-        processorControl->lock(operands);
-    };
-    instructions["NOP"] = [this](std::vector<std::string>& operands) {
-        processorControl->nop(operands);
-    };
-    instructions["INT"] = [this](std::vector<std::string>& operands) {
-        processorControl->int_op(operands);
-    };
-    instructions["INTO"] = [this](std::vector<std::string>& operands) {
-        processorControl->into(operands);
-    };
-    instructions["IRET"] = [this](std::vector<std::string>& operands) {
-        processorControl->iret(operands);
-    };
-    instructions["IN"] = [this](std::vector<std::string>& operands) {
-        processorControl->in_op(operands);
-    };
-    instructions["OUT"] = [this](std::vector<std::string>& operands) {
-        processorControl->out(operands);
-    };
-
-    instructions["RCL"] = [this](std::vector<std::string>& operands) {
-        bitManipulation->rcl(operands);
-    };
-    instructions["RCR"] = [this](std::vector<std::string>& operands) {
-        bitManipulation->rcr(operands);
-    };
-    instructions["ROL"] = [this](std::vector<std::string>& operands) {
-        bitManipulation->rol(operands);
-    };
-    instructions["ROR"] = [this](std::vector<std::string>& operands) {
-        bitManipulation->ror(operands);
-    };
-    instructions["SAL"] = [this](std::vector<std::string>& operands) {
-        bitManipulation->sal(operands);
-    };
-    instructions["SAR"] = [this](std::vector<std::string>& operands) {
-        bitManipulation->sar(operands);
-    };
-    instructions["SHL"] = [this](std::vector<std::string>& operands) {
-        bitManipulation->shl(operands);
-    };
-    instructions["SHR"] = [this](std::vector<std::string>& operands) {
-        bitManipulation->shr(operands);
-    };
-}
-
-uint16_t& Emulator8086::getRegister(const std::string& reg) {
-    std::string upperReg = reg;
-    std::transform(upperReg.begin(), upperReg.end(), upperReg.begin(), ::toupper);
-    if (upperReg == "AX")
+void Emulator8086::execute(Opcode opcode, const Operands& operands) {
+    checkOperandCount(opcode, operands.size());
+    switch (opcode) {
+#define IM8086_DISPATCH(id, name, unit, handler, ...) \
+    case Opcode::id:                                  \
+        unit.handler(operands);                       \
+        return;
+        IM8086_INSTRUCTIONS(IM8086_DISPATCH)
+#undef IM8086_DISPATCH
+        case Opcode::Invalid:
+            break;
+    }
+    throw std::runtime_error("Invalid opcode");
+}
+
+uint16_t& Emulator8086::getRegister(std::string_view reg) {
+    if (equalsIgnoreCase(reg, "AX"))
         return regs.AX.x;
-    if (upperReg == "BX")
+    if (equalsIgnoreCase(reg, "BX"))
         return regs.BX.x;
-    if (upperReg == "CX")
+    if (equalsIgnoreCase(reg, "CX"))
         return regs.CX.x;
-    if (upperReg == "DX")
+    if (equalsIgnoreCase(reg, "DX"))
         return regs.DX.x;
-    if (upperReg == "SI")
+    if (equalsIgnoreCase(reg, "SI"))
         return regs.SI;
-    if (upperReg == "DI")
+    if (equalsIgnoreCase(reg, "DI"))
         return regs.DI;
-    if (upperReg == "BP")
+    if (equalsIgnoreCase(reg, "BP"))
         return regs.BP;
-    if (upperReg == "SP")
+    if (equalsIgnoreCase(reg, "SP"))
         return regs.SP;
-    throw std::runtime_error("Invalid 16-bit register: " + reg);
+    throw std::runtime_error("Invalid 16-bit register: " + std::string(reg));
 }
 
-uint8_t& Emulator8086::getRegister8(const std::string& reg) {
-    std::string upperReg = reg;
-    std::transform(upperReg.begin(), upperReg.end(), upperReg.begin(), ::toupper);
-    if (upperReg == "AL")
+uint8_t& Emulator8086::getRegister8(std::string_view reg) {
+    if (equalsIgnoreCase(reg, "AL"))
         return regs.AX.bytes.l;
-    if (upperReg == "AH")
+    if (equalsIgnoreCase(reg, "AH"))
         return regs.AX.bytes.h;
-    if (upperReg == "BL")
+    if (equalsIgnoreCase(reg, "BL"))
         return regs.BX.bytes.l;
-    if (upperReg == "BH")
+    if (equalsIgnoreCase(reg, "BH"))
         return regs.BX.bytes.h;
-    if (upperReg == "CL")
+    if (equalsIgnoreCase(reg, "CL"))
         return regs.CX.bytes.l;
-    if (upperReg == "CH")
+    if (equalsIgnoreCase(reg, "CH"))
         return regs.CX.bytes.h;
-    if (upperReg == "DL")
+    if (equalsIgnoreCase(reg, "DL"))
         return regs.DX.bytes.l;
-    if (upperReg == "DH")
+    if (equalsIgnoreCase(reg, "DH"))
         return regs.DX.bytes.h;
-    throw std::runtime_error("Invalid 8-bit register: " + reg);
+    throw std::runtime_error("Invalid 8-bit register: " + std::string(reg));
 }
 
-bool Emulator8086::is8BitRegister(const std::string& reg) {
-    std::string upperReg = reg;
-    std::transform(upperReg.begin(), upperReg.end(), upperReg.begin(), ::toupper);
-    return (upperReg == "AL" || upperReg == "AH" || upperReg == "BL" || upperReg == "BH" ||
-            upperReg == "CL" || upperReg == "CH" || upperReg == "DL" || upperReg == "DH");
+bool Emulator8086::is8BitRegister(std::string_view reg) {
+    if (reg.size() != 2)
+        return false;
+    char r = static_cast<char>(std::toupper(static_cast<unsigned char>(reg[0])));
+    char half = static_cast<char>(std::toupper(static_cast<unsigned char>(reg[1])));
+    return (r == 'A' || r == 'B' || r == 'C' || r == 'D') && (half == 'L' || half == 'H');
 }
 
-bool Emulator8086::isMemoryOperand(const std::string& operand) {
-    return operand[0] == '[' && operand.back() == ']';
+bool Emulator8086::isMemoryOperand(std::string_view operand) {
+    return !operand.empty() && operand[0] == '[' && operand.back() == ']';
 }
 
-MemoryOperand Emulator8086::parseMemoryOperand(const std::string& operand) {
+MemoryOperand Emulator8086::parseMemoryOperand(std::string_view operand) {
     MemoryOperand result;
-    std::string inner = operand.substr(1, operand.length() - 2);
-    std::vector<std::string> parts;
-    std::string current;
-    bool negative = false;
-
-    for (size_t i = 0; i < inner.length(); i++) {
-        if (inner[i] == '+' || inner[i] == '-') {
-            if (!current.empty()) {
-                parts.push_back(current);
-                current.clear();
-            }
-            if (inner[i] == '-')
-                negative = true;
-        } else {
-            current += inner[i];
-        }
-    }
-    if (!current.empty())
-        parts.push_back(current);
+    std::string_view inner = operand.substr(1, operand.length() - 2);
+    // Any '-' makes the displacement negative, wherever it appears.
+    bool negative = inner.find('-') != std::string_view::npos;
+
+    size_t start = 0;
+    while (start <= inner.size()) {
+        size_t end = inner.find_first_of("+-", start);
+        if (end == std::string_view::npos)
+            end = inner.size();
+        std::string_view part = inner.substr(start, end - start);
+        start = end + 1;
+        while (!part.empty() && std::isspace(static_cast<unsigned char>(part.front())))
+            part.remove_prefix(1);
+        while (!part.empty() && std::isspace(static_cast<unsigned char>(part.back())))
+            part.remove_suffix(1);
+        if (part.empty())
+            continue;
 
-    for (const auto& part : parts) {
-        std::string upperPart = part;
-        std::transform(upperPart.begin(), upperPart.end(), upperPart.begin(), ::toupper);
-        if (upperPart == "BX") {
+        if (equalsIgnoreCase(part, "BX")) {
             result.hasBase = true;
             result.base = regs.BX.x;
-        } else if (upperPart == "BP") {
+        } else if (equalsIgnoreCase(part, "BP")) {
             result.hasBase = true;
             result.base = regs.BP;
-        } else if (upperPart == "SI") {
+        } else if (equalsIgnoreCase(part, "SI")) {
             result.hasIndex = true;
             result.index = regs.SI;
-        } else if (upperPart == "DI") {
+        } else if (equalsIgnoreCase(part, "DI")) {
             result.hasIndex = true;
             result.index = regs.DI;
         } else {
             result.hasDisplacement = true;
-            try {
-                result.displacement = std::stoi(part, nullptr, 16);
-                if (negative)
-                    result.displacement = -result.displacement;
-            } catch (const std::invalid_argument& e) {
-                throw std::runtime_error("Invalid displacement value: " + part);
-            } catch (const std::out_of_range& e) {
-                throw std::runtime_error("Displacement value out of range: " + part);
-            }
+            long value = 0;
+            NumberParse parsed = parseIntegerPrefix(part, 16, value);
+            if (parsed == NumberParse::Invalid)
+                throw std::runtime_error("Invalid displacement value: " + std::string(part));
+            if (parsed == NumberParse::OutOfRange || value > INT_MAX || value < INT_MIN)
+                throw std::runtime_error("Displacement value out of range: " + std::string(part));
+            result.displacement = static_cast<int16_t>(value);
+            if (negative)
+                result.displacement = -result.displacement;
         }
     }
     return result;
@@ -440,7 +143,12 @@ uint16_t Emulator8086::calculateEffectiveAddress(const MemoryOperand& memOp) {
 uint16_t Emulator8086::readMemoryWord(uint16_t address) {
     if (static_cast<size_t>(address) + 1 >= memory.size())
         throw std::out_of_range("Memory address out of range");
-    return (memory[address + 1] << 8) | memory[address];
+    uint16_t value = (memory[address + 1] << 8) | memory[address];
+    if (pageWatchBits(address, 2) & kPageWatchRead)
+        checkWatchpoints(address, 2, false);
+    if (hooks.memoryRead)
+        hooks.memoryRead(hooks.context, address, value, false);
+    return value;
 }
 
 void Emulator8086::writeMemoryWord(uint16_t address, uint16_t value) {
@@ -448,11 +156,19 @@ void Emulator8086::writeMemoryWord(uint16_t address, uint16_t value) {
         throw std::out_of_range("Memory address out of range");
     memory[address] = value & 0xFF;
     memory[address + 1] = (value >> 8) & 0xFF;
+    if (pageWatchBits(address, 2) & kPageWatchWrite)
+        checkWatchpoints(address, 2, true);
+    if (hooks.memoryWrite)
+        hooks.memoryWrite(hooks.context, address, value, false);
 }
 
 uint8_t Emulator8086::readMemoryByte(uint16_t address) {
     if (static_cast<size_t>(address) >= memory.size())
         throw std::out_of_range("Memory address out of range");
+    if (watchedPages[address >> 8] & kPageWatchRead)
+        checkWatchpoints(address, 1, false);
+    if (hooks.memoryRead)
+        hooks.memoryRead(hooks.context, address, memory[address], true);
     return memory[address];
 }
 
@@ -460,24 +176,35 @@ void Emulator8086::writeMemoryByte(uint16_t address, uint8_t value) {
     if (static_cast<size_t>(address) >= memory.size())
         throw std::out_of_range("Memory address out of range");
     memory[address] = value;
+    if (watchedPages[address >> 8] & kPageWatchWrite)
+        checkWatchpoints(address, 1, true);
+    if (hooks.memoryWrite)
+        hooks.memoryWrite(hooks.context, address, value, true);
 }
 
-uint16_t Emulator8086::getValue(const std::string& operand) {
+uint8_t* Emulator8086::directMemory(uint16_t address, size_t length, bool isWrite) {
+    size_t end = static_cast<size_t>(address) + length;
+    if (length == 0 || end > memory.size() || end > 0x10000)
+        return nullptr;
+    if (isWrite ? hooks.memoryWrite != nullptr : hooks.memoryRead != nullptr)
+        return nullptr;
+    uint8_t watchBit = isWrite ? kPageWatchWrite : kPageWatchRead;
+    for (size_t page = address >> 8; page <= (end - 1) >> 8; ++page) {
+        if (watchedPages[page] & watchBit)
+            return nullptr;
+    }
+    return memory.data() + address;
+}
+
+uint16_t Emulator8086::getValue(std::string_view operand) {
     if (isMemoryOperand(operand)) {
         MemoryOperand memOp = parseMemoryOperand(operand);
         uint16_t address = calculateEffectiveAddress(memOp);
         return readMemoryWord(address);
     } else if (operand.back() == 'h') {
-        std::string hexValue = operand.substr(0, operand.size() - 1);
-        return std::stoul(hexValue, nullptr, 16);
+        return static_cast<uint16_t>(parseImmediate(operand, true));
     } else if (operand[0] >= '0' && operand[0] <= '9') {
-        try {
-            return std::stoi(operand);
-        } catch (const std::invalid_argument& e) {
-            throw std::runtime_error("Invalid immediate value: " + operand);
-        } catch (const std::out_of_range& e) {
-            throw std::runtime_error("Immediate value out of range: " + operand);
-        }
+        return static_cast<uint16_t>(parseImmediate(operand, false));
     } else if (is8BitRegister(operand)) {
         throw std::runtime_error("Cannot get 16-bit value from 8-bit register");
     } else {
@@ -485,22 +212,15 @@ uint16_t Emulator8086::getValue(const std::string& operand) {
     }
 }
 
-uint8_t Emulator8086::getValue8(const std::string& operand) {
+uint8_t Emulator8086::getValue8(std::string_view operand) {
     if (isMemoryOperand(operand)) {
         MemoryOperand memOp = parseMemoryOperand(operand);
         uint16_t address = calculateEffectiveAddress(memOp);
         return readMemoryByte(address);
     } else if (operand.back() == 'h') {
-        std::string hexValue = operand.substr(0, operand.size() - 1);
-        return std::stoul(hexValue, nullptr, 16) & 0xFF;
+        return parseImmediate(operand, true) & 0xFF;
     } else if (operand[0] >= '0' && operand[0] <= '9') {
-        try {
-            return std::stoi(operand) & 0xFF;
-        } catch (const std::invalid_argument& e) {
-            throw std::runtime_error("Invalid immediate value: " + operand);
-        } catch (const std::out_of_range& e) {
-            throw std::runtime_error("Immediate value out of range: " + operand);
-        }
+        return parseImmediate(operand, false) & 0xFF;
     } else if (is8BitRegister(operand)) {
         return getRegister8(operand);
     } else {
@@ -512,104 +232,278 @@ void Emulator8086::updateFlags(uint32_t result, bool isByte, bool checkCarry) {
     uint16_t mask = isByte ? 0xFF : 0xFFFF;
     uint16_t res = result & mask;
 
-    regs.FLAGS = (res == 0) ? (regs.FLAGS | Registers::ZF) : (regs.FLAGS & ~Registers::ZF);
+    if (!(skipFlags & Registers::ZF))
+        regs.FLAGS = (res == 0) ? (regs.FLAGS | Registers::ZF) : (regs.FLAGS & ~Registers::ZF);
 
-    regs.FLAGS = (isByte ? (res & 0x80) : (res & 0x8000)) ? (regs.FLAGS | Registers::SF)
-                                                          : (regs.FLAGS & ~Registers::SF);
+    if (!(skipFlags & Registers::SF)) {
+        regs.FLAGS = (isByte ? (res & 0x80) : (res & 0x8000)) ? (regs.FLAGS | Registers::SF)
+                                                              : (regs.FLAGS & ~Registers::SF);
+    }
 
-    if (checkCarry) {
+    if (checkCarry && !(skipFlags & Registers::CF)) {
         regs.FLAGS = (isByte ? (result > 0xFF) : (result > 0xFFFF)) ? (regs.FLAGS | Registers::CF)
                                                                     : (regs.FLAGS & ~Registers::CF);
     }
 
-    uint8_t leastByte = res & 0xFF;
-    uint8_t parity = 0;
-    for (int i = 0; i < 8; ++i)
-        parity ^= (leastByte >> i) & 1;
-    regs.FLAGS = (parity == 0) ? (regs.FLAGS | Registers::PF) : (regs.FLAGS & ~Registers::PF);
-}
-
-void Emulator8086::executeInstruction(const std::string& instruction) {
-    std::istringstream iss(instruction);
-    std::string mnemonic;
-    iss >> mnemonic;
-
-    std::transform(mnemonic.begin(), mnemonic.end(), mnemonic.begin(), ::toupper);
-
-    std::vector<std::string> operands;
-    std::string operand;
-    while (std::getline(iss, operand, ',')) {
-        operand.erase(operand.begin(), std::find_if(operand.begin(), operand.end(), [](int ch) {
-                          return !std::isspace(ch);
-                      }));
-        operand.erase(
-            std::find_if(operand.rbegin(), operand.rend(), [](int ch) { return !std::isspace(ch); })
-                .base(),
-            operand.end());
-        if (!operand.empty())
-            operands.push_back(operand);
+    if (!(skipFlags & Registers::PF)) {
+        uint8_t leastByte = res & 0xFF;
+        uint8_t parity = 0;
+        for (int i = 0; i < 8; ++i)
+            parity ^= (leastByte >> i) & 1;
+        regs.FLAGS = (parity == 0) ? (regs.FLAGS | Registers::PF) : (regs.FLAGS & ~Registers::PF);
     }
+}
 
-    auto it = instructions.find(mnemonic);
-    if (it != instructions.end()) {
-        it->second(operands);
-    } else {
-        throw std::runtime_error("Unknown instruction: " + mnemonic);
+void Emulator8086::executeInstruction(std::string_view instruction) {
+    std::string_view mnemonic;
+    Operands operands;
+    if (!splitInstruction(instruction, mnemonic, operands))
+        throw std::runtime_error("Too many operands");
+    Opcode opcode = lookupMnemonic(mnemonic);
+    if (opcode == Opcode::Invalid) {
+        std::string name(mnemonic);
+        std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+        throw std::runtime_error("Unknown instruction: " + name);
     }
+    // Typed instructions have no line to come back to, so REP runs all of its chunks here.
+    do {
+        repeatSuspended = false;
+        execute(opcode, operands);
+    } while (repeatSuspended);
 }
 
 void Emulator8086::loadProgram(const std::vector<std::string>& lines) {
-    program.clear();
-    labels.clear();
-    regs.IP = 0;
-
+    DecodedProgram decoded;
+    std::string_view text;
     for (size_t i = 0; i < lines.size(); ++i) {
-        std::string line = lines[i];
-
-        line.erase(line.begin(), std::find_if(line.begin(), line.end(), [](int ch) {
-                       return !std::isspace(ch);
-                   }));
-        line.erase(
-            std::find_if(line.rbegin(), line.rend(), [](int ch) { return !std::isspace(ch); })
-                .base(),
-            line.end());
-        if (line.empty())
-            continue;
-
-        auto scPos = line.find(';');
-        if (scPos != std::string::npos)
-            line = line.substr(0, scPos);
-        if (line.empty())
-            continue;
-        if (line.back() == ':') {
-            std::string label = line.substr(0, line.size() - 1);
-            std::transform(label.begin(), label.end(), label.begin(), ::toupper);
-            labels[label] = program.size();
-        } else {
-            program.push_back(line);
+        switch (classifySourceLine(lines[i], text)) {
+            case SourceLineKind::Blank:
+                break;
+            case SourceLineKind::Instruction:
+                decoded.instructions.emplace_back(text);
+                decoded.sourceLines.push_back(i + 1);
+                break;
+            case SourceLineKind::Label: {
+                std::string label(text);
+                std::transform(label.begin(), label.end(), label.begin(), ::toupper);
+                decoded.labels[label] = decoded.instructions.size();
+                break;
+            }
         }
     }
+    loadProgram(std::move(decoded));
 }
 
-bool Emulator8086::step() {
-    if (regs.IP >= program.size())
-        return false;
-    std::string instr = program[regs.IP];
-    size_t oldIP = regs.IP;
+void Emulator8086::loadProgram(DecodedProgram decoded) {
+    loadProgram(Program::create(std::move(decoded)));
+}
+
+void Emulator8086::loadProgram(std::shared_ptr<const Program> shared) {
+    program = std::move(shared);
+    rebuildFusion();
+    rebuildFlagLiveness();
+    regs.IP = 0;
+    repeatSuspended = false;
+
+    if (profiler)
+        profiler->attach(getProgram(), getLabels(), getSourceLines());
+}
+
+void Emulator8086::executeLine(size_t line) {
     try {
-        executeInstruction(instr);
+        const DecodedInstruction& instruction = program->getDecodedLines()[line];
+        bool resuming = resumingRepeat(line);
+        repeatSuspended = false;
+        if (!resuming && isRepeatPrefix(instruction.opcode))
+            repeatEntry = regs;
+        if (instruction.opcode == Opcode::Invalid)
+            executeInstruction(getProgram()[line]);  // Reports why it did not decode.
+        else
+            execute(instruction.opcode, instruction.operands(getProgram()[line]));
     } catch (const std::exception& e) {
-        std::cerr << "Execution error at IP=" << oldIP << ": " << e.what() << "\n";
+        std::cerr << "Execution error at IP=" << line << ": " << e.what() << "\n";
     }
 
-    if (regs.IP == oldIP)
+    if (regs.IP == line && !repeatSuspended)
         regs.IP++;
-    return regs.IP < program.size();
+}
+
+void Emulator8086::executeFused(const FusedPair& pair, size_t line) {
+    if (pair.byte) {
+        uint8_t& dest = fusedRegister8(regs, pair.dest.reg);
+        uint8_t src = pair.src.kind == FusedOperand::Reg8 ? fusedRegister8(regs, pair.src.reg)
+                                                          : static_cast<uint8_t>(pair.src.value);
+        switch (pair.first) {
+            case Opcode::Mov:
+                dest = src;
+                break;
+            case Opcode::Cmp:
+                updateFlags(static_cast<uint16_t>(dest - src), true, true);
+                break;
+            case Opcode::Test:
+                updateFlags(static_cast<uint8_t>(dest & src), true, false);
+                break;
+            case Opcode::Add: {
+                uint16_t result = dest + src;
+                dest = result & 0xFF;
+                updateFlags(result, true, true);
+                break;
+            }
+            case Opcode::Sub: {
+                uint16_t result = dest - src;
+                dest = result & 0xFF;
+                updateFlags(result, true, true);
+                break;
+            }
+            case Opcode::Inc:
+            case Opcode::Dec: {
+                uint16_t result = pair.first == Opcode::Inc ? dest + 1 : dest - 1;
+                dest = result & 0xFF;
+                updateFlags(result, true, false);
+                break;
+            }
+            default:
+                break;
+        }
+    } else {
+        uint16_t& dest = fusedRegister16(regs, pair.dest.reg);
+        uint16_t src = pair.src.kind == FusedOperand::Reg16 ? fusedRegister16(regs, pair.src.reg)
+                                                            : pair.src.value;
+        switch (pair.first) {
+            case Opcode::Mov:
+                dest = src;
+                break;
+            case Opcode::Cmp:
+                updateFlags(static_cast<uint32_t>(dest - src), false, true);
+                break;
+            case Opcode::Test:
+                updateFlags(static_cast<uint16_t>(dest & src), false, false);
+                break;
+            case Opcode::Add: {
+                uint32_t result = dest + src;
+                dest = result & 0xFFFF;
+                updateFlags(result, false, true);
+                break;
+            }
+            case Opcode::Sub: {
+                uint32_t result = dest - src;
+                dest = result & 0xFFFF;
+                updateFlags(result, false, true);
+                break;
+            }
+            case Opcode::Inc:
+            case Opcode::Dec: {
+                uint32_t result = pair.first == Opcode::Inc ? dest + 1 : dest - 1;
+                dest = result & 0xFFFF;
+                updateFlags(result, false, false);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    regs.IP = static_cast<uint16_t>(line + 2);
+    if (pair.second != Opcode::Mov) {
+        if (fusedBranchTaken(pair.second, regs))
+            regs.IP = pair.target;
+    } else if (pair.secondByte) {
+        fusedRegister8(regs, pair.secondDest.reg) =
+            pair.secondSrc.kind == FusedOperand::Reg8
+                ? fusedRegister8(regs, pair.secondSrc.reg)
+                : static_cast<uint8_t>(pair.secondSrc.value);
+    } else {
+        fusedRegister16(regs, pair.secondDest.reg) =
+            pair.secondSrc.kind == FusedOperand::Reg16
+                ? fusedRegister16(regs, pair.secondSrc.reg)
+                : pair.secondSrc.value;
+    }
+}
+
+void Emulator8086::setFusionCandidates(const FusionCandidates& candidates) {
+    fusionCandidates = candidates;
+    rebuildFusion();
+}
+
+void Emulator8086::setJitEnabled(bool enable) {
+    if (!enable || !Jit::isSupported())
+        jit.reset();
+    else if (!jit)
+        jit = std::make_unique<Jit>(this);
+}
+
+void Emulator8086::rebuildFusion() {
+    ownFusedLines.clear();
+    fusedLines = &ownFusedLines;
+    if (fusionCandidates == FusionCandidates::all())
+        fusedLines = &program->getFusedPairs();
+    else if (fusionCandidates.count() != 0)
+        ownFusedLines = fuseProgram(getProgram(), getDecodedLines(), getLabels(), fusionCandidates);
+}
+
+void Emulator8086::setFlagLivenessEnabled(bool enable) {
+    flagLiveness = enable;
+    rebuildFlagLiveness();
+}
+
+// Translated blocks carry the dead flags of their lines, so they go too.
+void Emulator8086::rebuildFlagLiveness() {
+    ownDeadFlags.clear();
+    deadFlags = &ownDeadFlags;
+    if (flagLiveness && watchpoints.empty()) {
+        std::vector<size_t> breakpoints = getBreakpoints();
+        if (breakpoints.empty())
+            deadFlags = &program->getDeadFlags();
+        else
+            ownDeadFlags = program->getFlagFlow().findDeadFlagWrites(breakpoints);
+    }
+    if (jit)
+        jit->flush();
+}
+
+// A breakpoint only changes the dead flags of the lines within the horizon before it, so
+// those are recomputed, and only translations over them or over the breakpoint are dropped.
+void Emulator8086::updateBreakpointLiveness(const std::vector<size_t>& changed) {
+    const FlagFlowGraph& flow = program->getFlagFlow();
+    std::vector<size_t> lines;
+    for (size_t line : changed) {
+        std::vector<size_t> reaching = flow.linesReaching(line);
+        lines.insert(lines.end(), reaching.begin(), reaching.end());
+    }
+    if (flagLiveness && watchpoints.empty()) {
+        std::vector<size_t> breakpoints = getBreakpoints();
+        if (breakpoints.empty()) {
+            ownDeadFlags.clear();
+            deadFlags = &program->getDeadFlags();
+        } else {
+            if (deadFlags != &ownDeadFlags) {
+                ownDeadFlags = *deadFlags;
+                deadFlags = &ownDeadFlags;
+            }
+            flow.updateDeadFlagWrites(ownDeadFlags, lines, breakpoints);
+        }
+    }
+    if (jit)
+        jit->invalidate(lines);
+}
+
+bool Emulator8086::step() {
+    advance(1);
+    return regs.IP < program->size();
+}
+
+size_t Emulator8086::advance(size_t maxSteps) {
+    if (profiler) {
+        ProfilerInstrumentation policy(*profiler);
+        return run(policy, maxSteps);
+    }
+    return run(maxSteps);
 }
 
 void Emulator8086::reset() {
     regs = Registers();
-    std::fill(memory.begin(), memory.end(), 0);
+    repeatSuspended = false;
+    memory.zero();
 }
 
 void Emulator8086::displayRegisters() {
@@ -643,7 +537,8 @@ void Emulator8086::displayRegisters() {
               << (regs.FLAGS & Registers::ZF ? "Z" : "-")
               << (regs.FLAGS & Registers::AF ? "A" : "-")
               << (regs.FLAGS & Registers::PF ? "P" : "-")
-              << (regs.FLAGS & Registers::CF ? "C" : "-") << "]\n";
+              << (regs.FLAGS & Registers::CF ? "C" : "-") << "]\n"
+              << std::dec << std::setfill(' ');
 }
 
 void Emulator8086::displayStack() {
@@ -656,6 +551,7 @@ void Emulator8086::displayStack() {
         std::cout << std::hex << std::uppercase << std::setfill('0') << "SP+" << std::setw(4)
                   << (i - regs.SP) << ": " << std::setw(4) << readMemoryWord(i) << '\n';
     }
+    std::cout << std::dec << std::setfill(' ');
 }
 
 void Emulator8086::displayMemory(uint16_t address, uint16_t count) {
@@ -668,131 +564,14 @@ void Emulator8086::displayMemory(uint16_t address, uint16_t count) {
         if (i % 16 == 15 || i == count - 1)
             std::cout << '\n';
     }
+    std::cout << std::dec << std::setfill(' ');
 }
 
 void Emulator8086::displayHelp() {
     std::cout << "8086 Emulator - Supported Instructions:\n";
     std::cout << "----------------------------------------\n";
 
-    std::cout << "Data Transfer Instructions:\n";
-    std::cout << "  MOV dest,src       - Move data from src to dest (reg/mem/imm)\n";
-    std::cout << "  PUSH src           - Push 16-bit value onto stack\n";
-    std::cout << "  POP dest           - Pop 16-bit value from stack to dest\n";
-    std::cout << "  XCHG op1,op2       - Exchange contents of two operands\n";
-    std::cout << "  LEA reg,[mem]      - Load effective address into register\n";
-    std::cout << "  LDS reg,[mem]      - Load DS and register from memory\n";
-    std::cout << "  LES reg,[mem]      - Load ES and register from memory\n";
-    std::cout << "  LAHF               - Load AH from flags\n";
-    std::cout << "  SAHF               - Store AH into flags\n";
-    std::cout << "  PUSHF              - Push flags onto stack\n";
-    std::cout << "  POPF               - Pop flags from stack\n";
-    std::cout << "  PUSHA              - Push all general-purpose registers\n";
-    std::cout << "  POPA               - Pop all general-purpose registers\n";
-    std::cout << "  IN dest,port       - Input from port (enhanced simulation)\n";
-    std::cout << "  OUT port,src       - Output to port (enhanced simulation)\n";
-    std::cout << "  XLAT               - Translate byte using table (BX+AL)\n";
-    std::cout << "  XLATB              - Same as XLAT\n";
-
-    std::cout << "\nArithmetic Instructions:\n";
-    std::cout << "  ADD dest,src       - Add src to dest\n";
-    std::cout << "  ADC dest,src       - Add with carry\n";
-    std::cout << "  INC op             - Increment operand by 1\n";
-    std::cout << "  AAA                - ASCII adjust after addition\n";
-    std::cout << "  DAA                - Decimal adjust after addition\n";
-    std::cout << "  SUB dest,src       - Subtract src from dest\n";
-    std::cout << "  SBB dest,src       - Subtract with borrow\n";
-    std::cout << "  DEC op             - Decrement operand by 1\n";
-    std::cout << "  NEG op             - Negate operand (two's complement)\n";
-    std::cout << "  AAS                - ASCII adjust after subtraction\n";
-    std::cout << "  DAS                - Decimal adjust after subtraction\n";
-    std::cout << "  MUL op             - Unsigned multiply (AX or DX:AX)\n";
-    std::cout << "  IMUL op            - Signed multiply (AX or DX:AX)\n";
-    std::cout << "  AAM                - ASCII adjust after multiplication\n";
-    std::cout << "  DIV op             - Unsigned divide (AX or DX:AX)\n";
-    std::cout << "  IDIV op            - Signed divide (AX or DX:AX)\n";
-    std::cout << "  AAD                - ASCII adjust before division\n";
-    std::cout << "  CBW                - Convert byte to word (sign-extend AL to AX)\n";
-    std::cout << "  CWD                - Convert word to doubleword (sign-extend AX to DX:AX)\n";
-
-    std::cout << "\nLogical Instructions:\n";
-    std::cout << "  AND dest,src       - Bitwise AND\n";
-    std::cout << "  OR dest,src        - Bitwise OR\n";
-    std::cout << "  XOR dest,src       - Bitwise XOR\n";
-    std::cout << "  NOT op             - Bitwise NOT\n";
-    std::cout << "  TEST dest,src      - Test bits (AND without storing result)\n";
-    std::cout << "  CMP dest,src       - Compare (subtract without storing result)\n";
-
-    std::cout << "\nShift and Rotate Instructions:\n";
-    std::cout << "  RCL op,count       - Rotate left through carry\n";
-    std::cout << "  RCR op,count       - Rotate right through carry\n";
-    std::cout << "  ROL op,count       - Rotate left\n";
-    std::cout << "  ROR op,count       - Rotate right\n";
-    std::cout << "  SAL op,count       - Shift arithmetic left (same as SHL)\n";
-    std::cout << "  SAR op,count       - Shift arithmetic right\n";
-    std::cout << "  SHL op,count       - Shift logical left\n";
-    std::cout << "  SHR op,count       - Shift logical right\n";
-
-    std::cout << "\nString Instructions:\n";
-    std::cout << "  MOVSB              - Move byte from SI to DI\n";
-    std::cout << "  MOVSW              - Move word from SI to DI\n";
-    std::cout << "  CMPSB              - Compare byte at SI and DI\n";
-    std::cout << "  CMPSW              - Compare word at SI and DI\n";
-    std::cout << "  SCASB              - Scan byte (compare AL with DI)\n";
-    std::cout << "  SCASW              - Scan word (compare AX with DI)\n";
-    std::cout << "  LODSB              - Load byte from SI to AL\n";
-    std::cout << "  LODSW              - Load word from SI to AX\n";
-    std::cout << "  STOSB              - Store AL to DI\n";
-    std::cout << "  STOSW              - Store AX to DI\n";
-    std::cout << "  REP inst           - Repeat string instruction (enhanced)\n";
-    std::cout << "  REPE/REPZ inst     - Repeat while equal (enhanced)\n";
-    std::cout << "  REPNE/REPNZ inst   - Repeat while not equal (enhanced)\n";
-
-    std::cout << "\nControl Transfer Instructions:\n";
-    std::cout << "  CALL addr          - Call subroutine\n";
-    std::cout << "  JMP addr           - Unconditional jump\n";
-    std::cout << "  RET                - Return from subroutine\n";
-    std::cout << "  RETF               - Return far (pops CS and IP)\n";
-    std::cout << "  JE/JZ addr         - Jump if equal/zero (ZF=1)\n";
-    std::cout << "  JL/JNGE addr       - Jump if less/not greater or equal (SF!=OF)\n";
-    std::cout << "  JLE/JNG addr       - Jump if less or equal/not greater (ZF=1 or SF!=OF)\n";
-    std::cout << "  JB/JNAE/JC addr    - Jump if below/not above or equal/carry (CF=1)\n";
-    std::cout << "  JBE/JNA addr       - Jump if below or equal/not above (CF=1 or ZF=1)\n";
-    std::cout << "  JP/JPE addr        - Jump if parity/parity even (PF=1)\n";
-    std::cout << "  JO addr            - Jump if overflow (OF=1)\n";
-    std::cout << "  JS addr            - Jump if sign (SF=1)\n";
-    std::cout << "  JNE/JNZ addr       - Jump if not equal/not zero (ZF=0)\n";
-    std::cout << "  JNL/JGE addr       - Jump if not less/greater or equal (SF=OF)\n";
-    std::cout << "  JG/JNLE addr       - Jump if greater/not less or equal (ZF=0 and SF=OF)\n";
-    std::cout << "  JNB/JAE/JNC addr   - Jump if not below/above or equal/not carry (CF=0)\n";
-    std::cout << "  JA/JNBE addr       - Jump if above/not below or equal (CF=0 and ZF=0)\n";
-    std::cout << "  JNP/JPO addr       - Jump if not parity/parity odd (PF=0)\n";
-    std::cout << "  JNO addr           - Jump if no overflow (OF=0)\n";
-    std::cout << "  JNS addr           - Jump if not sign (SF=0)\n";
-    std::cout << "  LOOP addr          - Loop while CX != 0\n";
-    std::cout << "  LOOPZ/LOOPE addr   - Loop while CX != 0 and ZF=1\n";
-    std::cout << "  LOOPNZ/LOOPNE addr - Loop while CX != 0 and ZF=0\n";
-    std::cout << "  JCXZ addr          - Jump if CX = 0\n";
-
-    std::cout << "\nInterrupt Instructions:\n";
-    std::cout << "  INT num            - Software interrupt (enhanced simulation)\n";
-    std::cout << "  INTO               - Interrupt on overflow (enhanced)\n";
-    std::cout << "  IRET               - Return from interrupt (enhanced)\n";
-
-    std::cout << "\nFlag Control Instructions:\n";
-    std::cout << "  CLC                - Clear carry flag\n";
-    std::cout << "  CMC                - Complement carry flag\n";
-    std::cout << "  STC                - Set carry flag\n";
-    std::cout << "  CLD                - Clear direction flag\n";
-    std::cout << "  STD                - Set direction flag\n";
-    std::cout << "  CLI                - Clear interrupt flag\n";
-    std::cout << "  STI                - Set interrupt flag\n";
-
-    std::cout << "\nMiscellaneous Instructions:\n";
-    std::cout << "  HLT                - Halt execution\n";
-    std::cout << "  WAIT               - Wait for external signal\n";
-    std::cout << "  ESC op             - Escape to coprocessor (enhanced simulation)\n";
-    std::cout << "  LOCK inst          - Lock bus (simulation)\n";
-    std::cout << "  NOP                - No operation\n";
+    writeInstructionHelp(std::cout);
 
     std::cout << "\nEmulator Commands:\n";
     std::cout << "  reg                - Display registers\n";
@@ -804,20 +583,115 @@ void Emulator8086::displayHelp() {
     std::cout << "Notes: Use 'h' suffix for hex (e.g., 10h), memory as [BX+SI+offset]\n";
 }
 
-size_t Emulator8086::getLabelAddress(const std::string& label) {
-    std::string upperLabel = label;
-    std::transform(upperLabel.begin(), upperLabel.end(), upperLabel.begin(), ::toupper);
-
-    auto it = labels.find(upperLabel);
+size_t Emulator8086::getLabelAddress(std::string_view label) {
+    const LabelMap& labels = getLabels();
+    auto it = labels.find(label);
     if (it != labels.end()) {
         return it->second;
     } else {
-        throw std::runtime_error("Unknown label: " + label);
+        throw std::runtime_error("Unknown label: " + std::string(label));
+    }
+}
+
+bool Emulator8086::hasLabel(std::string_view label) {
+    return getLabels().count(label) != 0;
+}
+
+void Emulator8086::enableProfiler(bool enable) {
+    if (!enable) {
+        profiler.reset();
+        return;
+    }
+    if (!profiler)
+        profiler = std::make_unique<Profiler>();
+    profiler->attach(getProgram(), getLabels(), getSourceLines());
+}
+
+void Emulator8086::setBreakpoint(size_t line, bool enabled) {
+    if (hasBreakpoint(line) == enabled)
+        return;
+    size_t word = line >> 6;
+    if (word >= breakpointBits.size()) {
+        if (!enabled)
+            return;
+        breakpointBits.resize(word + 1, 0);
+    }
+    if (enabled)
+        breakpointBits[word] |= uint64_t(1) << (line & 63);
+    else
+        breakpointBits[word] &= ~(uint64_t(1) << (line & 63));
+    updateBreakpointLiveness({line});
+}
+
+bool Emulator8086::toggleBreakpoint(size_t line) {
+    bool enabled = !hasBreakpoint(line);
+    setBreakpoint(line, enabled);
+    return enabled;
+}
+
+void Emulator8086::clearBreakpoints() {
+    std::vector<size_t> cleared = getBreakpoints();
+    breakpointBits.clear();
+    updateBreakpointLiveness(cleared);
+}
+
+std::vector<size_t> Emulator8086::getBreakpoints() const {
+    std::vector<size_t> lines;
+    for (size_t word = 0; word < breakpointBits.size(); ++word) {
+        for (size_t bit = 0; bit < 64; ++bit) {
+            if ((breakpointBits[word] >> bit) & 1)
+                lines.push_back(word * 64 + bit);
+        }
     }
+    return lines;
 }
 
-bool Emulator8086::hasLabel(const std::string& label) {
-    std::string upperLabel = label;
-    std::transform(upperLabel.begin(), upperLabel.end(), upperLabel.begin(), ::toupper);
-    return labels.find(upperLabel) != labels.end();
+void Emulator8086::addWatchpoint(uint16_t address, uint16_t length, bool onRead, bool onWrite) {
+    if (length == 0)
+        throw std::runtime_error("Watchpoint length must be at least 1");
+    watchpoints.push_back({address, length, onRead, onWrite});
+    rebuildWatchedPages();
+}
+
+bool Emulator8086::removeWatchpoint(uint16_t address) {
+    auto it = std::remove_if(watchpoints.begin(), watchpoints.end(), [address](const Watchpoint& w) {
+        return w.address == address;
+    });
+    bool removed = it != watchpoints.end();
+    watchpoints.erase(it, watchpoints.end());
+    rebuildWatchedPages();
+    return removed;
+}
+
+void Emulator8086::clearWatchpoints() {
+    watchpoints.clear();
+    rebuildWatchedPages();
+}
+
+void Emulator8086::rebuildWatchedPages() {
+    watchedPages.fill(0);
+    for (const auto& watch : watchpoints) {
+        uint8_t bits = (watch.onRead ? kPageWatchRead : 0) | (watch.onWrite ? kPageWatchWrite : 0);
+        for (uint32_t offset = 0; offset < watch.length; offset += 256) {
+            watchedPages[static_cast<uint16_t>(watch.address + offset) >> 8] |= bits;
+        }
+        watchedPages[static_cast<uint16_t>(watch.address + watch.length - 1) >> 8] |= bits;
+    }
+    rebuildFlagLiveness();
+}
+
+void Emulator8086::checkWatchpoints(uint16_t address, uint16_t size, bool isWrite) {
+    for (const auto& watch : watchpoints) {
+        if (!(isWrite ? watch.onWrite : watch.onRead))
+            continue;
+        uint16_t offset = static_cast<uint16_t>(address - watch.address);
+        uint16_t back = static_cast<uint16_t>(watch.address - address);
+        if (offset < watch.length || back < size) {
+            if (!watchTriggered) {
+                watchTriggered = true;
+                watchHit = {address, isWrite, regs.IP};
+            }
+            return;
+        }
+    }
 }
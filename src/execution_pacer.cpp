@@ -0,0 +1,132 @@
+#include "execution_pacer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "emulator8086.h"
+
+ExecutionPacer::ExecutionPacer(Clock::duration frameBudget) : frameBudget(frameBudget) {
+    resume();
+}
+
+void ExecutionPacer::setMode(Mode newMode) {
+    mode = newMode;
+    credit = 0.0;
+}
+
+void ExecutionPacer::cycleMode() {
+    switch (mode) {
+        case Mode::Full:
+            setMode(Mode::Throttled);
+            break;
+        case Mode::Throttled:
+            setMode(Mode::Animate);
+            break;
+        case Mode::Animate:
+            setMode(Mode::Full);
+            break;
+    }
+}
+
+uint32_t ExecutionPacer::getRate() const {
+    return mode == Mode::Animate ? animateRate : throttleRate;
+}
+
+void ExecutionPacer::setRate(uint32_t rate) {
+    rate = std::max<uint32_t>(rate, 1);
+    if (mode == Mode::Animate)
+        animateRate = rate;
+    else
+        throttleRate = rate;
+}
+
+void ExecutionPacer::faster() {
+    uint32_t rate = getRate();
+    setRate(rate > UINT32_MAX / 2 ? UINT32_MAX : rate * 2);
+}
+
+void ExecutionPacer::slower() {
+    setRate(getRate() / 2);
+}
+
+void ExecutionPacer::resume(Clock::time_point now) {
+    lastFrame = now;
+    credit = 0.0;
+    windowStart = now;
+    windowRetired = 0;
+}
+
+ExecutionPacer::FrameResult ExecutionPacer::runFrame(Emulator8086& emulator,
+                                                     Clock::time_point now) {
+    FrameResult result;
+    double elapsed = std::chrono::duration<double>(now - lastFrame).count();
+    lastFrame = now;
+
+    if (mode == Mode::Full) {
+        runBudgeted(emulator, SIZE_MAX, result);
+    } else {
+        // Bank at most a quarter second of instructions so a stalled terminal does not come
+        // back as a burst.
+        double rate = getRate();
+        credit = std::min(credit + elapsed * rate, std::max(1.0, rate / 4));
+        size_t allowance = static_cast<size_t>(credit);
+        if (mode == Mode::Animate)
+            allowance = std::min<size_t>(allowance, 1);
+        if (allowance > 0)
+            credit -= static_cast<double>(runBudgeted(emulator, allowance, result));
+    }
+
+    measure(result.retired, now);
+    return result;
+}
+
+size_t ExecutionPacer::runBudgeted(Emulator8086& emulator, size_t limit, FrameResult& result) {
+    Clock::time_point deadline = Clock::now() + frameBudget;
+    while (result.retired < limit) {
+        size_t want = std::min(slice, limit - result.retired);
+        Clock::time_point sliceStart = Clock::now();
+        result.retired += emulator.advance(want);
+        Clock::time_point sliceEnd = Clock::now();
+        if (emulator.getStopReason() != Emulator8086::StopReason::StepLimit) {
+            result.stopped = true;
+            break;
+        }
+        // Aim for slices of about a millisecond: long enough to amortize the clock reads,
+        // short enough to land close to the deadline.
+        if (want == slice) {
+            auto took = sliceEnd - sliceStart;
+            if (took < std::chrono::microseconds(500))
+                slice = std::min(slice * 2, kMaxSlice);
+            else if (took > std::chrono::milliseconds(2))
+                slice = std::max(slice / 2, kMinSlice);
+        }
+        if (sliceEnd >= deadline)
+            break;
+    }
+    return result.retired;
+}
+
+void ExecutionPacer::measure(size_t retired, Clock::time_point now) {
+    windowRetired += retired;
+    double seconds = std::chrono::duration<double>(now - windowStart).count();
+    if (seconds < 1.0)
+        return;
+    measuredRate = windowRetired / seconds;
+    windowStart = now;
+    windowRetired = 0;
+}
+
+std::string ExecutionPacer::describe() const {
+    char text[48];
+    switch (mode) {
+        case Mode::Full:
+            return "full speed";
+        case Mode::Throttled:
+            std::snprintf(text, sizeof(text), "%u IPS", throttleRate);
+            return text;
+        case Mode::Animate:
+            std::snprintf(text, sizeof(text), "animate %u/s", animateRate);
+            return text;
+    }
+    return "";
+}
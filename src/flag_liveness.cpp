@@ -0,0 +1,262 @@
+#include "flag_liveness.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "fusion.h"
+
+namespace {
+
+constexpr uint16_t kEveryFlag = 0xFFFF;
+constexpr uint32_t kUnknown = UINT32_MAX;
+
+// Where control goes after a branch to `operand`. The interpreter steps past a branch to its
+// own line, so that one just continues.
+uint32_t branchTarget(const Operands& operands, const LabelMap& labels, size_t line) {
+    auto label = operands.size() == 1 ? labels.find(operands[0]) : labels.end();
+    if (label == labels.end())
+        return kUnknown;
+    return static_cast<uint32_t>(label->second == line ? line + 1 : label->second);
+}
+
+}  // namespace
+
+FlagFlowGraph::Node FlagFlowGraph::analyse(const std::string& text,
+                                           const DecodedInstruction& instruction,
+                                           const LabelMap& labels,
+                                           size_t line) {
+    Node node;
+    Opcode opcode = instruction.opcode;
+    if (opcode == Opcode::Invalid || opcode == Opcode::Lock || opcode == Opcode::Esc) {
+        node.reads = kEveryFlag;  // Nothing known about what runs.
+        node.next[0] = static_cast<uint32_t>(line + 1);
+        return node;
+    }
+    const InstructionInfo& info = instructionInfo(opcode);
+    node.reads = info.flagsRead;
+    Operands operands = instruction.operands(text);
+
+    node.writes = handlerFlagsWritten(opcode);
+    if (uint16_t written = node.writes) {
+        bool byte = false;
+        FusedOperand dest;
+        FusedOperand src;
+        if (resolveRegisterOperands(opcode, operands, byte, dest, src))
+            node.kills = written;
+    }
+
+    switch (info.kind) {
+        case InstructionKind::Jump:
+        case InstructionKind::Call:
+            node.next[0] = branchTarget(operands, labels, line);
+            node.opaque = node.next[0] == kUnknown;
+            break;
+        case InstructionKind::CondJump:
+        case InstructionKind::Loop:
+            node.next[0] = static_cast<uint32_t>(line + 1);
+            node.next[1] = branchTarget(operands, labels, line);
+            node.opaque = node.next[1] == kUnknown;
+            break;
+        case InstructionKind::Ret:
+        case InstructionKind::Int:
+        case InstructionKind::Iret:
+            node.opaque = true;
+            break;
+        case InstructionKind::Repeat:
+            node.reads = kEveryFlag;  // Runs the instruction it prefixes.
+            node.next[0] = static_cast<uint32_t>(line + 1);
+            break;
+        default:
+            node.opaque = opcode == Opcode::Hlt;
+            node.next[0] = static_cast<uint32_t>(line + 1);
+            break;
+    }
+    if (opcode == Opcode::Pushf)
+        node.reads = kEveryFlag;
+    return node;
+}
+
+uint16_t handlerFlagsWritten(Opcode opcode) {
+    constexpr uint16_t kSZP = Registers::SF | Registers::ZF | Registers::PF;
+    switch (opcode) {
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Cmp:
+        case Opcode::Neg:
+            return kSZP | Registers::CF;
+        case Opcode::Inc:
+        case Opcode::Dec:
+        case Opcode::And:
+        case Opcode::Or:
+        case Opcode::Xor:
+        case Opcode::Test:
+            return kSZP;
+        default:
+            return 0;
+    }
+}
+
+FlagFlowGraph::FlagFlowGraph(const std::vector<std::string>& program,
+                             const std::vector<DecodedInstruction>& decoded,
+                             const LabelMap& labels) {
+    size_t count = program.size();
+    nodes.resize(count);
+    for (size_t line = 0; line < count; ++line)
+        nodes[line] = analyse(program[line], decoded[line], labels, line);
+
+    // An opaque line's live flags never depend on its successors, so it is no one's
+    // predecessor here.
+    predecessorStart.assign(count + 1, 0);
+    for (const Node& node : nodes) {
+        for (uint32_t next : node.next) {
+            if (!node.opaque && next < count)
+                ++predecessorStart[next + 1];
+        }
+    }
+    for (size_t line = 0; line < count; ++line)
+        predecessorStart[line + 1] += predecessorStart[line];
+    predecessors.resize(predecessorStart[count]);
+    std::vector<uint32_t> filled(predecessorStart.begin(), predecessorStart.end() - 1);
+    for (size_t line = 0; line < count; ++line) {
+        for (uint32_t next : nodes[line].next) {
+            if (!nodes[line].opaque && next < count)
+                predecessors[filled[next]++] = static_cast<uint32_t>(line);
+        }
+    }
+}
+
+// Flags live after `node`, given the live-in flags of its successors. Running off the end
+// counts as reading every flag.
+template <typename LiveIn>
+uint16_t FlagFlowGraph::liveOut(const Node& node, LiveIn liveIn) const {
+    if (node.opaque)
+        return kEveryFlag;
+    uint16_t live = 0;
+    for (uint32_t next : node.next) {
+        if (next != kUnknown)
+            live |= next < nodes.size() ? liveIn(next) : kEveryFlag;
+    }
+    return live;
+}
+
+std::vector<uint16_t> FlagFlowGraph::findDeadFlagWrites(
+    const std::vector<size_t>& stopLines) const {
+    size_t count = nodes.size();
+    std::vector<bool> stops(count, false);
+    for (size_t line : stopLines) {
+        if (line < count)
+            stops[line] = true;
+    }
+
+    // liveIn[i]: flags that may be read or seen at a stop while at most `h` instructions run
+    // from line i. With h = 0 that is every flag, and each round adds one instruction. Only
+    // the predecessors of lines that changed in a round can change in the next, so a round
+    // revisits just those.
+    std::vector<uint16_t> liveIn(count, kEveryFlag);
+    auto in = [&liveIn](uint32_t line) { return liveIn[line]; };
+    std::vector<uint32_t> work(count);
+    std::iota(work.begin(), work.end(), 0);
+    std::vector<uint8_t> queued(count, 0);  // The last round each line was queued for.
+    std::vector<std::pair<uint32_t, uint16_t>> changed;
+    changed.reserve(count);
+    for (uint8_t round = 1; round <= kFlagLivenessHorizon && !work.empty(); ++round) {
+        changed.clear();
+        for (uint32_t line : work) {
+            if (stops[line])
+                continue;
+            const Node& node = nodes[line];
+            uint16_t live = node.reads | (liveOut(node, in) & ~node.kills);
+            if (live != liveIn[line])
+                changed.emplace_back(line, live);
+        }
+        work.clear();
+        for (const auto& [line, live] : changed) {
+            liveIn[line] = live;
+            for (uint32_t i = predecessorStart[line]; i < predecessorStart[line + 1]; ++i) {
+                uint32_t predecessor = predecessors[i];
+                if (queued[predecessor] != round) {
+                    queued[predecessor] = round;
+                    work.push_back(predecessor);
+                }
+            }
+        }
+    }
+
+    std::vector<uint16_t> dead(count, 0);
+    for (size_t line = 0; line < count; ++line)
+        dead[line] = nodes[line].writes & ~liveOut(nodes[line], in);
+    return dead;
+}
+
+std::vector<size_t> FlagFlowGraph::linesReaching(size_t line) const {
+    std::vector<size_t> lines;
+    if (line >= nodes.size())
+        return lines;
+    std::unordered_set<size_t> seen = {line};
+    lines.push_back(line);
+    size_t levelStart = 0;
+    for (size_t depth = 0; depth < kFlagLivenessHorizon && levelStart < lines.size(); ++depth) {
+        size_t levelEnd = lines.size();
+        for (size_t i = levelStart; i < levelEnd; ++i) {
+            for (uint32_t j = predecessorStart[lines[i]]; j < predecessorStart[lines[i] + 1]; ++j) {
+                if (seen.insert(predecessors[j]).second)
+                    lines.push_back(predecessors[j]);
+            }
+        }
+        levelStart = levelEnd;
+    }
+    return lines;
+}
+
+void FlagFlowGraph::updateDeadFlagWrites(std::vector<uint16_t>& dead,
+                                         const std::vector<size_t>& lines,
+                                         const std::vector<size_t>& stopLines) const {
+    // A result depends on the lines up to the horizon ahead of it, so the rounds run over
+    // just those, with every flag live beyond them. That is only wrong for live-in flags no
+    // result reads: each round's error moves one line closer to `lines`, and the horizon's
+    // worth of rounds ends before it arrives.
+    std::vector<size_t> stops(stopLines);
+    std::sort(stops.begin(), stops.end());
+    std::unordered_map<uint32_t, uint32_t> index;  // Line to its place in `region`.
+    std::vector<uint32_t> region;
+    for (size_t line : lines) {
+        if (line < nodes.size() && index.emplace(line, region.size()).second)
+            region.push_back(static_cast<uint32_t>(line));
+    }
+    size_t levelStart = 0;
+    for (size_t depth = 0; depth < kFlagLivenessHorizon && levelStart < region.size(); ++depth) {
+        size_t levelEnd = region.size();
+        for (size_t i = levelStart; i < levelEnd; ++i) {
+            const Node& node = nodes[region[i]];
+            for (uint32_t next : node.next) {
+                if (!node.opaque && next < nodes.size() &&
+                    index.emplace(next, region.size()).second)
+                    region.push_back(next);
+            }
+        }
+        levelStart = levelEnd;
+    }
+
+    std::vector<uint16_t> liveIn(region.size(), kEveryFlag);
+    std::vector<uint16_t> updated(region.size());
+    auto in = [&](uint32_t line) {
+        auto found = index.find(line);
+        return found == index.end() ? kEveryFlag : liveIn[found->second];
+    };
+    for (size_t round = 0; round < kFlagLivenessHorizon; ++round) {
+        for (size_t i = 0; i < region.size(); ++i) {
+            const Node& node = nodes[region[i]];
+            if (std::binary_search(stops.begin(), stops.end(), region[i]))
+                updated[i] = kEveryFlag;
+            else
+                updated[i] = node.reads | (liveOut(node, in) & ~node.kills);
+        }
+        liveIn.swap(updated);
+    }
+    for (size_t line : lines) {
+        if (line < nodes.size())
+            dead[line] = nodes[line].writes & ~liveOut(nodes[line], in);
+    }
+}
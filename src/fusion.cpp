@@ -0,0 +1,266 @@
+#include "fusion.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+constexpr std::string_view kRegisters16[] = {"AX", "CX", "DX", "BX", "SP", "BP", "SI", "DI"};
+constexpr std::string_view kRegisters8[] = {"AL", "CL", "DL", "BL", "AH", "CH", "DH", "BH"};
+
+bool isFirstHalf(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::Mov:
+        case Opcode::Cmp:
+        case Opcode::Test:
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Inc:
+        case Opcode::Dec:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isSecondHalf(Opcode opcode) {
+    if (opcode == Opcode::Invalid)
+        return false;
+    InstructionKind kind = instructionInfo(opcode).kind;
+    return opcode == Opcode::Mov || kind == InstructionKind::Jump ||
+           kind == InstructionKind::CondJump || kind == InstructionKind::Loop;
+}
+
+bool findRegister(std::string_view text, const std::string_view (&names)[8], uint8_t& reg) {
+    for (uint8_t i = 0; i < 8; ++i) {
+        if (equalsIgnoreCase(text, names[i])) {
+            reg = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Destination of a register-only instruction: the handlers test for an 8-bit register first
+// and otherwise take a 16-bit one.
+bool resolveDestination(std::string_view text, FusedOperand& operand) {
+    if (findRegister(text, kRegisters8, operand.reg)) {
+        operand.kind = FusedOperand::Reg8;
+        return true;
+    }
+    if (findRegister(text, kRegisters16, operand.reg)) {
+        operand.kind = FusedOperand::Reg16;
+        return true;
+    }
+    return false;
+}
+
+// Source operand, classified in the order getValue()/getValue8() use, so a pair only fuses
+// when the ordinary handler would read the same value without throwing.
+bool resolveSource(std::string_view text, bool byte, FusedOperand& operand) {
+    if (text.empty() || text.front() == '[')
+        return false;
+    bool hex = text.back() == 'h';
+    if (hex || (text[0] >= '0' && text[0] <= '9')) {
+        try {
+            long value = parseImmediate(text, hex);
+            operand.kind = FusedOperand::Immediate;
+            operand.value = byte ? static_cast<uint16_t>(value & 0xFF)
+                                 : static_cast<uint16_t>(value);
+            return true;
+        } catch (const std::runtime_error&) {
+            return false;
+        }
+    }
+    if (findRegister(text, kRegisters8, operand.reg)) {
+        operand.kind = FusedOperand::Reg8;
+        return byte;
+    }
+    if (findRegister(text, kRegisters16, operand.reg)) {
+        operand.kind = FusedOperand::Reg16;
+        return !byte;
+    }
+    return false;
+}
+
+bool operandCountFits(Opcode opcode, size_t count) {
+    const InstructionInfo& info = instructionInfo(opcode);
+    return count >= info.minOperands && count <= info.maxOperands;
+}
+
+}  // namespace
+
+bool resolveRegisterOperands(Opcode opcode,
+                             const Operands& operands,
+                             bool& byte,
+                             FusedOperand& dest,
+                             FusedOperand& src) {
+    if (!operandCountFits(opcode, operands.size()) || !resolveDestination(operands[0], dest))
+        return false;
+    byte = dest.kind == FusedOperand::Reg8;
+    if (operands.size() == 1)
+        return true;
+    return resolveSource(operands[1], byte, src);
+}
+
+FusionCandidates FusionCandidates::all() {
+    // Every emulator starts from this set, so it is worked out once.
+    static const FusionCandidates supported = [] {
+        FusionCandidates candidates;
+        for (size_t first = 0; first < kOpcodeCount; ++first) {
+            for (size_t second = 0; second < kOpcodeCount; ++second) {
+                if (supports(static_cast<Opcode>(first), static_cast<Opcode>(second)))
+                    candidates.allow(static_cast<Opcode>(first), static_cast<Opcode>(second));
+            }
+        }
+        return candidates;
+    }();
+    return supported;
+}
+
+FusionCandidates FusionCandidates::parse(std::istream& in, size_t limit) {
+    std::vector<std::pair<uint64_t, size_t>> ranked;  // (count, pair index)
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string first;
+        std::string second;
+        if (!(fields >> first) || first[0] == '#')
+            continue;
+        // Records from OpcodeProfile::writeData(): only the pairs matter here.
+        if (first == "op" || first == "triple" || first == "mode" || first == "width")
+            continue;
+        if (first == "pair" && !(fields >> first))
+            throw std::runtime_error("Fusion profile line needs two mnemonics: " + line);
+        uint64_t count = 0;
+        if (!(fields >> second))
+            throw std::runtime_error("Fusion profile line needs two mnemonics: " + line);
+        fields >> count;
+        Opcode a = lookupMnemonic(first);
+        Opcode b = lookupMnemonic(second);
+        if (a == Opcode::Invalid || b == Opcode::Invalid)
+            throw std::runtime_error("Unknown instruction in fusion profile: " + line);
+        if (supports(a, b))
+            ranked.emplace_back(count, index(a, b));
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const auto& x, const auto& y) { return x.first > y.first; });
+    if (limit != 0 && ranked.size() > limit)
+        ranked.resize(limit);
+
+    FusionCandidates candidates;
+    for (const auto& entry : ranked)
+        candidates.pairs.set(entry.second);
+    return candidates;
+}
+
+FusionCandidates FusionCandidates::load(const std::string& path, size_t limit) {
+    std::ifstream in(path);
+    if (!in)
+        throw std::runtime_error("Cannot open fusion profile: " + path);
+    return parse(in, limit);
+}
+
+bool FusionCandidates::supports(Opcode first, Opcode second) {
+    return isFirstHalf(first) && isSecondHalf(second);
+}
+
+void FusionCandidates::allow(Opcode first, Opcode second) {
+    if (supports(first, second))
+        pairs.set(index(first, second));
+}
+
+std::vector<FusedPair> fuseProgram(const std::vector<std::string>& program,
+                                   const std::vector<DecodedInstruction>& decoded,
+                                   const LabelMap& labels,
+                                   const FusionCandidates& candidates) {
+    std::vector<FusedPair> fused(program.size());
+    for (size_t i = 0; i + 1 < program.size(); ++i) {
+        const DecodedInstruction& a = decoded[i];
+        const DecodedInstruction& b = decoded[i + 1];
+        if (a.opcode == Opcode::Invalid || b.opcode == Opcode::Invalid ||
+            !candidates.allows(a.opcode, b.opcode))
+            continue;
+
+        FusedPair pair;
+        if (!resolveRegisterOperands(a.opcode, a.operands(program[i]), pair.byte, pair.dest,
+                                     pair.src))
+            continue;
+        Operands second = b.operands(program[i + 1]);
+        if (b.opcode == Opcode::Mov) {
+            if (!resolveRegisterOperands(b.opcode, second, pair.secondByte, pair.secondDest,
+                                         pair.secondSrc))
+                continue;
+        } else {
+            if (!operandCountFits(b.opcode, second.size()))
+                continue;
+            // A branch to its own line falls through in the interpreter; leave it alone.
+            auto label = labels.find(second[0]);
+            if (label == labels.end() || label->second == i + 1)
+                continue;
+            pair.target = static_cast<uint16_t>(label->second);
+        }
+        pair.first = a.opcode;
+        pair.second = b.opcode;
+        fused[i] = pair;
+    }
+    return fused;
+}
+
+bool fusedBranchTaken(Opcode opcode, Registers& regs) {
+    uint16_t f = regs.FLAGS;
+    bool zf = f & Registers::ZF;
+    bool sf = f & Registers::SF;
+    bool of = f & Registers::OF;
+    bool cf = f & Registers::CF;
+    bool pf = f & Registers::PF;
+    switch (opcode) {
+        case Opcode::Jmp:
+            return true;
+        case Opcode::Je:
+            return zf;
+        case Opcode::Jne:
+            return !zf;
+        case Opcode::Jl:
+            return sf != of;
+        case Opcode::Jnl:
+            return sf == of;
+        case Opcode::Jle:
+            return (sf != of) || zf;
+        case Opcode::Jg:
+            return (sf == of) && !zf;
+        case Opcode::Jb:
+            return cf;
+        case Opcode::Jnb:
+            return !cf;
+        case Opcode::Jbe:
+            return cf || zf;
+        case Opcode::Ja:
+            return !cf && !zf;
+        case Opcode::Jp:
+            return pf;
+        case Opcode::Jnp:
+            return !pf;
+        case Opcode::Jo:
+            return of;
+        case Opcode::Jno:
+            return !of;
+        case Opcode::Js:
+            return sf;
+        case Opcode::Jns:
+            return !sf;
+        case Opcode::Jcxz:
+            return regs.CX.x == 0;
+        case Opcode::Loop:
+            return --regs.CX.x != 0;
+        case Opcode::Loopz:
+            return --regs.CX.x != 0 && zf;
+        case Opcode::Loopnz:
+            return --regs.CX.x != 0 && !zf;
+        default:
+            return false;
+    }
+}
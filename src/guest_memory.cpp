@@ -0,0 +1,83 @@
+#include "guest_memory.h"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifndef _WIN32
+void* mapZeroPages(void* address, size_t length) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | (address ? MAP_FIXED : 0);
+    return ::mmap(address, length, PROT_READ | PROT_WRITE, flags, -1, 0);
+}
+#endif
+
+}  // namespace
+
+GuestMemory::GuestMemory(size_t size) : length(size) {
+#ifndef _WIN32
+    if (size != 0) {
+        void* address = mapZeroPages(nullptr, size);
+        if (address != MAP_FAILED) {
+            bytes = static_cast<uint8_t*>(address);
+            mapped = true;
+            return;
+        }
+    }
+#endif
+    fallback.assign(size, 0);
+    bytes = fallback.data();
+}
+
+GuestMemory::~GuestMemory() {
+#ifndef _WIN32
+    if (mapped)
+        ::munmap(bytes, length);
+#endif
+}
+
+bool GuestMemory::operator==(const GuestMemory& other) const {
+    return length == other.length && std::memcmp(bytes, other.bytes, length) == 0;
+}
+
+void GuestMemory::zero() {
+#ifndef _WIN32
+    // A fresh mapping over the same range drops the old pages and keeps the address.
+    if (mapped && mapZeroPages(bytes, length) != MAP_FAILED)
+        return;
+#endif
+    std::memset(bytes, 0, length);
+}
+
+// Linux's pagemap marks pages present in RAM, and those mapped by this process alone (bit
+// 56). Pages only read so far map the kernel's shared zero page and fail the second test.
+size_t GuestMemory::residentBytes() const {
+#if defined(__linux__)
+    if (mapped) {
+        size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+        size_t first = reinterpret_cast<uintptr_t>(bytes) / page;
+        std::vector<uint64_t> entries((length + page - 1) / page);
+        int fd = ::open("/proc/self/pagemap", O_RDONLY);
+        if (fd >= 0) {
+            size_t size = entries.size() * sizeof(uint64_t);
+            bool ok = ::pread(fd, entries.data(), size, first * sizeof(uint64_t)) ==
+                      static_cast<ssize_t>(size);
+            ::close(fd);
+            if (ok) {
+                constexpr uint64_t kPresent = uint64_t(1) << 63;
+                constexpr uint64_t kExclusive = uint64_t(1) << 56;
+                size_t resident = 0;
+                for (uint64_t entry : entries)
+                    resident += (entry & (kPresent | kExclusive)) == (kPresent | kExclusive);
+                return resident * page;
+            }
+        }
+    }
+#endif
+    return length;
+}
@@ -28,6 +28,7 @@
 #include <imgui_impl_sdl2.h>
 #include <imgui_internal.h>
 
+#include "emulation_worker.h"
 #include "emulator8086.h"
 #include "version.h"
 
@@ -99,7 +100,6 @@ bool commandExists(const std::string& command) {
 }  // namespace
 
 GUIApplication::GUIApplication() {
-    assemblyEditorCharBuffer[0] = '\0';
     fileDialog = std::make_unique<ImGuiFileDialog>();
 }
 GUIApplication::~GUIApplication() {
@@ -160,7 +160,15 @@ bool GUIApplication::initialize(int width, int height, const std::string& title)
             throw std::runtime_error("Failed to initialize ImGui");
         }
 
-        emulator = std::make_unique<Emulator8086>();
+        wakeEventType = SDL_RegisterEvents(1);
+        worker = std::make_unique<EmulationWorker>(EmulationWorker::kDefaultBatch, [this] {
+            if (wakeEventType == static_cast<Uint32>(-1) || wakePending.exchange(true))
+                return;
+            SDL_Event event{};
+            event.type = wakeEventType;
+            SDL_PushEvent(&event);
+        });
+        snapshot = &worker->acquireSnapshot();
 
         running = true;
         initialized = true;
@@ -181,39 +189,30 @@ bool GUIApplication::loadAssemblyFile(const std::string& filePath) {
         return false;
     }
 
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << filePath << std::endl;
+    DecodedProgram decoded;
+    SourceLoadStats stats;
+    try {
+        MappedFile file(filePath);
+        decoded = decodeSource(file.view(), SourceLoadOptions(), &stats);
+        editorText.assign(std::string(file.view()));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
         return false;
     }
-
     assemblyLines.clear();
+    editorText.syncLines(assemblyLines);
 
-    std::string line;
-    while (std::getline(file, line)) {
-        assemblyLines.push_back(line);
-    }
-
-    file.close();
-
-    if (assemblyLines.empty()) {
+    if (editorText.size() == 0) {
         std::cerr << "Warning: File is empty: " << filePath << std::endl;
         return false;
     }
 
     loadedFilePath = filePath;
 
-    if (emulator) {
-        try {
-            emulator->reset();
-            emulator->loadProgram(assemblyLines);
-            std::cout << "Successfully loaded " << assemblyLines.size() << " lines from "
-                      << filePath << std::endl;
-            return true;
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to load program into emulator: " << e.what() << std::endl;
-            return false;
-        }
+    if (worker) {
+        worker->load(std::move(decoded));
+        std::cout << "Successfully loaded " << filePath << ": " << stats.summary() << std::endl;
+        return true;
     }
 
     std::cerr << "Emulator not initialized" << std::endl;
@@ -228,10 +227,22 @@ void GUIApplication::run() {
 
     std::cout << "Starting main loop...\n";
 
+    statsWindowStart = SDL_GetPerformanceCounter();
     while (running) {
         handleEvents();
         update();
-        render();
+
+        Uint64 now = SDL_GetPerformanceCounter();
+        if ((pendingFrames > 0 || showSplashScreen) && now >= nextFrameCounter) {
+            render();
+            statsRenderCounter += SDL_GetPerformanceCounter() - now;
+            ++statsFrames;
+            ++frameStats.framesRendered;
+            if (pendingFrames > 0)
+                --pendingFrames;
+            nextFrameCounter = now + SDL_GetPerformanceFrequency() / kRunningFrameRate;
+        }
+        updateFrameStats();
     }
 
     std::cout << "Main loop ended.\n";
@@ -246,7 +257,8 @@ void GUIApplication::shutdown() {
 
     ImageLoader::unloadImage(logoImage);
 
-    emulator.reset();
+    snapshot = nullptr;
+    worker.reset();
     cleanupImGui();
     cleanupOpenGL();
     cleanupSDL();
@@ -461,25 +473,56 @@ bool GUIApplication::initImGui() {
 
 void GUIApplication::handleEvents() {
     SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-        ImGui_ImplSDL2_ProcessEvent(&event);
+    int timeoutMs = eventWaitTimeout();
+    Uint64 waitStart = SDL_GetPerformanceCounter();
+    int haveEvent = timeoutMs > 0 ? SDL_WaitEventTimeout(&event, timeoutMs) : SDL_PollEvent(&event);
+    statsIdleCounter += SDL_GetPerformanceCounter() - waitStart;
+
+    // With nothing happening, still draw once per idle period so the frame statistics in the
+    // status window stay current.
+    if (!haveEvent && timeoutMs == kIdleWaitMs)
+        pendingFrames = std::max(pendingFrames, 1);
+
+    while (haveEvent) {
+        processEvent(event);
+        haveEvent = SDL_PollEvent(&event);
+    }
+}
 
-        switch (event.type) {
-            case SDL_QUIT:
-                running = false;
-                break;
+void GUIApplication::processEvent(const SDL_Event& event) {
+    if (event.type == wakeEventType) {
+        wakePending.store(false);
+        return;
+    }
 
-            case SDL_KEYDOWN:
-                handleKeyDown(event);
-                break;
+    ImGui_ImplSDL2_ProcessEvent(&event);
+    pendingFrames = kFramesAfterInput;
 
-            case SDL_WINDOWEVENT:
-                handleWindowEvent(event);
-                break;
-        }
+    switch (event.type) {
+        case SDL_QUIT:
+            running = false;
+            break;
+
+        case SDL_KEYDOWN:
+            handleKeyDown(event);
+            break;
+
+        case SDL_WINDOWEVENT:
+            handleWindowEvent(event);
+            break;
     }
 }
 
+int GUIApplication::eventWaitTimeout() const {
+    if (pendingFrames == 0 && !showSplashScreen)
+        return kIdleWaitMs;
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (now >= nextFrameCounter)
+        return 0;
+    Uint64 ms = (nextFrameCounter - now) * 1000 / SDL_GetPerformanceFrequency();
+    return static_cast<int>(std::max<Uint64>(ms, 1));
+}
+
 void GUIApplication::handleKeyDown(const SDL_Event& event) {
     const Uint8* keystate = SDL_GetKeyboardState(NULL);
     bool ctrl = keystate[SDL_SCANCODE_LCTRL] || keystate[SDL_SCANCODE_RCTRL];
@@ -506,16 +549,12 @@ void GUIApplication::handleKeyDown(const SDL_Event& event) {
             break;
 
         case SDLK_F7:
-            if (emulator) {
-                try {
-                    bool continueExecution = emulator->step();
-                    if (!continueExecution) {
-                        std::cout << "Program execution completed\n";
-                    }
-                } catch (const std::exception& e) {
-                    std::cerr << "Step execution error: " << e.what() << std::endl;
-                }
-            }
+            if (worker)
+                worker->step();
+            break;
+
+        case SDLK_F8:
+            toggleExecution();
             break;
 
         case SDLK_F11:
@@ -523,24 +562,16 @@ void GUIApplication::handleKeyDown(const SDL_Event& event) {
             break;
 
         case SDLK_r:
-            if (ctrl && emulator) {
-                emulator->reset();
-                if (!assemblyLines.empty()) {
-                    emulator->loadProgram(assemblyLines);
-                }
+            if (ctrl && worker) {
+                resetEmulator();
                 std::cout << "Emulator reset\n";
             }
             break;
 
         case SDLK_l:
-            if (ctrl && emulator && !assemblyLines.empty()) {
-                try {
-                    emulator->reset();
-                    emulator->loadProgram(assemblyLines);
-                    std::cout << "Program loaded into emulator\n";
-                } catch (const std::exception& e) {
-                    std::cerr << "Load program error: " << e.what() << std::endl;
-                }
+            if (ctrl && worker && !assemblyLines.empty()) {
+                worker->load(assemblyLines);
+                std::cout << "Program loaded into emulator\n";
             }
             break;
 
@@ -560,7 +591,79 @@ void GUIApplication::handleWindowEvent(const SDL_Event& event) {
     }
 }
 
-void GUIApplication::update() {}
+void GUIApplication::update() {
+    if (!worker)
+        return;
+    snapshot = &worker->acquireSnapshot();
+    if (snapshot->sequence == lastSequence)
+        return;
+    lastSequence = snapshot->sequence;
+    pendingFrames = std::max(pendingFrames, 1);
+
+    char text[96];
+    if (snapshot->running) {
+        std::snprintf(text, sizeof(text), "Running... %llu instructions",
+                      static_cast<unsigned long long>(snapshot->retired));
+        executionStatus = text;
+        return;
+    }
+    switch (snapshot->stopReason) {
+        case Emulator8086::StopReason::Breakpoint:
+            std::snprintf(text, sizeof(text), "Breakpoint at line %u", snapshot->regs.IP);
+            executionStatus = text;
+            break;
+        case Emulator8086::StopReason::Watchpoint: {
+            const auto& hit = snapshot->watchHit;
+            std::snprintf(text,
+                          sizeof(text),
+                          "Watchpoint: %s %04X at line %zu",
+                          hit.isWrite ? "write to" : "read of",
+                          hit.address,
+                          hit.line);
+            executionStatus = text;
+            break;
+        }
+        case Emulator8086::StopReason::EndOfProgram:
+            executionStatus = snapshot->retired ? "Program execution completed" : "";
+            break;
+        case Emulator8086::StopReason::StepLimit:
+            executionStatus = "Paused";
+            break;
+    }
+}
+
+void GUIApplication::updateFrameStats() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 elapsed = now - statsWindowStart;
+    if (elapsed < frequency)
+        return;
+
+    frameStats.framesPerSecond = statsFrames * static_cast<double>(frequency) / elapsed;
+    frameStats.frameMs =
+        statsFrames ? 1000.0 * statsRenderCounter / frequency / statsFrames : 0.0;
+    frameStats.idlePercent = 100.0 * statsIdleCounter / elapsed;
+    statsWindowStart = now;
+    statsIdleCounter = 0;
+    statsRenderCounter = 0;
+    statsFrames = 0;
+}
+
+void GUIApplication::toggleExecution() {
+    if (!worker)
+        return;
+    if (snapshot->running)
+        worker->pause();
+    else
+        worker->run();
+}
+
+void GUIApplication::resetEmulator() {
+    if (assemblyLines.empty())
+        worker->reset();
+    else
+        worker->load(assemblyLines);
+}
 
 void GUIApplication::render() {
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
@@ -634,6 +737,7 @@ void GUIApplication::renderImGui() {
     ImGui::End();
 
     renderAssemblyEditor();
+    renderEmulatorStatus();
     renderRegistersWindow();
     renderMemoryWindow();
     renderStackWindow();
@@ -758,37 +862,23 @@ void GUIApplication::renderMainMenuBar() {
 
         if (ImGui::BeginMenu("Emulator")) {
             if (ImGui::MenuItem("Reset", "Ctrl+R")) {
-                if (emulator) {
-                    emulator->reset();
-
-                    if (!assemblyLines.empty()) {
-                        emulator->loadProgram(assemblyLines);
-                    }
+                if (worker) {
+                    resetEmulator();
                     std::cout << "Emulator reset\n";
                 }
             }
             ImGui::Separator();
             if (ImGui::MenuItem("Step Execute", "F7")) {
-                if (emulator) {
-                    try {
-                        bool continueExecution = emulator->step();
-                        if (!continueExecution) {
-                            std::cout << "Program execution completed\n";
-                        }
-                    } catch (const std::exception& e) {
-                        std::cerr << "Step execution error: " << e.what() << std::endl;
-                    }
-                }
+                if (worker)
+                    worker->step();
+            }
+            if (ImGui::MenuItem(snapshot && snapshot->running ? "Pause" : "Run", "F8")) {
+                toggleExecution();
             }
             if (ImGui::MenuItem("Load Program", "Ctrl+L")) {
-                if (emulator && !assemblyLines.empty()) {
-                    try {
-                        emulator->reset();
-                        emulator->loadProgram(assemblyLines);
-                        std::cout << "Program loaded into emulator\n";
-                    } catch (const std::exception& e) {
-                        std::cerr << "Load program error: " << e.what() << std::endl;
-                    }
+                if (worker && !assemblyLines.empty()) {
+                    worker->load(assemblyLines);
+                    std::cout << "Program loaded into emulator\n";
                 }
             }
             ImGui::EndMenu();
@@ -816,9 +906,9 @@ void GUIApplication::renderDemoWindow() {
                     1000.0f / ImGui::GetIO().Framerate,
                     ImGui::GetIO().Framerate);
 
-        if (emulator) {
+        if (worker) {
             ImGui::Text("Emulator initialized: Yes");
-            ImGui::Text("Memory size: %zu bytes", emulator->getMemory().size());
+            ImGui::Text("Memory size: %zu bytes", snapshot->memorySize);
         } else {
             ImGui::Text("Emulator initialized: No");
         }
@@ -826,8 +916,8 @@ void GUIApplication::renderDemoWindow() {
         ImGui::Separator();
 
         if (ImGui::Button("Test Reset Emulator")) {
-            if (emulator) {
-                emulator->reset();
+            if (worker) {
+                worker->reset();
                 std::cout << "Emulator reset via GUI\n";
             }
         }
@@ -844,9 +934,8 @@ void GUIApplication::renderDemoWindow() {
 void GUIApplication::renderAssemblyEditor() {
     if (ImGui::Begin("Assembly Editor")) {
         if (ImGui::Button("New")) {
-            assemblyLines.clear();
-            assemblyLines.push_back("; New 8086 Assembly Program");
-            assemblyLines.push_back("");
+            editorText.assign("; New 8086 Assembly Program\n");
+            editorText.syncLines(assemblyLines);
             assemblyEditorModified = true;
             loadedFilePath = "";
             syncEditorBuffer();
@@ -923,16 +1012,16 @@ void GUIApplication::renderAssemblyEditor() {
 
         bool contentChanged = ImGui::InputTextMultiline(
             "##assemblycode",
-            assemblyEditorCharBuffer,
-            EDITOR_BUFFER_SIZE,
+            assemblyEditorBuffer.data(),
+            assemblyEditorBuffer.capacity() + 1,
             textSize,
-            ImGuiInputTextFlags_AllowTabInput | ImGuiInputTextFlags_CallbackEdit,
+            ImGuiInputTextFlags_AllowTabInput | ImGuiInputTextFlags_CallbackEdit |
+                ImGuiInputTextFlags_CallbackResize,
             textEditCallback,
             this);
 
         if (contentChanged) {
             assemblyEditorModified = true;
-            assemblyEditorBuffer = assemblyEditorCharBuffer;
             updateAssemblyLinesFromBuffer();
         }
 
@@ -952,71 +1041,127 @@ void GUIApplication::renderAssemblyEditor() {
 void GUIApplication::renderEmulatorStatus() {
     static bool show_status = true;
 
-    if (show_status && emulator) {
+    if (show_status && worker) {
         ImGui::Begin("Emulator Status", &show_status);
 
         ImGui::Text("8086 Emulator State");
         ImGui::Separator();
 
-        ImGui::Text("Memory Size: %zu bytes", emulator->getMemory().size());
-        ImGui::Text("Current IP: %04X", (unsigned int)emulator->getIP());
+        ImGui::Text("Memory Size: %zu bytes", snapshot->memorySize);
+        ImGui::Text("Current IP: %04X", (unsigned int)snapshot->regs.IP);
 
-        const auto& program = emulator->getProgram();
+        const auto& program = *snapshot->program;
         ImGui::Text("Program Lines: %zu", program.size());
 
-        if (!program.empty() && emulator->getIP() < program.size()) {
-            ImGui::Text("Current Instruction: %s", program[emulator->getIP()].c_str());
+        if (!program.empty() && snapshot->regs.IP < program.size()) {
+            ImGui::Text("Current Instruction: %s", program[snapshot->regs.IP].c_str());
         }
 
         ImGui::Separator();
 
         if (ImGui::Button("Step Execute (F7)")) {
-            if (emulator) {
-                try {
-                    bool continueExecution = emulator->step();
-                    if (!continueExecution) {
-                        std::cout << "Program execution completed\n";
-                    }
-                } catch (const std::exception& e) {
-                    std::cerr << "Step execution error: " << e.what() << std::endl;
-                }
-            }
+            worker->step();
+        }
+
+        ImGui::SameLine();
+        if (ImGui::Button(snapshot->running ? "Pause (F8)" : "Run (F8)")) {
+            toggleExecution();
         }
 
         ImGui::SameLine();
         if (ImGui::Button("Reset (Ctrl+R)")) {
-            if (emulator) {
-                emulator->reset();
-                if (!assemblyLines.empty()) {
-                    emulator->loadProgram(assemblyLines);
-                }
-                std::cout << "Emulator reset\n";
-            }
+            resetEmulator();
+            std::cout << "Emulator reset\n";
         }
 
         ImGui::SameLine();
         if (ImGui::Button("Load Program (Ctrl+L)")) {
-            if (emulator && !assemblyLines.empty()) {
-                try {
-                    emulator->reset();
-                    emulator->loadProgram(assemblyLines);
-                    std::cout << "Program loaded into emulator\n";
-                } catch (const std::exception& e) {
-                    std::cerr << "Load program error: " << e.what() << std::endl;
-                }
+            if (!assemblyLines.empty()) {
+                worker->load(assemblyLines);
+                std::cout << "Program loaded into emulator\n";
             }
         }
 
+        if (!executionStatus.empty())
+            ImGui::Text("%s", executionStatus.c_str());
+
+        ImGui::Separator();
+        ImGui::Text("Frame: %.2f ms, %.1f FPS, idle %.0f%% (%llu frames drawn)",
+                    frameStats.frameMs,
+                    frameStats.framesPerSecond,
+                    frameStats.idlePercent,
+                    static_cast<unsigned long long>(frameStats.framesRendered));
+
+        renderBreakpoints();
+
         ImGui::End();
     }
 }
 
+void GUIApplication::renderBreakpoints() {
+    const auto& program = *snapshot->program;
+    if (ImGui::CollapsingHeader("Breakpoints")) {
+        ImGui::BeginChild("##breakpoints", ImVec2(0, 160), true);
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(program.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                size_t i = static_cast<size_t>(row);
+                bool isBP = snapshot->hasBreakpoint(i);
+                char label[160];
+                std::snprintf(label,
+                              sizeof(label),
+                              "%c%c %04zu  %s##bp%zu",
+                              isBP ? '*' : ' ',
+                              i == snapshot->regs.IP ? '>' : ' ',
+                              i,
+                              program[i].c_str(),
+                              i);
+                if (ImGui::Selectable(label, isBP))
+                    worker->toggleBreakpoint(i);
+            }
+        }
+        ImGui::EndChild();
+    }
+
+    if (ImGui::CollapsingHeader("Watchpoints")) {
+        ImGui::SetNextItemWidth(60);
+        ImGui::InputText("##watchaddr",
+                         watchAddressBuffer,
+                         sizeof(watchAddressBuffer),
+                         ImGuiInputTextFlags_CharsHexadecimal);
+        ImGui::SameLine();
+        if (ImGui::Button("Watch 16 bytes (writes)")) {
+            uint16_t address =
+                static_cast<uint16_t>(std::strtoul(watchAddressBuffer, nullptr, 16));
+            worker->addWatchpoint(address, 16, false, true);
+        }
+
+        int removeIndex = -1;
+        const auto& watchpoints = *snapshot->watchpoints;
+        for (size_t i = 0; i < watchpoints.size(); ++i) {
+            ImGui::Text("%04X+%u %s%s",
+                        watchpoints[i].address,
+                        watchpoints[i].length,
+                        watchpoints[i].onRead ? "R" : "",
+                        watchpoints[i].onWrite ? "W" : "");
+            ImGui::SameLine();
+            ImGui::PushID(static_cast<int>(i));
+            if (ImGui::SmallButton("Remove"))
+                removeIndex = static_cast<int>(i);
+            ImGui::PopID();
+        }
+        if (removeIndex >= 0)
+            worker->removeWatchpoint(watchpoints[removeIndex].address);
+    }
+}
+
 void GUIApplication::renderRegistersWindow() {
-    if (!emulator)
+    if (!worker)
         return;
 
     if (ImGui::Begin("Registers")) {
-        const auto& regs = emulator->getRegisters();
+        const auto& regs = snapshot->regs;
 
         ImGui::Text("8086 CPU Registers");
         ImGui::Separator();
@@ -1224,13 +1369,13 @@ void GUIApplication::renderRegistersWindow() {
 }
 
 void GUIApplication::renderMemoryWindow() {
-    if (!emulator)
+    if (!worker)
         return;
 
     if (ImGui::Begin("Memory Viewer")) {
-        const auto& memory = emulator->getMemory();
+        const size_t memorySize = snapshot->memorySize;
 
-        ImGui::Text("Memory Size: %zu bytes", memory.size());
+        ImGui::Text("Memory Size: %zu bytes", memorySize);
 
         ImGui::Text("Start Address:");
         ImGui::SameLine();
@@ -1238,7 +1383,7 @@ void GUIApplication::renderMemoryWindow() {
         if (ImGui::InputInt(
                 "##StartAddr", &displayAddr, 16, 256, ImGuiInputTextFlags_CharsHexadecimal)) {
             memoryViewStart =
-                std::max(0, std::min(displayAddr, (int)memory.size() - memoryViewSize));
+                std::max(0, std::min(displayAddr, (int)memorySize - memoryViewSize));
         }
 
         // ImGui::SameLine();
@@ -1255,7 +1400,7 @@ void GUIApplication::renderMemoryWindow() {
         ImGui::SameLine();
         if (ImGui::Button("Page Down")) {
             memoryViewStart =
-                std::min((int)memory.size() - memoryViewSize, memoryViewStart + memoryViewSize);
+                std::min((int)memorySize - memoryViewSize, memoryViewStart + memoryViewSize);
         }
         ImGui::SameLine();
         if (ImGui::Button("Go to 0x0000")) {
@@ -1272,7 +1417,7 @@ void GUIApplication::renderMemoryWindow() {
         while (clipper.Step()) {
             for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
                 int baseAddr = memoryViewStart + (row * 16);
-                if (baseAddr >= (int)memory.size())
+                if (baseAddr >= (int)memorySize)
                     break;
 
                 ImGui::Text("%04X:", baseAddr);
@@ -1280,10 +1425,10 @@ void GUIApplication::renderMemoryWindow() {
 
                 for (int col = 0; col < 16; col++) {
                     int addr = baseAddr + col;
-                    if (addr >= (int)memory.size()) {
+                    if (addr >= (int)memorySize) {
                         ImGui::Text("   ");
                     } else {
-                        uint8_t byte = emulator->readMemoryByte(addr);
+                        uint8_t byte = snapshot->readByte(static_cast<uint16_t>(addr));
                         ImGui::Text("%02X", byte);
                     }
                     if (col < 15) {
@@ -1301,10 +1446,10 @@ void GUIApplication::renderMemoryWindow() {
 
                 for (int col = 0; col < 16; col++) {
                     int addr = baseAddr + col;
-                    if (addr >= (int)memory.size()) {
+                    if (addr >= (int)memorySize) {
                         ImGui::Text(" ");
                     } else {
-                        uint8_t byte = emulator->readMemoryByte(addr);
+                        uint8_t byte = snapshot->readByte(static_cast<uint16_t>(addr));
                         char c = (byte >= 32 && byte < 127) ? (char)byte : '.';
                         ImGui::Text("%c", c);
                     }
@@ -1322,30 +1467,29 @@ void GUIApplication::renderMemoryWindow() {
 }
 
 void GUIApplication::syncEditorBuffer() {
-    assemblyEditorBuffer.clear();
-    for (size_t i = 0; i < assemblyLines.size(); ++i) {
-        assemblyEditorBuffer += assemblyLines[i];
-        if (i < assemblyLines.size() - 1) {
-            assemblyEditorBuffer += "\n";
-        }
-    }
-
-    size_t copySize = std::min(assemblyEditorBuffer.size(), EDITOR_BUFFER_SIZE - 1);
-    memcpy(assemblyEditorCharBuffer, assemblyEditorBuffer.c_str(), copySize);
-    assemblyEditorCharBuffer[copySize] = '\0';
+    assemblyEditorBuffer = editorText.text();
 }
 
+// The widget reports only that something changed, so find the edited span by trimming the
+// common prefix and suffix and apply it to the piece table as a single replace. syncLines then
+// touches only the lines inside that span.
 void GUIApplication::updateAssemblyLinesFromBuffer() {
-    assemblyLines.clear();
-    std::stringstream ss(assemblyEditorBuffer);
-    std::string line;
-    while (std::getline(ss, line)) {
-        assemblyLines.push_back(line);
-    }
-
-    if (assemblyLines.empty()) {
-        assemblyLines.push_back("");
-    }
+    const std::string previous = editorText.text();
+    const std::string& current = assemblyEditorBuffer;
+    size_t prefix = 0;
+    size_t shorter = std::min(previous.size(), current.size());
+    while (prefix < shorter && previous[prefix] == current[prefix])
+        ++prefix;
+    size_t suffix = 0;
+    while (suffix < shorter - prefix &&
+           previous[previous.size() - 1 - suffix] == current[current.size() - 1 - suffix])
+        ++suffix;
+
+    if (prefix == previous.size() && prefix == current.size())
+        return;
+    std::string_view inserted(current.data() + prefix, current.size() - prefix - suffix);
+    editorText.replace(prefix, previous.size() - prefix - suffix, inserted);
+    editorText.syncLines(assemblyLines);
 }
 
 bool GUIApplication::saveAssemblyFile(const std::string& filePath) {
@@ -1355,30 +1499,21 @@ bool GUIApplication::saveAssemblyFile(const std::string& filePath) {
         return false;
     }
 
-    for (const auto& line : assemblyLines) {
-        file << line << "\n";
-    }
-
+    file << editorText.text();
     file.close();
     std::cout << "Saved " << assemblyLines.size() << " lines to " << filePath << std::endl;
     return true;
 }
 
 void GUIApplication::assembleAndLoad() {
-    if (!emulator) {
+    if (!worker) {
         std::cerr << "Emulator not initialized" << std::endl;
         return;
     }
 
-    try {
-        updateAssemblyLinesFromBuffer();
-        emulator->reset();
-        emulator->loadProgram(assemblyLines);
-        std::cout << "Program assembled and loaded successfully (" << assemblyLines.size()
-                  << " lines)" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Assembly/load error: " << e.what() << std::endl;
-    }
+    worker->load(assemblyLines);
+    std::cout << "Program assembled and loaded successfully (" << assemblyLines.size()
+              << " lines)" << std::endl;
 }
 
 int GUIApplication::getCurrentLineNumber() {
@@ -1388,6 +1523,13 @@ int GUIApplication::getCurrentLineNumber() {
 int GUIApplication::textEditCallback(ImGuiInputTextCallbackData* data) {
     GUIApplication* app = (GUIApplication*)data->UserData;
 
+    if (data->EventFlag == ImGuiInputTextFlags_CallbackResize) {
+        std::string& text = app->assemblyEditorBuffer;
+        text.resize(data->BufTextLen);
+        data->Buf = text.data();
+        return 0;
+    }
+
     if (data->EventFlag == ImGuiInputTextFlags_CallbackEdit) {
         app->currentLine = 0;
         for (int i = 0; i < data->CursorPos; i++) {
@@ -1425,12 +1567,12 @@ void GUIApplication::cleanupSDL() {
 }
 
 void GUIApplication::renderStackWindow() {
-    if (!emulator) {
+    if (!worker) {
         return;
     }
 
     if (ImGui::Begin("Stack Viewer")) {
-        const auto& registers = emulator->getRegisters();
+        const auto& registers = snapshot->regs;
         uint16_t sp = registers.SP;
         uint16_t ss = registers.SS;
 
@@ -1483,7 +1625,7 @@ void GUIApplication::renderStackWindow() {
 
                 ImGui::TableNextColumn();
                 try {
-                    uint16_t value = emulator->readMemoryWord(addr);
+                    uint16_t value = snapshot->readWord(addr);
                     if (i == 0) {
                         ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 1.0f, 0.0f, 1.0f));
                         ImGui::Text("0x%04X", value);
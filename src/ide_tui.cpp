@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cctype>
 #include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <sstream>
@@ -28,12 +29,11 @@ EmulatorIDETUI::EmulatorIDETUI(Emulator8086* emu) : emulator(emu) {
     init_pair(5, COLOR_MAGENTA, -1);
     init_pair(6, COLOR_WHITE, COLOR_BLUE);
 
-    editorLines.push_back("; 8086 Assembly Program");
-    editorLines.push_back("MOV AX, 10h      ; Load 16 into AX");
-    editorLines.push_back("MOV BX, 20h      ; Load 32 into BX");
-    editorLines.push_back("ADD AX, BX       ; Add BX to AX");
-    editorLines.push_back("HLT              ; Halt");
-    editorLines.push_back("");
+    editor.assign("; 8086 Assembly Program\n"
+                  "MOV AX, 10h      ; Load 16 into AX\n"
+                  "MOV BX, 20h      ; Load 32 into BX\n"
+                  "ADD AX, BX       ; Add BX to AX\n"
+                  "HLT              ; Halt\n");
 }
 
 EmulatorIDETUI::~EmulatorIDETUI() {
@@ -63,13 +63,13 @@ void EmulatorIDETUI::drawEditor(int h, int w) {
     attroff(COLOR_PAIR(4));
 
     int startRow = editorScrollY;
-    int endRow = std::min((int)editorLines.size(), startRow + editorHeight - 1);
+    int lineCount = static_cast<int>(editor.lineCount());
 
     for (int i = 0; i < editorHeight - 1; ++i) {
         int lineNum = startRow + i;
         int screenY = i + 1;
 
-        if (lineNum < (int)editorLines.size()) {
+        if (lineNum < lineCount) {
             if (lineNum == cursorRow) {
                 attron(COLOR_PAIR(6));
                 mvprintw(screenY, 0, "%-*s", w, "");
@@ -78,11 +78,11 @@ void EmulatorIDETUI::drawEditor(int h, int w) {
 
             mvprintw(screenY, 0, "%4d ", lineNum + 1);
 
-            std::string line = editorLines[lineNum];
-            if (editorScrollX < (int)line.length()) {
-                std::string visible = line.substr(editorScrollX);
-                if (visible.length() > (size_t)(w - 6))
-                    visible = visible.substr(0, w - 6);
+            size_t length = editor.lineLength(lineNum);
+            if (editorScrollX < (int)length && w > 6) {
+                std::string visible = editor.substr(editor.lineStart(lineNum) + editorScrollX,
+                                                    std::min(length - editorScrollX,
+                                                             (size_t)(w - 6)));
                 mvprintw(screenY, 5, "%s", visible.c_str());
             }
         } else {
@@ -113,6 +113,10 @@ void EmulatorIDETUI::drawCode(int h, int w) {
 
     const auto& prog = emulator->getProgram();
     const auto& labels = emulator->getLabels();
+    Profiler* profiler = emulator->getProfiler();
+    std::vector<size_t> hotLines;
+    if (profiler)
+        hotLines = profiler->hottestLines(kHotLineCount);
     size_t ip = emulator->getIP();
     int linesAvail = h - 3;
     int first = 0;
@@ -122,8 +126,9 @@ void EmulatorIDETUI::drawCode(int h, int w) {
 
     for (int i = 0; i < linesAvail && first + i < (int)prog.size(); ++i) {
         size_t idx = first + i;
-        bool isBP = breakpoints.count(idx);
+        bool isBP = emulator->hasBreakpoint(idx);
         bool isIP = idx == ip;
+        bool isHot = std::find(hotLines.begin(), hotLines.end(), idx) != hotLines.end();
 
         std::string labelPrefix = "";
         for (const auto& labelPair : labels) {
@@ -139,9 +144,21 @@ void EmulatorIDETUI::drawCode(int h, int w) {
             attron(COLOR_PAIR(1));
         else if (isBP)
             attron(COLOR_PAIR(2));
-
-        std::string line =
-            std::string(1, isBP ? '*' : ' ') + std::to_string(idx) + ": " + labelPrefix + prog[idx];
+        else if (isHot)
+            attron(COLOR_PAIR(5));
+
+        std::string counts;
+        if (profiler) {
+            char buf[24];
+            std::snprintf(buf,
+                          sizeof(buf),
+                          " %9llu%c",
+                          (unsigned long long)profiler->getLineCosts()[idx].instructions,
+                          isHot ? '#' : ' ');
+            counts = buf;
+        }
+        std::string line = std::string(1, isBP ? '*' : ' ') + std::to_string(idx) + counts + ": " +
+                           labelPrefix + prog[idx];
         if (line.length() > (size_t)codeWidth - 1)
             line = line.substr(0, codeWidth - 4) + "...";
 
@@ -153,6 +170,8 @@ void EmulatorIDETUI::drawCode(int h, int w) {
             attroff(COLOR_PAIR(1));
         else if (isBP)
             attroff(COLOR_PAIR(2));
+        else if (isHot)
+            attroff(COLOR_PAIR(5));
     }
 }
 
@@ -255,7 +274,13 @@ void EmulatorIDETUI::drawStatus(int h, int w) {
         status +=
             " | Line: " + std::to_string(cursorRow + 1) + ", Col: " + std::to_string(cursorCol + 1);
     } else {
-        status += " | IP: " + std::to_string(emulator->getIP());
+        char speed[64];
+        std::snprintf(speed,
+                      sizeof(speed),
+                      " | Speed: %s (%.0f IPS)",
+                      pacer.describe().c_str(),
+                      pacer.getMeasuredRate());
+        status += " | IP: " + std::to_string(emulator->getIP()) + speed;
     }
     mvprintw(h - 1, 0, "%-*s", w, status.c_str());
     attroff(COLOR_PAIR(5));
@@ -266,6 +291,7 @@ void EmulatorIDETUI::run() {
         "F1=Help F2=Compile(WIP) F3=Debug F5=Run F10=Step Ctrl+S=Save Ctrl+O=Open Ctrl+N=New");
 
     while (!quit) {
+        auto frameStart = std::chrono::steady_clock::now();
         int ch = getch();
 
         if (ch != ERR) {
@@ -276,23 +302,13 @@ void EmulatorIDETUI::run() {
             }
         }
 
-        if (running && currentMode == 1) {
-            if (breakpoints.count(emulator->getIP())) {
-                running = false;
-                setStatus("Hit breakpoint at IP=" + std::to_string(emulator->getIP()));
-            } else {
-                bool cont = emulator->step();
-                if (!cont) {
-                    running = false;
-                    setStatus("Program finished");
-                }
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
+        bool executing = running && currentMode == 1;
+        if (executing)
+            runFrame();
 
         draw();
+        std::this_thread::sleep_until(frameStart + (executing ? std::chrono::milliseconds(16)
+                                                              : std::chrono::milliseconds(10)));
     }
 }
 
@@ -315,7 +331,7 @@ void EmulatorIDETUI::handleEditorInput(int ch) {
         case KEY_F(5):
             compileAndLoad();
             currentMode = 1;
-            running = true;
+            startRunning();
             setStatus("Running program...");
             break;
         case 15:
@@ -360,11 +376,8 @@ void EmulatorIDETUI::handleEditorInput(int ch) {
             newLine();
             break;
         case KEY_DC:
-            if (cursorCol < getCurrentLine().length()) {
-                std::string line = getCurrentLine();
-                line.erase(cursorCol, 1);
-                setCurrentLine(line);
-            }
+            if (cursorCol < (int)editor.lineLength(cursorRow))
+                editor.erase(cursorOffset(), 1);
             break;
         default:
             if (ch >= 32 && ch <= 126) {
@@ -386,7 +399,10 @@ void EmulatorIDETUI::handleDebuggerInput(int ch) {
             setStatus("Switched to edit mode. F3 to return to debugger.");
             break;
         case KEY_F(5):
-            running = !running;
+            if (running)
+                running = false;
+            else
+                startRunning();
             setStatus(running ? "Running..." : "Paused");
             break;
         case KEY_F(10):
@@ -397,17 +413,38 @@ void EmulatorIDETUI::handleDebuggerInput(int ch) {
         case 'B':
             toggleBreakpoint();
             break;
+        case 'w':
+        case 'W':
+            toggleWatchpoint();
+            break;
         case 'c':
         case 'C':
-            running = true;
+            startRunning();
             setStatus("Continuing...");
             break;
+        case 'm':
+        case 'M':
+        case '+':
+        case '=':
+        case '-':
+            changeSpeed(ch);
+            break;
         case 'r':
         case 'R':
             emulator->reset();
             compileAndLoad();
             setStatus("Program reset and reloaded");
             break;
+        case 'p':
+        case 'P':
+            emulator->enableProfiler(!emulator->isProfilerEnabled());
+            setStatus(emulator->isProfilerEnabled() ? "Profiler on (e to export)"
+                                                    : "Profiler off");
+            break;
+        case 'e':
+        case 'E':
+            exportProfile();
+            break;
         case 'q':
         case 'Q':
             quit = true;
@@ -432,6 +469,7 @@ void EmulatorIDETUI::handleDebuggerInput(int ch) {
 void EmulatorIDETUI::compileAndLoad() {
     try {
         emulator->reset();
+        editor.syncLines(editorLines);
         emulator->loadProgram(editorLines);
         setStatus("Program compiled and loaded successfully. " +
                   std::to_string(emulator->getProgram().size()) + " instructions, " +
@@ -442,9 +480,7 @@ void EmulatorIDETUI::compileAndLoad() {
 }
 
 void EmulatorIDETUI::newProgram() {
-    editorLines.clear();
-    editorLines.push_back("; New 8086 Assembly Program");
-    editorLines.push_back("");
+    editor.assign("; New 8086 Assembly Program\n");
     cursorRow = 1;
     cursorCol = 0;
     editorScrollY = 0;
@@ -455,9 +491,7 @@ void EmulatorIDETUI::newProgram() {
 void EmulatorIDETUI::saveProgram() {
     std::ofstream file("program.asm");
     if (file) {
-        for (const auto& line : editorLines) {
-            file << line << "\n";
-        }
+        file << editor.text();
         setStatus("Program saved to program.asm");
     } else {
         setStatus("Error: Could not save file");
@@ -465,15 +499,11 @@ void EmulatorIDETUI::saveProgram() {
 }
 
 void EmulatorIDETUI::loadProgram() {
-    std::ifstream file("program.asm");
+    std::ifstream file("program.asm", std::ios::binary);
     if (file) {
-        editorLines.clear();
-        std::string line;
-        while (std::getline(file, line)) {
-            editorLines.push_back(line);
-        }
-        if (editorLines.empty())
-            editorLines.push_back("");
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        editor.assign(contents.str());
         cursorRow = 0;
         cursorCol = 0;
         editorScrollY = 0;
@@ -485,39 +515,31 @@ void EmulatorIDETUI::loadProgram() {
 }
 
 void EmulatorIDETUI::insertChar(char ch) {
-    std::string line = getCurrentLine();
-    line.insert(cursorCol, 1, ch);
-    setCurrentLine(line);
+    editor.insert(cursorOffset(), std::string_view(&ch, 1));
     cursorCol++;
 }
 
 void EmulatorIDETUI::deleteChar() {
     if (cursorCol > 0) {
-        std::string line = getCurrentLine();
-        line.erase(cursorCol - 1, 1);
-        setCurrentLine(line);
+        editor.erase(cursorOffset() - 1, 1);
         cursorCol--;
     } else if (cursorRow > 0) {
-        std::string currentLine = getCurrentLine();
+        // Erasing the previous line's newline joins the two lines.
+        size_t offset = cursorOffset();
         cursorRow--;
-        cursorCol = getCurrentLine().length();
-        setCurrentLine(getCurrentLine() + currentLine);
-        editorLines.erase(editorLines.begin() + cursorRow + 1);
+        cursorCol = editor.lineLength(cursorRow);
+        editor.erase(offset - 1, 1);
     }
 }
 
 void EmulatorIDETUI::newLine() {
-    std::string line = getCurrentLine();
-    std::string newLine = line.substr(cursorCol);
-    setCurrentLine(line.substr(0, cursorCol));
-
+    editor.insert(cursorOffset(), "\n");
     cursorRow++;
     cursorCol = 0;
-    editorLines.insert(editorLines.begin() + cursorRow, newLine);
 }
 
 void EmulatorIDETUI::moveCursor(int dy, int dx) {
-    cursorRow = std::max(0, std::min((int)editorLines.size() - 1, cursorRow + dy));
+    cursorRow = std::max(0, std::min((int)editor.lineCount() - 1, cursorRow + dy));
     cursorCol = std::max(0, cursorCol + dx);
 
     if (cursorCol > (int)getCurrentLine().length())
@@ -541,13 +563,82 @@ void EmulatorIDETUI::ensureCursorVisible(int h, int w) {
 
 void EmulatorIDETUI::toggleBreakpoint() {
     size_t ip = emulator->getIP();
-    if (breakpoints.count(ip)) {
-        breakpoints.erase(ip);
+    if (emulator->toggleBreakpoint(ip))
+        setStatus("Breakpoint set at IP=" + std::to_string(ip));
+    else
         setStatus("Breakpoint removed at IP=" + std::to_string(ip));
+}
+
+void EmulatorIDETUI::toggleWatchpoint() {
+    uint16_t address = static_cast<uint16_t>(memWindowStart);
+    char text[64];
+    if (emulator->removeWatchpoint(address)) {
+        std::snprintf(text, sizeof(text), "Watchpoint removed at %04X", address);
     } else {
-        breakpoints.insert(ip);
-        setStatus("Breakpoint set at IP=" + std::to_string(ip));
+        emulator->addWatchpoint(address, 16, false, true);
+        std::snprintf(text, sizeof(text), "Watching writes to %04X+16", address);
+    }
+    setStatus(text);
+}
+
+void EmulatorIDETUI::startRunning() {
+    running = true;
+    pacer.resume();
+}
+
+void EmulatorIDETUI::runFrame() {
+    if (!pacer.runFrame(*emulator).stopped)
+        return;
+    switch (emulator->getStopReason()) {
+        case Emulator8086::StopReason::Breakpoint:
+            running = false;
+            setStatus("Hit breakpoint at IP=" + std::to_string(emulator->getIP()));
+            break;
+        case Emulator8086::StopReason::Watchpoint: {
+            running = false;
+            const auto& hit = emulator->getWatchHit();
+            char text[96];
+            std::snprintf(text,
+                          sizeof(text),
+                          "Watchpoint: %s %04X at IP=%zu",
+                          hit.isWrite ? "write to" : "read of",
+                          hit.address,
+                          hit.line);
+            setStatus(text);
+            break;
+        }
+        case Emulator8086::StopReason::EndOfProgram:
+            running = false;
+            setStatus("Program finished");
+            break;
+        case Emulator8086::StopReason::StepLimit:
+            break;
+    }
+}
+
+void EmulatorIDETUI::changeSpeed(int ch) {
+    if (ch == 'm' || ch == 'M') {
+        pacer.cycleMode();
+        pacer.resume();
+    } else if (ch == '+' || ch == '=') {
+        pacer.faster();
+    } else {
+        pacer.slower();
+    }
+    setStatus("Speed: " + pacer.describe());
+}
+
+void EmulatorIDETUI::exportProfile() {
+    Profiler* profiler = emulator->getProfiler();
+    if (!profiler) {
+        setStatus("Profiler is off (p to enable)");
+        return;
     }
+    if (profiler->exportFolded("program.folded") &&
+        profiler->exportCallgrind("callgrind.out.program", "program.asm"))
+        setStatus("Profile written to program.folded and callgrind.out.program");
+    else
+        setStatus("Error: Could not write profile");
 }
 
 void EmulatorIDETUI::step() {
@@ -568,14 +659,11 @@ void EmulatorIDETUI::setStatus(const std::string& msg) {
 }
 
 std::string EmulatorIDETUI::getCurrentLine() {
-    if (cursorRow >= 0 && cursorRow < (int)editorLines.size())
-        return editorLines[cursorRow];
+    if (cursorRow >= 0 && cursorRow < (int)editor.lineCount())
+        return editor.line(cursorRow);
     return "";
 }
 
-void EmulatorIDETUI::setCurrentLine(const std::string& line) {
-    if (cursorRow >= 0 && cursorRow < (int)editorLines.size())
-        editorLines[cursorRow] = line;
-    else if (cursorRow == (int)editorLines.size())
-        editorLines.push_back(line);
+size_t EmulatorIDETUI::cursorOffset() const {
+    return editor.lineStart(cursorRow) + cursorCol;
 }
@@ -0,0 +1,230 @@
+#include "instruction_table.h"
+
+#include <cctype>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+struct Spelling {
+    std::string_view text;
+    Opcode opcode;
+};
+
+constexpr Spelling kSpellings[] = {
+#define IM8086_SPELLING(id, name, ...) {name, Opcode::id},
+    IM8086_INSTRUCTIONS(IM8086_SPELLING)
+#undef IM8086_SPELLING
+#define IM8086_ALIAS(name, id) {name, Opcode::id},
+    IM8086_ALIASES(IM8086_ALIAS)
+#undef IM8086_ALIAS
+};
+
+constexpr size_t kSpellingCount = sizeof(kSpellings) / sizeof(kSpellings[0]);
+constexpr size_t kBuckets = 64;
+constexpr size_t kSlots = 256;
+constexpr uint8_t kEmptySlot = 0xFF;
+static_assert(kSpellingCount < kEmptySlot, "Too many mnemonics for the hash slots");
+
+// FNV-1a over the text with ASCII letters folded to upper case. Mnemonics are all letters;
+// anything else still hashes somewhere and is rejected by the final comparison.
+constexpr uint32_t mnemonicHash(std::string_view text, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (char ch : text) {
+        hash ^= static_cast<uint8_t>(ch) & 0xDF;
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+// Hash and displace: the seed-0 hash picks a bucket, and each bucket gets the smallest seed
+// that sends all of its spellings to free slots. Buckets are placed largest first.
+struct MnemonicHash {
+    std::array<uint16_t, kBuckets> seeds{};
+    std::array<uint8_t, kSlots> slots{};
+    bool complete = false;
+};
+
+constexpr MnemonicHash buildMnemonicHash() {
+    MnemonicHash table;
+    for (auto& slot : table.slots)
+        slot = kEmptySlot;
+
+    std::array<uint8_t, kBuckets> bucketSize{};
+    std::array<uint8_t, kSpellingCount> bucketOf{};
+    size_t largest = 0;
+    for (size_t i = 0; i < kSpellingCount; ++i) {
+        bucketOf[i] = static_cast<uint8_t>(mnemonicHash(kSpellings[i].text, 0) % kBuckets);
+        size_t size = ++bucketSize[bucketOf[i]];
+        largest = size > largest ? size : largest;
+    }
+
+    for (size_t size = largest; size > 0; --size) {
+        for (size_t bucket = 0; bucket < kBuckets; ++bucket) {
+            if (bucketSize[bucket] != size)
+                continue;
+            bool placed = false;
+            for (uint32_t seed = 1; seed < 0x10000 && !placed; ++seed) {
+                std::array<size_t, kSpellingCount> taken{};
+                size_t count = 0;
+                placed = true;
+                for (size_t i = 0; i < kSpellingCount && placed; ++i) {
+                    if (bucketOf[i] != bucket)
+                        continue;
+                    size_t slot = mnemonicHash(kSpellings[i].text, seed) % kSlots;
+                    if (table.slots[slot] != kEmptySlot) {
+                        placed = false;
+                        break;
+                    }
+                    table.slots[slot] = static_cast<uint8_t>(i);
+                    taken[count++] = slot;
+                }
+                if (placed) {
+                    table.seeds[bucket] = static_cast<uint16_t>(seed);
+                } else {
+                    for (size_t j = 0; j < count; ++j)
+                        table.slots[taken[j]] = kEmptySlot;
+                }
+            }
+            if (!placed)
+                return table;
+        }
+    }
+    table.complete = true;
+    return table;
+}
+
+constexpr MnemonicHash kMnemonicHash = buildMnemonicHash();
+static_assert(kMnemonicHash.complete, "No perfect hash found for the mnemonic table");
+
+constexpr const char* kGroupTitles[] = {
+    "Data Transfer Instructions:",    "Arithmetic Instructions:",
+    "Logical Instructions:",          "Shift and Rotate Instructions:",
+    "String Instructions:",           "Control Transfer Instructions:",
+    "Interrupt Instructions:",        "Flag Control Instructions:",
+    "Miscellaneous Instructions:",
+};
+static_assert(sizeof(kGroupTitles) / sizeof(kGroupTitles[0]) ==
+                  static_cast<size_t>(InstructionGroup::Miscellaneous) + 1,
+              "Every instruction group needs a help title");
+
+// Instructions whose operand is something more specific than "an operand", and what they say
+// when it is missing, after the mnemonic. Every other entry gets a message from its counts.
+struct OperandCountMessage {
+    Opcode opcode;
+    const char* message;
+};
+constexpr OperandCountMessage kOperandCountMessages[] = {
+    {Opcode::Rep, " requires 1 string operation"},
+    {Opcode::Repe, " requires 1 string operation"},
+    {Opcode::Repne, " requires 1 string operation"},
+    {Opcode::Esc, " requires operands"},
+    {Opcode::Lock, " requires an instruction to lock"},
+};
+
+bool isSpace(char ch) {
+    return std::isspace(static_cast<unsigned char>(ch)) != 0;
+}
+
+}  // namespace
+
+Opcode lookupMnemonic(std::string_view text) {
+    if (text.empty())
+        return Opcode::Invalid;
+    uint16_t seed = kMnemonicHash.seeds[mnemonicHash(text, 0) % kBuckets];
+    uint8_t index = kMnemonicHash.slots[mnemonicHash(text, seed) % kSlots];
+    if (index == kEmptySlot || !equalsIgnoreCase(kSpellings[index].text, text))
+        return Opcode::Invalid;
+    return kSpellings[index].opcode;
+}
+
+void checkOperandCount(Opcode opcode, size_t count) {
+    const InstructionInfo& info = instructionInfo(opcode);
+    if (count >= info.minOperands && count <= info.maxOperands)
+        return;
+    std::string name(info.mnemonic);
+    for (const auto& entry : kOperandCountMessages) {
+        if (entry.opcode == opcode)
+            throw std::runtime_error(name + entry.message);
+    }
+    if (info.maxOperands == 0)
+        throw std::runtime_error(name + " takes no operands");
+    std::string plural = info.minOperands == 1 ? " operand" : " operands";
+    if (info.minOperands == info.maxOperands)
+        throw std::runtime_error(name + " requires " + std::to_string(info.minOperands) + plural);
+    if (count < info.minOperands)
+        throw std::runtime_error(name + " requires at least " +
+                                 std::to_string(info.minOperands) + plural);
+    throw std::runtime_error(name + " takes at most " + std::to_string(info.maxOperands) +
+                             " operands");
+}
+
+bool splitInstruction(std::string_view text, std::string_view& mnemonic, Operands& operands) {
+    size_t begin = 0;
+    while (begin < text.size() && isSpace(text[begin]))
+        ++begin;
+    size_t end = begin;
+    while (end < text.size() && !isSpace(text[end]))
+        ++end;
+    mnemonic = text.substr(begin, end - begin);
+
+    std::string_view rest = text.substr(end);
+    while (!rest.empty()) {
+        size_t comma = rest.find(',');
+        std::string_view operand = rest.substr(0, comma);
+        rest = comma == std::string_view::npos ? std::string_view() : rest.substr(comma + 1);
+        while (!operand.empty() && isSpace(operand.front()))
+            operand.remove_prefix(1);
+        while (!operand.empty() && isSpace(operand.back()))
+            operand.remove_suffix(1);
+        if (operand.empty())
+            continue;
+        if (operands.size() == Operands::kCapacity)
+            return false;
+        operands.push_back(operand);
+    }
+    return true;
+}
+
+Operands DecodedInstruction::operands(std::string_view text) const {
+    Operands result;
+    for (size_t i = 0; i < operandCount; ++i)
+        result.push_back(text.substr(operandStart[i], operandLength[i]));
+    return result;
+}
+
+DecodedInstruction decodeInstruction(std::string_view text) {
+    DecodedInstruction decoded;
+    std::string_view mnemonic;
+    Operands operands;
+    if (!splitInstruction(text, mnemonic, operands))
+        return decoded;
+    decoded.opcode = lookupMnemonic(mnemonic);
+    decoded.operandCount = static_cast<uint8_t>(operands.size());
+    for (size_t i = 0; i < operands.size(); ++i) {
+        decoded.operandStart[i] = static_cast<uint32_t>(operands[i].data() - text.data());
+        decoded.operandLength[i] = static_cast<uint32_t>(operands[i].size());
+    }
+    return decoded;
+}
+
+void writeInstructionHelp(std::ostream& out) {
+    for (size_t group = 0; group < sizeof(kGroupTitles) / sizeof(kGroupTitles[0]); ++group) {
+        out << (group == 0 ? "" : "\n") << kGroupTitles[group] << '\n';
+        for (size_t op = 0; op < kOpcodeCount; ++op) {
+            const InstructionInfo& info = kInstructionTable[op];
+            if (static_cast<size_t>(info.group) != group)
+                continue;
+            std::string usage(info.mnemonic);
+            for (size_t i = kOpcodeCount; i < kSpellingCount; ++i) {
+                if (static_cast<size_t>(kSpellings[i].opcode) == op)
+                    usage += "/" + std::string(kSpellings[i].text);
+            }
+            if (*info.syntax)
+                usage += std::string(" ") + info.syntax;
+            out << "  " << std::left << std::setw(19) << usage << std::right << "- " << info.help
+                << '\n';
+        }
+    }
+}
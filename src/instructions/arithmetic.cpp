@@ -6,9 +6,7 @@
 
 ArithmeticInstructions::ArithmeticInstructions(Emulator8086* emu) : emulator(emu) {}
 
-void ArithmeticInstructions::add(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("ADD requires 2 operands");
+void ArithmeticInstructions::add(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
         uint8_t src = emulator->getValue8(operands[1]);
@@ -40,9 +38,7 @@ void ArithmeticInstructions::add(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::adc(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("ADC requires 2 operands");
+void ArithmeticInstructions::adc(const Operands& operands) {
     bool cf = emulator->getRegisters().FLAGS & Registers::CF;
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
@@ -59,9 +55,7 @@ void ArithmeticInstructions::adc(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::inc(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("INC requires 1 operand");
+void ArithmeticInstructions::inc(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
         uint16_t result = dest + 1;
@@ -82,9 +76,7 @@ void ArithmeticInstructions::inc(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::aaa(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("AAA takes no operands");
+void ArithmeticInstructions::aaa(const Operands&) {
     if ((emulator->getRegisters().AX.bytes.l & 0x0F) > 9 ||
         (emulator->getRegisters().FLAGS & Registers::AF)) {
         emulator->getRegisters().AX.bytes.l += 6;
@@ -96,9 +88,7 @@ void ArithmeticInstructions::aaa(const std::vector<std::string>& operands) {
     emulator->getRegisters().AX.bytes.l &= 0x0F;
 }
 
-void ArithmeticInstructions::daa(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("DAA takes no operands");
+void ArithmeticInstructions::daa(const Operands&) {
     uint8_t oldAL = emulator->getRegisters().AX.bytes.l;
     bool oldCF = emulator->getRegisters().FLAGS & Registers::CF;
     emulator->getRegisters().FLAGS &= ~Registers::CF;
@@ -113,9 +103,7 @@ void ArithmeticInstructions::daa(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::sub(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("SUB requires 2 operands");
+void ArithmeticInstructions::sub(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
         uint8_t src = emulator->getValue8(operands[1]);
@@ -147,9 +135,7 @@ void ArithmeticInstructions::sub(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::sbb(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("SBB requires 2 operands");
+void ArithmeticInstructions::sbb(const Operands& operands) {
     bool cf = emulator->getRegisters().FLAGS & Registers::CF;
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
@@ -166,9 +152,7 @@ void ArithmeticInstructions::sbb(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::dec(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("DEC requires 1 operand");
+void ArithmeticInstructions::dec(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
         uint16_t result = dest - 1;
@@ -189,9 +173,7 @@ void ArithmeticInstructions::dec(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::neg(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("NEG requires 1 operand");
+void ArithmeticInstructions::neg(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
         uint16_t result = 0 - dest;
@@ -212,9 +194,7 @@ void ArithmeticInstructions::neg(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::aas(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("AAS takes no operands");
+void ArithmeticInstructions::aas(const Operands&) {
     if ((emulator->getRegisters().AX.bytes.l & 0x0F) > 9 ||
         (emulator->getRegisters().FLAGS & Registers::AF)) {
         emulator->getRegisters().AX.bytes.l -= 6;
@@ -226,9 +206,7 @@ void ArithmeticInstructions::aas(const std::vector<std::string>& operands) {
     emulator->getRegisters().AX.bytes.l &= 0x0F;
 }
 
-void ArithmeticInstructions::das(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("DAS takes no operands");
+void ArithmeticInstructions::das(const Operands&) {
     uint8_t oldAL = emulator->getRegisters().AX.bytes.l;
     bool oldCF = emulator->getRegisters().FLAGS & Registers::CF;
     emulator->getRegisters().FLAGS &= ~Registers::CF;
@@ -243,9 +221,7 @@ void ArithmeticInstructions::das(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::mul(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("MUL requires 1 operand");
+void ArithmeticInstructions::mul(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint16_t result = emulator->getRegisters().AX.bytes.l * emulator->getRegister8(operands[0]);
         emulator->getRegisters().AX.x = result;
@@ -258,9 +234,7 @@ void ArithmeticInstructions::mul(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::imul(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("IMUL requires 1 operand");
+void ArithmeticInstructions::imul(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         int16_t result = static_cast<int8_t>(emulator->getRegisters().AX.bytes.l) *
                          static_cast<int8_t>(emulator->getRegister8(operands[0]));
@@ -275,18 +249,14 @@ void ArithmeticInstructions::imul(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::aam(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("AAM takes no operands");
+void ArithmeticInstructions::aam(const Operands&) {
     uint8_t al = emulator->getRegisters().AX.bytes.l;
     emulator->getRegisters().AX.bytes.h = al / 10;
     emulator->getRegisters().AX.bytes.l = al % 10;
     emulator->updateFlags(emulator->getRegisters().AX.x, false, false);
 }
 
-void ArithmeticInstructions::div(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("DIV requires 1 operand");
+void ArithmeticInstructions::div(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t divisor = emulator->getRegister8(operands[0]);
         if (divisor == 0)
@@ -304,9 +274,7 @@ void ArithmeticInstructions::div(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::idiv(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("IDIV requires 1 operand");
+void ArithmeticInstructions::idiv(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         int8_t divisor = static_cast<int8_t>(emulator->getRegister8(operands[0]));
         if (divisor == 0)
@@ -324,24 +292,18 @@ void ArithmeticInstructions::idiv(const std::vector<std::string>& operands) {
     }
 }
 
-void ArithmeticInstructions::aad(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("AAD takes no operands");
+void ArithmeticInstructions::aad(const Operands&) {
     emulator->getRegisters().AX.bytes.l =
         (emulator->getRegisters().AX.bytes.h * 10) + emulator->getRegisters().AX.bytes.l;
     emulator->getRegisters().AX.bytes.h = 0;
     emulator->updateFlags(emulator->getRegisters().AX.x, false, false);
 }
 
-void ArithmeticInstructions::cbw(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("CBW takes no operands");
+void ArithmeticInstructions::cbw(const Operands&) {
     emulator->getRegisters().AX.bytes.h =
         (emulator->getRegisters().AX.bytes.l & 0x80) ? 0xFF : 0x00;
 }
 
-void ArithmeticInstructions::cwd(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("CWD takes no operands");
+void ArithmeticInstructions::cwd(const Operands&) {
     emulator->getRegisters().DX.x = (emulator->getRegisters().AX.x & 0x8000) ? 0xFFFF : 0x0000;
 }
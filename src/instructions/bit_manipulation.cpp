@@ -6,10 +6,7 @@
 
 BitManipulationInstructions::BitManipulationInstructions(Emulator8086* emu) : emulator(emu) {}
 
-void BitManipulationInstructions::rcl(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("RCL requires 2 operands");
-
+void BitManipulationInstructions::rcl(const Operands& operands) {
     uint8_t count = emulator->getValue8(operands[1]) & 0x1F;
     bool carry = emulator->getRegisters().FLAGS & Registers::CF;
 
@@ -54,10 +51,7 @@ void BitManipulationInstructions::rcl(const std::vector<std::string>& operands)
     }
 }
 
-void BitManipulationInstructions::rcr(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("RCR requires 2 operands");
-
+void BitManipulationInstructions::rcr(const Operands& operands) {
     uint8_t count = emulator->getValue8(operands[1]) & 0x1F;
     bool carry = emulator->getRegisters().FLAGS & Registers::CF;
 
@@ -102,10 +96,7 @@ void BitManipulationInstructions::rcr(const std::vector<std::string>& operands)
     }
 }
 
-void BitManipulationInstructions::rol(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("ROL requires 2 operands");
-
+void BitManipulationInstructions::rol(const Operands& operands) {
     uint8_t count = emulator->getValue8(operands[1]) & 0x1F;
 
     if (emulator->is8BitRegister(operands[0])) {
@@ -145,10 +136,7 @@ void BitManipulationInstructions::rol(const std::vector<std::string>& operands)
     }
 }
 
-void BitManipulationInstructions::ror(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("ROR requires 2 operands");
-
+void BitManipulationInstructions::ror(const Operands& operands) {
     uint8_t count = emulator->getValue8(operands[1]) & 0x1F;
 
     if (emulator->is8BitRegister(operands[0])) {
@@ -188,14 +176,11 @@ void BitManipulationInstructions::ror(const std::vector<std::string>& operands)
     }
 }
 
-void BitManipulationInstructions::sal(const std::vector<std::string>& operands) {
+void BitManipulationInstructions::sal(const Operands& operands) {
     shl(operands);
 }
 
-void BitManipulationInstructions::sar(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("SAR requires 2 operands");
-
+void BitManipulationInstructions::sar(const Operands& operands) {
     uint8_t count = emulator->getValue8(operands[1]) & 0x1F;
 
     if (emulator->is8BitRegister(operands[0])) {
@@ -241,10 +226,7 @@ void BitManipulationInstructions::sar(const std::vector<std::string>& operands)
     }
 }
 
-void BitManipulationInstructions::shl(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("SHL requires 2 operands");
-
+void BitManipulationInstructions::shl(const Operands& operands) {
     uint8_t count = emulator->getValue8(operands[1]) & 0x1F;
 
     if (emulator->is8BitRegister(operands[0])) {
@@ -287,10 +269,7 @@ void BitManipulationInstructions::shl(const std::vector<std::string>& operands)
     }
 }
 
-void BitManipulationInstructions::shr(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("SHR requires 2 operands");
-
+void BitManipulationInstructions::shr(const Operands& operands) {
     uint8_t count = emulator->getValue8(operands[1]) & 0x1F;
 
     if (emulator->is8BitRegister(operands[0])) {
@@ -7,11 +7,9 @@
 
 DataTransferInstructions::DataTransferInstructions(Emulator8086* emu) : emulator(emu) {}
 
-void DataTransferInstructions::mov(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("MOV requires 2 operands");
-    const std::string& dest = operands[0];
-    const std::string& src = operands[1];
+void DataTransferInstructions::mov(const Operands& operands) {
+    std::string_view dest = operands[0];
+    std::string_view src = operands[1];
 
     if (emulator->is8BitRegister(dest)) {
         emulator->getRegister8(dest) = emulator->getValue8(src);
@@ -27,9 +25,7 @@ void DataTransferInstructions::mov(const std::vector<std::string>& operands) {
     }
 }
 
-void DataTransferInstructions::push(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("PUSH requires 1 operand");
+void DataTransferInstructions::push(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0]))
         throw std::runtime_error("PUSH requires 16-bit operand");
     uint16_t value = emulator->getValue(operands[0]);
@@ -37,9 +33,7 @@ void DataTransferInstructions::push(const std::vector<std::string>& operands) {
     emulator->writeMemoryWord(emulator->getRegisters().SP, value);
 }
 
-void DataTransferInstructions::pop(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("POP requires 1 operand");
+void DataTransferInstructions::pop(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0]))
         throw std::runtime_error("POP requires 16-bit operand");
     uint16_t value = emulator->readMemoryWord(emulator->getRegisters().SP);
@@ -52,10 +46,7 @@ void DataTransferInstructions::pop(const std::vector<std::string>& operands) {
     }
 }
 
-void DataTransferInstructions::xchg(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("XCHG requires 2 operands");
-
+void DataTransferInstructions::xchg(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0]) && emulator->is8BitRegister(operands[1])) {
         uint8_t temp = emulator->getRegister8(operands[0]);
         emulator->getRegister8(operands[0]) = emulator->getRegister8(operands[1]);
@@ -96,18 +87,14 @@ void DataTransferInstructions::xchg(const std::vector<std::string>& operands) {
     }
 }
 
-void DataTransferInstructions::lea(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("LEA requires 2 operands");
+void DataTransferInstructions::lea(const Operands& operands) {
     if (!emulator->isMemoryOperand(operands[1]))
         throw std::runtime_error("LEA requires memory source");
     MemoryOperand memOp = emulator->parseMemoryOperand(operands[1]);
     emulator->getRegister(operands[0]) = emulator->calculateEffectiveAddress(memOp);
 }
 
-void DataTransferInstructions::lds(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("LDS requires 2 operands");
+void DataTransferInstructions::lds(const Operands& operands) {
     if (!emulator->isMemoryOperand(operands[1]))
         throw std::runtime_error("LDS requires memory source");
     MemoryOperand memOp = emulator->parseMemoryOperand(operands[1]);
@@ -116,9 +103,7 @@ void DataTransferInstructions::lds(const std::vector<std::string>& operands) {
     emulator->getRegisters().DS = emulator->readMemoryWord(address + 2);
 }
 
-void DataTransferInstructions::les(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("LES requires 2 operands");
+void DataTransferInstructions::les(const Operands& operands) {
     if (!emulator->isMemoryOperand(operands[1]))
         throw std::runtime_error("LES requires memory source");
     MemoryOperand memOp = emulator->parseMemoryOperand(operands[1]);
@@ -127,36 +112,26 @@ void DataTransferInstructions::les(const std::vector<std::string>& operands) {
     emulator->getRegisters().ES = emulator->readMemoryWord(address + 2);
 }
 
-void DataTransferInstructions::lahf(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("LAHF takes no operands");
+void DataTransferInstructions::lahf(const Operands&) {
     emulator->getRegisters().AX.bytes.h = emulator->getRegisters().FLAGS & 0xFF;
 }
 
-void DataTransferInstructions::sahf(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("SAHF takes no operands");
+void DataTransferInstructions::sahf(const Operands&) {
     emulator->getRegisters().FLAGS =
         (emulator->getRegisters().FLAGS & 0xFF00) | (emulator->getRegisters().AX.bytes.h & 0xFF);
 }
 
-void DataTransferInstructions::pushf(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("PUSHF takes no operands");
+void DataTransferInstructions::pushf(const Operands&) {
     emulator->getRegisters().SP -= 2;
     emulator->writeMemoryWord(emulator->getRegisters().SP, emulator->getRegisters().FLAGS);
 }
 
-void DataTransferInstructions::popf(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("POPF takes no operands");
+void DataTransferInstructions::popf(const Operands&) {
     emulator->getRegisters().FLAGS = emulator->readMemoryWord(emulator->getRegisters().SP);
     emulator->getRegisters().SP += 2;
 }
 
-void DataTransferInstructions::pusha(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("PUSHA takes no operands");
+void DataTransferInstructions::pusha(const Operands&) {
     uint16_t tempSP = emulator->getRegisters().SP;
     push({"AX"});
     push({"CX"});
@@ -169,9 +144,7 @@ void DataTransferInstructions::pusha(const std::vector<std::string>& operands) {
     push({"DI"});
 }
 
-void DataTransferInstructions::popa(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("POPA takes no operands");
+void DataTransferInstructions::popa(const Operands&) {
     pop({"DI"});
     pop({"SI"});
     pop({"BP"});
@@ -6,9 +6,7 @@
 
 LogicalInstructions::LogicalInstructions(Emulator8086* emu) : emulator(emu) {}
 
-void LogicalInstructions::and_op(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("AND requires 2 operands");
+void LogicalInstructions::and_op(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
         uint8_t src = emulator->getValue8(operands[1]);
@@ -38,9 +36,7 @@ void LogicalInstructions::and_op(const std::vector<std::string>& operands) {
     }
 }
 
-void LogicalInstructions::or_op(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("OR requires 2 operands");
+void LogicalInstructions::or_op(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
         uint8_t src = emulator->getValue8(operands[1]);
@@ -70,9 +66,7 @@ void LogicalInstructions::or_op(const std::vector<std::string>& operands) {
     }
 }
 
-void LogicalInstructions::xor_op(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("XOR requires 2 operands");
+void LogicalInstructions::xor_op(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
         uint8_t src = emulator->getValue8(operands[1]);
@@ -102,9 +96,7 @@ void LogicalInstructions::xor_op(const std::vector<std::string>& operands) {
     }
 }
 
-void LogicalInstructions::not_op(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("NOT requires 1 operand");
+void LogicalInstructions::not_op(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t& dest = emulator->getRegister8(operands[0]);
         dest = ~dest;
@@ -120,9 +112,7 @@ void LogicalInstructions::not_op(const std::vector<std::string>& operands) {
     }
 }
 
-void LogicalInstructions::test(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("TEST requires 2 operands");
+void LogicalInstructions::test(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t dest = emulator->getRegister8(operands[0]);
         uint8_t src = emulator->getValue8(operands[1]);
@@ -150,9 +140,7 @@ void LogicalInstructions::test(const std::vector<std::string>& operands) {
     }
 }
 
-void LogicalInstructions::cmp(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("CMP requires 2 operands");
+void LogicalInstructions::cmp(const Operands& operands) {
     if (emulator->is8BitRegister(operands[0])) {
         uint8_t dest = emulator->getRegister8(operands[0]);
         uint8_t src = emulator->getValue8(operands[1]);
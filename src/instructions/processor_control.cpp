@@ -1,70 +1,66 @@
 #include "instructions/processor_control.h"
 
+#include <climits>
 #include <iostream>
 #include <stdexcept>
+#include <string>
 
 #include "emulator8086.h"
 
+namespace {
+
+// Interrupt and port numbers are hex, with or without a trailing 'h'.
+int parseHexOperand(std::string_view text, const char* invalid, const char* outOfRange) {
+    long value = 0;
+    NumberParse parsed = parseIntegerPrefix(text, 16, value);
+    if (parsed == NumberParse::Invalid)
+        throw std::runtime_error(invalid + std::string(text));
+    if (parsed == NumberParse::OutOfRange || value > INT_MAX || value < INT_MIN)
+        throw std::runtime_error(outOfRange + std::string(text));
+    return static_cast<int>(value);
+}
+
+}  // namespace
+
 ProcessorControlInstructions::ProcessorControlInstructions(Emulator8086* emu) : emulator(emu) {}
 
-void ProcessorControlInstructions::clc(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("CLC takes no operands");
+void ProcessorControlInstructions::clc(const Operands&) {
     emulator->getRegisters().FLAGS &= ~Registers::CF;
 }
 
-void ProcessorControlInstructions::cmc(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("CMC takes no operands");
+void ProcessorControlInstructions::cmc(const Operands&) {
     emulator->getRegisters().FLAGS ^= Registers::CF;
 }
 
-void ProcessorControlInstructions::stc(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("STC takes no operands");
+void ProcessorControlInstructions::stc(const Operands&) {
     emulator->getRegisters().FLAGS |= Registers::CF;
 }
 
-void ProcessorControlInstructions::cld(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("CLD takes no operands");
+void ProcessorControlInstructions::cld(const Operands&) {
     emulator->getRegisters().FLAGS &= ~Registers::DF;
 }
 
-void ProcessorControlInstructions::std(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("STD takes no operands");
+void ProcessorControlInstructions::std(const Operands&) {
     emulator->getRegisters().FLAGS |= Registers::DF;
 }
 
-void ProcessorControlInstructions::cli(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("CLI takes no operands");
+void ProcessorControlInstructions::cli(const Operands&) {
     emulator->getRegisters().FLAGS &= ~Registers::IF;
 }
 
-void ProcessorControlInstructions::sti(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("STI takes no operands");
+void ProcessorControlInstructions::sti(const Operands&) {
     emulator->getRegisters().FLAGS |= Registers::IF;
 }
 
-void ProcessorControlInstructions::hlt(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("HLT takes no operands");
+void ProcessorControlInstructions::hlt(const Operands&) {
     std::cout << "CPU halted. Program terminated.\n";
     // exit(0);
 }
 
-void ProcessorControlInstructions::wait(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("WAIT takes no operands");
+void ProcessorControlInstructions::wait(const Operands&) {
 }
 
-void ProcessorControlInstructions::esc(const std::vector<std::string>& operands) {
-    if (operands.empty())
-        throw std::runtime_error("ESC requires operands");
-
+void ProcessorControlInstructions::esc(const Operands& operands) {
     std::cout << "ESC instruction: Coprocessor operation - ";
     for (const auto& op : operands) {
         std::cout << op << " ";
@@ -72,31 +68,17 @@ void ProcessorControlInstructions::esc(const std::vector<std::string>& operands)
     std::cout << "(simulated)\n";
 }
 
-void ProcessorControlInstructions::lock(const std::vector<std::string>& operands) {
-    if (operands.empty())
-        throw std::runtime_error("LOCK requires an instruction to lock");
-
+void ProcessorControlInstructions::lock(const Operands& operands) {
     std::cout << "LOCK prefix applied to: " << operands[0] << "\n";
 }
 
-void ProcessorControlInstructions::nop(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("NOP takes no operands");
+void ProcessorControlInstructions::nop(const Operands&) {
 }
 
-void ProcessorControlInstructions::int_op(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("INT requires 1 operand");
-
+void ProcessorControlInstructions::int_op(const Operands& operands) {
     try {
-        int intNum;
-        try {
-            intNum = std::stoi(operands[0], nullptr, 16);
-        } catch (const std::invalid_argument& e) {
-            throw std::runtime_error("Invalid interrupt number: " + operands[0]);
-        } catch (const std::out_of_range& e) {
-            throw std::runtime_error("Interrupt number out of range: " + operands[0]);
-        }
+        int intNum = parseHexOperand(
+            operands[0], "Invalid interrupt number: ", "Interrupt number out of range: ");
         switch (intNum) {
             case 0x10:
                 std::cout << "BIOS Video Interrupt (INT 10h) - simulated\n";
@@ -114,37 +96,33 @@ void ProcessorControlInstructions::int_op(const std::vector<std::string>& operan
                 std::cout << "DOS Function Call (INT 21h) - simulated\n";
                 break;
             default:
-                std::cout << "Software Interrupt " << std::hex << intNum << "h - simulated\n";
+                std::cout << "Software Interrupt " << std::hex << intNum << std::dec
+                          << "h - simulated\n";
                 break;
         }
+        emulator->notifyInterrupt(static_cast<uint8_t>(intNum), emulator->getRegisters().IP + 1);
 
         emulator->getRegisters().SP -= 2;
         emulator->writeMemoryWord(emulator->getRegisters().SP, emulator->getRegisters().FLAGS);
         emulator->getRegisters().SP -= 2;
         emulator->writeMemoryWord(emulator->getRegisters().SP, emulator->getRegisters().CS);
         emulator->getRegisters().SP -= 2;
-        emulator->writeMemoryWord(emulator->getRegisters().SP, emulator->getRegisters().IP);
+        emulator->writeMemoryWord(emulator->getRegisters().SP, emulator->getRegisters().IP + 1);
 
         emulator->getRegisters().FLAGS &= ~Registers::IF;
     } catch (const std::exception&) {
-        throw std::runtime_error("Invalid interrupt number: " + operands[0]);
+        throw std::runtime_error("Invalid interrupt number: " + std::string(operands[0]));
     }
 }
 
-void ProcessorControlInstructions::into(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("INTO takes no operands");
-
+void ProcessorControlInstructions::into(const Operands&) {
     if (emulator->getRegisters().FLAGS & Registers::OF) {
         std::cout << "INTO: Overflow detected, generating interrupt 4\n";
         int_op({"4"});
     }
 }
 
-void ProcessorControlInstructions::iret(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("IRET takes no operands");
-
+void ProcessorControlInstructions::iret(const Operands&) {
     emulator->getRegisters().IP = emulator->readMemoryWord(emulator->getRegisters().SP);
     emulator->getRegisters().SP += 2;
     emulator->getRegisters().CS = emulator->readMemoryWord(emulator->getRegisters().SP);
@@ -153,81 +131,68 @@ void ProcessorControlInstructions::iret(const std::vector<std::string>& operands
     emulator->getRegisters().SP += 2;
 }
 
-void ProcessorControlInstructions::in_op(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("IN requires 2 operands");
-
+void ProcessorControlInstructions::in_op(const Operands& operands) {
     try {
-        uint16_t port;
-        try {
-            port = std::stoi(operands[1], nullptr, 16);
-        } catch (const std::invalid_argument& e) {
-            throw std::runtime_error("Invalid port number: " + operands[1]);
-        } catch (const std::out_of_range& e) {
-            throw std::runtime_error("Port number out of range: " + operands[1]);
-        }
+        uint16_t port = parseHexOperand(
+            operands[1], "Invalid port number: ", "Port number out of range: ");
 
         uint16_t value = 0;
         switch (port) {
             case 0x60:
                 value = 0x1C;
-                std::cout << "IN from keyboard port (60h): " << std::hex << value << "\n";
+                std::cout << "IN from keyboard port (60h): " << std::hex << value << std::dec
+                          << "\n";
                 break;
             case 0x61:
                 value = 0x00;
-                std::cout << "IN from keyboard status port (61h): " << std::hex << value << "\n";
+                std::cout << "IN from keyboard status port (61h): " << std::hex << value << std::dec
+                          << "\n";
                 break;
             case 0x3F8:
                 value = 0xFF;
-                std::cout << "IN from COM1 port (3F8h): " << std::hex << value << "\n";
+                std::cout << "IN from COM1 port (3F8h): " << std::hex << value << std::dec << "\n";
                 break;
             default:
                 value = 0x00;
                 std::cout << "IN from port " << std::hex << port << "h: " << value
-                          << " (simulated)\n";
+                          << std::dec << " (simulated)\n";
                 break;
         }
+        emulator->notifyPortIn(port, value);
 
         if (emulator->is8BitRegister(operands[0]))
             emulator->getRegister8(operands[0]) = value & 0xFF;
         else
             emulator->getRegister(operands[0]) = value;
     } catch (const std::exception&) {
-        throw std::runtime_error("Invalid port number: " + operands[1]);
+        throw std::runtime_error("Invalid port number: " + std::string(operands[1]));
     }
 }
 
-void ProcessorControlInstructions::out(const std::vector<std::string>& operands) {
-    if (operands.size() != 2)
-        throw std::runtime_error("OUT requires 2 operands");
-
+void ProcessorControlInstructions::out(const Operands& operands) {
     try {
-        uint16_t port;
-        try {
-            port = std::stoi(operands[0], nullptr, 16);
-        } catch (const std::invalid_argument& e) {
-            throw std::runtime_error("Invalid port number: " + operands[0]);
-        } catch (const std::out_of_range& e) {
-            throw std::runtime_error("Port number out of range: " + operands[0]);
-        }
+        uint16_t port = parseHexOperand(
+            operands[0], "Invalid port number: ", "Port number out of range: ");
         uint16_t value = emulator->getValue(operands[1]);
+        emulator->notifyPortOut(port, value);
 
         switch (port) {
             case 0x61:
-                std::cout << "OUT to system control port (61h): " << std::hex << value << "\n";
+                std::cout << "OUT to system control port (61h): " << std::hex << value << std::dec
+                          << "\n";
                 break;
             case 0x3F8:
                 std::cout << "OUT to COM1 port (3F8h): " << static_cast<char>(value & 0xFF) << "\n";
                 break;
             case 0x378:
-                std::cout << "OUT to LPT1 port (378h): " << std::hex << value << "\n";
+                std::cout << "OUT to LPT1 port (378h): " << std::hex << value << std::dec << "\n";
                 break;
             default:
                 std::cout << "OUT to port " << std::hex << port << "h: " << value
-                          << " (simulated)\n";
+                          << std::dec << " (simulated)\n";
                 break;
         }
     } catch (const std::exception&) {
-        throw std::runtime_error("Invalid port number: " + operands[0]);
+        throw std::runtime_error("Invalid port number: " + std::string(operands[0]));
     }
 }
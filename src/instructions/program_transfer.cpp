@@ -6,54 +6,37 @@
 
 ProgramTransferInstructions::ProgramTransferInstructions(Emulator8086* emu) : emulator(emu) {}
 
-void ProgramTransferInstructions::call(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("CALL requires 1 operand");
-
+void ProgramTransferInstructions::call(const Operands& operands) {
+    size_t target = emulator->getLabelAddress(operands[0]);
     emulator->getRegisters().SP -= 2;
-    emulator->writeMemoryWord(emulator->getRegisters().SP, emulator->getRegisters().IP);
+    emulator->writeMemoryWord(emulator->getRegisters().SP, emulator->getRegisters().IP + 1);
 
-    emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
+    emulator->getRegisters().IP = target;
 }
 
-void ProgramTransferInstructions::jmp(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JMP requires 1 operand");
-
+void ProgramTransferInstructions::jmp(const Operands& operands) {
     emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
 }
 
-void ProgramTransferInstructions::ret(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("RET takes no operands");
-
+void ProgramTransferInstructions::ret(const Operands&) {
     emulator->getRegisters().IP = emulator->readMemoryWord(emulator->getRegisters().SP);
     emulator->getRegisters().SP += 2;
 }
 
-void ProgramTransferInstructions::retf(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("RETF takes no operands");
-
+void ProgramTransferInstructions::retf(const Operands&) {
     emulator->getRegisters().IP = emulator->readMemoryWord(emulator->getRegisters().SP);
     emulator->getRegisters().SP += 2;
     emulator->getRegisters().CS = emulator->readMemoryWord(emulator->getRegisters().SP);
     emulator->getRegisters().SP += 2;
 }
 
-void ProgramTransferInstructions::je(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JE requires 1 operand");
-
+void ProgramTransferInstructions::je(const Operands& operands) {
     if (emulator->getRegisters().FLAGS & Registers::ZF) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jl(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JL requires 1 operand");
-
+void ProgramTransferInstructions::jl(const Operands& operands) {
     bool sf = emulator->getRegisters().FLAGS & Registers::SF;
     bool of = emulator->getRegisters().FLAGS & Registers::OF;
     if (sf != of) {
@@ -61,10 +44,7 @@ void ProgramTransferInstructions::jl(const std::vector<std::string>& operands) {
     }
 }
 
-void ProgramTransferInstructions::jle(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JLE requires 1 operand");
-
+void ProgramTransferInstructions::jle(const Operands& operands) {
     bool sf = emulator->getRegisters().FLAGS & Registers::SF;
     bool of = emulator->getRegisters().FLAGS & Registers::OF;
     bool zf = emulator->getRegisters().FLAGS & Registers::ZF;
@@ -73,65 +53,44 @@ void ProgramTransferInstructions::jle(const std::vector<std::string>& operands)
     }
 }
 
-void ProgramTransferInstructions::jb(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JB requires 1 operand");
-
+void ProgramTransferInstructions::jb(const Operands& operands) {
     if (emulator->getRegisters().FLAGS & Registers::CF) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jbe(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JBE requires 1 operand");
-
+void ProgramTransferInstructions::jbe(const Operands& operands) {
     if ((emulator->getRegisters().FLAGS & Registers::CF) ||
         (emulator->getRegisters().FLAGS & Registers::ZF)) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jp(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JP requires 1 operand");
-
+void ProgramTransferInstructions::jp(const Operands& operands) {
     if (emulator->getRegisters().FLAGS & Registers::PF) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jo(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JO requires 1 operand");
-
+void ProgramTransferInstructions::jo(const Operands& operands) {
     if (emulator->getRegisters().FLAGS & Registers::OF) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::js(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JS requires 1 operand");
-
+void ProgramTransferInstructions::js(const Operands& operands) {
     if (emulator->getRegisters().FLAGS & Registers::SF) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jne(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JNE requires 1 operand");
-
+void ProgramTransferInstructions::jne(const Operands& operands) {
     if (!(emulator->getRegisters().FLAGS & Registers::ZF)) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jnl(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JNL requires 1 operand");
-
+void ProgramTransferInstructions::jnl(const Operands& operands) {
     bool sf = emulator->getRegisters().FLAGS & Registers::SF;
     bool of = emulator->getRegisters().FLAGS & Registers::OF;
     if (sf == of) {
@@ -139,10 +98,7 @@ void ProgramTransferInstructions::jnl(const std::vector<std::string>& operands)
     }
 }
 
-void ProgramTransferInstructions::jg(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JG requires 1 operand");
-
+void ProgramTransferInstructions::jg(const Operands& operands) {
     bool sf = emulator->getRegisters().FLAGS & Registers::SF;
     bool of = emulator->getRegisters().FLAGS & Registers::OF;
     bool zf = emulator->getRegisters().FLAGS & Registers::ZF;
@@ -151,86 +107,59 @@ void ProgramTransferInstructions::jg(const std::vector<std::string>& operands) {
     }
 }
 
-void ProgramTransferInstructions::jnb(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JNB requires 1 operand");
-
+void ProgramTransferInstructions::jnb(const Operands& operands) {
     if (!(emulator->getRegisters().FLAGS & Registers::CF)) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::ja(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JA requires 1 operand");
-
+void ProgramTransferInstructions::ja(const Operands& operands) {
     if (!(emulator->getRegisters().FLAGS & Registers::CF) &&
         !(emulator->getRegisters().FLAGS & Registers::ZF)) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jnp(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JNP requires 1 operand");
-
+void ProgramTransferInstructions::jnp(const Operands& operands) {
     if (!(emulator->getRegisters().FLAGS & Registers::PF)) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jno(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JNO requires 1 operand");
-
+void ProgramTransferInstructions::jno(const Operands& operands) {
     if (!(emulator->getRegisters().FLAGS & Registers::OF)) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jns(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JNS requires 1 operand");
-
+void ProgramTransferInstructions::jns(const Operands& operands) {
     if (!(emulator->getRegisters().FLAGS & Registers::SF)) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::loop(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("LOOP requires 1 operand");
-
+void ProgramTransferInstructions::loop(const Operands& operands) {
     emulator->getRegisters().CX.x--;
     if (emulator->getRegisters().CX.x != 0) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::loopz(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("LOOPZ requires 1 operand");
-
+void ProgramTransferInstructions::loopz(const Operands& operands) {
     emulator->getRegisters().CX.x--;
     if (emulator->getRegisters().CX.x != 0 && (emulator->getRegisters().FLAGS & Registers::ZF)) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::loopnz(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("LOOPNZ requires 1 operand");
-
+void ProgramTransferInstructions::loopnz(const Operands& operands) {
     emulator->getRegisters().CX.x--;
     if (emulator->getRegisters().CX.x != 0 && !(emulator->getRegisters().FLAGS & Registers::ZF)) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
 }
 
-void ProgramTransferInstructions::jcxz(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("JCXZ requires 1 operand");
-
+void ProgramTransferInstructions::jcxz(const Operands& operands) {
     if (emulator->getRegisters().CX.x == 0) {
         emulator->getRegisters().IP = emulator->getLabelAddress(operands[0]);
     }
@@ -1,15 +1,42 @@
 #include "instructions/string.h"
 
 #include <algorithm>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 
 #include "emulator8086.h"
+#include "string_scan.h"
+
+namespace {
+
+// Copies `length` bytes with the result of moving them one at a time, ascending or, when
+// `descending`, from the top down. If the destination overlaps the part of the source still
+// to be read, those bytes repeat with a period of the distance between the two, so after
+// seeding one period the rest is filled by doubling.
+void copyOverlapping(uint8_t* dst, const uint8_t* src, size_t length, bool descending) {
+    if (!descending && src < dst && dst < src + length) {
+        size_t period = dst - src;
+        std::memcpy(dst, src, period);
+        for (size_t filled = period; filled < length; filled *= 2)
+            std::memcpy(dst + filled, dst, std::min(filled, length - filled));
+    } else if (descending && dst < src && src < dst + length) {
+        size_t period = src - dst;
+        std::memcpy(dst + length - period, src + length - period, period);
+        for (size_t filled = period; filled < length; filled *= 2) {
+            size_t chunk = std::min(filled, length - filled);
+            std::memcpy(dst + length - filled - chunk, dst + length - chunk, chunk);
+        }
+    } else {
+        std::memmove(dst, src, length);
+    }
+}
+
+}  // namespace
 
 StringInstructions::StringInstructions(Emulator8086* emu) : emulator(emu) {}
 
-void StringInstructions::movsb(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("MOVSB takes no operands");
+void StringInstructions::movsb(const Operands&) {
     uint8_t value = emulator->readMemoryByte(emulator->getRegisters().SI);
     emulator->writeMemoryByte(emulator->getRegisters().DI, value);
     int adjust = (emulator->getRegisters().FLAGS & Registers::DF) ? -1 : 1;
@@ -17,9 +44,7 @@ void StringInstructions::movsb(const std::vector<std::string>& operands) {
     emulator->getRegisters().DI += adjust;
 }
 
-void StringInstructions::movsw(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("MOVSW takes no operands");
+void StringInstructions::movsw(const Operands&) {
     uint16_t value = emulator->readMemoryWord(emulator->getRegisters().SI);
     emulator->writeMemoryWord(emulator->getRegisters().DI, value);
     int adjust = (emulator->getRegisters().FLAGS & Registers::DF) ? -2 : 2;
@@ -27,9 +52,7 @@ void StringInstructions::movsw(const std::vector<std::string>& operands) {
     emulator->getRegisters().DI += adjust;
 }
 
-void StringInstructions::cmpsb(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("CMPSB takes no operands");
+void StringInstructions::cmpsb(const Operands&) {
     uint8_t src = emulator->readMemoryByte(emulator->getRegisters().SI);
     uint8_t dest = emulator->readMemoryByte(emulator->getRegisters().DI);
     uint16_t result = src - dest;
@@ -39,9 +62,7 @@ void StringInstructions::cmpsb(const std::vector<std::string>& operands) {
     emulator->getRegisters().DI += adjust;
 }
 
-void StringInstructions::cmpsw(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("CMPSW takes no operands");
+void StringInstructions::cmpsw(const Operands&) {
     uint16_t src = emulator->readMemoryWord(emulator->getRegisters().SI);
     uint16_t dest = emulator->readMemoryWord(emulator->getRegisters().DI);
     uint32_t result = src - dest;
@@ -51,9 +72,7 @@ void StringInstructions::cmpsw(const std::vector<std::string>& operands) {
     emulator->getRegisters().DI += adjust;
 }
 
-void StringInstructions::scasb(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("SCASB takes no operands");
+void StringInstructions::scasb(const Operands&) {
     uint8_t dest = emulator->getRegisters().AX.bytes.l;
     uint8_t src = emulator->readMemoryByte(emulator->getRegisters().DI);
     uint16_t result = dest - src;
@@ -62,9 +81,7 @@ void StringInstructions::scasb(const std::vector<std::string>& operands) {
     emulator->getRegisters().DI += adjust;
 }
 
-void StringInstructions::scasw(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("SCASW takes no operands");
+void StringInstructions::scasw(const Operands&) {
     uint16_t dest = emulator->getRegisters().AX.x;
     uint16_t src = emulator->readMemoryWord(emulator->getRegisters().DI);
     uint32_t result = dest - src;
@@ -73,132 +90,244 @@ void StringInstructions::scasw(const std::vector<std::string>& operands) {
     emulator->getRegisters().DI += adjust;
 }
 
-void StringInstructions::lodsb(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("LODSB takes no operands");
+void StringInstructions::lodsb(const Operands&) {
     emulator->getRegisters().AX.bytes.l = emulator->readMemoryByte(emulator->getRegisters().SI);
     int adjust = (emulator->getRegisters().FLAGS & Registers::DF) ? -1 : 1;
     emulator->getRegisters().SI += adjust;
 }
 
-void StringInstructions::lodsw(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("LODSW takes no operands");
+void StringInstructions::lodsw(const Operands&) {
     emulator->getRegisters().AX.x = emulator->readMemoryWord(emulator->getRegisters().SI);
     int adjust = (emulator->getRegisters().FLAGS & Registers::DF) ? -2 : 2;
     emulator->getRegisters().SI += adjust;
 }
 
-void StringInstructions::stosb(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("STOSB takes no operands");
+void StringInstructions::stosb(const Operands&) {
     emulator->writeMemoryByte(emulator->getRegisters().DI, emulator->getRegisters().AX.bytes.l);
     int adjust = (emulator->getRegisters().FLAGS & Registers::DF) ? -1 : 1;
     emulator->getRegisters().DI += adjust;
 }
 
-void StringInstructions::stosw(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("STOSW takes no operands");
+void StringInstructions::stosw(const Operands&) {
     emulator->writeMemoryWord(emulator->getRegisters().DI, emulator->getRegisters().AX.x);
     int adjust = (emulator->getRegisters().FLAGS & Registers::DF) ? -2 : 2;
     emulator->getRegisters().DI += adjust;
 }
 
-void StringInstructions::rep(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("REP requires 1 string operation");
-
-    std::string op = operands[0];
-    std::transform(op.begin(), op.end(), op.begin(), ::toupper);
-
-    while (emulator->getRegisters().CX.x > 0) {
-        if (op == "MOVSB")
-            movsb({});
-        else if (op == "MOVSW")
-            movsw({});
-        else if (op == "STOSB")
-            stosb({});
-        else if (op == "STOSW")
-            stosw({});
-        else if (op == "LODSB")
-            lodsb({});
-        else if (op == "LODSW")
-            lodsw({});
-        else
-            throw std::runtime_error("REP not supported for " + op);
-
-        emulator->getRegisters().CX.x--;
+void StringInstructions::rep(const Operands& operands) {
+    Registers& regs = emulator->getRegisters();
+    if (regs.CX.x == 0)
+        return;
+
+    size_t chunk = std::min<size_t>(regs.CX.x, kRepeatChunk);
+    bool done = false;
+    void (StringInstructions::*element)(const Operands&) = nullptr;
+    switch (lookupMnemonic(operands[0])) {
+        case Opcode::Movsb:
+            done = bulkMove(1, chunk);
+            element = &StringInstructions::movsb;
+            break;
+        case Opcode::Movsw:
+            done = bulkMove(2, chunk);
+            element = &StringInstructions::movsw;
+            break;
+        case Opcode::Stosb:
+            done = bulkStore(1, chunk);
+            element = &StringInstructions::stosb;
+            break;
+        case Opcode::Stosw:
+            done = bulkStore(2, chunk);
+            element = &StringInstructions::stosw;
+            break;
+        case Opcode::Lodsb:
+            element = &StringInstructions::lodsb;
+            break;
+        case Opcode::Lodsw:
+            element = &StringInstructions::lodsw;
+            break;
+        default:
+            throw std::runtime_error("REP not supported for " + std::string(operands[0]));
     }
-}
 
-void StringInstructions::repe(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("REPE requires 1 string operation");
+    for (size_t i = 0; i < chunk && !done; ++i) {
+        (this->*element)({});
+        regs.CX.x--;
+        done = emulator->isWatchTriggered();
+    }
+    if (regs.CX.x > 0)
+        emulator->suspendRepeat();
+}
 
-    std::string op = operands[0];
-    std::transform(op.begin(), op.end(), op.begin(), ::toupper);
+bool StringInstructions::bulkMove(size_t size, size_t count) {
+    Registers& regs = emulator->getRegisters();
+    size_t length = count * size;
+    bool down = regs.FLAGS & Registers::DF;
+    size_t span = length - size;  // From the first element to the last.
+    if (down && (regs.SI < span || regs.DI < span))
+        return false;
+    uint16_t srcLow = static_cast<uint16_t>(down ? regs.SI - span : regs.SI);
+    uint16_t dstLow = static_cast<uint16_t>(down ? regs.DI - span : regs.DI);
+    const uint8_t* src = emulator->directMemory(srcLow, length, false);
+    uint8_t* dst = emulator->directMemory(dstLow, length, true);
+    if (!src || !dst)
+        return false;
+    // A destination less than one element ahead of the source in the copy direction reads
+    // half-written elements; leave that to the element loop.
+    if (down ? (dst < src && src - dst < static_cast<ptrdiff_t>(size))
+             : (src < dst && dst - src < static_cast<ptrdiff_t>(size)))
+        return false;
 
-    while (emulator->getRegisters().CX.x > 0) {
-        if (op == "CMPSB")
-            cmpsb({});
-        else if (op == "CMPSW")
-            cmpsw({});
-        else if (op == "SCASB")
-            scasb({});
-        else if (op == "SCASW")
-            scasw({});
-        else
-            throw std::runtime_error("REPE not supported for " + op);
+    copyOverlapping(dst, src, length, down);
+    uint16_t delta = static_cast<uint16_t>(length);
+    regs.SI = static_cast<uint16_t>(down ? regs.SI - delta : regs.SI + delta);
+    regs.DI = static_cast<uint16_t>(down ? regs.DI - delta : regs.DI + delta);
+    regs.CX.x = static_cast<uint16_t>(regs.CX.x - count);
+    return true;
+}
 
-        emulator->getRegisters().CX.x--;
+bool StringInstructions::bulkStore(size_t size, size_t count) {
+    Registers& regs = emulator->getRegisters();
+    size_t length = count * size;
+    bool down = regs.FLAGS & Registers::DF;
+    size_t span = length - size;
+    if (down && regs.DI < span)
+        return false;
+    uint16_t dstLow = static_cast<uint16_t>(down ? regs.DI - span : regs.DI);
+    uint8_t* dst = emulator->directMemory(dstLow, length, true);
+    if (!dst)
+        return false;
 
-        if (!(emulator->getRegisters().FLAGS & Registers::ZF))
-            break;
+    if (size == 1 || regs.AX.bytes.l == regs.AX.bytes.h) {
+        std::memset(dst, regs.AX.bytes.l, length);
+    } else {
+        dst[0] = regs.AX.bytes.l;
+        dst[1] = regs.AX.bytes.h;
+        for (size_t filled = 2; filled < length; filled *= 2)
+            std::memcpy(dst + filled, dst, std::min(filled, length - filled));
     }
+    uint16_t delta = static_cast<uint16_t>(length);
+    regs.DI = static_cast<uint16_t>(down ? regs.DI - delta : regs.DI + delta);
+    regs.CX.x = static_cast<uint16_t>(regs.CX.x - count);
+    return true;
 }
 
-void StringInstructions::repne(const std::vector<std::string>& operands) {
-    if (operands.size() != 1)
-        throw std::runtime_error("REPNE requires 1 string operation");
-
-    std::string op = operands[0];
-    std::transform(op.begin(), op.end(), op.begin(), ::toupper);
+void StringInstructions::repe(const Operands& operands) {
+    repeatCompare(operands[0], true);
+}
 
-    while (emulator->getRegisters().CX.x > 0) {
-        if (op == "CMPSB")
-            cmpsb({});
-        else if (op == "CMPSW")
-            cmpsw({});
-        else if (op == "SCASB")
-            scasb({});
-        else if (op == "SCASW")
-            scasw({});
-        else
-            throw std::runtime_error("REPNE not supported for " + op);
+void StringInstructions::repne(const Operands& operands) {
+    repeatCompare(operands[0], false);
+}
 
-        emulator->getRegisters().CX.x--;
+void StringInstructions::repeatCompare(std::string_view op, bool whileEqual) {
+    Registers& regs = emulator->getRegisters();
+    if (regs.CX.x == 0)
+        return;
 
-        if (emulator->getRegisters().FLAGS & Registers::ZF)
+    size_t chunk = std::min<size_t>(regs.CX.x, kRepeatChunk);
+    bool done = false;
+    void (StringInstructions::*element)(const Operands&) = nullptr;
+    switch (lookupMnemonic(op)) {
+        case Opcode::Cmpsb:
+            done = bulkCompare(false, 1, whileEqual, chunk);
+            element = &StringInstructions::cmpsb;
+            break;
+        case Opcode::Cmpsw:
+            done = bulkCompare(false, 2, whileEqual, chunk);
+            element = &StringInstructions::cmpsw;
+            break;
+        case Opcode::Scasb:
+            done = bulkCompare(true, 1, whileEqual, chunk);
+            element = &StringInstructions::scasb;
+            break;
+        case Opcode::Scasw:
+            done = bulkCompare(true, 2, whileEqual, chunk);
+            element = &StringInstructions::scasw;
             break;
+        default:
+            throw std::runtime_error(std::string(whileEqual ? "REPE" : "REPNE") +
+                                     " not supported for " + std::string(op));
     }
-}
 
-void StringInstructions::repnz(const std::vector<std::string>& operands) {
-    repne(operands);
+    for (size_t i = 0; i < chunk && !done; ++i) {
+        (this->*element)({});
+        regs.CX.x--;
+        done = emulator->isWatchTriggered() || bool(regs.FLAGS & Registers::ZF) != whileEqual;
+    }
+    // The last element run decides: a mismatch (REPE) or match (REPNE) ends the repeat.
+    if (regs.CX.x > 0 && bool(regs.FLAGS & Registers::ZF) == whileEqual)
+        emulator->suspendRepeat();
 }
 
-void StringInstructions::repz(const std::vector<std::string>& operands) {
-    repe(operands);
+bool StringInstructions::bulkCompare(bool scan, size_t size, bool whileEqual, size_t count) {
+    Registers& regs = emulator->getRegisters();
+    size_t length = count * size;
+    bool down = regs.FLAGS & Registers::DF;
+    size_t span = length - size;
+    if (down && (regs.DI < span || (!scan && regs.SI < span)))
+        return false;
+    const uint8_t* dst =
+        emulator->directMemory(static_cast<uint16_t>(down ? regs.DI - span : regs.DI), length,
+                               false);
+    const uint8_t* src = scan ? nullptr
+                              : emulator->directMemory(
+                                    static_cast<uint16_t>(down ? regs.SI - span : regs.SI),
+                                    length, false);
+    if (!dst || (!scan && !src))
+        return false;
+    uint16_t pattern = size == 1 ? regs.AX.bytes.l * 0x0101 : regs.AX.x;
+
+    // Byte offset of the element that ends the repeat, or `length` if every element runs.
+    // REPE ends at the first element with any differing byte; word REPNE needs both bytes of
+    // an element equal, so a half match resumes the search at the next element boundary.
+    size_t hit = length;
+    if (size == 1 || whileEqual) {
+        hit = scanBytes(dst, src, pattern, length, !whileEqual, down);
+        if (hit < length)
+            hit &= ~(size - 1);
+    } else {
+        size_t begin = 0;
+        size_t end = length;
+        while (begin < end) {
+            size_t at = begin + scanBytes(dst + begin, src ? src + begin : nullptr, pattern,
+                                          end - begin, true, down);
+            if (at == end)
+                break;
+            at &= ~size_t(1);
+            bool equal = src ? dst[at] == src[at] && dst[at + 1] == src[at + 1]
+                             : (dst[at] | (dst[at + 1] << 8)) == pattern;
+            if (equal) {
+                hit = at;
+                break;
+            }
+            if (down)
+                end = at;
+            else
+                begin = at + 2;
+        }
+    }
+
+    // Skip the elements that cannot end the repeat and run the last one for real, so its
+    // flags and the final registers come from the ordinary handler.
+    size_t executed = hit == length ? count : (down ? span - hit : hit) / size + 1;
+    uint16_t delta = static_cast<uint16_t>((executed - 1) * size);
+    regs.DI = static_cast<uint16_t>(down ? regs.DI - delta : regs.DI + delta);
+    if (!scan)
+        regs.SI = static_cast<uint16_t>(down ? regs.SI - delta : regs.SI + delta);
+    regs.CX.x = static_cast<uint16_t>(regs.CX.x - (executed - 1));
+    if (scan && size == 1)
+        scasb({});
+    else if (scan)
+        scasw({});
+    else if (size == 1)
+        cmpsb({});
+    else
+        cmpsw({});
+    regs.CX.x--;
+    return true;
 }
 
-void StringInstructions::xlat(const std::vector<std::string>& operands) {
-    if (!operands.empty())
-        throw std::runtime_error("XLAT takes no operands");
+void StringInstructions::xlat(const Operands&) {
     uint16_t address = emulator->getRegisters().BX.x + emulator->getRegisters().AX.bytes.l;
     emulator->getRegisters().AX.bytes.l = emulator->readMemoryByte(address);
 }
-
-void StringInstructions::xlatb(const std::vector<std::string>& operands) {
-    xlat(operands);
-}
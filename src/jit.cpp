@@ -0,0 +1,723 @@
+#include "jit.h"
+
+#include <algorithm>
+#include <cstddef>
+
+#include "emulator8086.h"
+#include "flag_liveness.h"
+#include "fusion.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#define IM8086_JIT_X86_64 1
+#endif
+
+namespace {
+
+// What the trampoline reads on entry and writes back on exit.
+struct Context {
+    Registers* regs;
+    uint64_t budget;  // Instructions left.
+    uint64_t line;    // Where execution continues.
+};
+
+constexpr size_t kCodeSize = 4 << 20;
+// Room a block may need: its instructions with their flag updates, the exits and the bail stub.
+constexpr size_t kBlockReserve = Jit::kMaxBlockLength * 48 + 256;
+
+enum Host : uint8_t {
+    RAX,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15,
+};
+
+// Register allocation while translated code runs. Guest registers use the encoding order of
+// FusedOperand (AX CX DX BX SP BP SI DI), which is the host's own apart from SP, so AL..BH
+// map to the host's byte registers without a REX prefix. R9 carries the exit line, R10 and
+// R11 are scratch, R12 points at the Context, R13 holds FLAGS, R14 the budget and R15 the
+// guest Registers.
+constexpr uint8_t kGuestHost[] = {RAX, RCX, RDX, RBX, R8, RBP, RSI, RDI};
+constexpr uint8_t kExitLine = R9;
+constexpr uint8_t kScratch = R10;
+constexpr uint8_t kScratch2 = R11;
+constexpr uint8_t kContext = R12;
+constexpr uint8_t kFlags = R13;
+constexpr uint8_t kBudget = R14;
+constexpr uint8_t kGuest = R15;
+
+const uint8_t kGuestOffset[] = {
+    offsetof(Registers, AX), offsetof(Registers, CX), offsetof(Registers, DX),
+    offsetof(Registers, BX), offsetof(Registers, SP), offsetof(Registers, BP),
+    offsetof(Registers, SI), offsetof(Registers, DI),
+};
+
+// Condition codes, as in Jcc = 0F 80+cc.
+constexpr uint8_t kBelow = 0x2;
+constexpr uint8_t kZero = 0x4;
+constexpr uint8_t kNotZero = 0x5;
+
+bool isBranch(Opcode opcode) {
+    if (opcode == Opcode::Invalid)
+        return false;
+    InstructionKind kind = instructionInfo(opcode).kind;
+    return kind == InstructionKind::Jump || kind == InstructionKind::CondJump ||
+           kind == InstructionKind::Loop;
+}
+
+bool isTranslatable(Opcode opcode) {
+    return opcode == Opcode::Mov || opcode == Opcode::Not || handlerFlagsWritten(opcode) != 0 ||
+           isBranch(opcode);
+}
+
+struct Step {
+    Opcode opcode = Opcode::Invalid;
+    bool byte = false;
+    FusedOperand dest;
+    FusedOperand src;
+    size_t target = 0;  // Branches.
+};
+
+// Decodes a line for translation; false when it has to stay with the interpreter.
+bool decodeStep(const std::vector<std::string>& program,
+                const std::vector<DecodedInstruction>& decoded,
+                const LabelMap& labels,
+                size_t line,
+                Step& step) {
+    step.opcode = decoded[line].opcode;
+    if (!isTranslatable(step.opcode))
+        return false;
+    Operands operands = decoded[line].operands(program[line]);
+    if (!isBranch(step.opcode))
+        return resolveRegisterOperands(step.opcode, operands, step.byte, step.dest, step.src);
+    // A branch to its own line falls through in the interpreter; leave it there.
+    auto label = operands.size() == 1 ? labels.find(operands[0]) : labels.end();
+    if (label == labels.end() || label->second == line)
+        return false;
+    step.target = label->second;
+    return true;
+}
+
+#if defined(IM8086_JIT_X86_64)
+class Assembler {
+  public:
+    Assembler(uint8_t* at, uint8_t* end) : at(at), end(end) {}
+
+    uint8_t* here() const {
+        return at;
+    }
+    bool overflowed() const {
+        return at > end;
+    }
+
+    void byte(uint8_t value) {
+        if (at < end)
+            *at = value;
+        ++at;
+    }
+    void word(uint16_t value) {
+        byte(value & 0xFF);
+        byte(value >> 8);
+    }
+    void dword(uint32_t value) {
+        word(value & 0xFFFF);
+        word(value >> 16);
+    }
+
+    // REX prefix when the operation is 64-bit or names R8-R15; `reg` is the ModRM reg field,
+    // `rm` the r/m field or base register.
+    void rex(bool wide, uint8_t reg, uint8_t rm) {
+        uint8_t prefix = 0x40 | (wide ? 8 : 0) | ((reg >> 3) << 2) | (rm >> 3);
+        if (prefix != 0x40)
+            byte(prefix);
+    }
+    void modrm(uint8_t mod, uint8_t reg, uint8_t rm) {
+        byte(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7)));
+    }
+    // [base + disp8]; R12 as a base needs a SIB byte.
+    void memory(uint8_t reg, uint8_t base, uint8_t disp) {
+        modrm(1, reg, base);
+        if ((base & 7) == RSP)
+            byte(0x24);
+        byte(disp);
+    }
+
+    void push(uint8_t reg) {
+        rex(false, 0, reg);
+        byte(0x50 + (reg & 7));
+    }
+    void pop(uint8_t reg) {
+        rex(false, 0, reg);
+        byte(0x58 + (reg & 7));
+    }
+    void load64(uint8_t dst, uint8_t base, uint8_t disp) {
+        rex(true, dst, base);
+        byte(0x8B);
+        memory(dst, base, disp);
+    }
+    void store64(uint8_t base, uint8_t disp, uint8_t src) {
+        rex(true, src, base);
+        byte(0x89);
+        memory(src, base, disp);
+    }
+    void load16(uint8_t dst, uint8_t base, uint8_t disp) {  // movzx r32, word [base + disp]
+        rex(false, dst, base);
+        byte(0x0F);
+        byte(0xB7);
+        memory(dst, base, disp);
+    }
+    void store16(uint8_t base, uint8_t disp, uint8_t src) {
+        byte(0x66);
+        rex(false, src, base);
+        byte(0x89);
+        memory(src, base, disp);
+    }
+    void movImmediate(uint8_t dst, uint32_t value) {  // mov r32, imm32
+        rex(false, 0, dst);
+        byte(0xB8 + (dst & 7));
+        dword(value);
+    }
+    void mov64(uint8_t dst, uint8_t src) {
+        rex(true, src, dst);
+        byte(0x89);
+        modrm(3, src, dst);
+    }
+
+    // reg, reg forms of the ALU: `op` is the r/m, reg opcode (ADD = 01, MOV = 89, ...).
+    void op32(uint8_t op, uint8_t dst, uint8_t src) {
+        rex(false, src, dst);
+        byte(op);
+        modrm(3, src, dst);
+    }
+    void op16(uint8_t op, uint8_t dst, uint8_t src) {
+        byte(0x66);
+        op32(op, dst, src);
+    }
+    void op8(uint8_t op, uint8_t dst, uint8_t src) {  // AL..BH only, so never a REX prefix.
+        byte(op);
+        modrm(3, src, dst);
+    }
+    // Group opcodes with a /digit in the reg field: 81 /n, F7 /n, FF /n, C1 /n, ...
+    void group32(uint8_t op, uint8_t digit, uint8_t dst) {
+        rex(false, 0, dst);
+        byte(op);
+        modrm(3, digit, dst);
+    }
+    void group64(uint8_t op, uint8_t digit, uint8_t dst) {
+        rex(true, 0, dst);
+        byte(op);
+        modrm(3, digit, dst);
+    }
+    void group16(uint8_t op, uint8_t digit, uint8_t dst) {
+        byte(0x66);
+        group32(op, digit, dst);
+    }
+    void group8(uint8_t op, uint8_t digit, uint8_t dst) {
+        byte(op);
+        modrm(3, digit, dst);
+    }
+
+    // Jcc rel32 / JMP rel32; returns the rel32 field for patch().
+    uint8_t* jcc(uint8_t condition) {
+        byte(0x0F);
+        byte(0x80 + condition);
+        uint8_t* field = at;
+        dword(0);
+        return field;
+    }
+    uint8_t* jmp() {
+        byte(0xE9);
+        uint8_t* field = at;
+        dword(0);
+        return field;
+    }
+    static void patch(uint8_t* field, const uint8_t* target) {
+        int32_t rel = static_cast<int32_t>(target - (field + 4));
+        for (int i = 0; i < 4; ++i)
+            field[i] = static_cast<uint8_t>(static_cast<uint32_t>(rel) >> (8 * i));
+    }
+
+  private:
+    uint8_t* at;
+    uint8_t* end;
+};
+
+// FLAGS = (FLAGS & ~mask) | (host flags & mask), straight after the operation.
+void emitFlagUpdate(Assembler& a, uint16_t mask) {
+    a.byte(0x9C);  // pushfq
+    a.pop(kScratch);
+    a.group32(0x81, 4, kScratch);  // and r10d, mask
+    a.dword(mask);
+    a.group32(0x81, 4, kFlags);  // and r13d, ~mask
+    a.dword(~static_cast<uint32_t>(mask));
+    a.op32(0x09, kFlags, kScratch);  // or r13d, r10d
+}
+
+// `src` is a register operand or the immediate to combine with `dest`.
+void emitOperation(Assembler& a,
+                   Opcode opcode,
+                   bool byte,
+                   const FusedOperand& dest,
+                   const FusedOperand& src) {
+    uint8_t d = byte ? dest.reg : kGuestHost[dest.reg];
+    uint8_t s = byte ? src.reg : kGuestHost[src.reg];
+    bool immediate = src.kind == FusedOperand::Immediate;
+
+    // Opcodes of the r/m, reg form and the /digit of the 81 (immediate) form.
+    uint8_t op = 0;
+    uint8_t digit = 0;
+    switch (opcode) {
+        case Opcode::Inc:
+        case Opcode::Dec:
+            digit = opcode == Opcode::Inc ? 0 : 1;
+            if (byte)
+                a.group8(0xFE, digit, d);
+            else
+                a.group16(0xFF, digit, d);
+            return;
+        case Opcode::Not:
+        case Opcode::Neg:
+            digit = opcode == Opcode::Not ? 2 : 3;
+            if (byte)
+                a.group8(0xF6, digit, d);
+            else
+                a.group16(0xF7, digit, d);
+            return;
+        case Opcode::Mov:
+            if (!immediate)
+                break;
+            if (byte) {
+                a.byte(0xB0 + d);
+                a.byte(static_cast<uint8_t>(src.value));
+            } else {
+                a.byte(0x66);
+                a.rex(false, 0, d);
+                a.byte(0xB8 + (d & 7));
+                a.word(src.value);
+            }
+            return;
+        case Opcode::Test:
+            if (!immediate)
+                break;
+            if (byte) {
+                a.group8(0xF6, 0, d);
+                a.byte(static_cast<uint8_t>(src.value));
+            } else {
+                a.group16(0xF7, 0, d);
+                a.word(src.value);
+            }
+            return;
+        default:
+            break;
+    }
+    switch (opcode) {
+        case Opcode::Mov:
+            op = 0x89;
+            break;
+        case Opcode::Test:
+            op = 0x85;
+            break;
+        case Opcode::Add:
+            op = 0x01, digit = 0;
+            break;
+        case Opcode::Or:
+            op = 0x09, digit = 1;
+            break;
+        case Opcode::And:
+            op = 0x21, digit = 4;
+            break;
+        case Opcode::Sub:
+            op = 0x29, digit = 5;
+            break;
+        case Opcode::Xor:
+            op = 0x31, digit = 6;
+            break;
+        case Opcode::Cmp:
+            op = 0x39, digit = 7;
+            break;
+        default:
+            return;
+    }
+    if (!immediate && byte) {
+        a.op8(op - 1, d, s);
+    } else if (!immediate) {
+        a.op16(op, d, s);
+    } else if (byte) {
+        a.group8(0x80, digit, d);
+        a.byte(static_cast<uint8_t>(src.value));
+    } else {
+        a.group16(0x81, digit, d);
+        a.word(src.value);
+    }
+}
+
+// Leaves host ZF so that the returned condition code holds when the branch is taken.
+uint8_t emitCondition(Assembler& a, Opcode opcode) {
+    uint16_t mask = 0;
+    bool whenSet = true;
+    switch (opcode) {
+        case Opcode::Je:
+        case Opcode::Jne:
+            mask = Registers::ZF, whenSet = opcode == Opcode::Je;
+            break;
+        case Opcode::Jb:
+        case Opcode::Jnb:
+            mask = Registers::CF, whenSet = opcode == Opcode::Jb;
+            break;
+        case Opcode::Jbe:
+        case Opcode::Ja:
+            mask = Registers::CF | Registers::ZF, whenSet = opcode == Opcode::Jbe;
+            break;
+        case Opcode::Js:
+        case Opcode::Jns:
+            mask = Registers::SF, whenSet = opcode == Opcode::Js;
+            break;
+        case Opcode::Jp:
+        case Opcode::Jnp:
+            mask = Registers::PF, whenSet = opcode == Opcode::Jp;
+            break;
+        case Opcode::Jo:
+        case Opcode::Jno:
+            mask = Registers::OF, whenSet = opcode == Opcode::Jo;
+            break;
+        case Opcode::Jcxz:
+            a.op16(0x85, kGuestHost[1], kGuestHost[1]);  // test cx, cx
+            return kZero;
+        default: {
+            // SF != OF: OF (bit 11) shifted onto SF (bit 7), xored with FLAGS.
+            a.op32(0x89, kScratch, kFlags);
+            a.group32(0xC1, 5, kScratch);  // shr r10d, 4
+            a.byte(4);
+            a.op32(0x31, kScratch, kFlags);
+            a.group32(0x81, 4, kScratch);  // and r10d, SF
+            a.dword(Registers::SF);
+            bool less = opcode == Opcode::Jl || opcode == Opcode::Jnl;
+            if (!less) {
+                a.op32(0x89, kScratch2, kFlags);
+                a.group32(0x81, 4, kScratch2);  // and r11d, ZF
+                a.dword(Registers::ZF);
+                a.op32(0x09, kScratch, kScratch2);
+            }
+            return opcode == Opcode::Jl || opcode == Opcode::Jle ? kNotZero : kZero;
+        }
+    }
+    a.group32(0xF7, 0, kFlags);  // test r13d, mask
+    a.dword(mask);
+    return whenSet ? kNotZero : kZero;
+}
+#endif
+
+}  // namespace
+
+Jit::Jit(Emulator8086* emulator) : emulator(emulator) {
+    flush();
+}
+
+Jit::~Jit() {
+#if defined(IM8086_JIT_X86_64)
+    if (code)
+        munmap(code, codeSize);
+#endif
+}
+
+bool Jit::isSupported() {
+#if defined(IM8086_JIT_X86_64)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void Jit::flush() {
+    const std::vector<DecodedInstruction>& decoded = emulator->getDecodedLines();
+    entries.assign(decoded.size(), nullptr);
+    heat.assign(decoded.size(), kHotThreshold);
+    const std::vector<std::string>& program = emulator->getProgram();
+    const LabelMap& labels = emulator->getLabels();
+    Step step;
+    for (size_t line = 0; line < decoded.size(); ++line) {
+        if (line == 0 || !decodeStep(program, decoded, labels, line - 1, step) ||
+            isBranch(step.opcode))
+            heat[line] = 0;
+    }
+    for (const auto& label : labels) {
+        if (label.second < heat.size())
+            heat[label.second] = 0;
+    }
+    unlinkedExits.clear();
+    linkedExits.clear();
+    translated.clear();
+    blocks = 0;
+    codeUsed = trampolineSize;
+}
+
+void Jit::invalidate(const std::vector<size_t>& lines) {
+    std::vector<size_t> starts;
+    for (size_t line : lines) {
+        size_t first = line >= kMaxBlockLength ? line - kMaxBlockLength + 1 : 0;
+        for (size_t start = first; start <= line && start < entries.size(); ++start) {
+            if (entries[start] && start + translated.at(start).length > line)
+                starts.push_back(start);
+        }
+    }
+    if (starts.empty())
+        return;
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+#if defined(IM8086_JIT_X86_64)
+    if (mprotect(code, codeSize, PROT_READ | PROT_WRITE) != 0) {
+        flush();
+        return;
+    }
+    for (size_t start : starts)
+        drop(start);
+    if (mprotect(code, codeSize, PROT_READ | PROT_EXEC) != 0)
+        flush();
+#endif
+}
+
+// The code stays where it is, unreachable, until the next flush.
+void Jit::drop(size_t start) {
+#if defined(IM8086_JIT_X86_64)
+    auto forget = [](std::unordered_map<size_t, std::vector<uint8_t*>>& exits,
+                     size_t line,
+                     uint8_t* field) {
+        auto found = exits.find(line);
+        if (found == exits.end())
+            return;
+        auto& fields = found->second;
+        fields.erase(std::remove(fields.begin(), fields.end(), field), fields.end());
+        if (fields.empty())
+            exits.erase(found);
+    };
+    auto block = translated.find(start);
+    for (const auto& [field, line] : block->second.exits) {
+        forget(linkedExits, line, field);
+        forget(unlinkedExits, line, field);
+    }
+    translated.erase(block);
+
+    auto linked = linkedExits.find(start);
+    if (linked != linkedExits.end()) {
+        auto& waiting = unlinkedExits[start];
+        for (uint8_t* field : linked->second) {
+            Assembler::patch(field, exitStub);
+            waiting.push_back(field);
+        }
+        linkedExits.erase(linked);
+    }
+    entries[start] = nullptr;
+    heat[start] = 0;
+    --blocks;
+#else
+    (void)start;
+#endif
+}
+
+bool Jit::allocate() {
+#if defined(IM8086_JIT_X86_64)
+    void* region =
+        mmap(nullptr, kCodeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+        return false;
+    code = static_cast<uint8_t*>(region);
+    codeSize = kCodeSize;
+    emitTrampoline();
+    return mprotect(code, codeSize, PROT_READ | PROT_EXEC) == 0;
+#else
+    return false;
+#endif
+}
+
+// void trampoline(Context* context, const uint8_t* block): loads the guest registers, jumps
+// to the block and, at the exit stub that follows, stores them back and returns. The exit
+// stub expects the next line in R9.
+void Jit::emitTrampoline() {
+#if defined(IM8086_JIT_X86_64)
+    Assembler a(code, code + codeSize);
+    for (uint8_t reg : {RBX, RBP, R12, R13, R14, R15})
+        a.push(reg);
+    a.mov64(kContext, RDI);
+    a.mov64(kScratch2, RSI);
+    a.load64(kGuest, kContext, offsetof(Context, regs));
+    a.load64(kBudget, kContext, offsetof(Context, budget));
+    for (size_t i = 0; i < 8; ++i)
+        a.load16(kGuestHost[i], kGuest, kGuestOffset[i]);
+    a.load16(kFlags, kGuest, offsetof(Registers, FLAGS));
+    a.group32(0xFF, 4, kScratch2);  // jmp r11
+
+    exitStub = a.here();
+    a.store64(kContext, offsetof(Context, line), kExitLine);
+    a.store64(kContext, offsetof(Context, budget), kBudget);
+    for (size_t i = 0; i < 8; ++i)
+        a.store16(kGuest, kGuestOffset[i], kGuestHost[i]);
+    a.store16(kGuest, offsetof(Registers, FLAGS), kFlags);
+    for (uint8_t reg : {R15, R14, R13, R12, RBP, RBX})
+        a.pop(reg);
+    a.byte(0xC3);  // ret
+    trampolineSize = codeUsed = static_cast<size_t>(a.here() - code);
+#endif
+}
+
+size_t Jit::enter(const uint8_t* block, Registers& regs, size_t budget) {
+#if defined(IM8086_JIT_X86_64)
+    Context context{&regs, budget, regs.IP};
+    auto trampoline = reinterpret_cast<void (*)(Context*, const uint8_t*)>(code);
+    trampoline(&context, block);
+    regs.IP = static_cast<uint16_t>(context.line);
+    return budget - context.budget;
+#else
+    (void)block;
+    (void)regs;
+    (void)budget;
+    return 0;
+#endif
+}
+
+bool Jit::translate(size_t start) {
+#if defined(IM8086_JIT_X86_64)
+    const std::vector<std::string>& program = emulator->getProgram();
+    const std::vector<DecodedInstruction>& decoded = emulator->getDecodedLines();
+    const LabelMap& labels = emulator->getLabels();
+
+    std::vector<Step> steps;
+    bool branch = false;
+    for (size_t line = start; line < program.size() && steps.size() < kMaxBlockLength &&
+                              !branch && !emulator->hasBreakpoint(line);
+         ++line) {
+        Step step;
+        if (!decodeStep(program, decoded, labels, line, step))
+            break;
+        branch = isBranch(step.opcode);
+        steps.push_back(step);
+    }
+    if (steps.empty())
+        return false;
+    size_t next = start + steps.size();
+    if (!branch && steps.size() == kMaxBlockLength && next < heat.size() && !entries[next])
+        heat[next] = 0;  // Straight-line code longer than a block goes on in a block of its own.
+
+    if (!code && !allocate())
+        return false;
+    if (codeSize - codeUsed < kBlockReserve)
+        flush();
+    if (mprotect(code, codeSize, PROT_READ | PROT_WRITE) != 0)
+        return false;
+
+    // Lines that skip dead flags need the horizon's worth of budget left after them, as in
+    // the interpreter.
+    const std::vector<uint16_t>& dead = emulator->getDeadFlags();
+    size_t needed = steps.size();
+    for (size_t i = 0; i < steps.size() && !dead.empty(); ++i) {
+        if (dead[start + i] != 0) {
+            needed += kFlagLivenessHorizon;
+            break;
+        }
+    }
+
+    Assembler a(code + codeUsed, code + codeSize);
+    uint8_t* entry = a.here();
+    a.group64(0x81, 7, kBudget);  // cmp r14, needed
+    a.dword(static_cast<uint32_t>(needed));
+    uint8_t* bail = a.jcc(kBelow);
+    a.group64(0x81, 5, kBudget);  // sub r14, n
+    a.dword(static_cast<uint32_t>(steps.size()));
+
+    std::vector<std::pair<uint8_t*, size_t>> exits;  // (jmp field, line)
+    auto exitTo = [&](size_t line) {
+        a.movImmediate(kExitLine, static_cast<uint32_t>(line));
+        exits.emplace_back(a.jmp(), line);
+    };
+    for (size_t i = 0; i < steps.size(); ++i) {
+        const Step& step = steps[i];
+        size_t line = start + i;
+        switch (instructionInfo(step.opcode).kind) {
+            case InstructionKind::Jump:
+                exitTo(step.target);
+                break;
+            case InstructionKind::CondJump: {
+                uint8_t* taken = a.jcc(emitCondition(a, step.opcode));
+                exitTo(line + 1);
+                Assembler::patch(taken, a.here());
+                exitTo(step.target);
+                break;
+            }
+            case InstructionKind::Loop: {
+                a.group16(0xFF, 1, kGuestHost[1]);  // dec cx
+                uint8_t* done = nullptr;
+                uint8_t* taken = nullptr;
+                if (step.opcode == Opcode::Loop) {
+                    taken = a.jcc(kNotZero);
+                } else {
+                    done = a.jcc(kZero);
+                    a.group32(0xF7, 0, kFlags);  // test r13d, ZF
+                    a.dword(Registers::ZF);
+                    taken = a.jcc(step.opcode == Opcode::Loopz ? kNotZero : kZero);
+                    Assembler::patch(done, a.here());
+                }
+                exitTo(line + 1);
+                Assembler::patch(taken, a.here());
+                exitTo(step.target);
+                break;
+            }
+            default:
+                emitOperation(a, step.opcode, step.byte, step.dest, step.src);
+                uint16_t mask = handlerFlagsWritten(step.opcode);
+                if (!dead.empty())
+                    mask &= ~dead[line];
+                if (mask != 0)
+                    emitFlagUpdate(a, mask);
+                break;
+        }
+    }
+    if (!branch)
+        exitTo(next);
+    Assembler::patch(bail, a.here());
+    a.movImmediate(kExitLine, static_cast<uint32_t>(start));
+    Assembler::patch(a.jmp(), exitStub);
+
+    if (a.overflowed()) {
+        mprotect(code, codeSize, PROT_READ | PROT_EXEC);
+        return false;
+    }
+    codeUsed = static_cast<size_t>(a.here() - code);
+    entries[start] = entry;
+    ++blocks;
+    for (const auto& [field, line] : exits) {
+        if (line < entries.size() && entries[line]) {
+            Assembler::patch(field, entries[line]);
+            linkedExits[line].push_back(field);
+        } else {
+            Assembler::patch(field, exitStub);
+            if (line < entries.size())
+                unlinkedExits[line].push_back(field);
+        }
+    }
+    auto waiting = unlinkedExits.find(start);
+    if (waiting != unlinkedExits.end()) {
+        auto& linked = linkedExits[start];
+        for (uint8_t* field : waiting->second) {
+            Assembler::patch(field, entry);
+            linked.push_back(field);
+        }
+        unlinkedExits.erase(waiting);
+    }
+    translated[start] = {steps.size(), std::move(exits)};
+    return mprotect(code, codeSize, PROT_READ | PROT_EXEC) == 0;
+#else
+    (void)start;
+    return false;
+#endif
+}
@@ -0,0 +1,262 @@
+#include "lockstep.h"
+
+#include <cstdio>
+#include <random>
+#include <sstream>
+
+namespace {
+
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+constexpr uint64_t kFnvPrime = 0x100000001b3ULL;
+constexpr size_t kMaxByteDifferences = 16;
+
+struct RegisterField {
+    const char* name;
+    uint16_t Registers::*field;
+};
+
+const RegisterField kRegisterFields[] = {
+    {"SI", &Registers::SI},
+    {"DI", &Registers::DI},
+    {"BP", &Registers::BP},
+    {"SP", &Registers::SP},
+    {"CS", &Registers::CS},
+    {"DS", &Registers::DS},
+    {"ES", &Registers::ES},
+    {"SS", &Registers::SS},
+    {"IP", &Registers::IP},
+    {"FLAGS", &Registers::FLAGS},
+};
+
+std::string hex(uint32_t value, int width) {
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%0*X", width, value);
+    return buffer;
+}
+
+void compareField(std::vector<std::string>& differences,
+                  const char* name,
+                  uint16_t reference,
+                  uint16_t candidate) {
+    if (reference != candidate)
+        differences.push_back(std::string(name) + ": " + hex(reference, 4) +
+                              " != " + hex(candidate, 4));
+}
+
+}  // namespace
+
+LockstepChecker::LockstepChecker(Emulator8086& reference, Emulator8086& candidate) {
+    sides[0].emu = &reference;
+    sides[1].emu = &candidate;
+    for (auto& side : sides)
+        side.stepper = [](Emulator8086& emu, DirtyPageTracker& tracker) { emu.run(tracker, 1); };
+}
+
+void LockstepChecker::load(const std::vector<std::string>& program) {
+    sides[0].emu->loadProgram(program);
+    load(sides[0].emu->getSharedProgram());
+}
+
+void LockstepChecker::load(const DecodedProgram& program) {
+    load(Program::create(program));
+}
+
+void LockstepChecker::load(const std::shared_ptr<const Program>& program) {
+    for (auto& side : sides) {
+        side.emu->reset();
+        side.emu->loadProgram(program);
+        rehashAll(side);
+    }
+}
+
+void LockstepChecker::rehashPage(Side& side, size_t page) {
+    const auto& memory = side.emu->getMemory();
+    uint64_t hash = kFnvOffset ^ page;
+    size_t base = page << DirtyPageTracker::kPageShift;
+    for (size_t i = 0; i < (size_t(1) << DirtyPageTracker::kPageShift); ++i) {
+        hash ^= memory[base + i];
+        hash *= kFnvPrime;
+    }
+    side.memoryHash ^= side.pageHashes[page] ^ hash;
+    side.pageHashes[page] = hash;
+}
+
+void LockstepChecker::rehashAll(Side& side) {
+    side.memoryHash = 0;
+    side.pageHashes.fill(0);
+    for (size_t page = 0; page < DirtyPageTracker::kPageCount; ++page)
+        rehashPage(side, page);
+}
+
+void LockstepChecker::compareRegisters(std::vector<std::string>& differences) const {
+    const Registers& a = sides[0].emu->getRegisters();
+    const Registers& b = sides[1].emu->getRegisters();
+    compareField(differences, "AX", a.AX.x, b.AX.x);
+    compareField(differences, "BX", a.BX.x, b.BX.x);
+    compareField(differences, "CX", a.CX.x, b.CX.x);
+    compareField(differences, "DX", a.DX.x, b.DX.x);
+    for (const auto& field : kRegisterFields)
+        compareField(differences, field.name, a.*field.field, b.*field.field);
+}
+
+void LockstepChecker::compareMemory(std::vector<std::string>& differences) const {
+    if (sides[0].memoryHash == sides[1].memoryHash)
+        return;
+    const auto& a = sides[0].emu->getMemory();
+    const auto& b = sides[1].emu->getMemory();
+    size_t reported = 0;
+    for (size_t page = 0; page < DirtyPageTracker::kPageCount; ++page) {
+        if (sides[0].pageHashes[page] == sides[1].pageHashes[page])
+            continue;
+        size_t base = page << DirtyPageTracker::kPageShift;
+        for (size_t i = 0; i < (size_t(1) << DirtyPageTracker::kPageShift); ++i) {
+            size_t address = base + i;
+            if (a[address] == b[address])
+                continue;
+            if (reported++ == kMaxByteDifferences) {
+                differences.push_back("... more memory differences");
+                return;
+            }
+            differences.push_back("[" + hex(static_cast<uint32_t>(address), 4) +
+                                  "]: " + hex(a[address], 2) + " != " + hex(b[address], 2));
+        }
+    }
+}
+
+LockstepResult LockstepChecker::run(uint64_t maxSteps) {
+    LockstepResult result;
+    compareRegisters(result.differences);
+    compareMemory(result.differences);
+    if (!result.differences.empty()) {
+        result.diverged = true;
+        result.instruction = "(initial state)";
+        return result;
+    }
+
+    const auto& program = sides[0].emu->getProgram();
+    while (result.steps < maxSteps) {
+        bool referenceDone = sides[0].emu->getIP() >= program.size();
+        bool candidateDone = sides[1].emu->getIP() >= sides[1].emu->getProgram().size();
+        if (referenceDone && candidateDone)
+            break;
+
+        result.line = sides[0].emu->getIP();
+        result.instruction = referenceDone ? "(halted)" : program[result.line];
+        if (referenceDone != candidateDone) {
+            result.diverged = true;
+            result.differences.push_back(referenceDone ? "reference halted, candidate did not"
+                                                       : "candidate halted, reference did not");
+            return result;
+        }
+
+        for (auto& side : sides) {
+            side.tracker.clear();
+            side.stepper(*side.emu, side.tracker);
+        }
+        for (auto& side : sides) {
+            for (size_t page : side.tracker.dirtyPages) {
+                rehashPage(sides[0], page);
+                rehashPage(sides[1], page);
+            }
+        }
+
+        compareRegisters(result.differences);
+        compareMemory(result.differences);
+        if (!result.differences.empty()) {
+            result.diverged = true;
+            return result;
+        }
+        ++result.steps;
+    }
+    return result;
+}
+
+std::string LockstepChecker::formatReport(const LockstepResult& result) {
+    std::ostringstream out;
+    if (!result.diverged) {
+        out << "Engines agree after " << result.steps << " instructions\n";
+        return out.str();
+    }
+    out << "Divergence after " << result.steps << " matching instructions\n"
+        << "  at line " << result.line << ": " << result.instruction << "\n";
+    for (const auto& difference : result.differences)
+        out << "    " << difference << "\n";
+    return out.str();
+}
+
+std::vector<std::string> generateRandomProgram(uint32_t seed, size_t length) {
+    static const char* const kReg16[] = {"AX", "BX", "CX", "DX", "SI", "DI", "BP"};
+    static const char* const kReg8[] = {"AL", "AH", "BL", "BH", "CL", "CH", "DL", "DH"};
+    static const char* const kAlu[] = {"MOV", "ADD", "SUB", "AND", "OR", "XOR", "CMP", "TEST"};
+    static const char* const kUnary[] = {"INC", "DEC", "NEG", "NOT"};
+    static const char* const kShift[] = {"SHL", "SHR", "SAR", "ROL", "ROR", "RCL", "RCR"};
+    static const char* const kMemory[] = {"[BX]", "[SI]", "[DI]", "[BX+SI]", "[BX+DI+10h]"};
+    static const char* const kJumps[] = {"JE", "JNE", "JB", "JNB", "JS", "JNS", "JL", "JG"};
+    static const char* const kNullary[] = {"CLC", "STC", "CMC", "CBW", "CWD", "LAHF", "SAHF"};
+
+    std::mt19937 rng(seed);
+    auto pick = [&](const auto& table) {
+        return table[rng() % (sizeof(table) / sizeof(table[0]))];
+    };
+    auto imm16 = [&] { return "0" + hex(rng() & 0xFFFF, 4) + "h"; };
+    auto imm8 = [&] { return "0" + hex(rng() & 0xFF, 2) + "h"; };
+
+    std::vector<std::string> program;
+    std::vector<std::pair<size_t, std::string>> pendingLabels;
+    size_t labelCount = 0;
+
+    for (size_t i = 0; i < length; ++i) {
+        for (auto it = pendingLabels.begin(); it != pendingLabels.end();) {
+            if (it->first == i) {
+                program.push_back(it->second + ":");
+                it = pendingLabels.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        std::string line;
+        switch (rng() % 10) {
+            case 0:
+            case 1:
+                line = std::string(pick(kAlu)) + " " + pick(kReg16) + ", " +
+                       (rng() % 2 ? std::string(pick(kReg16)) : imm16());
+                break;
+            case 2:
+                line = std::string(pick(kAlu)) + " " + pick(kReg8) + ", " +
+                       (rng() % 2 ? std::string(pick(kReg8)) : imm8());
+                break;
+            case 3:
+                line = std::string(rng() % 2 ? "MOV " : "ADD ") + pick(kMemory) + ", " +
+                       (rng() % 2 ? pick(kReg16) : pick(kReg8));
+                break;
+            case 4:
+                line = std::string("MOV ") + pick(kReg16) + ", " + pick(kMemory);
+                break;
+            case 5:
+                line = std::string(pick(kUnary)) + " " + (rng() % 2 ? pick(kReg16) : pick(kReg8));
+                break;
+            case 6:
+                line = std::string(pick(kShift)) + " " + (rng() % 2 ? pick(kReg16) : pick(kReg8)) +
+                       (rng() % 2 ? ", 1" : ", CL");
+                break;
+            case 7:
+                line = std::string(rng() % 2 ? "PUSH " : "POP ") + pick(kReg16);
+                break;
+            case 8: {
+                std::string label = "L" + std::to_string(labelCount++);
+                pendingLabels.emplace_back(i + 1 + rng() % 6, label);
+                line = std::string(pick(kJumps)) + " " + label;
+                break;
+            }
+            default:
+                line = pick(kNullary);
+                break;
+        }
+        program.push_back(line);
+    }
+    for (const auto& pending : pendingLabels)
+        program.push_back(pending.second + ":");
+    program.push_back("NOP");
+    return program;
+}
@@ -1,20 +1,154 @@
-#include <fstream>
+#include <cstdio>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "dos_loader.h"
 #include "emulator8086.h"
 #include "ide_tui.h"
+#include "opcode_profile.h"
+#include "program_image.h"
 #include "tui.h"
 #include "version.h"
 #ifdef WITH_GUI
 int main_gui(int argc, char* argv[]);
 #endif
 
+namespace {
+
+const char* describeStop(Emulator8086::StopReason reason) {
+    switch (reason) {
+        case Emulator8086::StopReason::StepLimit:
+            return "step limit reached";
+        case Emulator8086::StopReason::EndOfProgram:
+            return "end of program";
+        case Emulator8086::StopReason::Breakpoint:
+            return "breakpoint";
+        case Emulator8086::StopReason::Watchpoint:
+            return "watchpoint";
+    }
+    return "";
+}
+
+// --run <file> and --batch <file>...: load through the program image cache, run headless and
+// report. Options: --max N caps the instructions per program, --no-cache always parses,
+// --fusion FILE fuses only the instruction pairs listed in FILE and --no-fusion none.
+// --no-jit keeps hot blocks in the interpreter instead of translating them to host code.
+// --no-flag-liveness computes every flag, even ones that are overwritten before being read.
+// --opcode-profile FILE counts the instruction mix over all the programs, prints a ranked
+// report and writes the counts to FILE in the format --fusion reads.
+int runHeadless(int argc, char** argv) {
+    bool batch = std::string(argv[1]) == "--batch";
+    size_t maxSteps = 100000000;
+    bool useCache = true;
+    bool useFusion = true;
+    bool useJit = true;
+    bool useFlagLiveness = true;
+    std::string fusionProfile;
+    std::string opcodeProfilePath;
+    std::vector<std::string> files;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max" && i + 1 < argc)
+            maxSteps = std::stoull(argv[++i], nullptr, 0);
+        else if (arg == "--no-cache")
+            useCache = false;
+        else if (arg == "--no-fusion")
+            useFusion = false;
+        else if (arg == "--no-jit")
+            useJit = false;
+        else if (arg == "--no-flag-liveness")
+            useFlagLiveness = false;
+        else if (arg == "--fusion" && i + 1 < argc)
+            fusionProfile = argv[++i];
+        else if (arg == "--opcode-profile" && i + 1 < argc)
+            opcodeProfilePath = argv[++i];
+        else
+            files.push_back(arg);
+    }
+    if (files.empty() || (!batch && files.size() > 1)) {
+        std::cerr << "Usage: " << argv[0] << " --run <file> | --batch <file>... [--max N] "
+                  << "[--no-cache] [--fusion FILE | --no-fusion] [--no-jit] "
+                  << "[--no-flag-liveness] [--opcode-profile FILE]\n";
+        return 2;
+    }
+
+    FusionCandidates fusion = useFusion ? FusionCandidates::all() : FusionCandidates::none();
+    if (useFusion && !fusionProfile.empty()) {
+        try {
+            fusion = FusionCandidates::load(fusionProfile);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    ProgramCache cache(useCache ? ProgramCache::defaultDirectory() : std::string());
+    std::unique_ptr<OpcodeProfile> opcodeProfile;
+    if (!opcodeProfilePath.empty())
+        opcodeProfile = std::make_unique<OpcodeProfile>();
+    int failures = 0;
+    for (const auto& file : files) {
+        Emulator8086 emu;
+        emu.setFusionCandidates(fusion);
+        emu.setJitEnabled(useJit);
+        emu.setFlagLivenessEnabled(useFlagLiveness);
+        bool hit = false;
+        SourceLoadStats stats;
+        try {
+            emu.loadProgram(cache.load(file, &hit, &stats));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
+            ++failures;
+            continue;
+        }
+        size_t retired = 0;
+        if (opcodeProfile) {
+            opcodeProfile->attach(emu.getProgram());
+            OpcodeProfileInstrumentation policy(*opcodeProfile);
+            retired = emu.run(policy, maxSteps);
+        } else {
+            retired = emu.run(maxSteps);
+        }
+        const Registers& regs = emu.getRegisters();
+        char line[160];
+        std::snprintf(line,
+                      sizeof(line),
+                      "%s: %zu instructions, %s, AX=%04X BX=%04X CX=%04X DX=%04X (%s %.1f ms)",
+                      file.c_str(),
+                      retired,
+                      describeStop(emu.getStopReason()),
+                      regs.AX.x,
+                      regs.BX.x,
+                      regs.CX.x,
+                      regs.DX.x,
+                      hit ? "image" : "parsed",
+                      stats.seconds * 1e3);
+        std::cout << line << "\n";
+        if (!batch)
+            emu.displayRegisters();
+    }
+    if (opcodeProfile) {
+        std::cout << "\n";
+        opcodeProfile->writeReport(std::cout);
+        if (!opcodeProfile->exportData(opcodeProfilePath)) {
+            std::cerr << "Cannot write opcode profile: " << opcodeProfilePath << "\n";
+            return 1;
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+}  // namespace
+
 int main(int argc, char** argv) {
     Emulator8086 emu;
 
+    if (argc >= 2 && (std::string(argv[1]) == "--run" || std::string(argv[1]) == "--batch"))
+        return runHeadless(argc, argv);
+
 #ifdef WITH_GUI
     if (argc >= 2 && std::string(argv[1]) == "--gui") {
         return main_gui(argc, argv);
@@ -31,17 +165,17 @@ int main(int argc, char** argv) {
 
 #ifdef WITH_TUI
     if (argc >= 3 && std::string(argv[1]) == "--tui") {
-        std::ifstream fin(argv[2]);
-        if (!fin) {
-            std::cerr << "Failed to open program file: " << argv[2] << "\n";
+        try {
+            // DOS binaries are placed in memory for inspection; execution is text-only.
+            if (isExecutablePath(argv[2]))
+                loadExecutableFile(emu, argv[2]);
+            else
+                emu.loadProgram(loadSourceFile(argv[2]));
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << "\n";
             return 1;
         }
-        std::vector<std::string> lines;
-        std::string line;
-        while (std::getline(fin, line))
-            lines.push_back(line);
-        emu.loadProgram(lines);
-        EmulatorTUI tui(&emu);
+        EmulatorTUI tui(&emu, argv[2]);
         tui.run();
         return 0;
     }
@@ -54,6 +188,14 @@ int main(int argc, char** argv) {
         std::cout << "\n";
         std::cout << "Usage:\n";
         std::cout << "  " << argv[0] << "                    - Interactive command line mode\n";
+        std::cout << "  " << argv[0] << " --run <file>      - Run headless and print registers\n";
+        std::cout << "  " << argv[0] << " --batch <files>   - Run each program, one line each\n";
+        std::cout << "      [--max N] [--no-cache]   - Step limit; bypass the .i86img cache\n";
+        std::cout << "      [--fusion FILE]          - Fuse only the instruction pairs in FILE\n";
+        std::cout << "      [--no-fusion]            - Run every instruction on its own\n";
+        std::cout << "      [--no-jit]               - Interpret hot blocks instead of compiling\n";
+        std::cout << "      [--no-flag-liveness]     - Compute flags nothing reads\n";
+        std::cout << "      [--opcode-profile FILE]  - Count opcode n-grams; write them to FILE\n";
 #ifdef WITH_GUI
         std::cout << "  " << argv[0] << " --gui             - Modern GUI mode with SDL2/ImGui\n";
         std::cout << "  " << argv[0] << " --gui <file>      - GUI mode with assembly file loaded\n";
@@ -63,6 +205,8 @@ int main(int argc, char** argv) {
                   << " --ide             - IDE mode with integrated editor and debugger\n";
         std::cout << "  " << argv[0]
                   << " --tui <file>      - TUI debugger mode with assembly file\n";
+        std::cout << "  " << argv[0]
+                  << " --tui <prog.com>  - Inspect a DOS .COM/.EXE loaded at PSP 0100h\n";
 #endif
 
 #ifdef WITH_GUI
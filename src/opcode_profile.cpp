@@ -0,0 +1,260 @@
+#include "opcode_profile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iomanip>
+
+#include "operands.h"
+
+namespace {
+
+constexpr const char* kModeNames[] = {
+    "reg8",   "reg16",   "segment",      "immediate",         "direct", "indirect",
+    "based",  "indexed", "based-indexed", "based-indexed-disp", "label",
+};
+static_assert(sizeof(kModeNames) / sizeof(kModeNames[0]) == OpcodeProfile::kModeCount,
+              "Every addressing mode needs a name");
+
+constexpr const char* kWidthNames[] = {"byte", "word", "none"};
+
+bool isAnyOf(std::string_view text, std::initializer_list<std::string_view> names) {
+    for (std::string_view name : names) {
+        if (equalsIgnoreCase(text, name))
+            return true;
+    }
+    return false;
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+        text.remove_prefix(1);
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back())))
+        text.remove_suffix(1);
+    return text;
+}
+
+OpcodeProfile::Mode classifyMemory(std::string_view inner) {
+    bool base = false;
+    bool index = false;
+    bool displacement = false;
+    size_t start = 0;
+    while (start <= inner.size()) {
+        size_t end = inner.find_first_of("+-", start);
+        if (end == std::string_view::npos)
+            end = inner.size();
+        std::string_view part = trim(inner.substr(start, end - start));
+        start = end + 1;
+        if (part.empty())
+            continue;
+        if (isAnyOf(part, {"BX", "BP"}))
+            base = true;
+        else if (isAnyOf(part, {"SI", "DI"}))
+            index = true;
+        else
+            displacement = true;
+    }
+    using Mode = OpcodeProfile::Mode;
+    if (base && index)
+        return displacement ? Mode::BasedIndexedOffset : Mode::BasedIndexed;
+    if (base || index) {
+        if (!displacement)
+            return Mode::RegisterIndirect;
+        return base ? Mode::Based : Mode::Indexed;
+    }
+    return Mode::Direct;
+}
+
+// Byte or word from the operands, falling back to a string instruction's suffix.
+OpcodeProfile::Width widthOf(const InstructionInfo& info, const uint8_t* modes, size_t count) {
+    using Mode = OpcodeProfile::Mode;
+    bool word = false;
+    for (size_t i = 0; i < count; ++i) {
+        Mode mode = static_cast<Mode>(modes[i]);
+        if (mode == Mode::Register8)
+            return OpcodeProfile::Width::Byte;
+        if (mode != Mode::Immediate && mode != Mode::Label)
+            word = true;
+    }
+    if (word)
+        return OpcodeProfile::Width::Word;
+    if (info.group == InstructionGroup::String && info.mnemonic.size() == 5) {
+        char suffix = info.mnemonic.back();
+        if (suffix == 'B')
+            return OpcodeProfile::Width::Byte;
+        if (suffix == 'W')
+            return OpcodeProfile::Width::Word;
+    }
+    return OpcodeProfile::Width::None;
+}
+
+}  // namespace
+
+OpcodeProfile::OpcodeProfile()
+    : unigrams(kOpcodeCount),
+      bigrams(kOpcodeCount * kOpcodeCount),
+      trigrams(kOpcodeCount * kOpcodeCount * kOpcodeCount),
+      modes(kOpcodeCount * kModeCount) {}
+
+void OpcodeProfile::attach(const std::vector<std::string>& program) {
+    lines.assign(program.size(), LineInfo());
+    for (size_t i = 0; i < program.size(); ++i) {
+        DecodedInstruction decoded = decodeInstruction(program[i]);
+        LineInfo& info = lines[i];
+        info.opcode = decoded.opcode;
+        if (decoded.opcode == Opcode::Invalid)
+            continue;
+        const InstructionInfo& instruction = instructionInfo(decoded.opcode);
+        Operands operands = decoded.operands(program[i]);
+        if (instruction.kind == InstructionKind::Repeat) {
+            // The operand is the repeated instruction, which decides the width.
+            Opcode inner = operands.empty() ? Opcode::Invalid : lookupMnemonic(operands[0]);
+            if (inner != Opcode::Invalid)
+                info.width = widthOf(instructionInfo(inner), nullptr, 0);
+            continue;
+        }
+        info.modeCount = static_cast<uint8_t>(std::min<size_t>(operands.size(), 2));
+        for (size_t j = 0; j < info.modeCount; ++j)
+            info.modes[j] = static_cast<uint8_t>(classifyOperand(operands[j]));
+        info.width = widthOf(instruction, info.modes, info.modeCount);
+    }
+    previous = kNone;
+    beforePrevious = kNone;
+}
+
+void OpcodeProfile::reset() {
+    std::fill(unigrams.begin(), unigrams.end(), 0);
+    std::fill(bigrams.begin(), bigrams.end(), 0);
+    std::fill(trigrams.begin(), trigrams.end(), 0);
+    std::fill(modes.begin(), modes.end(), 0);
+    std::fill(std::begin(widths), std::end(widths), 0);
+    total = 0;
+    previous = kNone;
+    beforePrevious = kNone;
+}
+
+uint64_t OpcodeProfile::count(Opcode a, Opcode b) const {
+    return bigrams[static_cast<size_t>(a) * kOpcodeCount + static_cast<size_t>(b)];
+}
+
+uint64_t OpcodeProfile::count(Opcode a, Opcode b, Opcode c) const {
+    size_t pair = static_cast<size_t>(a) * kOpcodeCount + static_cast<size_t>(b);
+    return trigrams[pair * kOpcodeCount + static_cast<size_t>(c)];
+}
+
+std::vector<OpcodeProfile::Gram> OpcodeProfile::ranked(size_t length) const {
+    const std::vector<uint64_t>& counts =
+        length == 1 ? unigrams : length == 2 ? bigrams : trigrams;
+    std::vector<Gram> grams;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] == 0)
+            continue;
+        Gram gram;
+        size_t rest = i;
+        for (size_t k = length; k > 0; --k) {
+            gram.ops[k - 1] = static_cast<Opcode>(rest % kOpcodeCount);
+            rest /= kOpcodeCount;
+        }
+        gram.count = counts[i];
+        grams.push_back(gram);
+    }
+    std::stable_sort(grams.begin(), grams.end(),
+                     [](const Gram& a, const Gram& b) { return a.count > b.count; });
+    return grams;
+}
+
+OpcodeProfile::Mode OpcodeProfile::classifyOperand(std::string_view operand) {
+    operand = trim(operand);
+    if (!operand.empty() && operand.front() == '[' && operand.back() == ']')
+        return classifyMemory(operand.substr(1, operand.size() - 2));
+    if (isAnyOf(operand, {"AL", "AH", "BL", "BH", "CL", "CH", "DL", "DH"}))
+        return Mode::Register8;
+    if (isAnyOf(operand, {"AX", "BX", "CX", "DX", "SI", "DI", "BP", "SP"}))
+        return Mode::Register16;
+    if (isAnyOf(operand, {"CS", "DS", "ES", "SS"}))
+        return Mode::Segment;
+    if (!operand.empty() && (std::isdigit(static_cast<unsigned char>(operand.front())) ||
+                             operand.front() == '-' || operand.front() == '+'))
+        return Mode::Immediate;
+    return Mode::Label;
+}
+
+const char* OpcodeProfile::modeName(Mode mode) {
+    return kModeNames[static_cast<size_t>(mode)];
+}
+
+void OpcodeProfile::writeReport(std::ostream& out, size_t top) const {
+    auto percent = [this](uint64_t count) {
+        return total ? 100.0 * static_cast<double>(count) / static_cast<double>(total) : 0.0;
+    };
+    out << std::fixed << std::setprecision(2);
+    out << "Retired instructions: " << total << "\n";
+
+    const char* titles[] = {"Opcodes", "Bigrams", "Trigrams"};
+    for (size_t length = 1; length <= 3; ++length) {
+        std::vector<Gram> grams = ranked(length);
+        out << "\n" << titles[length - 1] << " (" << grams.size() << " distinct):\n";
+        for (size_t i = 0; i < grams.size() && i < top; ++i) {
+            std::string name;
+            for (size_t k = 0; k < length; ++k)
+                name += (k ? " " : "") + std::string(instructionInfo(grams[i].ops[k]).mnemonic);
+            out << "  " << std::left << std::setw(24) << name << std::right << std::setw(12)
+                << grams[i].count << std::setw(8) << percent(grams[i].count) << "%\n";
+        }
+    }
+
+    out << "\nAddressing modes:\n";
+    std::vector<std::pair<uint64_t, size_t>> byMode;
+    for (size_t mode = 0; mode < kModeCount; ++mode) {
+        uint64_t sum = 0;
+        for (size_t op = 0; op < kOpcodeCount; ++op)
+            sum += modes[op * kModeCount + mode];
+        if (sum)
+            byMode.emplace_back(sum, mode);
+    }
+    std::stable_sort(byMode.begin(), byMode.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+    for (const auto& [count, mode] : byMode)
+        out << "  " << std::left << std::setw(24) << kModeNames[mode] << std::right
+            << std::setw(12) << count << "\n";
+
+    out << "\nOperand width:\n";
+    for (size_t width = 0; width < 3; ++width)
+        out << "  " << std::left << std::setw(24) << kWidthNames[width] << std::right
+            << std::setw(12) << widths[width] << std::setw(8) << percent(widths[width]) << "%\n";
+    if (widths[0] + widths[1])
+        out << "  8-bit share of sized instructions: "
+            << 100.0 * static_cast<double>(widths[0]) / static_cast<double>(widths[0] + widths[1])
+            << "%\n";
+    out << std::defaultfloat;
+}
+
+void OpcodeProfile::writeData(std::ostream& out) const {
+    out << "# im8086 opcode profile: " << total << " instructions\n";
+    const char* tags[] = {"op", "pair", "triple"};
+    for (size_t length = 1; length <= 3; ++length) {
+        for (const Gram& gram : ranked(length)) {
+            out << tags[length - 1];
+            for (size_t k = 0; k < length; ++k)
+                out << ' ' << instructionInfo(gram.ops[k]).mnemonic;
+            out << ' ' << gram.count << '\n';
+        }
+    }
+    for (size_t op = 0; op < kOpcodeCount; ++op) {
+        for (size_t mode = 0; mode < kModeCount; ++mode) {
+            if (uint64_t count = modes[op * kModeCount + mode])
+                out << "mode " << instructionInfo(static_cast<Opcode>(op)).mnemonic << ' '
+                    << kModeNames[mode] << ' ' << count << '\n';
+        }
+    }
+    for (size_t width = 0; width < 3; ++width)
+        out << "width " << kWidthNames[width] << ' ' << widths[width] << '\n';
+}
+
+bool OpcodeProfile::exportData(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    writeData(out);
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,98 @@
+#include "operands.h"
+
+#include <cctype>
+#include <climits>
+#include <stdexcept>
+
+namespace {
+
+char upper(char ch) {
+    return (ch >= 'a' && ch <= 'z') ? static_cast<char>(ch - 'a' + 'A') : ch;
+}
+
+int digitValue(char ch) {
+    if (ch >= '0' && ch <= '9')
+        return ch - '0';
+    ch = upper(ch);
+    if (ch >= 'A' && ch <= 'Z')
+        return ch - 'A' + 10;
+    return 36;
+}
+
+}  // namespace
+
+Operands::Operands(std::initializer_list<std::string_view> list) {
+    for (std::string_view operand : list)
+        push_back(operand);
+}
+
+void Operands::push_back(std::string_view operand) {
+    if (count == kCapacity)
+        throw std::runtime_error("Too many operands");
+    items[count++] = operand;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (upper(a[i]) != upper(b[i]))
+            return false;
+    }
+    return true;
+}
+
+bool CaseInsensitiveLess::operator()(std::string_view a, std::string_view b) const {
+    size_t common = a.size() < b.size() ? a.size() : b.size();
+    for (size_t i = 0; i < common; ++i) {
+        char x = upper(a[i]);
+        char y = upper(b[i]);
+        if (x != y)
+            return static_cast<unsigned char>(x) < static_cast<unsigned char>(y);
+    }
+    return a.size() < b.size();
+}
+
+NumberParse parseIntegerPrefix(std::string_view text, int base, long& value) {
+    size_t i = 0;
+    while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i])))
+        ++i;
+    bool negative = false;
+    if (i < text.size() && (text[i] == '+' || text[i] == '-'))
+        negative = text[i++] == '-';
+    if (base == 16 && i + 2 < text.size() && text[i] == '0' && upper(text[i + 1]) == 'X' &&
+        digitValue(text[i + 2]) < 16)
+        i += 2;
+
+    size_t first = i;
+    unsigned long magnitude = 0;
+    bool overflow = false;
+    const unsigned long limit = negative ? static_cast<unsigned long>(LONG_MAX) + 1 : LONG_MAX;
+    for (; i < text.size(); ++i) {
+        int digit = digitValue(text[i]);
+        if (digit >= base)
+            break;
+        if (magnitude > (limit - digit) / base)
+            overflow = true;
+        else
+            magnitude = magnitude * base + digit;
+    }
+    if (i == first)
+        return NumberParse::Invalid;
+    if (overflow)
+        return NumberParse::OutOfRange;
+    value = negative ? static_cast<long>(0 - magnitude) : static_cast<long>(magnitude);
+    return NumberParse::Ok;
+}
+
+long parseImmediate(std::string_view operand, bool hex) {
+    if (hex)
+        operand.remove_suffix(1);
+    long value = 0;
+    NumberParse parsed = parseIntegerPrefix(operand, hex ? 16 : 10, value);
+    if (parsed == NumberParse::Invalid)
+        throw std::runtime_error("Invalid immediate value: " + std::string(operand));
+    if (parsed == NumberParse::OutOfRange || (!hex && (value > INT_MAX || value < INT_MIN)))
+        throw std::runtime_error("Immediate value out of range: " + std::string(operand));
+    return value;
+}
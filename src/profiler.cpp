@@ -0,0 +1,488 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+enum Condition : uint8_t {
+    CondNone,
+    CondZ,
+    CondNZ,
+    CondL,
+    CondNL,
+    CondLE,
+    CondG,
+    CondB,
+    CondNB,
+    CondBE,
+    CondA,
+    CondP,
+    CondNP,
+    CondO,
+    CondNO,
+    CondS,
+    CondNS,
+    CondCXZ,
+    CondLoop,
+    CondLoopZ,
+    CondLoopNZ,
+};
+
+Condition conditionFor(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::Je:
+            return CondZ;
+        case Opcode::Jne:
+            return CondNZ;
+        case Opcode::Jl:
+            return CondL;
+        case Opcode::Jnl:
+            return CondNL;
+        case Opcode::Jle:
+            return CondLE;
+        case Opcode::Jg:
+            return CondG;
+        case Opcode::Jb:
+            return CondB;
+        case Opcode::Jnb:
+            return CondNB;
+        case Opcode::Jbe:
+            return CondBE;
+        case Opcode::Ja:
+            return CondA;
+        case Opcode::Jp:
+            return CondP;
+        case Opcode::Jnp:
+            return CondNP;
+        case Opcode::Jo:
+            return CondO;
+        case Opcode::Jno:
+            return CondNO;
+        case Opcode::Js:
+            return CondS;
+        case Opcode::Jns:
+            return CondNS;
+        case Opcode::Jcxz:
+            return CondCXZ;
+        case Opcode::Loop:
+            return CondLoop;
+        case Opcode::Loopz:
+            return CondLoopZ;
+        case Opcode::Loopnz:
+            return CondLoopNZ;
+        default:
+            return CondNone;
+    }
+}
+
+// Per-iteration cost of a repeated string primitive, added on top of the REP base.
+uint32_t repIterationCycles(const std::string& op) {
+    if (op == "MOVSB" || op == "MOVSW")
+        return 17;
+    if (op == "STOSB" || op == "STOSW")
+        return 10;
+    if (op == "LODSB" || op == "LODSW")
+        return 13;
+    if (op == "CMPSB" || op == "CMPSW")
+        return 22;
+    if (op == "SCASB" || op == "SCASW")
+        return 15;
+    return 0;
+}
+
+bool is8BitOperand(const std::string& operand) {
+    static const char* regs8[] = {"AL", "AH", "BL", "BH", "CL", "CH", "DL", "DH"};
+    for (const char* r : regs8) {
+        if (operand == r)
+            return true;
+    }
+    return false;
+}
+
+std::string trim(const std::string& s) {
+    size_t b = s.find_first_not_of(" \t");
+    if (b == std::string::npos)
+        return "";
+    size_t e = s.find_last_not_of(" \t");
+    return s.substr(b, e - b + 1);
+}
+
+}  // namespace
+
+void Profiler::attach(const std::vector<std::string>& program,
+                      const LabelMap& labels,
+                      const std::vector<size_t>& sourceLines) {
+    lines.assign(program.size(), LineInfo());
+    sourceLineMap = sourceLines;
+    labelAt.clear();
+    for (const auto& label : labels) {
+        if (!labelAt.count(label.second))
+            labelAt[label.second] = label.first;
+    }
+
+    for (size_t i = 0; i < program.size(); ++i) {
+        LineInfo& info = lines[i];
+        std::istringstream iss(program[i]);
+        std::string mnemonic;
+        iss >> mnemonic;
+        std::string rest;
+        std::getline(iss, rest);
+        std::string upperOperand = trim(rest);
+        std::transform(upperOperand.begin(), upperOperand.end(), upperOperand.begin(), ::toupper);
+
+        // Costs and kinds come from the instruction table.
+        info.opcode = lookupMnemonic(mnemonic);
+        if (info.opcode != Opcode::Invalid) {
+            const InstructionInfo& entry = instructionInfo(info.opcode);
+            info.kind = entry.kind;
+            info.baseCycles = entry.baseCycles;
+            info.extraCycles = entry.extraCycles;
+            info.condition = conditionFor(info.opcode);
+        }
+
+        if (info.kind == InstructionKind::Shift) {
+            info.countInCl = upperOperand.size() >= 2 &&
+                             upperOperand.compare(upperOperand.size() - 2, 2, "CL") == 0;
+        } else if (info.kind == InstructionKind::Repeat) {
+            info.extraCycles = repIterationCycles(upperOperand);
+        } else if (info.opcode == Opcode::Mul || info.opcode == Opcode::Imul ||
+                   info.opcode == Opcode::Div || info.opcode == Opcode::Idiv) {
+            if (is8BitOperand(upperOperand)) {
+                info.baseCycles = info.opcode == Opcode::Mul    ? 70
+                                  : info.opcode == Opcode::Imul ? 80
+                                  : info.opcode == Opcode::Div  ? 80
+                                                                : 101;
+            }
+        }
+
+        if (program[i].find('[') != std::string::npos)
+            info.baseCycles += 8;
+    }
+
+    reset();
+}
+
+void Profiler::reset() {
+    lineCosts.assign(lines.size(), Cost());
+    branches.clear();
+    total = Cost();
+    functions.clear();
+    functionEntry.clear();
+    functionIds.clear();
+    activeFrames.clear();
+    stack.clear();
+    selfCosts.clear();
+    callEdges.clear();
+    foldedPaths.clear();
+    foldedCycles.clear();
+    foldedIds.clear();
+    currentLine = 0;
+    pushFrame("(program)", 0);
+}
+
+size_t Profiler::functionId(const std::string& name) {
+    auto it = functionIds.find(name);
+    if (it != functionIds.end())
+        return it->second;
+    size_t id = functions.size();
+    functions.push_back(FunctionStats());
+    functions.back().name = name;
+    functionEntry.push_back(0);
+    activeFrames.push_back(0);
+    functionIds[name] = id;
+    return id;
+}
+
+size_t Profiler::foldedId(const std::string& path) {
+    auto it = foldedIds.find(path);
+    if (it != foldedIds.end())
+        return it->second;
+    size_t id = foldedPaths.size();
+    foldedPaths.push_back(path);
+    foldedCycles.push_back(0);
+    foldedIds[path] = id;
+    return id;
+}
+
+void Profiler::pushFrame(const std::string& name, size_t entryLine) {
+    size_t fn = functionId(name);
+    functions[fn].calls++;
+    if (functions[fn].calls == 1)
+        functionEntry[fn] = entryLine;
+    activeFrames[fn]++;
+
+    Frame frame;
+    frame.function = fn;
+    frame.callLine = currentLine;
+    frame.entry = total;
+    frame.foldedKey = foldedId(stack.empty() ? name : foldedPaths[stack.back().foldedKey] + ";" +
+                                                          name);
+    stack.push_back(frame);
+}
+
+void Profiler::popFrame() {
+    if (stack.size() <= 1)
+        return;
+    Frame frame = stack.back();
+    stack.pop_back();
+
+    Cost inclusive;
+    inclusive.instructions = total.instructions - frame.entry.instructions;
+    inclusive.cycles = total.cycles - frame.entry.cycles;
+
+    if (activeFrames[frame.function] == 1) {
+        functions[frame.function].inclusive.instructions += inclusive.instructions;
+        functions[frame.function].inclusive.cycles += inclusive.cycles;
+    }
+    activeFrames[frame.function]--;
+
+    CallEdge& edge =
+        callEdges[std::make_tuple(stack.back().function, frame.callLine, frame.function)];
+    edge.count++;
+    edge.inclusive.instructions += inclusive.instructions;
+    edge.inclusive.cycles += inclusive.cycles;
+}
+
+bool Profiler::conditionTaken(const LineInfo& info, const Registers& before) const {
+    uint16_t f = before.FLAGS;
+    bool zf = f & Registers::ZF;
+    bool sf = f & Registers::SF;
+    bool of = f & Registers::OF;
+    bool cf = f & Registers::CF;
+    bool pf = f & Registers::PF;
+    uint16_t cx = before.CX.x;
+    switch (info.condition) {
+        case CondZ:
+            return zf;
+        case CondNZ:
+            return !zf;
+        case CondL:
+            return sf != of;
+        case CondNL:
+            return sf == of;
+        case CondLE:
+            return zf || sf != of;
+        case CondG:
+            return !zf && sf == of;
+        case CondB:
+            return cf;
+        case CondNB:
+            return !cf;
+        case CondBE:
+            return cf || zf;
+        case CondA:
+            return !cf && !zf;
+        case CondP:
+            return pf;
+        case CondNP:
+            return !pf;
+        case CondO:
+            return of;
+        case CondNO:
+            return !of;
+        case CondS:
+            return sf;
+        case CondNS:
+            return !sf;
+        case CondCXZ:
+            return cx == 0;
+        case CondLoop:
+            return static_cast<uint16_t>(cx - 1) != 0;
+        case CondLoopZ:
+            return static_cast<uint16_t>(cx - 1) != 0 && zf;
+        case CondLoopNZ:
+            return static_cast<uint16_t>(cx - 1) != 0 && !zf;
+        default:
+            return false;
+    }
+}
+
+uint32_t Profiler::cyclesFor(const LineInfo& info,
+                             const Registers& before,
+                             const Registers& after,
+                             bool taken) const {
+    switch (info.kind) {
+        case InstructionKind::CondJump:
+        case InstructionKind::Loop:
+            return info.baseCycles + (taken ? info.extraCycles : 0);
+        case InstructionKind::Int:
+            if (info.opcode == Opcode::Into)
+                return info.baseCycles + (taken ? info.extraCycles : 0);
+            return info.baseCycles;
+        case InstructionKind::Shift:
+            if (info.countInCl)
+                return info.baseCycles + 6 + 4u * (before.CX.bytes.l & 0x1F);
+            return info.baseCycles;
+        case InstructionKind::Repeat: {
+            uint16_t iterations = static_cast<uint16_t>(before.CX.x - after.CX.x);
+            return info.baseCycles + info.extraCycles * iterations;
+        }
+        default:
+            return info.baseCycles;
+    }
+}
+
+void Profiler::onRetire(size_t line, const Registers& before, const Registers& after) {
+    if (line >= lines.size())
+        return;
+    const LineInfo& info = lines[line];
+    currentLine = line;
+
+    bool taken = false;
+    if (info.kind == InstructionKind::CondJump || info.kind == InstructionKind::Loop) {
+        taken = conditionTaken(info, before);
+        BranchStats& b = branches[line];
+        if (taken)
+            b.taken++;
+        else
+            b.notTaken++;
+    } else if (info.kind == InstructionKind::Int && info.opcode == Opcode::Into) {
+        taken = before.FLAGS & Registers::OF;
+    }
+
+    uint32_t cycles = cyclesFor(info, before, after, taken);
+    lineCosts[line].instructions++;
+    lineCosts[line].cycles += cycles;
+    total.instructions++;
+    total.cycles += cycles;
+
+    const Frame& top = stack.back();
+    functions[top.function].exclusive.instructions++;
+    functions[top.function].exclusive.cycles += cycles;
+    Cost& self = selfCosts[(static_cast<uint64_t>(top.function) << 32) | line];
+    self.instructions++;
+    self.cycles += cycles;
+    foldedCycles[top.foldedKey] += cycles;
+
+    switch (info.kind) {
+        case InstructionKind::Call: {
+            // A CALL that failed, e.g. to an unknown label, carries on at the next line without
+            // pushing a return address and so enters no function.
+            if (after.IP == line + 1 || after.SP != static_cast<uint16_t>(before.SP - 2))
+                break;
+            size_t target = after.IP;
+            auto label = labelAt.find(target);
+            pushFrame(label != labelAt.end() ? label->second : "line_" + std::to_string(target),
+                      target);
+            break;
+        }
+        // INT and INTO are simulated in place and carry on at the next line, so they stay in
+        // the caller's frame; an IRET has no interrupt frame to leave either.
+        case InstructionKind::Ret:
+            popFrame();
+            break;
+        default:
+            break;
+    }
+}
+
+size_t Profiler::sourceLine(size_t line) const {
+    if (line < sourceLineMap.size())
+        return sourceLineMap[line];
+    return line + 1;
+}
+
+std::vector<Profiler::FunctionStats> Profiler::getFunctionStats() const {
+    std::vector<FunctionStats> result = functions;
+    std::vector<bool> counted(functions.size(), false);
+    for (const Frame& frame : stack) {
+        if (counted[frame.function])
+            continue;
+        counted[frame.function] = true;
+        result[frame.function].inclusive.instructions +=
+            total.instructions - frame.entry.instructions;
+        result[frame.function].inclusive.cycles += total.cycles - frame.entry.cycles;
+    }
+    return result;
+}
+
+std::vector<size_t> Profiler::hottestLines(size_t count) const {
+    std::vector<size_t> order;
+    for (size_t i = 0; i < lineCosts.size(); ++i) {
+        if (lineCosts[i].instructions > 0)
+            order.push_back(i);
+    }
+    count = std::min(count, order.size());
+    std::partial_sort(order.begin(), order.begin() + count, order.end(), [this](size_t a, size_t b) {
+        if (lineCosts[a].cycles != lineCosts[b].cycles)
+            return lineCosts[a].cycles > lineCosts[b].cycles;
+        return a < b;
+    });
+    order.resize(count);
+    return order;
+}
+
+void Profiler::writeFolded(std::ostream& out) const {
+    for (size_t i = 0; i < foldedPaths.size(); ++i) {
+        if (foldedCycles[i] > 0)
+            out << foldedPaths[i] << ' ' << foldedCycles[i] << '\n';
+    }
+}
+
+void Profiler::writeCallgrind(std::ostream& out, const std::string& sourceName) const {
+    auto edges = callEdges;
+    for (size_t i = 1; i < stack.size(); ++i) {
+        CallEdge& edge =
+            edges[std::make_tuple(stack[i - 1].function, stack[i].callLine, stack[i].function)];
+        edge.count++;
+        edge.inclusive.instructions += total.instructions - stack[i].entry.instructions;
+        edge.inclusive.cycles += total.cycles - stack[i].entry.cycles;
+    }
+
+    out << "# callgrind format\n";
+    out << "version: 1\n";
+    out << "creator: Im8086\n";
+    out << "positions: line\n";
+    out << "events: Ir Cycles\n";
+    out << "summary: " << total.instructions << ' ' << total.cycles << "\n\n";
+    out << "fl=" << sourceName << "\n";
+
+    std::map<size_t, std::vector<std::pair<size_t, Cost>>> selfByFunction;
+    for (const auto& entry : selfCosts) {
+        size_t fn = static_cast<size_t>(entry.first >> 32);
+        size_t line = static_cast<size_t>(entry.first & 0xFFFFFFFFu);
+        selfByFunction[fn].push_back({line, entry.second});
+    }
+
+    for (size_t fn = 0; fn < functions.size(); ++fn) {
+        out << "fn=" << functions[fn].name << "\n";
+        auto self = selfByFunction[fn];
+        std::sort(self.begin(), self.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+        for (const auto& cost : self) {
+            out << sourceLine(cost.first) << ' ' << cost.second.instructions << ' '
+                << cost.second.cycles << "\n";
+        }
+        for (const auto& edge : edges) {
+            if (std::get<0>(edge.first) != fn)
+                continue;
+            size_t callee = std::get<2>(edge.first);
+            out << "cfn=" << functions[callee].name << "\n";
+            out << "calls=" << edge.second.count << ' ' << sourceLine(functionEntry[callee])
+                << "\n";
+            out << sourceLine(std::get<1>(edge.first)) << ' ' << edge.second.inclusive.instructions
+                << ' ' << edge.second.inclusive.cycles << "\n";
+        }
+        out << "\n";
+    }
+}
+
+bool Profiler::exportFolded(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    writeFolded(out);
+    return static_cast<bool>(out);
+}
+
+bool Profiler::exportCallgrind(const std::string& path, const std::string& sourceName) const {
+    std::ofstream out(path);
+    if (!out)
+        return false;
+    writeCallgrind(out, sourceName);
+    return static_cast<bool>(out);
+}
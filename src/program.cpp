@@ -0,0 +1,30 @@
+#include "program.h"
+
+Program::Program(DecodedProgram decoded, ProgramTables tables)
+    : lines(std::move(decoded.instructions)),
+      decodedLines(std::move(tables.decodedLines)),
+      sourceLines(std::move(decoded.sourceLines)),
+      labels(std::move(decoded.labels)),
+      fusedLines(std::move(tables.fusedLines)),
+      deadFlags(std::move(tables.deadFlags)) {
+    if (decodedLines.size() != lines.size()) {
+        decodedLines.resize(lines.size());
+        for (size_t i = 0; i < lines.size(); ++i)
+            decodedLines[i] = decodeInstruction(lines[i]);
+    }
+    if (fusedLines.size() != lines.size())
+        fusedLines = fuseProgram(lines, decodedLines, labels, FusionCandidates::all());
+    if (deadFlags.size() != lines.size())
+        deadFlags = getFlagFlow().findDeadFlagWrites({});
+}
+
+const FlagFlowGraph& Program::getFlagFlow() const {
+    std::call_once(flagFlowBuilt,
+                   [this] { flagFlow = FlagFlowGraph(lines, decodedLines, labels); });
+    return flagFlow;
+}
+
+const std::shared_ptr<const Program>& Program::empty() {
+    static const std::shared_ptr<const Program> program = create(DecodedProgram());
+    return program;
+}
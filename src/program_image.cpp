@@ -0,0 +1,357 @@
+#include "program_image.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kMagic[8] = {'I', '8', '6', 'I', 'M', 'G', '\0', '\0'};
+constexpr uint32_t kByteOrderMark = 0x01020304;
+
+size_t alignTo8(size_t offset) {
+    return (offset + 7) & ~size_t(7);
+}
+
+template <typename T>
+bool tableFits(uint64_t offset, uint64_t count, uint64_t size) {
+    return offset % alignof(T) == 0 && offset <= size && count <= (size - offset) / sizeof(T);
+}
+
+ImageDecoded toImage(const DecodedInstruction& decoded) {
+    ImageDecoded entry{};
+    entry.opcode = static_cast<uint8_t>(decoded.opcode);
+    entry.operandCount = decoded.operandCount;
+    for (size_t i = 0; i < Operands::kCapacity; ++i) {
+        entry.operandStart[i] = decoded.operandStart[i];
+        entry.operandLength[i] = decoded.operandLength[i];
+    }
+    return entry;
+}
+
+ImageFusedOperand toImage(const FusedOperand& operand) {
+    return {static_cast<uint8_t>(operand.kind), operand.reg, operand.value};
+}
+
+ImageFused toImage(size_t line, const FusedPair& pair) {
+    ImageFused entry{};
+    entry.line = static_cast<uint32_t>(line);
+    entry.first = static_cast<uint8_t>(pair.first);
+    entry.second = static_cast<uint8_t>(pair.second);
+    entry.byte = pair.byte;
+    entry.secondByte = pair.secondByte;
+    entry.dest = toImage(pair.dest);
+    entry.src = toImage(pair.src);
+    entry.secondDest = toImage(pair.secondDest);
+    entry.secondSrc = toImage(pair.secondSrc);
+    entry.target = pair.target;
+    return entry;
+}
+
+bool validOperand(const ImageFusedOperand& operand) {
+    return operand.kind <= FusedOperand::Immediate && operand.reg < 8;
+}
+
+FusedOperand fromImage(const ImageFusedOperand& operand) {
+    FusedOperand result;
+    result.kind = static_cast<FusedOperand::Kind>(operand.kind);
+    result.reg = operand.reg;
+    result.value = operand.value;
+    return result;
+}
+
+}  // namespace
+
+uint64_t hashSource(std::string_view text) {
+    uint64_t hash = 0xCBF29CE484222325ull ^ text.size();
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 29;
+    }
+    for (; i < text.size(); ++i) {
+        hash ^= static_cast<uint8_t>(text[i]);
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+uint64_t hashInstructionTable() {
+    static const uint64_t hash = [] {
+        std::string text = std::to_string(kFlagLivenessHorizon);
+        for (const InstructionInfo& info : kInstructionTable) {
+            text += info.mnemonic;
+            for (unsigned value : {unsigned(info.minOperands),
+                                   unsigned(info.maxOperands),
+                                   unsigned(info.flagsRead),
+                                   unsigned(info.flagsWritten),
+                                   unsigned(info.kind)})
+                text += "," + std::to_string(value);
+            text += ";";
+        }
+        return hashSource(text);
+    }();
+    return hash;
+}
+
+ProgramImage::ProgramImage(const std::string& path) : file(path) {
+    std::string_view data = file.view();
+    if (data.size() < sizeof(ImageHeader))
+        throw std::runtime_error("Program image is truncated: " + path);
+    header = reinterpret_cast<const ImageHeader*>(data.data());
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0)
+        throw std::runtime_error("Not a program image: " + path);
+    if (header->version != kVersion || header->byteOrder != kByteOrderMark ||
+        header->tableHash != hashInstructionTable())
+        throw std::runtime_error("Unsupported program image version: " + path);
+
+    uint64_t size = data.size();
+    uint64_t count = header->instructionCount;
+    bool valid =
+        header->fileSize == size && header->stringsOffset <= size &&
+        tableFits<ImageInstruction>(header->instructionsOffset, count, size) &&
+        tableFits<ImageDecoded>(header->decodedOffset, count, size) &&
+        tableFits<ImageLabel>(header->labelsOffset, header->labelCount, size) &&
+        tableFits<ImageFused>(header->fusedOffset, header->fusedCount, size) &&
+        tableFits<uint16_t>(header->deadFlagsOffset, count, size);
+    if (!valid)
+        throw std::runtime_error("Program image is corrupt: " + path);
+
+    instructions =
+        reinterpret_cast<const ImageInstruction*>(data.data() + header->instructionsOffset);
+    decoded = reinterpret_cast<const ImageDecoded*>(data.data() + header->decodedOffset);
+    labels = reinterpret_cast<const ImageLabel*>(data.data() + header->labelsOffset);
+    fused = reinterpret_cast<const ImageFused*>(data.data() + header->fusedOffset);
+    deadFlags = reinterpret_cast<const uint16_t*>(data.data() + header->deadFlagsOffset);
+    strings = data.substr(header->stringsOffset);
+}
+
+std::string_view ProgramImage::poolString(uint64_t offset, uint32_t length) const {
+    if (offset > strings.size() || length > strings.size() - offset)
+        throw std::runtime_error("Program image string out of range");
+    return strings.substr(offset, length);
+}
+
+std::string_view ProgramImage::instruction(size_t index) const {
+    return poolString(instructions[index].textOffset, instructions[index].textLength);
+}
+
+std::string_view ProgramImage::labelName(size_t index) const {
+    return poolString(labels[index].nameOffset, labels[index].nameLength);
+}
+
+std::shared_ptr<const Program> ProgramImage::toProgram() const {
+    size_t count = instructionCount();
+    DecodedProgram program;
+    ProgramTables tables;
+    program.instructions.reserve(count);
+    program.sourceLines.reserve(count);
+    tables.decodedLines.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        program.instructions.emplace_back(instruction(i));
+        program.sourceLines.push_back(sourceLine(i));
+
+        const ImageDecoded& entry = decoded[i];
+        if (entry.opcode > kOpcodeCount || entry.operandCount > Operands::kCapacity)
+            throw std::runtime_error("Program image instruction out of range");
+        DecodedInstruction& line = tables.decodedLines[i];
+        line.opcode = static_cast<Opcode>(entry.opcode);
+        line.operandCount = entry.operandCount;
+        for (size_t k = 0; k < entry.operandCount; ++k) {
+            uint32_t length = instructions[i].textLength;
+            if (entry.operandStart[k] > length ||
+                entry.operandLength[k] > length - entry.operandStart[k])
+                throw std::runtime_error("Program image operand out of range");
+            line.operandStart[k] = entry.operandStart[k];
+            line.operandLength[k] = entry.operandLength[k];
+        }
+    }
+    for (size_t i = 0; i < labelCount(); ++i)
+        program.labels.emplace_hint(program.labels.end(), labelName(i), labelIndex(i));
+
+    tables.fusedLines.resize(count);
+    for (size_t i = 0; i < header->fusedCount; ++i) {
+        const ImageFused& entry = fused[i];
+        bool valid = entry.line + size_t(1) < count && entry.first < kOpcodeCount &&
+                     entry.second < kOpcodeCount && entry.target <= count &&
+                     validOperand(entry.dest) && validOperand(entry.src) &&
+                     validOperand(entry.secondDest) && validOperand(entry.secondSrc);
+        if (!valid)
+            throw std::runtime_error("Program image fused pair out of range");
+        FusedPair& pair = tables.fusedLines[entry.line];
+        pair.first = static_cast<Opcode>(entry.first);
+        pair.second = static_cast<Opcode>(entry.second);
+        pair.byte = entry.byte != 0;
+        pair.secondByte = entry.secondByte != 0;
+        pair.dest = fromImage(entry.dest);
+        pair.src = fromImage(entry.src);
+        pair.secondDest = fromImage(entry.secondDest);
+        pair.secondSrc = fromImage(entry.secondSrc);
+        pair.target = entry.target;
+    }
+    tables.deadFlags.assign(deadFlags, deadFlags + count);
+    return Program::create(std::move(program), std::move(tables));
+}
+
+void ProgramImage::write(const std::string& path,
+                         const Program& program,
+                         std::string_view source,
+                         size_t sourceLineCount) {
+    const std::vector<std::string>& lines = program.getLines();
+    std::vector<ImageInstruction> instructionTable;
+    std::vector<ImageDecoded> decodedTable;
+    std::vector<ImageLabel> labelTable;
+    std::vector<ImageFused> fusedTable;
+    std::string pool;
+    instructionTable.reserve(lines.size());
+    decodedTable.reserve(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i) {
+        instructionTable.push_back({pool.size(),
+                                    static_cast<uint32_t>(lines[i].size()),
+                                    static_cast<uint32_t>(program.getSourceLines()[i])});
+        decodedTable.push_back(toImage(program.getDecodedLines()[i]));
+        pool += lines[i];
+        const FusedPair& pair = program.getFusedPairs()[i];
+        if (pair.first != Opcode::Invalid)
+            fusedTable.push_back(toImage(i, pair));
+    }
+    for (const auto& [name, index] : program.getLabels()) {
+        labelTable.push_back({pool.size(), static_cast<uint32_t>(name.size()), 0, index});
+        pool += name;
+    }
+    const std::vector<uint16_t>& deadFlagTable = program.getDeadFlags();
+
+    ImageHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.sourceHash = hashSource(source);
+    header.sourceSize = source.size();
+    header.tableHash = hashInstructionTable();
+    header.sourceLineCount = sourceLineCount;
+    header.instructionCount = lines.size();
+    header.labelCount = labelTable.size();
+    header.fusedCount = fusedTable.size();
+    header.instructionsOffset = alignTo8(sizeof(ImageHeader));
+    header.decodedOffset =
+        alignTo8(header.instructionsOffset + instructionTable.size() * sizeof(ImageInstruction));
+    header.labelsOffset =
+        alignTo8(header.decodedOffset + decodedTable.size() * sizeof(ImageDecoded));
+    header.fusedOffset = alignTo8(header.labelsOffset + labelTable.size() * sizeof(ImageLabel));
+    header.deadFlagsOffset =
+        alignTo8(header.fusedOffset + fusedTable.size() * sizeof(ImageFused));
+    header.stringsOffset = header.deadFlagsOffset + deadFlagTable.size() * sizeof(uint16_t);
+    header.fileSize = header.stringsOffset + pool.size();
+
+    // Written beside the target and renamed into place so readers never map a partial image.
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("Failed to write program image: " + path);
+        uint64_t position = 0;
+        auto writeAt = [&](uint64_t offset, const void* data, size_t bytes) {
+            const char padding[8] = {};
+            out.write(padding, offset - position);
+            out.write(static_cast<const char*>(data), bytes);
+            position = offset + bytes;
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.instructionsOffset,
+                instructionTable.data(),
+                instructionTable.size() * sizeof(ImageInstruction));
+        writeAt(header.decodedOffset,
+                decodedTable.data(),
+                decodedTable.size() * sizeof(ImageDecoded));
+        writeAt(header.labelsOffset, labelTable.data(), labelTable.size() * sizeof(ImageLabel));
+        writeAt(header.fusedOffset, fusedTable.data(), fusedTable.size() * sizeof(ImageFused));
+        writeAt(header.deadFlagsOffset,
+                deadFlagTable.data(),
+                deadFlagTable.size() * sizeof(uint16_t));
+        writeAt(header.stringsOffset, pool.data(), pool.size());
+        if (!out)
+            throw std::runtime_error("Failed to write program image: " + path);
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error("Failed to write program image: " + path);
+    }
+}
+
+std::string ProgramCache::defaultDirectory() {
+    if (const char* dir = std::getenv("IM8086_CACHE_DIR"))
+        return dir;
+    if (const char* dir = std::getenv("XDG_CACHE_HOME"))
+        return std::string(dir) + "/im8086";
+    if (const char* home = std::getenv("HOME"))
+        return std::string(home) + "/.cache/im8086";
+    if (const char* local = std::getenv("LOCALAPPDATA"))
+        return std::string(local) + "/im8086";
+    return "";
+}
+
+ProgramCache::ProgramCache(std::string directory) : directory(std::move(directory)) {}
+
+std::string ProgramCache::imagePath(uint64_t sourceHash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.i86img", static_cast<unsigned long long>(sourceHash));
+    return directory + "/" + name;
+}
+
+std::shared_ptr<const Program> ProgramCache::load(const std::string& sourcePath,
+                                                  bool* hit,
+                                                  SourceLoadStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    MappedFile source(sourcePath);
+    if (hit)
+        *hit = false;
+    if (directory.empty())
+        return Program::create(decodeSource(source.view(), SourceLoadOptions(), stats));
+
+    uint64_t hash = hashSource(source.view());
+    std::string path = imagePath(hash);
+    std::error_code error;
+    if (std::filesystem::exists(path, error)) {
+        try {
+            ProgramImage image(path);
+            const ImageHeader& header = image.getHeader();
+            if (header.sourceHash == hash && header.sourceSize == source.view().size()) {
+                std::shared_ptr<const Program> program = image.toProgram();
+                if (hit)
+                    *hit = true;
+                if (stats) {
+                    stats->bytes = source.view().size();
+                    stats->lines = header.sourceLineCount;
+                    stats->threads = 1;
+                    stats->seconds = std::chrono::duration<double>(
+                                         std::chrono::steady_clock::now() - start)
+                                         .count();
+                }
+                return program;
+            }
+        } catch (const std::exception&) {
+            // Stale or damaged images are rebuilt below.
+        }
+    }
+
+    SourceLoadStats decodeStats;
+    std::shared_ptr<const Program> program =
+        Program::create(decodeSource(source.view(), SourceLoadOptions(), &decodeStats));
+    try {
+        std::filesystem::create_directories(directory, error);
+        ProgramImage::write(path, *program, source.view(), decodeStats.lines);
+    } catch (const std::exception&) {
+        // An unwritable cache only costs the next run a parse.
+    }
+    if (stats)
+        *stats = decodeStats;
+    return program;
+}
@@ -0,0 +1,237 @@
+#include "source_loader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+bool isSpace(char ch) {
+    return std::isspace(static_cast<unsigned char>(ch)) != 0;
+}
+
+// First '\n' in [p, end), or end. Sixteen bytes per compare where SSE2 is available.
+const char* findNewline(const char* p, const char* end) {
+#if defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+        if (mask)
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+        p += 16;
+    }
+#endif
+    const void* hit = std::memchr(p, '\n', end - p);
+    return hit ? static_cast<const char*>(hit) : end;
+}
+
+struct DecodedChunk {
+    std::vector<std::string> instructions;
+    std::vector<size_t> sourceLines;  // 0-based within the chunk.
+    std::vector<std::pair<std::string, size_t>> labels;  // Chunk-relative program index.
+    size_t lineCount = 0;
+};
+
+void decodeChunk(const char* begin, const char* end, DecodedChunk& out) {
+    std::string_view text;
+    size_t line = 0;
+    for (const char* p = begin; p < end; ++line) {
+        const char* newline = findNewline(p, end);
+        switch (classifySourceLine(std::string_view(p, newline - p), text)) {
+            case SourceLineKind::Blank:
+                break;
+            case SourceLineKind::Instruction:
+                out.instructions.emplace_back(text);
+                out.sourceLines.push_back(line);
+                break;
+            case SourceLineKind::Label: {
+                std::string label(text);
+                std::transform(label.begin(), label.end(), label.begin(), ::toupper);
+                out.labels.emplace_back(std::move(label), out.instructions.size());
+                break;
+            }
+        }
+        p = newline + 1;
+    }
+    out.lineCount = line;
+}
+
+// Runs task(i) for i in [0, count) on up to `threads` workers that pull indices from a shared
+// counter, so uneven chunks still balance.
+template <typename Task>
+void parallelFor(size_t count, unsigned threads, Task task) {
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < count; i = next++)
+            task(i);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i)
+        pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool)
+        thread.join();
+}
+
+}  // namespace
+
+SourceLineKind classifySourceLine(std::string_view line, std::string_view& text) {
+    size_t first = 0;
+    while (first < line.size() && isSpace(line[first]))
+        ++first;
+    size_t last = line.size();
+    while (last > first && isSpace(line[last - 1]))
+        --last;
+    line = line.substr(first, last - first);
+
+    line = line.substr(0, line.find(';'));
+    if (line.empty())
+        return SourceLineKind::Blank;
+    if (line.back() == ':') {
+        text = line.substr(0, line.size() - 1);
+        return SourceLineKind::Label;
+    }
+    text = line;
+    return SourceLineKind::Instruction;
+}
+
+double SourceLoadStats::megabytesPerSecond() const {
+    return seconds > 0.0 ? bytes / seconds / 1e6 : 0.0;
+}
+
+std::string SourceLoadStats::summary() const {
+    char text[128];
+    std::snprintf(text,
+                  sizeof(text),
+                  "%zu lines, %.1f MB in %.1f ms (%.0f MB/s, %u threads)",
+                  lines,
+                  bytes / 1e6,
+                  seconds * 1e3,
+                  megabytesPerSecond(),
+                  threads);
+    return text;
+}
+
+MappedFile::MappedFile(const std::string& path) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Failed to open program file: " + path);
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* address = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address != MAP_FAILED) {
+            ::madvise(address, info.st_size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(address);
+            length = static_cast<size_t>(info.st_size);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+    if (mapped)
+        return;
+#endif
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Failed to open program file: " + path);
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    fallback = contents.str();
+    data = fallback.data();
+    length = fallback.size();
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped)
+        ::munmap(const_cast<char*>(data), length);
+#endif
+}
+
+DecodedProgram decodeSource(std::string_view text,
+                            const SourceLoadOptions& options,
+                            SourceLoadStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Chunk boundaries sit just past a newline so no line is split between tasks.
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    std::vector<const char*> bounds{begin};
+    size_t chunkSize = std::max<size_t>(options.chunkSize, 1);
+    while (end - bounds.back() > static_cast<ptrdiff_t>(chunkSize)) {
+        const char* newline = findNewline(bounds.back() + chunkSize, end);
+        if (newline == end)
+            break;
+        bounds.push_back(newline + 1);
+    }
+    bounds.push_back(end);
+    size_t chunkCount = bounds.size() - 1;
+
+    unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    threads = static_cast<unsigned>(std::min<size_t>(std::max(threads, 1u), chunkCount));
+    std::vector<DecodedChunk> chunks(chunkCount);
+    parallelFor(chunkCount, threads, [&](size_t i) {
+        decodeChunk(bounds[i], bounds[i + 1], chunks[i]);
+    });
+
+    DecodedProgram program;
+    size_t instructionCount = 0;
+    for (const auto& chunk : chunks)
+        instructionCount += chunk.instructions.size();
+    program.instructions.reserve(instructionCount);
+    program.sourceLines.reserve(instructionCount);
+
+    size_t lineBase = 0;
+    for (auto& chunk : chunks) {
+        size_t programBase = program.instructions.size();
+        for (auto& label : chunk.labels)
+            program.labels[std::move(label.first)] = programBase + label.second;
+        std::move(chunk.instructions.begin(),
+                  chunk.instructions.end(),
+                  std::back_inserter(program.instructions));
+        for (size_t line : chunk.sourceLines)
+            program.sourceLines.push_back(lineBase + line + 1);
+        lineBase += chunk.lineCount;
+    }
+
+    if (stats) {
+        stats->bytes = text.size();
+        stats->lines = lineBase;
+        stats->threads = threads;
+        stats->seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    return program;
+}
+
+DecodedProgram loadSourceFile(const std::string& path,
+                              const SourceLoadOptions& options,
+                              SourceLoadStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file(path);
+    DecodedProgram program = decodeSource(file.view(), options, stats);
+    if (stats)
+        stats->seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return program;
+}
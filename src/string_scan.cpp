@@ -0,0 +1,122 @@
+#include "string_scan.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define IM8086_AVX2_DISPATCH 1
+#endif
+
+namespace {
+
+struct Scan {
+    const uint8_t* data;
+    const uint8_t* other;
+    uint8_t low;
+    uint8_t high;
+    bool matchEqual;
+
+    bool hit(size_t i) const {
+        uint8_t expected = other ? other[i] : (i & 1) ? high : low;
+        return (data[i] == expected) == matchEqual;
+    }
+};
+
+// The block scanners consume whole blocks from the front of [begin, end), or from the back
+// when descending, and narrow the window to what is left. Blocks start at even offsets so
+// the two-byte pattern stays in phase.
+
+#if defined(IM8086_AVX2_DISPATCH)
+bool hasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+__attribute__((target("avx2"))) bool scanAvx2(
+    const Scan& s, size_t& begin, size_t& end, bool descending, size_t& found) {
+    const __m256i pattern = _mm256_set1_epi16(static_cast<short>(s.low | (s.high << 8)));
+    while (end - begin >= 32) {
+        size_t at = descending ? end - 32 : begin;
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.data + at));
+        __m256i y = s.other ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.other + at))
+                            : pattern;
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y)));
+        if (!s.matchEqual)
+            mask = ~mask;
+        if (mask) {
+            found = at + (descending ? 31 - __builtin_clz(mask) : __builtin_ctz(mask));
+            return true;
+        }
+        if (descending)
+            end -= 32;
+        else
+            begin += 32;
+    }
+    return false;
+}
+#endif
+
+#if defined(__SSE2__)
+bool scanSse2(const Scan& s, size_t& begin, size_t& end, bool descending, size_t& found) {
+    const __m128i pattern = _mm_set1_epi16(static_cast<short>(s.low | (s.high << 8)));
+    while (end - begin >= 16) {
+        size_t at = descending ? end - 16 : begin;
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data + at));
+        __m128i y =
+            s.other ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.other + at)) : pattern;
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)));
+        if (!s.matchEqual)
+            mask ^= 0xFFFF;
+        if (mask) {
+            found = at + (descending ? 31 - __builtin_clz(mask) : __builtin_ctz(mask));
+            return true;
+        }
+        if (descending)
+            end -= 16;
+        else
+            begin += 16;
+    }
+    return false;
+}
+#endif
+
+}  // namespace
+
+size_t scanBytes(const uint8_t* data,
+                 const uint8_t* other,
+                 uint16_t pattern,
+                 size_t length,
+                 bool matchEqual,
+                 bool descending) {
+    Scan s{data, other, static_cast<uint8_t>(pattern), static_cast<uint8_t>(pattern >> 8),
+           matchEqual};
+    size_t begin = 0;
+    size_t end = length;
+    size_t found = length;
+    if (descending && (end & 1)) {
+        if (s.hit(--end))
+            return end;
+    }
+#if defined(IM8086_AVX2_DISPATCH)
+    if (hasAvx2() && scanAvx2(s, begin, end, descending, found))
+        return found;
+#endif
+#if defined(__SSE2__)
+    if (scanSse2(s, begin, end, descending, found))
+        return found;
+#endif
+    if (descending) {
+        for (size_t i = end; i > begin; --i) {
+            if (s.hit(i - 1))
+                return i - 1;
+        }
+    } else {
+        for (size_t i = begin; i < end; ++i) {
+            if (s.hit(i))
+                return i;
+        }
+    }
+    return length;
+}
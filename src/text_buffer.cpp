@@ -0,0 +1,414 @@
+#include "text_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+void findNewlines(const char* text, size_t length, size_t base, std::vector<size_t>& out) {
+    const char* end = text + length;
+    for (const char* p = text; p < end;) {
+        const char* hit = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (!hit)
+            break;
+        out.push_back(base + (hit - text));
+        p = hit + 1;
+    }
+}
+
+}  // namespace
+
+TextBuffer::TextBuffer() = default;
+
+TextBuffer::TextBuffer(std::string text) {
+    assign(std::move(text));
+}
+
+size_t TextBuffer::size() const {
+    return totalLength(root);
+}
+
+size_t TextBuffer::lineCount() const {
+    return totalNewlines(root) + 1;
+}
+
+void TextBuffer::assign(std::string text) {
+    size_t previousLines = lineCount();
+    original = std::move(text);
+    added.clear();
+    newlinePositions[0].clear();
+    newlinePositions[1].clear();
+    findNewlines(original.data(), original.size(), 0, newlinePositions[0]);
+    nodes.clear();
+    freeNodes.clear();
+    root = original.empty() ? kNull : newNode(0, 0, original.size(), nextPriority());
+    ++version;
+    recordEdit(0, previousLines, lineCount());
+}
+
+void TextBuffer::insert(size_t offset, std::string_view text) {
+    if (offset > size())
+        throw std::runtime_error("TextBuffer insert offset out of range");
+    if (text.empty())
+        return;
+
+    size_t firstLine = lineOfOffset(offset);
+    size_t appendedAt = added.size();
+    added.append(text.data(), text.size());
+    size_t before = newlinePositions[1].size();
+    findNewlines(text.data(), text.size(), appendedAt, newlinePositions[1]);
+    size_t newlines = newlinePositions[1].size() - before;
+
+    // Typing appends to the piece the previous insert created instead of adding a node per key.
+    if (!extendLastInsert(offset, appendedAt, text.size(), newlines)) {
+        int left, right;
+        split(root, offset, left, right);
+        int node = newNode(1, appendedAt, text.size(), nextPriority());
+        root = merge(merge(left, node), right);
+    }
+    ++version;
+    recordEdit(firstLine, 1, newlines + 1);
+}
+
+void TextBuffer::erase(size_t offset, size_t length) {
+    if (offset > size() || length > size() - offset)
+        throw std::runtime_error("TextBuffer erase range out of range");
+    if (length == 0)
+        return;
+
+    size_t firstLine = lineOfOffset(offset);
+    int left, middle, right;
+    split(root, offset, left, middle);
+    split(middle, length, middle, right);
+    size_t removedNewlines = totalNewlines(middle);
+    release(middle);
+    root = merge(left, right);
+    ++version;
+    recordEdit(firstLine, removedNewlines + 1, 1);
+}
+
+void TextBuffer::replace(size_t offset, size_t length, std::string_view text) {
+    erase(offset, length);
+    insert(offset, text);
+}
+
+char TextBuffer::at(size_t offset) const {
+    int node = root;
+    while (node != kNull) {
+        const Node& n = nodes[node];
+        size_t leftLength = totalLength(n.left);
+        if (offset < leftLength) {
+            node = n.left;
+        } else if (offset < leftLength + n.length) {
+            return data(n.buffer)[n.start + offset - leftLength];
+        } else {
+            offset -= leftLength + n.length;
+            node = n.right;
+        }
+    }
+    throw std::runtime_error("TextBuffer offset out of range");
+}
+
+std::string TextBuffer::text() const {
+    return substr(0, size());
+}
+
+std::string TextBuffer::substr(size_t offset, size_t length) const {
+    std::string out;
+    size_t end = std::min(size(), offset + std::min(length, size()));
+    if (offset < end) {
+        out.reserve(end - offset);
+        collect(root, 0, offset, end, out);
+    }
+    return out;
+}
+
+size_t TextBuffer::lineStart(size_t line) const {
+    if (line == 0)
+        return 0;
+    if (line >= lineCount())
+        throw std::runtime_error("TextBuffer line out of range");
+
+    // Find the line-th newline; the line starts right after it.
+    size_t remaining = line;
+    size_t base = 0;
+    int node = root;
+    while (node != kNull) {
+        const Node& n = nodes[node];
+        size_t leftNewlines = totalNewlines(n.left);
+        if (remaining <= leftNewlines) {
+            node = n.left;
+            continue;
+        }
+        remaining -= leftNewlines;
+        base += totalLength(n.left);
+        if (remaining <= n.newlines) {
+            const auto& positions = newlinePositions[n.buffer];
+            auto first = std::lower_bound(positions.begin(), positions.end(), n.start);
+            return base + (first[remaining - 1] - n.start) + 1;
+        }
+        remaining -= n.newlines;
+        base += n.length;
+        node = n.right;
+    }
+    return size();
+}
+
+size_t TextBuffer::lineLength(size_t line) const {
+    size_t start = lineStart(line);
+    size_t end = line + 1 < lineCount() ? lineStart(line + 1) - 1 : size();
+    return end - start;
+}
+
+size_t TextBuffer::lineOfOffset(size_t offset) const {
+    size_t line = 0;
+    int node = root;
+    while (node != kNull) {
+        const Node& n = nodes[node];
+        size_t leftLength = totalLength(n.left);
+        if (offset <= leftLength) {
+            node = n.left;
+            continue;
+        }
+        line += totalNewlines(n.left);
+        offset -= leftLength;
+        if (offset <= n.length)
+            return line + countNewlines(n.buffer, n.start, offset);
+        line += n.newlines;
+        offset -= n.length;
+        node = n.right;
+    }
+    return line;
+}
+
+std::string TextBuffer::line(size_t line) const {
+    return substr(lineStart(line), lineLength(line));
+}
+
+std::vector<std::string> TextBuffer::lines() const {
+    std::vector<std::string> result;
+    result.reserve(lineCount());
+    std::string all = text();
+    size_t start = 0;
+    while (true) {
+        size_t end = all.find('\n', start);
+        if (end == std::string::npos) {
+            result.push_back(all.substr(start));
+            break;
+        }
+        result.push_back(all.substr(start, end - start));
+        start = end + 1;
+    }
+    return result;
+}
+
+void TextBuffer::syncLines(std::vector<std::string>& lines) {
+    if (lines.empty()) {
+        lines = this->lines();
+        dirty = false;
+        return;
+    }
+    if (!dirty)
+        return;
+
+    size_t oldCount = std::min(dirtyOldEnd, lines.size()) - std::min(dirtyFirst, lines.size());
+    size_t newCount = dirtyNewEnd - dirtyFirst;
+    size_t common = std::min(oldCount, newCount);
+    for (size_t i = 0; i < common; ++i)
+        lines[dirtyFirst + i] = line(dirtyFirst + i);
+    if (newCount > oldCount) {
+        std::vector<std::string> extra;
+        extra.reserve(newCount - common);
+        for (size_t i = common; i < newCount; ++i)
+            extra.push_back(line(dirtyFirst + i));
+        lines.insert(lines.begin() + dirtyFirst + common,
+                     std::make_move_iterator(extra.begin()),
+                     std::make_move_iterator(extra.end()));
+    } else {
+        lines.erase(lines.begin() + dirtyFirst + common, lines.begin() + dirtyFirst + oldCount);
+    }
+    dirty = false;
+}
+
+size_t TextBuffer::countNewlines(uint8_t buffer, size_t start, size_t length) const {
+    const auto& positions = newlinePositions[buffer];
+    return std::lower_bound(positions.begin(), positions.end(), start + length) -
+           std::lower_bound(positions.begin(), positions.end(), start);
+}
+
+uint32_t TextBuffer::nextPriority() {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+int TextBuffer::newNode(uint8_t buffer, size_t start, size_t length, uint32_t priority) {
+    Node node;
+    node.buffer = buffer;
+    node.start = start;
+    node.length = length;
+    node.newlines = countNewlines(buffer, start, length);
+    node.priority = priority;
+    int index;
+    if (!freeNodes.empty()) {
+        index = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[index] = node;
+    } else {
+        index = static_cast<int>(nodes.size());
+        nodes.push_back(node);
+    }
+    update(index);
+    return index;
+}
+
+void TextBuffer::update(int node) {
+    Node& n = nodes[node];
+    n.totalLength = n.length + totalLength(n.left) + totalLength(n.right);
+    n.totalNewlines = n.newlines + totalNewlines(n.left) + totalNewlines(n.right);
+}
+
+int TextBuffer::merge(int a, int b) {
+    if (a == kNull)
+        return b;
+    if (b == kNull)
+        return a;
+    if (nodes[a].priority > nodes[b].priority) {
+        nodes[a].right = merge(nodes[a].right, b);
+        update(a);
+        return a;
+    }
+    nodes[b].left = merge(a, nodes[b].left);
+    update(b);
+    return b;
+}
+
+// Splits the tree into the first `offset` characters and the rest, cutting a piece in two if
+// the offset falls inside it. Indices only: newNode() may reallocate `nodes`.
+void TextBuffer::split(int node, size_t offset, int& left, int& right) {
+    if (node == kNull) {
+        left = right = kNull;
+        return;
+    }
+    size_t leftLength = totalLength(nodes[node].left);
+    size_t pieceLength = nodes[node].length;
+    int a, b;
+    if (offset <= leftLength) {
+        split(nodes[node].left, offset, a, b);
+        nodes[node].left = b;
+        update(node);
+        left = a;
+        right = node;
+    } else if (offset >= leftLength + pieceLength) {
+        split(nodes[node].right, offset - leftLength - pieceLength, a, b);
+        nodes[node].right = a;
+        update(node);
+        left = node;
+        right = b;
+    } else {
+        size_t cut = offset - leftLength;
+        int tail = newNode(nodes[node].buffer,
+                           nodes[node].start + cut,
+                           pieceLength - cut,
+                           nodes[node].priority);
+        nodes[tail].right = nodes[node].right;
+        update(tail);
+        Node& head = nodes[node];
+        head.right = kNull;
+        head.length = cut;
+        head.newlines = countNewlines(head.buffer, head.start, cut);
+        update(node);
+        left = node;
+        right = tail;
+    }
+}
+
+void TextBuffer::release(int node) {
+    if (node == kNull)
+        return;
+    release(nodes[node].left);
+    release(nodes[node].right);
+    freeNodes.push_back(node);
+}
+
+bool TextBuffer::extendLastInsert(size_t offset,
+                                  size_t appendedAt,
+                                  size_t length,
+                                  size_t newlines) {
+    if (offset == 0 || root == kNull)
+        return false;
+
+    // The piece holding the character before `offset` must end there and end where the add
+    // buffer ended before this insert.
+    int node = root;
+    size_t position = offset - 1;
+    while (true) {
+        const Node& n = nodes[node];
+        size_t leftLength = totalLength(n.left);
+        if (position < leftLength) {
+            node = n.left;
+        } else if (position < leftLength + n.length) {
+            if (n.buffer != 1 || position - leftLength + 1 != n.length ||
+                n.start + n.length != appendedAt)
+                return false;
+            break;
+        } else {
+            position -= leftLength + n.length;
+            node = n.right;
+        }
+    }
+
+    node = root;
+    position = offset - 1;
+    while (true) {
+        Node& n = nodes[node];
+        n.totalLength += length;
+        n.totalNewlines += newlines;
+        size_t leftLength = totalLength(n.left);
+        if (position < leftLength) {
+            node = n.left;
+        } else if (position < leftLength + n.length) {
+            n.length += length;
+            n.newlines += newlines;
+            return true;
+        } else {
+            position -= leftLength + n.length;
+            node = n.right;
+        }
+    }
+}
+
+void TextBuffer::collect(int node, size_t base, size_t from, size_t to, std::string& out) const {
+    if (node == kNull)
+        return;
+    const Node& n = nodes[node];
+    size_t pieceStart = base + totalLength(n.left);
+    size_t pieceEnd = pieceStart + n.length;
+    if (from < pieceStart)
+        collect(n.left, base, from, to, out);
+    if (from < pieceEnd && to > pieceStart) {
+        size_t first = std::max(from, pieceStart);
+        size_t last = std::min(to, pieceEnd);
+        out.append(data(n.buffer) + n.start + (first - pieceStart), last - first);
+    }
+    if (to > pieceEnd)
+        collect(n.right, pieceEnd, from, to, out);
+}
+
+void TextBuffer::recordEdit(size_t firstLine, size_t removedLines, size_t insertedLines) {
+    if (!dirty) {
+        dirty = true;
+        dirtyFirst = firstLine;
+        dirtyOldEnd = firstLine + removedLines;
+        dirtyNewEnd = firstLine + insertedLines;
+        return;
+    }
+    // Lines past both ranges are unchanged and shift one-for-one, so the merged range ends at
+    // whichever edit reaches further down.
+    size_t end = std::max(dirtyNewEnd, firstLine + removedLines);
+    dirtyOldEnd += end - dirtyNewEnd;
+    dirtyNewEnd = end + insertedLines - removedLines;
+    dirtyFirst = std::min(dirtyFirst, firstLine);
+}
@@ -0,0 +1,423 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kMagic[8] = {'I', 'M', '8', '6', 'T', 'R', 'C', '1'};
+
+const char* const kRegisterNames[kTraceRegisterCount] = {
+    "AX", "BX", "CX", "DX", "SI", "DI", "BP", "SP", "CS", "DS", "ES", "SS", "FLAGS"};
+
+uint16_t& registerRef(Registers& regs, int index) {
+    switch (index) {
+        case 0:
+            return regs.AX.x;
+        case 1:
+            return regs.BX.x;
+        case 2:
+            return regs.CX.x;
+        case 3:
+            return regs.DX.x;
+        case 4:
+            return regs.SI;
+        case 5:
+            return regs.DI;
+        case 6:
+            return regs.BP;
+        case 7:
+            return regs.SP;
+        case 8:
+            return regs.CS;
+        case 9:
+            return regs.DS;
+        case 10:
+            return regs.ES;
+        case 11:
+            return regs.SS;
+        default:
+            return regs.FLAGS;
+    }
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void putString(std::vector<uint8_t>& out, const std::string& text) {
+    putVarint(out, text.size());
+    out.insert(out.end(), text.begin(), text.end());
+}
+
+std::string mnemonicOf(const std::string& line) {
+    std::string mnemonic;
+    for (char c : line) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (!mnemonic.empty())
+                break;
+            continue;
+        }
+        mnemonic += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    }
+    return mnemonic;
+}
+
+std::string hex4(uint16_t value) {
+    char buffer[8];
+    std::snprintf(buffer, sizeof(buffer), "%04X", value);
+    return buffer;
+}
+
+}  // namespace
+
+const char* traceRegisterName(int index) {
+    return kRegisterNames[index];
+}
+
+uint16_t traceRegisterValue(const Registers& regs, int index) {
+    return registerRef(const_cast<Registers&>(regs), index);
+}
+
+TraceWriter::TraceWriter(const std::string& path,
+                         const std::vector<std::string>& program,
+                         const Registers& initial)
+    : out(path, std::ios::binary) {
+    if (!out)
+        throw std::runtime_error("Cannot open trace file: " + path);
+
+    std::vector<std::string> mnemonics;
+    std::unordered_map<std::string, uint32_t> ids;
+    lineOpcodes.reserve(program.size());
+    for (const auto& line : program) {
+        std::string mnemonic = mnemonicOf(line);
+        auto it = ids.find(mnemonic);
+        if (it == ids.end()) {
+            it = ids.emplace(mnemonic, static_cast<uint32_t>(mnemonics.size())).first;
+            mnemonics.push_back(mnemonic);
+        }
+        lineOpcodes.push_back(it->second);
+    }
+
+    active.reserve(kBufferSize + 256);
+    pending.reserve(kBufferSize + 256);
+    active.insert(active.end(), kMagic, kMagic + sizeof(kMagic));
+    putVarint(active, mnemonics.size());
+    for (const auto& mnemonic : mnemonics)
+        putString(active, mnemonic);
+    putVarint(active, program.size());
+    for (const auto& line : program)
+        putString(active, line);
+    for (int i = 0; i < kTraceRegisterCount; ++i)
+        putVarint(active, traceRegisterValue(initial, i));
+
+    worker = std::thread(&TraceWriter::writerLoop, this);
+}
+
+TraceWriter::~TraceWriter() {
+    close();
+}
+
+void TraceWriter::memoryWrite(uint16_t address, uint16_t value, bool isByte) {
+    pendingWrites.push_back({address, value, isByte});
+}
+
+void TraceWriter::retire(size_t line, const Registers& before, const Registers& after) {
+    putVarint(active, line < lineOpcodes.size() ? lineOpcodes[line] : 0);
+    putVarint(active,
+              zigzag(static_cast<int64_t>(line) - static_cast<int64_t>(previousLine + 1)));
+    previousLine = line;
+
+    uint16_t mask = 0;
+    for (int i = 0; i < kTraceRegisterCount; ++i) {
+        if (traceRegisterValue(before, i) != traceRegisterValue(after, i))
+            mask |= 1u << i;
+    }
+    putVarint(active, mask);
+    for (int i = 0; i < kTraceRegisterCount; ++i) {
+        if (mask & (1u << i)) {
+            int16_t delta = static_cast<int16_t>(traceRegisterValue(after, i) -
+                                                 traceRegisterValue(before, i));
+            putVarint(active, zigzag(delta));
+        }
+    }
+
+    putVarint(active, pendingWrites.size());
+    uint16_t previousAddress = 0;
+    for (const auto& write : pendingWrites) {
+        int16_t delta = static_cast<int16_t>(write.address - previousAddress);
+        putVarint(active, (zigzag(delta) << 1) | (write.isByte ? 1 : 0));
+        putVarint(active, write.value);
+        previousAddress = write.address;
+    }
+    pendingWrites.clear();
+
+    ++recordCount;
+    if (active.size() >= kBufferSize)
+        handOff();
+}
+
+void TraceWriter::handOff() {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready.wait(lock, [this] { return !pendingFull; });
+    std::swap(active, pending);
+    pendingFull = true;
+    active.clear();
+    ready.notify_all();
+}
+
+void TraceWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        ready.wait(lock, [this] { return pendingFull || stopping; });
+        if (pendingFull) {
+            lock.unlock();
+            out.write(reinterpret_cast<const char*>(pending.data()),
+                      static_cast<std::streamsize>(pending.size()));
+            lock.lock();
+            pending.clear();
+            pendingFull = false;
+            ready.notify_all();
+        } else if (stopping) {
+            break;
+        }
+    }
+}
+
+void TraceWriter::close() {
+    if (closed)
+        return;
+    closed = true;
+    if (!active.empty())
+        handOff();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    worker.join();
+    out.close();
+}
+
+TraceReader::TraceReader(const std::string& path) {
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Cannot open trace file: " + path);
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = contents.data();
+    size = contents.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open trace file: " + path);
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat trace file: " + path);
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size > 0) {
+        void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Cannot map trace file: " + path);
+        }
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const uint8_t*>(mapping);
+    }
+    ::close(fd);
+#endif
+
+    try {
+        if (size < sizeof(kMagic) || std::memcmp(data, kMagic, sizeof(kMagic)) != 0)
+            throw std::runtime_error("Not an Im8086 trace: " + path);
+        pos = sizeof(kMagic);
+
+        mnemonics.resize(readCount());
+        for (auto& mnemonic : mnemonics)
+            mnemonic = readString();
+        program.resize(readCount());
+        for (auto& line : program)
+            line = readString();
+        for (int i = 0; i < kTraceRegisterCount; ++i)
+            registerRef(initial, i) = static_cast<uint16_t>(readVarint());
+    } catch (...) {
+#ifndef _WIN32
+        if (data)
+            ::munmap(const_cast<uint8_t*>(data), size);
+#endif
+        throw;
+    }
+
+    recordsStart = pos;
+    state = initial;
+}
+
+TraceReader::~TraceReader() {
+#ifndef _WIN32
+    if (data)
+        ::munmap(const_cast<uint8_t*>(data), size);
+#endif
+}
+
+uint64_t TraceReader::readVarint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= size)
+            throw std::runtime_error("Truncated trace record");
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+    throw std::runtime_error("Malformed varint in trace");
+}
+
+// Every counted element takes at least one byte, which bounds corrupt counts.
+size_t TraceReader::readCount() {
+    uint64_t count = readVarint();
+    if (count > size - pos)
+        throw std::runtime_error("Malformed count in trace");
+    return static_cast<size_t>(count);
+}
+
+std::string TraceReader::readString() {
+    uint64_t length = readVarint();
+    if (length > size - pos)
+        throw std::runtime_error("Truncated trace header");
+    std::string text(reinterpret_cast<const char*>(data + pos), length);
+    pos += length;
+    return text;
+}
+
+bool TraceReader::next(TraceRecord& record) {
+    if (pos >= size)
+        return false;
+
+    record.index = index++;
+    record.opcode = static_cast<uint32_t>(readVarint());
+    record.line = static_cast<size_t>(static_cast<int64_t>(previousLine + 1) +
+                                      unzigzag(readVarint()));
+    previousLine = record.line;
+
+    record.changedMask = static_cast<uint16_t>(readVarint());
+    for (int i = 0; i < kTraceRegisterCount; ++i) {
+        if (record.changedMask & (1u << i))
+            registerRef(state, i) += static_cast<uint16_t>(unzigzag(readVarint()));
+    }
+    state.IP = static_cast<uint16_t>(record.line);
+    record.regs = state;
+
+    record.writes.resize(readCount());
+    uint16_t previousAddress = 0;
+    for (auto& write : record.writes) {
+        uint64_t tag = readVarint();
+        write.isByte = tag & 1;
+        write.address = static_cast<uint16_t>(previousAddress + unzigzag(tag >> 1));
+        write.value = static_cast<uint16_t>(readVarint());
+        previousAddress = write.address;
+    }
+    return true;
+}
+
+void TraceReader::rewind() {
+    pos = recordsStart;
+    state = initial;
+    previousLine = static_cast<size_t>(-1);
+    index = 0;
+}
+
+const std::string& TraceReader::mnemonic(const TraceRecord& record) const {
+    static const std::string unknown = "?";
+    return record.opcode < mnemonics.size() ? mnemonics[record.opcode] : unknown;
+}
+
+TraceDivergence findFirstDivergence(TraceReader& left, TraceReader& right) {
+    TraceDivergence result;
+    uint64_t compared = 0;
+    while (true) {
+        bool haveLeft = left.next(result.left);
+        bool haveRight = right.next(result.right);
+        if (!haveLeft && !haveRight) {
+            result.index = compared;
+            return result;
+        }
+
+        if (!haveLeft || !haveRight) {
+            result.diverged = true;
+            result.leftEnded = !haveLeft;
+            result.rightEnded = !haveRight;
+            result.index = haveLeft ? result.left.index : result.right.index;
+            result.differences.push_back(haveLeft ? "right trace ended" : "left trace ended");
+            return result;
+        }
+
+        const TraceRecord& a = result.left;
+        const TraceRecord& b = result.right;
+        if (a.line != b.line)
+            result.differences.push_back("line: " + std::to_string(a.line) +
+                                         " != " + std::to_string(b.line));
+        if (left.mnemonic(a) != right.mnemonic(b))
+            result.differences.push_back("opcode: " + left.mnemonic(a) + " != " +
+                                         right.mnemonic(b));
+        for (int i = 0; i < kTraceRegisterCount; ++i) {
+            uint16_t va = traceRegisterValue(a.regs, i);
+            uint16_t vb = traceRegisterValue(b.regs, i);
+            if (va != vb)
+                result.differences.push_back(std::string(traceRegisterName(i)) + ": " +
+                                             hex4(va) + " != " + hex4(vb));
+        }
+        if (a.writes != b.writes)
+            result.differences.push_back("memory writes differ");
+
+        if (!result.differences.empty()) {
+            result.diverged = true;
+            result.index = a.index;
+            return result;
+        }
+        ++compared;
+    }
+}
+
+std::string formatTraceRecord(const TraceReader& reader, const TraceRecord& record) {
+    std::ostringstream out;
+    out << '#' << record.index << "  " << record.line << ": ";
+    const auto& program = reader.getProgram();
+    out << (record.line < program.size() ? program[record.line] : reader.mnemonic(record));
+    for (int i = 0; i < kTraceRegisterCount; ++i) {
+        if (record.changedMask & (1u << i))
+            out << "  " << traceRegisterName(i) << '=' << hex4(traceRegisterValue(record.regs, i));
+    }
+    for (const auto& write : record.writes) {
+        out << "  [" << hex4(write.address) << "]=";
+        if (write.isByte)
+            out << hex4(write.value).substr(2);
+        else
+            out << hex4(write.value);
+    }
+    return out.str();
+}
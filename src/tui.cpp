@@ -10,7 +10,8 @@
 
 #include "emulator8086.h"
 
-EmulatorTUI::EmulatorTUI(Emulator8086* emu) : emulator(emu) {
+EmulatorTUI::EmulatorTUI(Emulator8086* emu, const std::string& sourcePath)
+    : emulator(emu), sourcePath(sourcePath) {
     initscr();
     cbreak();
     noecho();
@@ -22,6 +23,7 @@ EmulatorTUI::EmulatorTUI(Emulator8086* emu) : emulator(emu) {
     init_pair(1, COLOR_GREEN, -1);
     init_pair(2, COLOR_RED, -1);
     init_pair(3, COLOR_YELLOW, -1);
+    init_pair(4, COLOR_MAGENTA, -1);
 }
 
 EmulatorTUI::~EmulatorTUI() {
@@ -126,9 +128,16 @@ void EmulatorTUI::drawMemory(int y, int x, int w, int h) {
 
 void EmulatorTUI::drawCode(int h, int w) {
     int x = 0, y = 0;
-    mvprintw(y++, x, "CODE (F10 step, F5 run/stop, b breakpoint, c continue, l labels, q quit)");
+    mvprintw(y++,
+             x,
+             "CODE (F10 step, F5 run/stop, b breakpoint, w watch, c continue, m speed, +/- rate, "
+             "l labels, p profile, e export, q quit)");
     const auto& prog = emulator->getProgram();
     const auto& labels = emulator->getLabels();
+    Profiler* profiler = emulator->getProfiler();
+    std::vector<size_t> hotLines;
+    if (profiler)
+        hotLines = profiler->hottestLines(kHotLineCount);
     size_t ip = emulator->getIP();
     int linesAvail = h - 2;
     int first = 0;
@@ -136,8 +145,9 @@ void EmulatorTUI::drawCode(int h, int w) {
         first = ip - linesAvail / 2;
     for (int i = 0; i < linesAvail && first + i < (int)prog.size(); ++i) {
         size_t idx = first + i;
-        bool isBP = breakpoints.count(idx);
+        bool isBP = emulator->hasBreakpoint(idx);
         bool isIP = idx == ip;
+        bool isHot = std::find(hotLines.begin(), hotLines.end(), idx) != hotLines.end();
 
         std::string labelPrefix = "";
         for (const auto& labelPair : labels) {
@@ -153,19 +163,35 @@ void EmulatorTUI::drawCode(int h, int w) {
             attron(COLOR_PAIR(1));
         else if (isBP)
             attron(COLOR_PAIR(2));
-        mvprintw(y + i,
-                 x,
-                 "%c%04zu: %s%s",
-                 isBP ? '*' : ' ',
-                 idx,
-                 labelPrefix.c_str(),
-                 prog[idx].c_str());
+        else if (isHot)
+            attron(COLOR_PAIR(4));
+        if (profiler) {
+            mvprintw(y + i,
+                     x,
+                     "%c%04zu %10llu%c %s%s",
+                     isBP ? '*' : ' ',
+                     idx,
+                     (unsigned long long)profiler->getLineCosts()[idx].instructions,
+                     isHot ? '#' : ' ',
+                     labelPrefix.c_str(),
+                     prog[idx].c_str());
+        } else {
+            mvprintw(y + i,
+                     x,
+                     "%c%04zu: %s%s",
+                     isBP ? '*' : ' ',
+                     idx,
+                     labelPrefix.c_str(),
+                     prog[idx].c_str());
+        }
         if (isIP && isBP)
             attroff(COLOR_PAIR(3));
         else if (isIP)
             attroff(COLOR_PAIR(1));
         else if (isBP)
             attroff(COLOR_PAIR(2));
+        else if (isHot)
+            attroff(COLOR_PAIR(4));
     }
 }
 
@@ -192,9 +218,13 @@ void EmulatorTUI::draw() {
 
     mvprintw(h - 1,
              0,
-             "Mode: %s  IP=%zu  (help keys: h)",
+             "Mode: %s%s  IP=%zu  Speed: %s (%.0f IPS)  %s",
              running ? "RUN" : "PAUSE",
-             (size_t)emulator->getIP());
+             emulator->isProfilerEnabled() ? " +PROF" : "",
+             (size_t)emulator->getIP(),
+             pacer.describe().c_str(),
+             pacer.getMeasuredRate(),
+             statusMessage.c_str());
     refresh();
 }
 
@@ -240,10 +270,82 @@ void EmulatorTUI::drawLabels(int h, int w) {
 
 void EmulatorTUI::toggleBreakpoint() {
     size_t ip = emulator->getIP();
-    if (breakpoints.count(ip))
-        breakpoints.erase(ip);
+    bool enabled = emulator->toggleBreakpoint(ip);
+    statusMessage = (enabled ? "Breakpoint set at " : "Breakpoint removed at ") + std::to_string(ip);
+}
+
+void EmulatorTUI::toggleWatchpoint() {
+    uint16_t address = static_cast<uint16_t>(memWindowStart);
+    std::ostringstream oss;
+    oss << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << address;
+    if (emulator->removeWatchpoint(address)) {
+        statusMessage = "Watchpoint removed at " + oss.str();
+    } else {
+        emulator->addWatchpoint(address, 16, false, true);
+        statusMessage = "Watching writes to " + oss.str() + "+16";
+    }
+}
+
+void EmulatorTUI::startRunning() {
+    running = true;
+    pacer.resume();
+}
+
+void EmulatorTUI::runFrame() {
+    if (!pacer.runFrame(*emulator).stopped)
+        return;
+    switch (emulator->getStopReason()) {
+        case Emulator8086::StopReason::Breakpoint:
+            running = false;
+            statusMessage = "Breakpoint at " + std::to_string(emulator->getIP());
+            break;
+        case Emulator8086::StopReason::Watchpoint: {
+            running = false;
+            const auto& hit = emulator->getWatchHit();
+            std::ostringstream oss;
+            oss << "Watchpoint: " << (hit.isWrite ? "write to " : "read of ") << std::hex
+                << std::uppercase << std::setw(4) << std::setfill('0') << hit.address << std::dec
+                << " at line " << hit.line;
+            statusMessage = oss.str();
+            break;
+        }
+        case Emulator8086::StopReason::EndOfProgram:
+            running = false;
+            statusMessage = "Program finished";
+            break;
+        case Emulator8086::StopReason::StepLimit:
+            break;
+    }
+}
+
+void EmulatorTUI::changeSpeed(int ch) {
+    if (ch == 'm' || ch == 'M') {
+        pacer.cycleMode();
+        pacer.resume();
+    } else if (ch == '+' || ch == '=') {
+        pacer.faster();
+    } else {
+        pacer.slower();
+    }
+    statusMessage = "Speed: " + pacer.describe();
+}
+
+void EmulatorTUI::toggleProfiler() {
+    emulator->enableProfiler(!emulator->isProfilerEnabled());
+    statusMessage = emulator->isProfilerEnabled() ? "Profiler on" : "Profiler off";
+}
+
+void EmulatorTUI::exportProfile() {
+    Profiler* profiler = emulator->getProfiler();
+    if (!profiler) {
+        statusMessage = "Profiler is off (p to enable)";
+        return;
+    }
+    if (profiler->exportFolded("profile.folded") &&
+        profiler->exportCallgrind("callgrind.out.im8086", sourcePath))
+        statusMessage = "Profile written to profile.folded and callgrind.out.im8086";
     else
-        breakpoints.insert(ip);
+        statusMessage = "Error: could not write profile";
 }
 
 void EmulatorTUI::step() {
@@ -252,11 +354,15 @@ void EmulatorTUI::step() {
 
 void EmulatorTUI::run() {
     while (!quit) {
+        auto frameStart = std::chrono::steady_clock::now();
         int ch = getch();
         if (ch != ERR) {
             switch (ch) {
                 case KEY_F(5):
-                    running = !running;
+                    if (running)
+                        running = false;
+                    else
+                        startRunning();
                     break;
                 case KEY_F(10):
                     running = false;
@@ -272,12 +378,31 @@ void EmulatorTUI::run() {
                     break;
                 case 'c':
                 case 'C':
-                    running = true;
+                    startRunning();
+                    break;
+                case 'm':
+                case 'M':
+                case '+':
+                case '=':
+                case '-':
+                    changeSpeed(ch);
+                    break;
+                case 'w':
+                case 'W':
+                    toggleWatchpoint();
                     break;
                 case 'l':
                 case 'L':
                     showLabels = !showLabels;
                     break;
+                case 'p':
+                case 'P':
+                    toggleProfiler();
+                    break;
+                case 'e':
+                case 'E':
+                    exportProfile();
+                    break;
                 case KEY_UP:
                     memWindowStart = std::max(0, memWindowStart - 16);
                     break;
@@ -296,18 +421,11 @@ void EmulatorTUI::run() {
                     break;
             }
         }
-        if (running) {
-            if (breakpoints.count(emulator->getIP()) && ch != KEY_F(10)) {
-                running = false;
-            } else {
-                bool cont = emulator->step();
-                if (!cont)
-                    running = false;
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(30));
-        } else {
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
+        if (running)
+            runFrame();
         draw();
+        // Redraw once per frame while running; the pacer already spent the frame executing.
+        std::this_thread::sleep_until(frameStart + (running ? std::chrono::milliseconds(16)
+                                                            : std::chrono::milliseconds(10)));
     }
 }
@@ -1,8 +1,57 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "aot.h"
+#include "dos_loader.h"
+#include "emulation_worker.h"
 #include "emulator8086.h"
+#include "execution_pacer.h"
+#include "instruction_table.h"
+#include "lockstep.h"
+#include "opcode_profile.h"
+#include "program_image.h"
+#include "source_loader.h"
 #include "test_framework.h"
+#include "text_buffer.h"
+#include "trace.h"
+
+// Counts heap allocations while countAllocations is set, so tests can assert that a hot path
+// does not allocate.
+static std::atomic<bool> countAllocations{false};
+static std::atomic<size_t> allocationCount{0};
+
+void* operator new(size_t size) {
+    if (countAllocations.load(std::memory_order_relaxed))
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+// GCC flags free() on memory from operator new once these are inlined, though it came from
+// the malloc above.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
 
 TEST_CASE(EmulatorBasicInitialization) {
     Emulator8086 emulator;
@@ -117,6 +166,1257 @@ TEST_CASE(EmulatorMemoryOperations) {
     REQUIRE_EQ(readWord, testWord);
 }
 
+TEST_CASE(ProfilerLineCountsAndBranches) {
+    Emulator8086 emulator;
+    emulator.enableProfiler(true);
+
+    std::vector<std::string> program = {"MOV CX, 3", "again:", "DEC CX", "JNZ again", "NOP"};
+    emulator.loadProgram(program);
+    while (emulator.step()) {
+    }
+
+    Profiler* profiler = emulator.getProfiler();
+    REQUIRE(profiler != nullptr);
+    REQUIRE_EQ(profiler->getLineCosts()[0].instructions, 1);
+    REQUIRE_EQ(profiler->getLineCosts()[1].instructions, 3);
+    REQUIRE_EQ(profiler->getLineCosts()[2].instructions, 3);
+    REQUIRE_EQ(profiler->getBranchStats().at(2).taken, 2);
+    REQUIRE_EQ(profiler->getBranchStats().at(2).notTaken, 1);
+    REQUIRE_EQ(profiler->getTotal().instructions, 8);
+}
+
+TEST_CASE(ProfilerCallGraphAndFoldedExport) {
+    Emulator8086 emulator;
+    emulator.enableProfiler(true);
+
+    std::vector<std::string> program = {"CALL work",
+                                        "CALL work",
+                                        "JMP done",
+                                        "work:",
+                                        "MOV AX, 1",
+                                        "ADD AX, 2",
+                                        "RET",
+                                        "done:",
+                                        "NOP"};
+    emulator.loadProgram(program);
+    while (emulator.step()) {
+    }
+
+    Profiler* profiler = emulator.getProfiler();
+    auto functions = profiler->getFunctionStats();
+    bool foundWork = false;
+    for (const auto& fn : functions) {
+        if (fn.name == "WORK") {
+            foundWork = true;
+            REQUIRE_EQ(fn.calls, 2);
+            REQUIRE_EQ(fn.exclusive.instructions, 6);
+            REQUIRE_EQ(fn.inclusive.instructions, 6);
+        }
+    }
+    REQUIRE(foundWork);
+    REQUIRE_EQ(profiler->getCallDepth(), 1);
+
+    std::ostringstream folded;
+    profiler->writeFolded(folded);
+    REQUIRE(folded.str().find("(program);WORK ") != std::string::npos);
+
+    std::ostringstream callgrind;
+    profiler->writeCallgrind(callgrind, "test.asm");
+    REQUIRE(callgrind.str().find("cfn=WORK") != std::string::npos);
+    REQUIRE(callgrind.str().find("calls=1 5") != std::string::npos);
+}
+
+TEST_CASE(ProfilerKeepsSimulatedInterruptsInTheCallersFrame) {
+    Emulator8086 emulator;
+    emulator.enableProfiler(true);
+    emulator.loadProgram({"MOV CX, 3", "top:", "INT 21h", "CALL work", "LOOP top", "JMP done",
+                          "work:", "INC AX", "RET", "done:", "NOP"});
+    std::streambuf* output = std::cout.rdbuf(nullptr);  // The interrupt's notice.
+    while (emulator.step()) {
+    }
+    std::cout.rdbuf(output);
+
+    Profiler* profiler = emulator.getProfiler();
+    REQUIRE_EQ(profiler->getCallDepth(), 1);
+    for (const auto& fn : profiler->getFunctionStats()) {
+        REQUIRE(fn.name.find("INT") == std::string::npos);
+        if (fn.name == "WORK") {
+            REQUIRE_EQ(fn.calls, 3);
+            REQUIRE_EQ(fn.exclusive.instructions, 6);
+        }
+    }
+    std::ostringstream folded;
+    profiler->writeFolded(folded);
+    REQUIRE(folded.str().find("INT") == std::string::npos);
+    REQUIRE(folded.str().find("(program);WORK ") != std::string::npos);
+}
+
+TEST_CASE(ProfilerIgnoresFailedCalls) {
+    Emulator8086 emulator;
+    emulator.enableProfiler(true);
+    emulator.loadProgram({"CALL nowhere", "MOV AX, 1", "CALL work", "JMP done", "work:", "RET",
+                          "done:", "NOP"});
+    std::streambuf* output = std::cerr.rdbuf(nullptr);  // The unknown label's error.
+    while (emulator.step()) {
+    }
+    std::cerr.rdbuf(output);
+
+    Profiler* profiler = emulator.getProfiler();
+    REQUIRE_EQ(profiler->getCallDepth(), 1);
+    for (const auto& fn : profiler->getFunctionStats())
+        REQUIRE(fn.name.find("line_") == std::string::npos);
+    std::ostringstream folded;
+    profiler->writeFolded(folded);
+    REQUIRE(folded.str().find("line_") == std::string::npos);
+    REQUIRE(folded.str().find("(program);WORK ") != std::string::npos);
+}
+
+namespace {
+
+struct CountingInstrumentation : NullInstrumentation {
+    static constexpr bool kRetire = true;
+    static constexpr bool kMemory = true;
+    static constexpr bool kPorts = true;
+    static constexpr bool kInterrupts = true;
+
+    void onRetire(size_t, const Registers&, const Registers&) {
+        retired++;
+    }
+    void onMemoryRead(uint16_t, uint16_t, bool) {
+        reads++;
+    }
+    void onMemoryWrite(uint16_t address, uint16_t value, bool isByte) {
+        writes++;
+        lastWrite = address;
+        lastWriteValue = value;
+        lastWriteByte = isByte;
+    }
+    void onPortOut(uint16_t port, uint16_t value) {
+        lastPort = port;
+        lastPortValue = value;
+    }
+    void onInterrupt(uint8_t vector, size_t returnLine) {
+        lastVector = vector;
+        interruptReturn = returnLine;
+    }
+
+    size_t retired = 0;
+    size_t reads = 0;
+    size_t writes = 0;
+    uint16_t lastWrite = 0;
+    uint16_t lastWriteValue = 0;
+    bool lastWriteByte = false;
+    uint16_t lastPort = 0;
+    uint16_t lastPortValue = 0;
+    uint8_t lastVector = 0;
+    size_t interruptReturn = 0;
+};
+
+}  // namespace
+
+TEST_CASE(InstrumentationPolicyHooks) {
+    Emulator8086 emulator;
+    std::vector<std::string> program = {"MOV BX, 100h",
+                                        "MOV AL, 5Ah",
+                                        "MOV [BX], AL",
+                                        "MOV AH, [BX]",
+                                        "OUT 61h, AX",
+                                        "INT 21h",
+                                        "NOP"};
+    emulator.loadProgram(program);
+
+    CountingInstrumentation counter;
+    REQUIRE_EQ(emulator.run(counter, 5), 5);
+    REQUIRE_EQ(counter.retired, 5);
+    REQUIRE_EQ(counter.reads, 1);
+    REQUIRE_EQ(counter.writes, 1);
+    REQUIRE_EQ(counter.lastWrite, 0x100);
+    REQUIRE_EQ(counter.lastWriteValue, 0x5A);
+    REQUIRE(counter.lastWriteByte);
+    REQUIRE_EQ(counter.lastPort, 0x61);
+    REQUIRE_EQ(counter.lastPortValue, 0x5A5A);
+
+    REQUIRE_EQ(emulator.run(counter, 1), 1);
+    REQUIRE_EQ(counter.lastVector, 0x21);
+    REQUIRE_EQ(counter.interruptReturn, 6);
+    REQUIRE_EQ(counter.writes, 4);
+
+    // Hooks are only live for the duration of the instrumented run.
+    size_t writesBefore = counter.writes;
+    emulator.writeMemoryByte(0x200, 1);
+    REQUIRE_EQ(emulator.run(1), 1);
+    REQUIRE_EQ(counter.writes, writesBefore);
+}
+
+namespace {
+
+void recordTrace(const std::string& path, const std::vector<std::string>& program) {
+    Emulator8086 emulator;
+    emulator.loadProgram(program);
+    TraceWriter writer(path, emulator.getProgram(), emulator.getRegisters());
+    TraceInstrumentation policy(writer);
+    emulator.run(policy, 1000);
+}
+
+}  // namespace
+
+TEST_CASE(TraceRoundTripAndDiff) {
+    const std::string pathA = "test_trace_a.tmp";
+    const std::string pathB = "test_trace_b.tmp";
+    std::vector<std::string> program = {"MOV CX, 3",
+                                        "MOV BX, 200h",
+                                        "again:",
+                                        "MOV [BX], CX",
+                                        "ADD BX, 2",
+                                        "LOOP again",
+                                        "MOV AL, [BX-2]"};
+    recordTrace(pathA, program);
+
+    {
+        TraceReader reader(pathA);
+        REQUIRE_EQ(reader.getProgram().size(), 6);
+        TraceRecord rec;
+        size_t count = 0;
+        size_t writes = 0;
+        while (reader.next(rec)) {
+            ++count;
+            writes += rec.writes.size();
+        }
+        REQUIRE_EQ(count, 12);
+        REQUIRE_EQ(writes, 3);
+        REQUIRE_EQ(rec.line, 5);
+        REQUIRE_EQ(reader.mnemonic(rec), "MOV");
+        REQUIRE_EQ(rec.regs.AX.bytes.l, 1);
+        REQUIRE_EQ(rec.regs.BX.x, 0x206);
+        REQUIRE_EQ(rec.regs.CX.x, 0);
+
+        reader.rewind();
+        REQUIRE(reader.next(rec));
+        REQUIRE_EQ(rec.index, 0);
+        REQUIRE_EQ(rec.regs.CX.x, 3);
+    }
+
+    program[4] = "ADD BX, 4";
+    recordTrace(pathB, program);
+    {
+        TraceReader a(pathA);
+        TraceReader b(pathA);
+        REQUIRE(!findFirstDivergence(a, b).diverged);
+    }
+    {
+        TraceReader a(pathA);
+        TraceReader b(pathB);
+        TraceDivergence result = findFirstDivergence(a, b);
+        REQUIRE(result.diverged);
+        REQUIRE_EQ(result.index, 3);
+        REQUIRE_EQ(result.differences.size(), 1);
+        REQUIRE_EQ(result.differences[0], "BX: 0202 != 0204");
+    }
+
+    std::remove(pathA.c_str());
+    std::remove(pathB.c_str());
+}
+
+TEST_CASE(LockstepDetectsFirstDivergence) {
+    Emulator8086 reference;
+    Emulator8086 candidate;
+    LockstepChecker checker(reference, candidate);
+
+    checker.load(generateRandomProgram(7, 100));
+    REQUIRE(!checker.run(10000).diverged);
+
+    // A faulty candidate that drops the high byte of every memory write.
+    checker.setCandidateStepper([](Emulator8086& emu, DirtyPageTracker& tracker) {
+        std::vector<uint8_t> before(emu.getMemory().begin(), emu.getMemory().begin() + 0x10000);
+        emu.run(tracker, 1);
+        for (size_t page : tracker.dirtyPages) {
+            for (size_t i = 0; i < 256; ++i) {
+                size_t address = (page << 8) + i;
+                if (emu.getMemory()[address] != before[address] && address % 2 == 1)
+                    emu.getMemory()[address] = before[address];
+            }
+        }
+    });
+    checker.load({"MOV AX, 1234h", "MOV BX, 100h", "MOV [BX], AX", "NOP"});
+    LockstepResult result = checker.run(100);
+    REQUIRE(result.diverged);
+    REQUIRE_EQ(result.steps, 2);
+    REQUIRE_EQ(result.line, 2);
+    REQUIRE_EQ(result.differences.size(), 1);
+    REQUIRE_EQ(result.differences[0], "[0101]: 12 != 00");
+}
+
+TEST_CASE(LockstepChecksTranslatedAndFusedCodeInBlocks) {
+    Emulator8086 reference;
+    Emulator8086 candidate;
+    reference.setJitEnabled(false);
+    reference.setFusionCandidates(FusionCandidates::none());
+    reference.setFlagLivenessEnabled(false);
+    LockstepChecker checker(reference, candidate);
+    LockstepChecker::Stepper block = [](Emulator8086& emu, DirtyPageTracker& tracker) {
+        emu.run(tracker, 40);
+    };
+    checker.setReferenceStepper(block);
+    checker.setCandidateStepper(block);
+
+    checker.load({"MOV CX, 300", "top:", "ADD AX, CX", "XOR DX, AX", "MOV [BX], DX",
+                  "CMP AX, 1234h", "JNE skip", "INC BX", "skip:", "DEC CX", "JNZ top", "NOP"});
+    REQUIRE(!candidate.getFusedPairs().empty());
+    LockstepResult result = checker.run(1000);
+    REQUIRE(!result.diverged);
+    REQUIRE(candidate.getIP() == candidate.getProgram().size());
+    if (Jit::isSupported())
+        REQUIRE(candidate.getJit()->blockCount() > 0);
+}
+
+TEST_CASE(BreakpointsAndWatchpointsStopRun) {
+    Emulator8086 emu;
+    emu.loadProgram({"MOV AX, 1", "MOV BX, 200h", "MOV [BX], AX", "INC AX", "MOV CX, [BX]", "NOP"});
+
+    REQUIRE(emu.toggleBreakpoint(3));
+    REQUIRE_EQ(emu.run(100), 3);
+    REQUIRE(emu.getStopReason() == Emulator8086::StopReason::Breakpoint);
+    REQUIRE_EQ(emu.getIP(), 3);
+
+    // Resuming from the breakpoint line executes it instead of stopping again.
+    REQUIRE_EQ(emu.run(100), 3);
+    REQUIRE(emu.getStopReason() == Emulator8086::StopReason::EndOfProgram);
+    REQUIRE(!emu.toggleBreakpoint(3));
+    REQUIRE(emu.getBreakpoints().empty());
+
+    emu.reset();
+    emu.loadProgram({"MOV AX, 1", "MOV BX, 200h", "MOV [BX], AX", "INC AX", "MOV CX, [BX]", "NOP"});
+    emu.addWatchpoint(0x201, 1, false, true);
+    REQUIRE_EQ(emu.run(100), 3);
+    REQUIRE(emu.getStopReason() == Emulator8086::StopReason::Watchpoint);
+    REQUIRE_EQ(emu.getWatchHit().address, 0x200);
+    REQUIRE(emu.getWatchHit().isWrite);
+    REQUIRE_EQ(emu.getWatchHit().line, 2);
+
+    // Write-only watches ignore reads; a read watch on the same word catches MOV CX, [BX].
+    emu.addWatchpoint(0x200, 2, true, false);
+    REQUIRE_EQ(emu.run(100), 2);
+    REQUIRE(!emu.getWatchHit().isWrite);
+    REQUIRE_EQ(emu.getWatchHit().line, 4);
+    REQUIRE(emu.removeWatchpoint(0x200));
+    REQUIRE(!emu.removeWatchpoint(0x200));
+    REQUIRE_EQ(emu.run(100), 1);
+    REQUIRE(emu.getStopReason() == Emulator8086::StopReason::EndOfProgram);
+}
+
+TEST_CASE(EmulationWorkerPublishesSnapshots) {
+    std::atomic<int> published{0};
+    EmulationWorker worker(100, [&published] { ++published; });
+    uint64_t lastSequence = worker.acquireSnapshot().sequence;
+    auto waitFor = [&](auto predicate) -> const EmulatorSnapshot& {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (true) {
+            const EmulatorSnapshot& snapshot = worker.acquireSnapshot();
+            if (snapshot.sequence != lastSequence && predicate(snapshot)) {
+                lastSequence = snapshot.sequence;
+                return snapshot;
+            }
+            REQUIRE(std::chrono::steady_clock::now() < deadline);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    const std::vector<std::string> program = {
+        "MOV AX, 1", "MOV BX, 300h", "MOV CX, 2000", "L1:", "ADD [BX], AX", "LOOP L1", "NOP"};
+    REQUIRE(worker.load(program));
+    REQUIRE(worker.run());
+    const EmulatorSnapshot& done = waitFor([](const EmulatorSnapshot& s) {
+        return !s.running && s.stopReason == Emulator8086::StopReason::EndOfProgram;
+    });
+    REQUIRE_EQ(done.readWord(0x300), 2000);
+    REQUIRE_EQ(done.regs.CX.x, 0);
+    REQUIRE(done.retired > 4000);
+    REQUIRE_EQ(done.program->size(), done.regs.IP);
+
+    REQUIRE(worker.load(program));
+    REQUIRE(worker.toggleBreakpoint(2));
+    REQUIRE(worker.run());
+    const EmulatorSnapshot& hit = waitFor([](const EmulatorSnapshot& s) {
+        return !s.running && s.stopReason == Emulator8086::StopReason::Breakpoint;
+    });
+    REQUIRE_EQ(hit.regs.IP, 2);
+    REQUIRE(hit.hasBreakpoint(2));
+    REQUIRE_EQ(hit.readWord(0x300), 0);
+
+    REQUIRE(worker.step());
+    const EmulatorSnapshot& stepped = waitFor([](const EmulatorSnapshot& s) { return s.regs.IP == 3; });
+    REQUIRE_EQ(stepped.regs.CX.x, 2000);
+    REQUIRE_EQ(stepped.retired, 3);
+    REQUIRE(published.load() >= 5);
+}
+
+TEST_CASE(ExecutionPacerModes) {
+    using std::chrono::milliseconds;
+    Emulator8086 emu;
+    emu.loadProgram({"L1:", "INC AX", "JMP L1"});
+
+    ExecutionPacer pacer;
+    pacer.setMode(ExecutionPacer::Mode::Throttled);
+    pacer.setRate(100);
+    auto t0 = ExecutionPacer::Clock::now();
+    pacer.resume(t0);
+    REQUIRE_EQ(pacer.runFrame(emu, t0 + milliseconds(100)).retired, 10);
+    REQUIRE_EQ(pacer.runFrame(emu, t0 + milliseconds(100)).retired, 0);
+    // A long stall only banks a quarter second.
+    REQUIRE_EQ(pacer.runFrame(emu, t0 + milliseconds(10100)).retired, 25);
+
+    pacer.cycleMode();
+    REQUIRE(pacer.getMode() == ExecutionPacer::Mode::Animate);
+    pacer.resume(t0);
+    REQUIRE_EQ(pacer.runFrame(emu, t0 + milliseconds(5000)).retired, 1);
+
+    pacer.cycleMode();
+    REQUIRE(pacer.getMode() == ExecutionPacer::Mode::Full);
+    size_t jumpLine = emu.getProgram().size() - 1;
+    emu.toggleBreakpoint(jumpLine);
+    ExecutionPacer::FrameResult result = pacer.runFrame(emu);
+    REQUIRE(result.stopped);
+    REQUIRE(emu.getStopReason() == Emulator8086::StopReason::Breakpoint);
+    REQUIRE_EQ(emu.getIP(), jumpLine);
+    emu.toggleBreakpoint(jumpLine);
+    result = pacer.runFrame(emu);
+    REQUIRE(!result.stopped);
+    REQUIRE(result.retired > 1000);
+
+    // A long REP runs in several chunks but retires once.
+    Emulator8086 rep;
+    rep.loadProgram({"MOV CX, 0FFFFh", "REP STOSB", "NOP"});
+    result = pacer.runFrame(rep);
+    REQUIRE(result.stopped);
+    REQUIRE_EQ(result.retired, 3);
+}
+
+TEST_CASE(TextBufferPieceTableEdits) {
+    TextBuffer buffer("MOV AX, 1\nHLT\n");
+    std::vector<std::string> lines;
+    buffer.syncLines(lines);
+    REQUIRE_EQ(lines.size(), 3);
+    REQUIRE_EQ(buffer.lineStart(1), 10);
+    REQUIRE_EQ(buffer.lineOfOffset(10), 1);
+
+    buffer.insert(10, "INC AX\nDEC BX\n");
+    buffer.erase(4, 2);
+    buffer.insert(buffer.lineStart(4), "NOP");
+    REQUIRE_EQ(buffer.text(), std::string("MOV , 1\nINC AX\nDEC BX\nHLT\nNOP"));
+    REQUIRE_EQ(buffer.line(2), std::string("DEC BX"));
+    REQUIRE_EQ(buffer.lineLength(4), 3);
+    buffer.syncLines(lines);
+    REQUIRE(lines == buffer.lines());
+
+    // Mixed edits on a source larger than the old 64K editor cap, checked against std::string.
+    std::string reference;
+    for (int i = 0; i < 8000; ++i)
+        reference += "ADD AX, " + std::to_string(i) + "\n";
+    REQUIRE(reference.size() > 0x10000);
+    buffer.assign(reference);
+    buffer.syncLines(lines);
+    uint32_t seed = 12345;
+    auto next = [&seed](size_t bound) {
+        seed = seed * 1103515245u + 12345u;
+        return (seed >> 8) % bound;
+    };
+    for (int i = 0; i < 300; ++i) {
+        size_t offset = next(reference.size() + 1);
+        if (i % 3 == 0) {
+            size_t length = std::min<size_t>(next(40), reference.size() - offset);
+            buffer.erase(offset, length);
+            reference.erase(offset, length);
+        } else {
+            std::string text = i % 2 ? "x" : "MOV\nBX\n";
+            buffer.insert(offset, text);
+            reference.insert(offset, text);
+        }
+        if (i % 50 == 0) {
+            buffer.syncLines(lines);
+            REQUIRE(lines == TextBuffer(reference).lines());
+        }
+    }
+    REQUIRE(buffer.text() == reference);
+    REQUIRE_EQ(buffer.lineCount(), TextBuffer(reference).lineCount());
+    size_t line = buffer.lineCount() / 2;
+    REQUIRE_EQ(buffer.lineOfOffset(buffer.lineStart(line)), line);
+    buffer.syncLines(lines);
+    REQUIRE(lines == TextBuffer(reference).lines());
+}
+
+TEST_CASE(SourceLoaderMatchesLoadProgram) {
+    std::string source;
+    std::vector<std::string> lines;
+    for (int i = 0; i < 2000; ++i) {
+        std::string line;
+        switch (i % 5) {
+            case 0: line = "loop" + std::to_string(i / 5) + ":"; break;
+            case 1: line = "  MOV AX, " + std::to_string(i) + "  ; load\r"; break;
+            case 2: line = ""; break;
+            case 3: line = "; comment only"; break;
+            case 4: line = "\tJMP LOOP" + std::to_string(i / 5); break;
+        }
+        lines.push_back(line);
+        source += line + "\n";
+    }
+    source += "dup:\nNOP\ndup:\nHLT";  // No trailing newline; the later label wins.
+    for (const char* line : {"dup:", "NOP", "dup:", "HLT"})
+        lines.push_back(line);
+
+    Emulator8086 expected;
+    expected.loadProgram(lines);
+
+    SourceLoadOptions options;
+    options.threads = 4;
+    options.chunkSize = 1000;
+    SourceLoadStats stats;
+    DecodedProgram decoded = decodeSource(source, options, &stats);
+    REQUIRE_EQ(stats.lines, lines.size());
+    REQUIRE_EQ(stats.bytes, source.size());
+    REQUIRE_EQ(stats.threads, 4);
+    REQUIRE(decoded.instructions == expected.getProgram());
+    REQUIRE(decoded.sourceLines == expected.getSourceLines());
+    REQUIRE(decoded.labels == expected.getLabels());
+    REQUIRE_EQ(decoded.labels.at("DUP"), decoded.instructions.size() - 1);
+
+    std::string path = "source_loader_test.asm";
+    {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        REQUIRE(file != nullptr);
+        std::fwrite(source.data(), 1, source.size(), file);
+        std::fclose(file);
+    }
+    Emulator8086 loaded;
+    loaded.loadProgram(loadSourceFile(path));
+    std::remove(path.c_str());
+    REQUIRE(loaded.getProgram() == expected.getProgram());
+    REQUIRE(loaded.getLabels() == expected.getLabels());
+}
+
+TEST_CASE(ProgramImageCacheRoundTrip) {
+    namespace fs = std::filesystem;
+    std::string source = "start:\nMOV CX, 3\nloop1:\nDEC CX\nJNZ LOOP1 ; back\n\nHLT\n";
+    fs::path dir = "program_cache_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    std::string sourcePath = (dir / "prog.asm").string();
+    {
+        std::ofstream out(sourcePath, std::ios::binary);
+        out << source;
+    }
+
+    ProgramCache cache(dir.string());
+    bool hit = true;
+    SourceLoadStats stats;
+    std::shared_ptr<const Program> first = cache.load(sourcePath, &hit, &stats);
+    REQUIRE(!hit);
+    std::string imagePath = cache.imagePath(hashSource(source));
+    REQUIRE(fs::exists(imagePath));
+
+    ProgramImage image(imagePath);
+    REQUIRE_EQ(image.instructionCount(), 4);
+    REQUIRE(image.instruction(2) == "JNZ LOOP1 ");
+    REQUIRE_EQ(image.sourceLine(3), 7);
+    REQUIRE_EQ(image.getHeader().sourceLineCount, 7);
+    REQUIRE_EQ(image.getHeader().fusedCount, 1);
+
+    std::shared_ptr<const Program> second = cache.load(sourcePath, &hit, &stats);
+    REQUIRE(hit);
+    REQUIRE_EQ(stats.lines, 7);
+    REQUIRE(second->getLines() == first->getLines());
+    REQUIRE(second->getSourceLines() == first->getSourceLines());
+    REQUIRE(second->getLabels() == first->getLabels());
+    // The tables come back as stored rather than worked out again.
+    for (size_t i = 0; i < first->size(); ++i) {
+        const DecodedInstruction& a = first->getDecodedLines()[i];
+        const DecodedInstruction& b = second->getDecodedLines()[i];
+        REQUIRE(a.opcode == b.opcode);
+        REQUIRE(a.operands(first->getLines()[i]).size() ==
+                b.operands(second->getLines()[i]).size());
+        for (size_t k = 0; k < a.operandCount; ++k)
+            REQUIRE(a.operands(first->getLines()[i])[k] == b.operands(second->getLines()[i])[k]);
+        const FusedPair& x = first->getFusedPairs()[i];
+        const FusedPair& y = second->getFusedPairs()[i];
+        REQUIRE(x.first == y.first && x.second == y.second && x.target == y.target);
+        REQUIRE(x.dest.reg == y.dest.reg && x.dest.kind == y.dest.kind);
+    }
+    REQUIRE(first->getFusedPairs()[1].first == Opcode::Dec);
+    REQUIRE(second->getDeadFlags() == first->getDeadFlags());
+    REQUIRE(second->getFlagFlow().findDeadFlagWrites({}) == first->getDeadFlags());
+    Emulator8086 emu;
+    emu.loadProgram(second);
+    emu.run(100);
+    REQUIRE_EQ(emu.getRegisters().CX.x, 0);
+
+    // So is one whose tables point outside the program.
+    {
+        std::fstream out(imagePath, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(image.getHeader().decodedOffset);
+        out.put(char(0xFF));
+    }
+    cache.load(sourcePath, &hit);
+    REQUIRE(!hit);
+
+    // A damaged image is rejected and rebuilt.
+    fs::resize_file(imagePath, sizeof(ImageHeader) + 4);
+    bool threw = false;
+    try {
+        ProgramImage broken(imagePath);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+    cache.load(sourcePath, &hit);
+    REQUIRE(!hit);
+    cache.load(sourcePath, &hit);
+    REQUIRE(hit);
+    fs::remove_all(dir);
+}
+
+TEST_CASE(DosExecutableLoaders) {
+    Emulator8086 emu;
+    const std::string com("\xB8\x34\x12\xC3", 4);  // MOV AX, 1234h / RET
+    ExecutableInfo info = loadExecutable(emu, com, " /X");
+    REQUIRE(info.format == ExecutableFormat::Com);
+    const auto& memory = emu.getMemory();
+    const Registers& regs = emu.getRegisters();
+    size_t psp = size_t(kDefaultPspSegment) * 16;
+    REQUIRE_EQ(memory[psp], 0xCD);
+    REQUIRE_EQ(memory[psp + 1], 0x20);
+    REQUIRE_EQ(memory[psp + 0x80], 3);
+    REQUIRE_EQ(memory[psp + 0x84], 0x0D);
+    REQUIRE_EQ(memory[psp + 0x100], 0xB8);
+    REQUIRE_EQ(memory[psp + 0x103], 0xC3);
+    REQUIRE_EQ(regs.CS, kDefaultPspSegment);
+    REQUIRE_EQ(regs.SS, kDefaultPspSegment);
+    REQUIRE_EQ(regs.IP, 0x100);
+    REQUIRE_EQ(regs.SP, 0xFFFE);
+
+    // Two-paragraph header, one relocation at image offset 0002h, CS:IP = 0001:0000.
+    std::string exe(0x20 + 0x30, '\0');
+    auto put = [&exe](size_t at, uint16_t value) {
+        exe[at] = static_cast<char>(value & 0xFF);
+        exe[at + 1] = static_cast<char>(value >> 8);
+    };
+    exe[0] = 'M';
+    exe[1] = 'Z';
+    put(0x02, exe.size());
+    put(0x04, 1);
+    put(0x06, 1);
+    put(0x08, 2);
+    put(0x0E, 2);
+    put(0x10, 0x0100);
+    put(0x16, 1);
+    put(0x18, 0x1C);
+    put(0x1C, 0x0002);
+    put(0x1E, 0x0000);
+    put(0x20 + 0x02, 0x0003);  // Segment value to relocate.
+    exe[0x20 + 0x10] = static_cast<char>(0x90);
+    info = loadExecutable(emu, exe);
+    REQUIRE(info.format == ExecutableFormat::Mz);
+    REQUIRE_EQ(info.relocations, 1);
+    uint16_t load = kDefaultPspSegment + 0x10;
+    REQUIRE_EQ(info.loadSegment, load);
+    size_t base = size_t(load) * 16;
+    REQUIRE_EQ(memory[base + 2] | (memory[base + 3] << 8), load + 3);
+    REQUIRE_EQ(memory[base + 0x10], 0x90);
+    REQUIRE_EQ(regs.CS, load + 1);
+    REQUIRE_EQ(regs.IP, 0);
+    REQUIRE_EQ(regs.SS, load + 2);
+    REQUIRE_EQ(regs.SP, 0x0100);
+    REQUIRE_EQ(regs.DS, kDefaultPspSegment);
+
+    bool threw = false;
+    try {
+        loadExecutable(emu, exe.substr(0, 0x28));
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+    REQUIRE(isExecutablePath("GAME.EXE"));
+    REQUIRE(!isExecutablePath("prog.asm"));
+}
+
+TEST_CASE(InstructionTableLookupAndDecode) {
+    for (size_t i = 0; i < kOpcodeCount; ++i)
+        REQUIRE(lookupMnemonic(kInstructionTable[i].mnemonic) == static_cast<Opcode>(i));
+    REQUIRE(lookupMnemonic("mov") == Opcode::Mov);
+    REQUIRE(lookupMnemonic("JnZ") == Opcode::Jne);
+    REQUIRE(lookupMnemonic("xlatb") == Opcode::Xlat);
+    REQUIRE(lookupMnemonic("MOVE") == Opcode::Invalid);
+    REQUIRE(lookupMnemonic("MO") == Opcode::Invalid);
+    REQUIRE(lookupMnemonic("") == Opcode::Invalid);
+    static_assert(instructionInfo(Opcode::Adc).flagsRead == Registers::CF, "ADC reads CF");
+    REQUIRE(instructionInfo(Opcode::Jg).kind == InstructionKind::CondJump);
+
+    std::string line = "  add ax , [BX + SI+2]";
+    DecodedInstruction decoded = decodeInstruction(line);
+    REQUIRE(decoded.opcode == Opcode::Add);
+    Operands operands = decoded.operands(line);
+    REQUIRE_EQ(operands.size(), 2);
+    REQUIRE(operands[0] == "ax");
+    REQUIRE(operands[1] == "[BX + SI+2]");
+    REQUIRE(decodeInstruction("FOO AX").opcode == Opcode::Invalid);
+    REQUIRE(decodeInstruction("ESC 1,2,3,4,5").opcode == Opcode::Invalid);
+
+    auto countError = [](Opcode opcode, size_t count) {
+        try {
+            checkOperandCount(opcode, count);
+        } catch (const std::runtime_error& e) {
+            return std::string(e.what());
+        }
+        return std::string();
+    };
+    REQUIRE_EQ(countError(Opcode::Mov, 1), "MOV requires 2 operands");
+    REQUIRE_EQ(countError(Opcode::Cbw, 1), "CBW takes no operands");
+    REQUIRE_EQ(countError(Opcode::Repne, 0), "REPNE requires 1 string operation");
+    REQUIRE_EQ(countError(Opcode::Lock, 0), "LOCK requires an instruction to lock");
+    REQUIRE_EQ(countError(Opcode::Esc, 3), "");
+
+    std::ostringstream help;
+    writeInstructionHelp(help);
+    REQUIRE(help.str().find("  JNB/JAE/JNC addr   - Jump if not below") != std::string::npos);
+    REQUIRE(help.str().find("Flag Control Instructions:\n  CLC") != std::string::npos);
+}
+
+TEST_CASE(BulkRepMatchesElementLoop) {
+    struct Case {
+        const char* op;
+        uint16_t si, di, cx;
+        bool down;
+    };
+    const Case cases[] = {
+        {"MOVSB", 0x100, 0x200, 64, false},  {"MOVSB", 0x100, 0x101, 50, false},
+        {"MOVSB", 0x100, 0x103, 50, false},  {"MOVSB", 0x103, 0x100, 50, false},
+        {"MOVSB", 0x180, 0x17F, 50, true},   {"MOVSB", 0x180, 0x17D, 50, true},
+        {"MOVSB", 0x17D, 0x180, 50, true},   {"MOVSW", 0x100, 0x101, 30, false},
+        {"MOVSW", 0x100, 0x102, 30, false},  {"MOVSW", 0x100, 0x105, 30, false},
+        {"MOVSW", 0x180, 0x17E, 30, true},   {"MOVSW", 0x180, 0x17B, 30, true},
+        {"MOVSB", 0xFFF0, 0x300, 40, false}, {"MOVSW", 0x300, 0xFFFF, 3, false},
+        {"MOVSB", 0x0010, 0x300, 40, true},  {"STOSB", 0, 0x120, 77, false},
+        {"STOSW", 0, 0x121, 77, false},      {"STOSW", 0, 0x1F0, 60, true},
+        {"STOSB", 0, 0xFFF8, 20, false},     {"MOVSB", 0x100, 0x200, 0, false},
+    };
+    for (const Case& c : cases) {
+        Emulator8086 bulk;
+        Emulator8086 element;
+        for (Emulator8086* emu : {&bulk, &element}) {
+            auto& memory = emu->getMemory();
+            for (size_t i = 0; i < 0x10000; ++i)
+                memory[i] = static_cast<uint8_t>(i * 7 + (i >> 8));
+            Registers& regs = emu->getRegisters();
+            regs.SI = c.si;
+            regs.DI = c.di;
+            regs.CX.x = c.cx;
+            regs.AX.x = 0x5AA5;
+            if (c.down)
+                regs.FLAGS |= Registers::DF;
+            emu->loadProgram({std::string("REP ") + c.op});
+        }
+        bulk.run(1);
+        DirtyPageTracker tracker;  // Hooks force the one-element-at-a-time path.
+        element.run(tracker, 1);
+
+        const Registers& a = bulk.getRegisters();
+        const Registers& b = element.getRegisters();
+        REQUIRE_EQ(a.SI, b.SI);
+        REQUIRE_EQ(a.DI, b.DI);
+        REQUIRE_EQ(a.CX.x, b.CX.x);
+        REQUIRE(std::equal(bulk.getMemory().begin(), bulk.getMemory().begin() + 0x10001,
+                           element.getMemory().begin()));
+    }
+}
+
+TEST_CASE(BulkRepCompareMatchesElementLoop) {
+    struct Case {
+        const char* line;
+        uint16_t si, di, cx, ax;
+        bool down;
+        uint16_t copies[3][2];  // memory[to] = memory[from] before running, when to != 0.
+    };
+    const Case cases[] = {
+        {"REPE CMPSB", 0x1000, 0x5000, 1000, 0, false, {{0x52BC, 0x52BD}}},
+        {"REPE CMPSB", 0x1000, 0x5000, 1000, 0, false, {}},
+        {"REPE CMPSB", 0x1000, 0x5000, 1000, 0, true, {{0x4E00, 0x4E01}}},
+        {"REPE CMPSW", 0x1000, 0x5000, 100, 0, false, {{0x504B, 0x504C}}},
+        {"REPE CMPSW", 0x1800, 0x5800, 900, 0, true, {{0x5607, 0x5608}}},
+        {"REPNE CMPSB", 0x1001, 0x5000, 2000, 0, false, {{0x55DC, 0x15DD}}},
+        {"REPNE CMPSB", 0x1001, 0x5000, 2000, 0, true, {{0x5123, 0x1124}}},
+        {"REPNE CMPSW", 0x1001, 0x5000, 500, 0, false,
+         {{0x5064, 0x1065}, {0x5258, 0x1259}, {0x5259, 0x125A}}},
+        {"REPNE CMPSW", 0x1401, 0x5400, 500, 0, true, {{0x5065, 0x1066}}},
+        {"REPNE SCASB", 0, 0x2000, 3000, 0x41, false, {}},
+        {"REPNE SCASB", 0, 0x2FFF, 1001, 0x41, true, {}},
+        {"REPNE SCASW", 0, 0x2000, 2000, 0x4241, false, {}},
+        {"REPNE SCASW", 0, 0x2001, 2000, 0x4241, false, {}},
+        {"REPNE SCASW", 0, 0x2FFF, 1001, 0x4241, true, {}},
+        {"REPE SCASW", 0, 0x8000, 2000, 0x4141, false, {{0x84D2, 0}}},
+        {"REPE SCASB", 0, 0x8FFF, 3001, 0x41, true, {}},
+        {"REPE SCASB", 0, 0xFFF0, 40, 0xF0, false, {}},
+        {"REPNE SCASB", 0, 0x0010, 40, 0xFF, true, {}},
+        {"REPNE SCASW", 0, 0x2000, 0, 0x4241, false, {}},
+    };
+    for (const Case& c : cases) {
+        Emulator8086 bulk;
+        Emulator8086 element;
+        for (Emulator8086* emu : {&bulk, &element}) {
+            auto& memory = emu->getMemory();
+            for (size_t i = 0; i < 0x10000; ++i)
+                memory[i] = static_cast<uint8_t>(i >= 0x8000 && i < 0x9000 ? 0x41 : i);
+            for (const auto& copy : c.copies) {
+                if (copy[0])
+                    memory[copy[0]] = memory[copy[1]];
+            }
+            Registers& regs = emu->getRegisters();
+            regs.SI = c.si;
+            regs.DI = c.di;
+            regs.CX.x = c.cx;
+            regs.AX.x = c.ax;
+            if (c.down)
+                regs.FLAGS |= Registers::DF;
+            emu->loadProgram({c.line});
+        }
+        bulk.run(1);
+        DirtyPageTracker tracker;
+        element.run(tracker, 1);
+
+        const Registers& a = bulk.getRegisters();
+        const Registers& b = element.getRegisters();
+        REQUIRE_EQ(a.SI, b.SI);
+        REQUIRE_EQ(a.DI, b.DI);
+        REQUIRE_EQ(a.CX.x, b.CX.x);
+        REQUIRE_EQ(a.FLAGS, b.FLAGS);
+    }
+}
+
+struct RetireCounter : NullInstrumentation {
+    static constexpr bool kRetire = true;
+    size_t retired = 0;
+    uint16_t firstCX = 0;
+    void onRetire(size_t line, const Registers& before, const Registers&) {
+        ++retired;
+        if (line == 1)
+            firstCX = before.CX.x;
+    }
+};
+
+TEST_CASE(RepSuspendsBetweenChunksAndResumes) {
+    Emulator8086 emu;
+    emu.loadProgram({"MOV CX, 0FFFFh", "REP STOSB", "HLT"});
+    emu.getRegisters().AX.x = 0x77;
+    emu.setBreakpoint(1, true);
+    REQUIRE_EQ(emu.run(10), 1);
+    REQUIRE(emu.getStopReason() == Emulator8086::StopReason::Breakpoint);
+
+    // Each chunk is a step that retires nothing; IP stays on the REP while iterations are
+    // left, and the breakpoint on its line does not stop it again.
+    RetireCounter counter;
+    REQUIRE_EQ(emu.run(counter, 1), 0);
+    REQUIRE_EQ(emu.getIP(), 1);
+    uint16_t left = emu.getRegisters().CX.x;
+    REQUIRE(left > 0 && left < 0xFFFF);
+    REQUIRE_EQ(emu.getRegisters().DI, 0xFFFF - left);
+    REQUIRE_EQ(counter.retired, 0);
+    REQUIRE_EQ(emu.run(counter, 1000), 2);
+    REQUIRE_EQ(emu.getRegisters().CX.x, 0);
+    REQUIRE_EQ(emu.getRegisters().DI, 0xFFFF);
+    REQUIRE_EQ(emu.getMemory()[0xFFFE], 0x77);
+    REQUIRE_EQ(counter.retired, 2);  // The REP once, with its starting CX, then HLT.
+    REQUIRE_EQ(counter.firstCX, 0xFFFF);
+
+    // A watchpoint stops the element loop right after the iteration that hit it.
+    Emulator8086 watched;
+    watched.loadProgram({"MOV CX, 100", "MOV DI, 200h", "REPNE SCASB", "HLT"});
+    watched.getRegisters().AX.x = 0xFF;
+    watched.addWatchpoint(0x20A, 1, true, false);
+    watched.run(100);
+    REQUIRE(watched.getStopReason() == Emulator8086::StopReason::Watchpoint);
+    REQUIRE_EQ(watched.getIP(), 2);
+    REQUIRE_EQ(watched.getRegisters().CX.x, 89);
+    REQUIRE_EQ(watched.getRegisters().DI, 0x20B);
+    watched.clearWatchpoints();
+    watched.run(100);
+    REQUIRE_EQ(watched.getRegisters().CX.x, 0);
+    REQUIRE_EQ(watched.getRegisters().DI, 0x264);
+
+    // Typed instructions have nowhere to resume, so they run every chunk.
+    Emulator8086 typed;
+    typed.getRegisters().CX.x = 0x9000;
+    typed.executeInstruction("REP STOSW");
+    REQUIRE_EQ(typed.getRegisters().CX.x, 0);
+    REQUIRE_EQ(typed.getRegisters().DI, 0x2000);
+}
+
+TEST_CASE(FusedPairsMatchUnfusedExecution) {
+    const std::vector<std::string> program = {
+        "MOV CX, 300", "MOV BX, 0", "top:", "MOV AL, CL", "AND AL, 7", "CMP AL, 3", "JNE skip",
+        "ADD BX, 5", "skip:", "TEST CL, 1", "JZ even", "SUB BX, 1", "even:", "MOV DX, BX",
+        "MOV ah, 12h", "DEC DX", "JNS pos", "INC BX", "pos:", "CMP BX, 1000", "JA done",
+        "mov si, [100h]", "ADD DI, CX", "LOOP top", "done:", "HLT"};
+
+    Emulator8086 fused;
+    Emulator8086 plain;
+    fused.setJitEnabled(false);
+    plain.setJitEnabled(false);
+    plain.setFusionCandidates(FusionCandidates::none());
+    fused.loadProgram(program);
+    plain.loadProgram(program);
+    const auto& pairs = fused.getFusedPairs();
+    REQUIRE(plain.getFusedPairs().empty());
+    REQUIRE(pairs[0].first == Opcode::Mov && pairs[0].second == Opcode::Mov);
+    REQUIRE(pairs[4].first == Opcode::Cmp && pairs[4].second == Opcode::Jne);
+    REQUIRE(pairs[12].first == Opcode::Dec && pairs[12].second == Opcode::Jns);
+    REQUIRE(pairs[18].first == Opcode::Add && pairs[18].second == Opcode::Loop);
+    REQUIRE(pairs[3].first == Opcode::Invalid);   // AND is not a first half.
+    REQUIRE(pairs[17].first == Opcode::Invalid);  // Memory operand.
+
+    REQUIRE_EQ(fused.run(100000), plain.run(100000));
+    const Registers& a = fused.getRegisters();
+    const Registers& b = plain.getRegisters();
+    REQUIRE_EQ(a.AX.x, b.AX.x);
+    REQUIRE_EQ(a.BX.x, b.BX.x);
+    REQUIRE_EQ(a.CX.x, b.CX.x);
+    REQUIRE_EQ(a.DX.x, b.DX.x);
+    REQUIRE_EQ(a.SI, b.SI);
+    REQUIRE_EQ(a.DI, b.DI);
+    REQUIRE_EQ(a.IP, b.IP);
+    REQUIRE_EQ(a.FLAGS, b.FLAGS);
+
+    // Single steps and breakpoints still see every instruction boundary.
+    Emulator8086 stepped;
+    stepped.loadProgram(program);
+    REQUIRE_EQ(stepped.run(4), 4);
+    REQUIRE_EQ(stepped.run(1), 1);
+    REQUIRE_EQ(stepped.getIP(), 5);
+    Emulator8086 stopped;
+    stopped.loadProgram(program);
+    stopped.setBreakpoint(5, true);
+    REQUIRE_EQ(stopped.run(100), 5);
+    REQUIRE(stopped.getStopReason() == Emulator8086::StopReason::Breakpoint);
+
+    std::istringstream profile("# pair counts\nCMP JNE 50\nDEC JNZ 900\n\nMOV MOV 10\n");
+    FusionCandidates top = FusionCandidates::parse(profile, 2);
+    REQUIRE_EQ(top.count(), 2);
+    REQUIRE(top.allows(Opcode::Dec, Opcode::Jne));
+    REQUIRE(!top.allows(Opcode::Mov, Opcode::Mov));
+}
+
+TEST_CASE(OpcodeProfileCountsNgramsModesAndWidths) {
+    Emulator8086 emu;
+    emu.loadProgram({"MOV CX, 3", "top:", "MOV AL, [BX + SI + 2]", "CMP AL, 10h", "JNE skip",
+                     "INC DX", "skip:", "DEC CX", "JNZ top", "HLT"});
+    OpcodeProfile profile;
+    profile.attach(emu.getProgram());
+    OpcodeProfileInstrumentation policy(profile);
+    size_t retired = emu.run(policy, 1000);
+
+    REQUIRE_EQ(profile.getTotal(), retired);
+    REQUIRE_EQ(profile.count(Opcode::Cmp), 3);
+    REQUIRE_EQ(profile.count(Opcode::Cmp, Opcode::Jne), 3);
+    REQUIRE_EQ(profile.count(Opcode::Dec, Opcode::Jne), 3);
+    REQUIRE_EQ(profile.count(Opcode::Mov, Opcode::Cmp, Opcode::Jne), 3);
+    REQUIRE_EQ(profile.count(Opcode::Jne, Opcode::Mov), 2);  // Back edges into the loop.
+    REQUIRE_EQ(profile.modeCount(Opcode::Mov, OpcodeProfile::Mode::BasedIndexedOffset), 3);
+    REQUIRE_EQ(profile.modeCount(Opcode::Cmp, OpcodeProfile::Mode::Immediate), 3);
+    REQUIRE_EQ(profile.widthCount(OpcodeProfile::Width::Byte), 6);  // MOV AL and CMP AL.
+    REQUIRE(OpcodeProfile::classifyOperand("[di]") == OpcodeProfile::Mode::RegisterIndirect);
+    REQUIRE(OpcodeProfile::classifyOperand("[BP - 4]") == OpcodeProfile::Mode::Based);
+    REQUIRE(OpcodeProfile::classifyOperand("[100h]") == OpcodeProfile::Mode::Direct);
+
+    // The data file feeds the fusion stage directly.
+    std::stringstream data;
+    profile.writeData(data);
+    FusionCandidates top = FusionCandidates::parse(data, 2);
+    REQUIRE_EQ(top.count(), 2);
+    REQUIRE(top.allows(Opcode::Cmp, Opcode::Jne));
+    REQUIRE(top.allows(Opcode::Dec, Opcode::Jne));
+
+    // A second program adds to the counts without joining n-grams across programs.
+    Emulator8086 next;
+    next.loadProgram({"INC AX", "INC AX"});
+    profile.attach(next.getProgram());
+    next.run(policy, 10);
+    REQUIRE_EQ(profile.count(Opcode::Inc, Opcode::Inc), 1);
+    REQUIRE_EQ(profile.count(Opcode::Hlt, Opcode::Inc), 0);
+}
+
+TEST_CASE(TranslatedBlocksMatchInterpreter) {
+    const std::vector<std::string> program = {
+        "MOV CX, 400", "MOV BX, 0100h", "top:", "MOV AL, CL", "AND AL, 7", "CMP AL, 3",
+        "JNE skip", "ADD BX, 5", "skip:", "NEG DX", "XOR dh, BL", "SUB BP, 3", "JL neg",
+        "NOT SI", "neg:", "OR AH, 80h", "TEST CL, 1", "JZ even", "mov [bx + 2], ax",
+        "even:", "INC DI", "DEC BL", "JBE low", "ADD SP, CX", "low:", "CMP BX, 0FF0h", "JG done",
+        "LOOPNZ top", "JCXZ done", "JMP top", "done:", "HLT"};
+
+    Emulator8086 jit;
+    Emulator8086 plain;
+    plain.setJitEnabled(false);
+    plain.setFusionCandidates(FusionCandidates::none());
+    jit.loadProgram(program);
+    plain.loadProgram(program);
+    REQUIRE(jit.isJitEnabled() == Jit::isSupported());
+    REQUIRE(!plain.isJitEnabled());
+
+    // Odd budgets end runs inside blocks, which then hand over to the interpreter.
+    for (size_t budget : {7, 100, 33, 1, 2000, 61, 5000}) {
+        REQUIRE_EQ(jit.run(budget), plain.run(budget));
+        const Registers& a = jit.getRegisters();
+        const Registers& b = plain.getRegisters();
+        REQUIRE_EQ(a.AX.x, b.AX.x);
+        REQUIRE_EQ(a.BX.x, b.BX.x);
+        REQUIRE_EQ(a.CX.x, b.CX.x);
+        REQUIRE_EQ(a.DX.x, b.DX.x);
+        REQUIRE_EQ(a.SI, b.SI);
+        REQUIRE_EQ(a.DI, b.DI);
+        REQUIRE_EQ(a.BP, b.BP);
+        REQUIRE_EQ(a.SP, b.SP);
+        REQUIRE_EQ(a.IP, b.IP);
+        REQUIRE_EQ(a.FLAGS, b.FLAGS);
+    }
+    REQUIRE(jit.getMemory() == plain.getMemory());
+    if (Jit::isSupported())
+        REQUIRE(jit.getJit()->blockCount() > 0);
+
+    // A breakpoint set on a translated line drops the translations and is honoured.
+    jit.loadProgram(program);
+    jit.run(3000);
+    jit.setBreakpoint(17, true);  // DEC BL
+    jit.run(100000);
+    REQUIRE(jit.getStopReason() == Emulator8086::StopReason::Breakpoint);
+    REQUIRE_EQ(jit.getIP(), 17);
+}
+
+TEST_CASE(DeadFlagWritesAreSkippedWithoutChangingResults) {
+    const std::vector<std::string> program = {
+        "MOV CX, 500", "MOV BX, 1", "top:", "ADD AX, CX", "XOR DX, AX", "DEC CX", "JNZ top",
+        "CMP AX, BX", "PUSHF", "ADD BX, 1", "ADD BX, [SI]"};
+
+    Emulator8086 plain;
+    plain.setJitEnabled(false);
+    plain.setFusionCandidates(FusionCandidates::none());
+    plain.setFlagLivenessEnabled(false);
+    plain.loadProgram(program);
+    REQUIRE(plain.getDeadFlags().empty());
+
+    Emulator8086 interpreted;
+    interpreted.setJitEnabled(false);
+    interpreted.setFusionCandidates(FusionCandidates::none());
+    interpreted.loadProgram(program);
+    const uint16_t szp = Registers::SF | Registers::ZF | Registers::PF;
+    const auto& dead = interpreted.getDeadFlags();
+    REQUIRE_EQ(dead.size(), interpreted.getProgram().size());
+    REQUIRE_EQ(dead[2], szp | Registers::CF);  // DEC sets SZP, ADD or CMP then CF too.
+    REQUIRE_EQ(dead[3], szp);
+    REQUIRE_EQ(dead[4], Registers::SF | Registers::PF);  // JNZ reads ZF.
+    REQUIRE_EQ(dead[6], 0);                              // PUSHF reads them all.
+    REQUIRE_EQ(dead[8], 0);  // ADD with a memory operand can fail before setting flags.
+    REQUIRE_EQ(dead[9], 0);  // The end of the program shows every flag.
+
+    Emulator8086 fast;
+    fast.loadProgram(program);
+    for (size_t budget : {7, 100, 33, 1, 2000, 17, 5000}) {
+        size_t ran = plain.run(budget);
+        for (Emulator8086* emu : {&interpreted, &fast}) {
+            REQUIRE_EQ(emu->run(budget), ran);
+            const Registers& a = emu->getRegisters();
+            const Registers& b = plain.getRegisters();
+            REQUIRE_EQ(a.AX.x, b.AX.x);
+            REQUIRE_EQ(a.BX.x, b.BX.x);
+            REQUIRE_EQ(a.CX.x, b.CX.x);
+            REQUIRE_EQ(a.DX.x, b.DX.x);
+            REQUIRE_EQ(a.IP, b.IP);
+            REQUIRE_EQ(a.FLAGS, b.FLAGS);
+        }
+    }
+    REQUIRE(fast.getMemory() == plain.getMemory());
+
+    // A run can stop at a breakpoint, so flags are live there.
+    interpreted.setBreakpoint(3, true);
+    REQUIRE_EQ(interpreted.getDeadFlags()[2], 0);
+    interpreted.clearBreakpoints();
+    interpreted.addWatchpoint(0x200, 2, false, true);
+    REQUIRE(interpreted.getDeadFlags().empty());
+}
+
+TEST_CASE(BreakpointsOnlyRecomputeLinesThatReachThem) {
+    std::vector<std::string> program = {"MOV CX, 2000", "first:", "ADD AX, CX", "XOR DX, AX",
+                                        "DEC CX", "JNZ first"};
+    for (int i = 0; i < 40; ++i)
+        program.push_back("MOV SI, " + std::to_string(i));
+    program.insert(program.end(), {"MOV CX, 2000", "second:", "ADD BX, CX", "SUB DX, BX",
+                                   "DEC CX", "JNZ second", "NOP"});
+    Emulator8086 emu;
+    emu.loadProgram(program);
+    const size_t secondAdd = 46;
+    REQUIRE(emu.getProgram()[secondAdd] == "ADD BX, CX");
+    const FlagFlowGraph& flow = emu.getSharedProgram()->getFlagFlow();
+
+    // Only the second loop and the straight line just before it can reach its ADD in time.
+    std::vector<size_t> reaching = flow.linesReaching(secondAdd);
+    REQUIRE_EQ(*std::min_element(reaching.begin(), reaching.end()), secondAdd - 16);
+    REQUIRE(std::find(reaching.begin(), reaching.end(), 4) == reaching.end());
+
+    emu.run(20000);
+    size_t translated = emu.getJit() ? emu.getJit()->blockCount() : 0;
+    emu.setBreakpoint(secondAdd, true);
+    REQUIRE(emu.getDeadFlags() == flow.findDeadFlagWrites({secondAdd}));
+    if (Jit::isSupported()) {
+        // The first loop's block stays; the second's went with the breakpoint.
+        REQUIRE(translated >= 2);
+        REQUIRE(emu.getJit()->blockCount() < translated);
+        REQUIRE(emu.getJit()->blockCount() > 0);
+    }
+    emu.setBreakpoint(3, true);
+    REQUIRE(emu.getDeadFlags() == flow.findDeadFlagWrites(emu.getBreakpoints()));
+    emu.setBreakpoint(3, false);
+    REQUIRE(emu.getDeadFlags() == flow.findDeadFlagWrites({secondAdd}));
+    emu.reset();
+    emu.run(20000);
+    REQUIRE(emu.getStopReason() == Emulator8086::StopReason::Breakpoint);
+    REQUIRE_EQ(emu.getIP(), secondAdd);
+    REQUIRE_EQ(emu.getRegisters().CX.x, 2000);
+
+    emu.clearBreakpoints();
+    REQUIRE(&emu.getDeadFlags() == &emu.getSharedProgram()->getDeadFlags());
+    emu.run(20000);
+    Emulator8086 plain;
+    plain.setJitEnabled(false);
+    plain.setFlagLivenessEnabled(false);
+    plain.loadProgram(program);
+    plain.run(20000);
+    REQUIRE_EQ(emu.getRegisters().AX.x, plain.getRegisters().AX.x);
+    REQUIRE_EQ(emu.getRegisters().BX.x, plain.getRegisters().BX.x);
+    REQUIRE_EQ(emu.getRegisters().DX.x, plain.getRegisters().DX.x);
+    REQUIRE_EQ(emu.getRegisters().FLAGS, plain.getRegisters().FLAGS);
+}
+
+TEST_CASE(EmulatorsShareOneImmutableProgram) {
+    std::shared_ptr<const Program> program =
+        Program::create(decodeSource("top:\nADD AX, CX\nDEC CX\nJNZ top\nMOV [200h], AX\n"));
+    REQUIRE_EQ(program->size(), 4);
+
+    // One program, many inputs, each run on its own thread with its own registers and memory.
+    std::vector<uint16_t> sums(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < sums.size(); ++i) {
+        threads.emplace_back([&sums, &program, i] {
+            Emulator8086 emu;
+            emu.loadProgram(program);
+            emu.getRegisters().CX.x = static_cast<uint16_t>(100 + i);
+            emu.run(100000);
+            sums[i] = emu.readMemoryWord(0x200);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (size_t i = 0; i < sums.size(); ++i)
+        REQUIRE_EQ(sums[i], (100 + i) * (101 + i) / 2);
+
+    Emulator8086 emu;
+    emu.loadProgram(program);
+    REQUIRE(emu.getSharedProgram() == program);
+    REQUIRE(&emu.getProgram() == &program->getLines());
+    REQUIRE(&emu.getFusedPairs() == &program->getFusedPairs());
+    REQUIRE(&emu.getDeadFlags() == &program->getDeadFlags());
+
+    // Settings other than the defaults give the emulator its own fused pairs and dead flags.
+    emu.setFusionCandidates(FusionCandidates::none());
+    emu.setBreakpoint(1, true);
+    REQUIRE(emu.getFusedPairs().empty());
+    REQUIRE(!program->getFusedPairs().empty());
+    REQUIRE_EQ(emu.getDeadFlags()[0], 0);  // ADD before the breakpoint.
+    REQUIRE(program->getDeadFlags()[0] != 0);
+}
+
+TEST_CASE(GuestMemoryOnlyKeepsWrittenPages) {
+    Emulator8086 emu;
+    GuestMemory& memory = emu.getMemory();
+    REQUIRE_EQ(memory.size(), 1024 * 1024);
+    REQUIRE_EQ(memory[0xFFFFF], 0);
+    emu.loadProgram({"MOV AX, 1234h", "MOV [0200h], AX", "MOV [9000h], AL"});
+    emu.run(10);
+    REQUIRE_EQ(emu.readMemoryWord(0x200), 0x1234);
+    REQUIRE_EQ(memory[0x9000], 0x34);
+#if defined(__linux__)
+    // Two pages written; the ones only read stay on the shared zero page.
+    REQUIRE(memory.residentBytes() > 0);
+    REQUIRE(memory.residentBytes() <= 2 * 16384);
+#endif
+
+    emu.reset();
+    REQUIRE_EQ(memory[0x200], 0);
+    REQUIRE_EQ(memory[0x9000], 0);
+#if defined(__linux__)
+    REQUIRE_EQ(memory.residentBytes(), 0);
+#endif
+    Emulator8086 fresh;
+    REQUIRE(memory == fresh.getMemory());
+}
+
+TEST_CASE(AotTranslationWritesRegisterCodeAndInterpretsTheRest) {
+    DecodedProgram program = decodeSource(
+        "MOV CX, 3\ntop:\nADD AX, [BX]\nDEC CX\nsame:\nJNE same\nLOOP top\nJMP done\n"
+        "done:\n");
+    std::ostringstream out;
+    AotStats stats = writeAotProgram(out, program, "aot_test", true);
+    REQUIRE_EQ(stats.lines, 6);
+    REQUIRE_EQ(stats.translated, 4);  // The memory operand and the jump to itself are not.
+
+    std::string source = out.str();
+    REQUIRE(source.find("const AotProgram aot_test = {") != std::string::npos);
+    REQUIRE(source.find("return aotMain(aot_test, argc, argv);") != std::string::npos);
+    REQUIRE(source.find("if (--regs.CX.x != 0)\n        goto L1;") != std::string::npos);
+    REQUIRE(source.find("goto L6;") != std::string::npos);
+    REQUIRE(source.find("L1:  // ADD AX, [BX]\n    if (steps == maxSteps) {\n        regs.IP = 1;"
+                        "\n        return steps;\n    }\n    regs.IP = 1;\n"
+                        "    steps += emu.run(policy, 1);") != std::string::npos);
+    REQUIRE(source.find("{\"TOP\", 1},") != std::string::npos);
+
+    REQUIRE_EQ(aotProgramName("samples/loop-2.asm"), std::string("aot_loop_2"));
+    bool threw = false;
+    try {
+        writeAotProgram(out, program, "2fast", false);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    REQUIRE(threw);
+}
+
+namespace {
+
+const std::vector<std::string> kAllocationLoop = {
+    "MOV CX, 500", "MOV BX, 100h", "top:", "ADD AX, [BX + SI + 2]", "mov [bx+di], ax",
+    "INC SI", "XOR DX, DX", "CMP AL, 10h", "PUSH AX", "POP DX", "CALL sub", "LOOP TOP", "HLT",
+    "sub:", "SHL DX, 1", "RET"};
+
+size_t countSteadyStateAllocations(Emulator8086& emu) {
+    emu.loadProgram(kAllocationLoop);
+    emu.run(500);  // Let one-time setup, translation included, happen before counting.
+
+    allocationCount = 0;
+    countAllocations = true;
+    size_t retired = emu.run(2000);
+    countAllocations = false;
+    REQUIRE_EQ(retired, 2000);
+    return allocationCount.load();
+}
+
+}  // namespace
+
+TEST_CASE(SteadyStateExecutionDoesNotAllocate) {
+    Emulator8086 emu;
+    emu.setJitEnabled(false);
+    emu.setFusionCandidates(FusionCandidates::none());
+    REQUIRE_EQ(countSteadyStateAllocations(emu), 0);
+}
+
+TEST_CASE(SteadyStateTranslatedExecutionDoesNotAllocate) {
+    Emulator8086 emu;
+    REQUIRE_EQ(countSteadyStateAllocations(emu), 0);
+    if (emu.getJit())
+        REQUIRE(emu.getJit()->blockCount() > 0);
+}
+
 int main() {
     return TestFramework::instance().runAll();
 }
@@ -0,0 +1,68 @@
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "aot.h"
+
+namespace {
+
+void printUsage(const char* argv0) {
+    std::cout << "Usage: " << argv0 << " <program.asm> [-o out.cpp] [--name NAME] [--main]\n"
+              << "\nWrites the program as a C++ translation unit that defines\n"
+              << "`const AotProgram NAME` (default: aot_ and the file name). Compile it with\n"
+              << "the core sources; --main adds a main() that runs the program, times it\n"
+              << "with --repeat N or checks it against the interpreter with --lockstep.\n";
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string input;
+    std::string output;
+    std::string name;
+    bool withMain = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-o" && hasValue) {
+            output = argv[++i];
+        } else if (arg == "--name" && hasValue) {
+            name = argv[++i];
+        } else if (arg == "--main") {
+            withMain = true;
+        } else if (arg == "--help" || arg[0] == '-' || !input.empty()) {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 2;
+        } else {
+            input = arg;
+        }
+    }
+    if (input.empty()) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    if (name.empty())
+        name = aotProgramName(input);
+
+    std::ostringstream source;
+    AotStats stats;
+    try {
+        stats = writeAotProgram(source, loadSourceFile(input), name, withMain);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    if (output.empty()) {
+        std::cout << source.str();
+    } else {
+        std::ofstream out(output);
+        if (!(out << source.str())) {
+            std::cerr << "Cannot write " << output << "\n";
+            return 1;
+        }
+    }
+    std::cerr << name << ": " << stats.translated << " of " << stats.lines
+              << " lines translated, the rest run in the interpreter\n";
+    return 0;
+}
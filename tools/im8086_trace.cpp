@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "emulator8086.h"
+#include "trace.h"
+
+namespace {
+
+void printUsage(const char* argv0) {
+    std::cout << "Usage:\n"
+              << "  " << argv0 << " record <program.asm> <out.trace> [--max N]\n"
+              << "  " << argv0 << " print <trace> [--from N] [--count N] [--op MNEMONIC]\n"
+              << "        [--line A[-B]] [--writes ADDR]\n"
+              << "  " << argv0 << " diff <a.trace> <b.trace>\n"
+              << "\nNumbers accept a trailing 'h' for hex. diff exits with 1 at the first\n"
+              << "divergent instruction and prints both records and the differing state.\n";
+}
+
+uint64_t parseNumber(const std::string& text) {
+    if (!text.empty() && (text.back() == 'h' || text.back() == 'H'))
+        return std::stoull(text.substr(0, text.size() - 1), nullptr, 16);
+    return std::stoull(text, nullptr, 0);
+}
+
+int record(int argc, char** argv) {
+    if (argc < 4) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    size_t maxSteps = 10000000;
+    for (int i = 4; i + 1 < argc; i += 2) {
+        if (std::string(argv[i]) == "--max")
+            maxSteps = parseNumber(argv[i + 1]);
+    }
+
+    Emulator8086 emu;
+    SourceLoadStats stats;
+    try {
+        emu.loadProgram(loadSourceFile(argv[2], SourceLoadOptions(), &stats));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    std::cerr << "Loaded " << stats.summary() << "\n";
+    TraceWriter writer(argv[3], emu.getProgram(), emu.getRegisters());
+    TraceInstrumentation policy(writer);
+    size_t steps = emu.run(policy, maxSteps);
+    writer.close();
+    std::cerr << "Recorded " << steps << " instructions to " << argv[3] << "\n";
+    return 0;
+}
+
+int print(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    uint64_t from = 0;
+    uint64_t count = UINT64_MAX;
+    std::string op;
+    size_t lineFirst = 0;
+    size_t lineLast = SIZE_MAX;
+    bool filterWrites = false;
+    uint16_t writeAddress = 0;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--from") {
+            from = parseNumber(value);
+        } else if (flag == "--count") {
+            count = parseNumber(value);
+        } else if (flag == "--op") {
+            op = value;
+            std::transform(op.begin(), op.end(), op.begin(), ::toupper);
+        } else if (flag == "--line") {
+            auto dash = value.find('-');
+            lineFirst = parseNumber(value.substr(0, dash));
+            lineLast = dash == std::string::npos ? lineFirst : parseNumber(value.substr(dash + 1));
+        } else if (flag == "--writes") {
+            filterWrites = true;
+            writeAddress = static_cast<uint16_t>(parseNumber(value));
+        } else {
+            std::cerr << "Unknown option: " << flag << "\n";
+            return 2;
+        }
+    }
+
+    TraceReader reader(argv[2]);
+    TraceRecord rec;
+    uint64_t printed = 0;
+    while (printed < count && reader.next(rec)) {
+        if (rec.index < from)
+            continue;
+        if (!op.empty() && reader.mnemonic(rec) != op)
+            continue;
+        if (rec.line < lineFirst || rec.line > lineLast)
+            continue;
+        if (filterWrites && std::none_of(rec.writes.begin(), rec.writes.end(), [&](const auto& w) {
+                return w.address == writeAddress || (!w.isByte && w.address + 1 == writeAddress);
+            }))
+            continue;
+        std::cout << formatTraceRecord(reader, rec) << "\n";
+        ++printed;
+    }
+    return 0;
+}
+
+int diff(int argc, char** argv) {
+    if (argc < 4) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    TraceReader left(argv[2]);
+    TraceReader right(argv[3]);
+    TraceDivergence result = findFirstDivergence(left, right);
+    if (!result.diverged) {
+        std::cout << "Traces match (" << result.index << " instructions)\n";
+        return 0;
+    }
+
+    std::cout << "First divergence at instruction #" << result.index << "\n";
+    if (!result.leftEnded)
+        std::cout << "  < " << formatTraceRecord(left, result.left) << "\n";
+    if (!result.rightEnded)
+        std::cout << "  > " << formatTraceRecord(right, result.right) << "\n";
+    for (const auto& difference : result.differences)
+        std::cout << "    " << difference << "\n";
+    return 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage(argv[0]);
+        return 2;
+    }
+    std::string command = argv[1];
+    try {
+        if (command == "record")
+            return record(argc, argv);
+        if (command == "print")
+            return print(argc, argv);
+        if (command == "diff")
+            return diff(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << "im8086-trace: " << e.what() << "\n";
+        return 1;
+    }
+    printUsage(argv[0]);
+    return 2;
+}